@@ -3,6 +3,7 @@ inc_main := 1
 
 include $(IMAGINE_PATH)/make/imagineAppBase.mk
 
+emuFramework_libraryIndex := 1
 include $(EMUFRAMEWORK_PATH)/common.mk
 
 CPPFLAGS += -DHAVE_INTTYPES -DBSPF_UNIX -DTHUMB_SUPPORT \
@@ -28,6 +28,9 @@
 #include "ImagineSound.hh"
 #include <unzip.h>
 #include <EmuSystem.hh>
+#ifdef CONFIG_EMUFRAMEWORK_LIBRARY_INDEX
+#include <LibraryIndex.hh>
+#endif
 #include <CommonFrameworkIncludes.hh>
 #include "CommonGui.hh"
 
@@ -231,7 +234,7 @@ uint EmuSystem::multiresVideoBaseX() { return 0; }
 uint EmuSystem::multiresVideoBaseY() { return 0; }
 bool touchControlsApplicable() { return 1; }
 
-static bool openROM(uchar buff[MAX_ROM_SIZE], const char *path, uint32& size)
+static bool openROM(uchar buff[MAX_ROM_SIZE], const char *path, uint32& size, FsSys::cPath &member)
 {
 	if(string_hasDotExtension(path, "zip"))
 	{
@@ -258,6 +261,7 @@ static bool openROM(uchar buff[MAX_ROM_SIZE], const char *path, uint32& size)
 
 			if(isVCSRomExtension(name))
 			{
+				string_copy(member, name);
 				foundRom = 1;
 				break;
 			}
@@ -300,9 +304,9 @@ static bool openROM(uchar buff[MAX_ROM_SIZE], const char *path, uint32& size)
 	}
 }
 
-static int loadGameCommon(const uint8 *buff, uint size)
+static int loadGameCommon(const uint8 *buff, uint size, const char *cachedMD5 = nullptr)
 {
-	string md5 = MD5(buff, size);
+	string md5 = cachedMD5 ? cachedMD5 : MD5(buff, size);
 	osystem.propSet().getMD5(md5, currGameProps);
 	string romType = currGameProps.get(Cartridge_Type);
 	string cartId;
@@ -336,11 +340,22 @@ int EmuSystem::loadGame(const char *path)
 	setupGamePaths(path);
 	uint8 buff[MAX_ROM_SIZE];
 	uint32 size;
-	if(!openROM(buff, path, size))
+	FsSys::cPath member {0};
+	if(!openROM(buff, path, size, member))
 	{
 		popup.post("Error loading game", 1);
 		return 0;
 	}
+	#ifdef CONFIG_EMUFRAMEWORK_LIBRARY_INDEX
+	LibraryEntry entry;
+	if(libraryIndex.find(path, strlen(member) ? member : nullptr, entry) && entry.size == size)
+	{
+		char md5[33];
+		LibraryIndex::md5ToStr(entry.md5, md5);
+		logMsg("using indexed MD5 %s", md5);
+		return loadGameCommon(buff, size, md5);
+	}
+	#endif
 	return loadGameCommon(buff, size);
 }
 
@@ -66,6 +66,10 @@ extern "C"
 }
 
 const char *creditsViewStr = CREDITS_INFO_STRING "(c) 2013-2014\nRobert Broglia\nwww.explusalpha.com\n\nPortions (c) the\nVice Team\nwww.viceteam.org";
+// VICE's maincpu_mainloop() never returns, so it runs on its own thread as a
+// coroutine: runFrame() resumes it and blocks until vsync_do_vsync() hands
+// control back. This is independent of the framework's EmuThread, which just
+// calls runFrame() from another thread when active.
 #ifdef __APPLE__
 static semaphore_t execSem, execDoneSem;
 #else
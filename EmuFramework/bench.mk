@@ -0,0 +1,8 @@
+# headless benchmark runner, usage: <exec>-bench [--frames N] [--warmup N] [--no-video] [--audio] <game path>
+# shared by each emulator's linux-x86_64-bench.mk, which only includes this file
+emuFramework_headlessBenchmark := 1
+target = $(metadata_exec)-bench
+include $(IMAGINE_PATH)/make/config.mk
+-include $(projectPath)/config.mk
+include $(IMAGINE_PATH)/make/linux-x86_64-gcc.mk
+include $(projectPath)/build.mk
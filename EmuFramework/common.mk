@@ -1,5 +1,7 @@
 ifneq ($(filter linux ios android webos,$(ENV)),)
  emuFramework_onScreenControls := 1
+ emuFramework_emuThread := 1
+ emuFramework_cpuFilter := 1
 endif
 
 emuFrameworkPath := $(lastMakefileDir)
@@ -14,10 +16,66 @@ Screenshot.cc ButtonConfigView.cc VideoImageOverlay.cc \
 StateSlotView.cc MenuView.cc EmuInput.cc TextEntry.cc \
 EmuOptions.cc OptionView.cc EmuView.cc MultiChoiceView.cc \
 ConfigFile.cc InputManagerView.cc FileUtils.cc EmuApp.cc \
-BundledGamesView.cc VideoImageEffect.cc
+BundledGamesView.cc VideoImageEffect.cc FrameSkip.cc
 
 ifeq ($(emuFramework_cheats), 1)
  SRC += Cheats.cc
+ # the system supplies its RAM regions with EmuSystem::cheatSearchRegions()
+ ifeq ($(emuFramework_cheatSearch), 1)
+  CPPFLAGS += -DCONFIG_EMUFRAMEWORK_CHEAT_SEARCH
+  SRC += CheatSearch.cc
+ endif
+endif
+
+ifeq ($(emuFramework_headlessBenchmark), 1)
+ CPPFLAGS += -DCONFIG_EMUFRAMEWORK_HEADLESS_BENCHMARK
+ SRC += HeadlessBenchmark.cc
+endif
+
+ifeq ($(emuFramework_rewind), 1)
+ CPPFLAGS += -DCONFIG_EMUFRAMEWORK_REWIND
+ SRC += Rewind.cc
+endif
+
+# run-ahead uses the same in-memory state functions as rewind
+ifeq ($(emuFramework_runAhead), 1)
+ ifneq ($(emuFramework_rewind), 1)
+  $(error emuFramework_runAhead requires emuFramework_rewind)
+ endif
+ CPPFLAGS += -DCONFIG_EMUFRAMEWORK_RUN_AHEAD
+ SRC += RunAhead.cc
+endif
+
+# save states are written from the in-memory state on a background thread
+ifeq ($(emuFramework_asyncState), 1)
+ ifneq ($(emuFramework_rewind), 1)
+  $(error emuFramework_asyncState requires emuFramework_rewind)
+ endif
+ ifneq ($(filter linux ios android,$(ENV)),)
+  CPPFLAGS += -DCONFIG_EMUFRAMEWORK_ASYNC_STATE
+  SRC += AsyncStateWriter.cc
+  include $(IMAGINE_PATH)/make/package/zlib.mk
+ endif
+endif
+
+# ROM hashes are cached in an index that's updated on a background thread
+ifeq ($(emuFramework_libraryIndex), 1)
+ ifneq ($(filter linux ios android,$(ENV)),)
+  CPPFLAGS += -DCONFIG_EMUFRAMEWORK_LIBRARY_INDEX
+  SRC += LibraryIndex.cc
+  include $(IMAGINE_PATH)/make/package/zlib.mk
+  include $(IMAGINE_PATH)/make/package/unzip.mk
+ endif
+endif
+
+ifeq ($(emuFramework_emuThread), 1)
+ CPPFLAGS += -DCONFIG_EMUFRAMEWORK_EMU_THREAD
+ SRC += EmuThread.cc
+endif
+
+ifeq ($(emuFramework_cpuFilter), 1)
+ CPPFLAGS += -DCONFIG_EMUFRAMEWORK_CPU_FILTER
+ SRC += VideoImageFilter.cc
 endif
 
 ifeq ($(emuFramework_onScreenControls), 1)
@@ -0,0 +1,64 @@
+#pragma once
+
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#include <imagine/engine-globals.h>
+#include <imagine/util/thread/pthread.hh>
+#include <imagine/base/Pipe.hh>
+#include <imagine/fs/sys.hh>
+
+// Saves states without blocking the UI: the in-memory state is captured
+// synchronously, then deflated (unless the core already compressed it) and
+// written to a temporary file that's renamed over the destination on a
+// background thread. The result is posted to the popup from the main thread
+// once the write finishes.
+class AsyncStateWriter
+{
+public:
+	constexpr AsyncStateWriter() {}
+	// captures the current state and queues it to be written to path,
+	// when notify is false only errors are posted to the popup
+	int save(const char *path, bool notify = true);
+	// blocks until all queued states are on disk
+	void waitForIdle();
+	// true if path holds a state in the compressed format written by save()
+	static bool isCompressedState(const char *path);
+	static int loadState(const char *path);
+
+private:
+	struct Result
+	{
+		int result;
+		bool notify;
+	};
+
+	ThreadPThread thread;
+	MutexPThread mutex;
+	CondVarPThread workCond, idleCond;
+	Base::Pipe resultPipe;
+	uint8 *snapshot = nullptr, *pending = nullptr;
+	uint snapshotCapacity = 0, pendingCapacity = 0, pendingSize = 0;
+	FsSys::cPath pendingPath {0};
+	bool snapshotCompressed = false, pendingCompressed = false;
+	bool pendingNotify = false, hasPending = false, busy = false, started = false;
+
+	bool init();
+	void run();
+	uint captureState();
+	static int writeState(const char *path, const uint8 *state, uint size, bool compressed);
+};
+
+extern AsyncStateWriter stateWriter;
@@ -0,0 +1,118 @@
+#pragma once
+
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#include <imagine/engine-globals.h>
+#include <imagine/gui/BaseMenuView.hh>
+#include <imagine/gui/MenuItem.hh>
+#include <MultiChoiceView.hh>
+
+// RAM exposed by a system for searching, values are read in host byte order
+// and data must be aligned to 4 bytes
+struct CheatSearchRegion
+{
+	const char *name;
+	const uint8 *data;
+	uint32 address; // address of data[0] as shown to the user
+	uint size;
+};
+
+// Narrows down the addresses holding a value by repeatedly comparing RAM
+// against the previous pass or a constant. Every aligned value in the
+// regions is a candidate when a search starts and candidates are tracked in
+// a bitset, one bit per value. Each pass compares 64 values at a time with
+// SSE2 or NEON and skips words with no candidates left, so later passes
+// only touch the few spots that still match.
+class CheatSearch
+{
+public:
+	enum Compare { EQ, NE, LT, LE, GT, GE };
+	enum Size { BITS_8, BITS_16, BITS_32 };
+	static constexpr uint MAX_REGIONS = 4;
+
+	struct Result
+	{
+		uint32 address;
+		uint32 value;
+	};
+
+	constexpr CheatSearch() {}
+	// snapshots the system's regions with every value as a candidate
+	bool start(Size size, bool isSigned);
+	// keeps the candidates whose value compares true with the last pass,
+	// then snapshots the current values for the next one
+	void filterPrevious(Compare compare);
+	// keeps the candidates whose value compares true with value
+	void filterValue(Compare compare, uint32 value);
+	uint candidates() const;
+	// fills up to max results in address order, returns the number filled
+	uint results(Result *result, uint max) const;
+	bool isActive() const { return regions; }
+	Size valueSize() const { return size; }
+	bool valuesAreSigned() const { return isSigned; }
+	void end();
+
+private:
+	struct Region
+	{
+		uint32 address;
+		uint values;
+		const uint8 *data;
+		uint8 *saved; // values from the last pass
+		uint64 *bits;
+	};
+
+	Region region[MAX_REGIONS] {};
+	uint regions = 0;
+	Size size = BITS_8;
+	bool isSigned = false;
+
+	void filter(Compare compare, bool usePrevious, uint32 value);
+};
+
+extern CheatSearch cheatSearch;
+
+class CheatSearchView : public BaseMenuView
+{
+public:
+	CheatSearchView(Base::Window &win);
+	void init(bool highlightFirst);
+
+private:
+	MultiChoiceSelectMenuItem valueSize;
+	BoolMenuItem isSigned;
+	TextMenuItem start, comparePrevious, compareValue;
+	DualTextMenuItem results;
+	MenuItem *item[6] {nullptr};
+	char resultsStr[16] {0};
+
+	void updateResults();
+	void pickCompare(const char *name, const Input::Event &e, bool usePrevious);
+};
+
+class CheatSearchResultsView : public BaseMenuView
+{
+public:
+	static constexpr uint MAX_RESULTS = 64;
+
+	CheatSearchResultsView(Base::Window &win): BaseMenuView("Search Results", win) {}
+	void init(bool highlightFirst);
+
+private:
+	DualTextMenuItem result[MAX_RESULTS];
+	MenuItem *item[MAX_RESULTS] {nullptr};
+	char str[MAX_RESULTS][2][16] {{{0}}};
+};
@@ -24,7 +24,10 @@ class BaseCheatsView : public BaseMenuView
 {
 protected:
 	TextMenuItem edit;
-	MenuItem *item[EmuCheats::MAX + 1] = {nullptr};
+	#ifdef CONFIG_EMUFRAMEWORK_CHEAT_SEARCH
+	TextMenuItem search;
+	#endif
+	MenuItem *item[EmuCheats::MAX + 2] = {nullptr};
 	RefreshCheatsDelegate onRefreshCheats;
 
 public:
@@ -51,6 +51,9 @@ static const int guiKeyIdxIncStateSlot = 5;
 static const int guiKeyIdxFastForward = 6;
 static const int guiKeyIdxGameScreenshot = 7;
 static const int guiKeyIdxExit = 8;
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+static const int guiKeyIdxRewind = 9;
+#endif
 
 void processRelPtr(const Input::Event &e);
 void commonInitInput();
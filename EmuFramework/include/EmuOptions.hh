@@ -61,6 +61,17 @@ extern Byte1Option optionHideStatusBar;
 extern OptionSwappedGamepadConfirm optionSwappedGamepadConfirm;
 extern Byte1Option optionConfirmOverwriteState;
 extern Byte1Option optionFastForwardSpeed;
+extern Byte1Option optionShowFrameStats;
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+extern Byte1Option optionRewindMemory; // in MiB, 0 disables rewind
+extern Byte1Option optionRewindInterval;
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+extern Byte1Option optionRunAhead; // frames, 0 disables run-ahead
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+extern Byte1Option optionEmuThread;
+#endif
 #ifdef INPUT_HAS_SYSTEM_DEVICE_HOTSWAP
 extern Byte1Option optionNotifyInputDeviceChange;
 #endif
@@ -80,6 +91,9 @@ extern OptionAspectRatio optionAspectRatio;
 #ifdef CONFIG_GFX_OPENGL_SHADER_PIPELINE
 extern Byte1Option optionImgEffect;
 #endif
+#ifdef CONFIG_EMUFRAMEWORK_CPU_FILTER
+extern Byte1Option optionImgCpuFilter;
+#endif
 extern Byte1Option optionOverlayEffect;
 extern Byte1Option optionOverlayEffectLevel;
 
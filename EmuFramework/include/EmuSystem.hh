@@ -22,6 +22,13 @@
 #include <imagine/util/time/sys.hh>
 #include <imagine/util/audio/PcmFormat.hh>
 #include <imagine/gui/FSPicker.hh>
+#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+#include <EmuThread.hh>
+#endif
+
+#ifdef CONFIG_EMUFRAMEWORK_CHEAT_SEARCH
+struct CheatSearchRegion;
+#endif
 
 struct AspectRatioInfo
 {
@@ -72,6 +79,21 @@ public:
 	static void startAutoSaveStateTimer();
 	static int loadState(int slot = saveStateSlot);
 	static int saveState();
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	// uncompressed state for rewinding, returns the bytes written or 0 if size is too small
+	static uint saveStateToMemory(void *buff, uint size);
+	static int loadStateFromMemory(const void *buff, uint size);
+	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+	// state as written to a save file, returns the bytes written or 0 if size is too small,
+	// sets compressed if the data is already in the core's compressed file format so it's stored as-is,
+	// otherwise it must load with loadStateFromMemory()
+	static uint saveStateFileToMemory(void *buff, uint size, bool &compressed);
+	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_CHEAT_SEARCH
+	// fills in up to max RAM regions for the cheat search, returns the number filled
+	static uint cheatSearchRegions(CheatSearchRegion *region, uint max);
+	#endif
 	static bool stateExists(int slot);
 	static bool shouldOverwriteExistingState();
 	static const char *systemName();
@@ -125,6 +147,8 @@ public:
 	}
 	static void clearInputBuffers();
 	static void handleInputAction(uint state, uint emuKey);
+	// calls handleInputAction() now or before the next frame if emulation is on its own thread
+	static void postInputAction(uint state, uint emuKey);
 	static uint translateInputAction(uint input, bool &turbo);
 	static uint translateInputAction(uint input)
 	{
@@ -158,6 +182,9 @@ public:
 
 	static void pause()
 	{
+		#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+		emuThread.waitForIdle();
+		#endif
 		if(isActive())
 			state = State::PAUSED;
 		stopSound();
@@ -0,0 +1,84 @@
+#pragma once
+
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#include <imagine/engine-globals.h>
+#include <imagine/util/thread/pthread.hh>
+#include <imagine/pixmap/Pixmap.hh>
+#include <atomic>
+
+// Runs EmuSystem::runFrame() on its own thread when active. Frames are
+// requested by the renderer each screen refresh and finished video frames
+// come back through a triple buffer, so neither side waits on the other.
+class EmuThread
+{
+public:
+	struct FrameRequest
+	{
+		uint frames = 0; // frames to emulate, only the last one is rendered
+		bool renderAudio = false;
+		bool fastForward = false; // run unthrottled until the next normal request
+		bool rewind = false;
+	};
+
+	constexpr EmuThread() {}
+	bool setActive(bool on);
+	bool isActive() const { return active; }
+	bool onEmuThread() const { return active && pthread_equal(pthread_self(), threadId); }
+	void requestFrames(FrameRequest req);
+	void waitForIdle();
+	void postInputAction(uint state, uint emuKey);
+
+	// called by the emulation thread with a finished frame
+	void postFrame(const IG::Pixmap &pix);
+	// called by the renderer, returns the newest frame if one arrived since the last call
+	IG::Pixmap *takeFrame();
+
+private:
+	struct FrameSlot
+	{
+		char *data = nullptr;
+		uint capacity = 0;
+		IG::Pixmap pix {PixelFormatRGB565};
+	};
+	struct InputAction
+	{
+		uint state, emuKey;
+	};
+	static constexpr uint MAX_PENDING_FRAMES = 8;
+	static constexpr uint MAX_INPUT_ACTIONS = 64;
+	static constexpr uint8 FRAME_FRESH = 0x4;
+
+	ThreadPThread thread;
+	pthread_t threadId {};
+	MutexPThread mutex;
+	CondVarPThread workCond, idleCond;
+	bool active = false, started = false, busy = false, quit = false, syncCreated = false;
+	FrameRequest pending;
+	InputAction inputAction[MAX_INPUT_ACTIONS] {};
+	uint inputActions = 0;
+	FrameSlot slot[3];
+	// index of the last completed slot, ORed with FRAME_FRESH until the renderer takes it
+	std::atomic<uint8> readySlot {1};
+	uint8 frontSlot = 0, backSlot = 2;
+
+	void run();
+	void stop();
+	void applyInputActions();
+	void runRequest(FrameRequest req);
+};
+
+extern EmuThread emuThread;
@@ -17,8 +17,12 @@
 
 #include <imagine/gfx/GfxSprite.hh>
 #include <imagine/gfx/GfxBufferImage.hh>
+#include <imagine/gfx/GfxText.hh>
 #include <VideoImageOverlay.hh>
 #include <VideoImageEffect.hh>
+#ifdef CONFIG_EMUFRAMEWORK_CPU_FILTER
+#include <VideoImageFilter.hh>
+#endif
 #include <imagine/gui/View.hh>
 #include <EmuOptions.hh>
 
@@ -26,10 +30,16 @@ class EmuView : public View
 {
 public:
 	bool ffGuiKeyPush = 0, ffGuiTouch = 0;
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	bool rewindGuiKeyPush = 0;
+	#endif
 	VideoImageOverlay vidImgOverlay;
 	#ifdef CONFIG_GFX_OPENGL_SHADER_PIPELINE
 	VideoImageEffect vidImgEffect;
 	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_CPU_FILTER
+	VideoImageFilter vidImgFilter;
+	#endif
 	Gfx::Sprite disp;
 	Gfx::BufferImage vidImg;
 	IG::Pixmap vidPix {PixelFormatRGB565};
@@ -37,9 +47,15 @@ public:
 private:
 	char *pixBuff = nullptr;
 	uint vidPixAlign = Gfx::BufferImage::MAX_ASSUME_ALIGN;
+	uint vidImgX = 0, vidImgY = 0; // size of vidImg, may differ from vidPix until the next frame is written
 	IG::WindowRect gameRect_;
 	Gfx::GCRect gameRectG;
 	IG::WindowRect rect;
+	Gfx::Text frameStatsText;
+	char frameStatsStr[128] {0};
+
+	void updateFrameStatsText();
+	void drawFrameStats();
 
 public:
 	constexpr EmuView(Base::Window &win): View(win) {}
@@ -50,6 +66,10 @@ public:
 	template <bool active>
 	void drawContent();
 	void runFrame(Base::FrameTimeBase frameTime);
+	#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+	void requestThreadFrames(Base::FrameTimeBase frameTime, bool renderAudio);
+	void presentThreadFrame();
+	#endif
 	void draw(Base::FrameTimeBase frameTime) override;
 	void inputEvent(const Input::Event &e) override;
 	void takeGameScreenshot();
@@ -61,6 +81,8 @@ public:
 	void reinitImage();
 	void resizeImage(uint x, uint y, uint pitch = 0);
 	void resizeImage(uint xO, uint yO, uint x, uint y, uint totalX, uint totalY, uint pitch = 0);
+	void resizeVideoTexture(IG::Pixmap &pix);
+	void writeVideoTexture(IG::Pixmap &pix);
 	void initImage(bool force, uint x, uint y, uint pitch = 0);
 	void initImage(bool force, uint xO, uint yO, uint x, uint y, uint totalX, uint totalY, uint pitch = 0);
 
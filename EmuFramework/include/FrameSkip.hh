@@ -0,0 +1,62 @@
+#pragma once
+
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#include <imagine/engine-globals.h>
+#include <imagine/util/time/sys.hh>
+#include <atomic>
+
+struct FrameTimingStats
+{
+	double skipsPerSec = 0;
+	double emulateMs = 0; // frame with video
+	double skipEmulateMs = 0; // frame without video
+	double presentMs = 0;
+	int audioFill = -1; // percent of the audio buffer in use, -1 if unknown
+};
+
+// Decides how many of the frames due on a host frame run without video, based
+// on moving averages of the measured emulation and presentation costs and
+// the audio buffer fill. Frames that don't fit in the host frame are carried
+// over while the audio buffer has slack instead of being skipped at once.
+class FrameSkipScheduler
+{
+public:
+	static constexpr uint MAX_FRAME_SKIP = 6;
+
+	constexpr FrameSkipScheduler() {}
+	void reset();
+	// returns the frames to run without video, framesDue is at least 1,
+	// carriedFrames returns the due frames deferred to the next host frame
+	uint framesToSkip(uint framesDue, int audioFill, double framePeriodMs, uint &carriedFrames);
+	void addEmulateTime(bool video, uint frames, TimeSys time);
+	// nested is true when presenting from inside the emulated frame
+	void addPresentTime(TimeSys time, bool nested);
+	// true once per stats period with new stats available
+	bool updateStats();
+	const FrameTimingStats &stats() const { return stats_; }
+
+private:
+	std::atomic<float> emulateMs {0}, skipEmulateMs {0}, presentMs {0};
+	float nestedPresentMs = 0;
+	uint skips = 0;
+	int lastAudioFill = -1;
+	TimeSys periodStart;
+	uint periods = 0;
+	FrameTimingStats stats_;
+};
+
+extern FrameSkipScheduler frameSkipScheduler;
@@ -0,0 +1,32 @@
+#pragma once
+
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#include <imagine/engine-globals.h>
+
+// Runs a game from the command line without a window or audio output and prints
+// frame timing statistics as JSON to stdout, returns the process exit code
+int runHeadlessBenchmark(int argc, char** argv);
+
+// Optional system specific micro-benchmark run with --system-bench, prints
+// results as JSON lines to stdout, returns the process exit code
+int runSystemBenchmark(uint frames);
+
+// Optional system specific statistics for a game benchmark, reset after the
+// warmup frames and printed as extra ,"key":value JSON fields before the game
+// is closed
+void resetSystemBenchmarkStats();
+void printSystemBenchmarkStats(uint frames);
@@ -0,0 +1,83 @@
+#pragma once
+
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#include <imagine/engine-globals.h>
+#include <imagine/util/thread/pthread.hh>
+#include <imagine/fs/sys.hh>
+
+struct LibraryEntry
+{
+	uint32 crc32;
+	uint32 size; // uncompressed size for zip members
+	uint8 md5[16];
+};
+
+// Cache of ROM hashes so cores don't need to hash a game on every launch.
+// The last browsed directory and the directories of recent games are
+// scanned on a background thread, and the CRC32 & MD5 of every file the
+// picker would show (and of every member of zip files) is stored in a
+// sorted index file next to the config, along with each scanned
+// directory's filtered listing for the picker. Entries are keyed by path and
+// zip member name, and are only valid while the file's size and
+// modification time match. The index is mapped read-only between scans.
+class LibraryIndex
+{
+public:
+	constexpr LibraryIndex() {}
+	// maps the existing index and starts a scan of the current work
+	// directory and the recent game directories
+	void startScan();
+	// stops a running scan, keeping the previous index
+	void cancelScan();
+	// looks up path, or member inside the zip at path if member isn't null,
+	// returns false if it isn't indexed or the file has changed
+	bool find(const char *path, const char *member, LibraryEntry &entry);
+	// adds the entries of directory path as the picker's default filter
+	// would list them, returns false if it isn't indexed or has changed
+	bool listDir(const char *path, FsSys &dir);
+	// returns true if path was a file at the last scan, without touching the file system
+	bool hasFile(const char *path);
+	static void md5ToStr(const uint8 md5[16], char (&str)[33]);
+
+private:
+	struct Record;
+	struct Builder;
+	static constexpr uint MAX_ROOTS = 11;
+
+	ThreadPThread thread;
+	MutexPThread mutex;
+	const char *map = nullptr; // guarded by mutex
+	size_t mapSize = 0;
+	FsSys::cPath root[MAX_ROOTS] {{0}};
+	uint roots = 0;
+	bool init = false, quit = false, scanning = false;
+	time_t scanStartTime = 0;
+
+	void run();
+	bool cancelled();
+	void scanDir(Builder &builder, const char *path, uint depth);
+	void scanFile(Builder &builder, const char *path);
+	void addDirListing(Builder &builder, const char *path, const struct stat &s, FsSys &dir);
+	bool copyRecords(Builder &builder, const char *path, uint32 hash, const struct stat &s);
+	static bool writeIndex(Builder &builder, const char *path);
+	bool mapIndex();
+	void unmapIndex();
+	const Record *findRecord(const char *path, uint32 hash) const;
+	const char *str(uint32 offset) const;
+};
+
+extern LibraryIndex libraryIndex;
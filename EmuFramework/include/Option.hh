@@ -288,7 +288,9 @@ enum { CFGKEY_SOUND = 0, CFGKEY_TOUCH_CONTROL_DISPLAY = 1,
 	CFGKEY_TOUCH_CONTROL_SCALED_COORDINATES = 66, CFGKEY_VIEWPORT_ZOOM = 67,
 	CFGKEY_VCONTROLLER_LAYOUT_POS = 68, CFGKEY_MOGA_INPUT_SYSTEM = 69,
 	CFGKEY_FAST_FORWARD_SPEED = 70, CFGKEY_SHOW_BUNDLED_GAMES = 71,
-	CFGKEY_IMAGE_EFFECT = 72
+	CFGKEY_IMAGE_EFFECT = 72, CFGKEY_REWIND_MEMORY = 73,
+	CFGKEY_REWIND_INTERVAL = 74, CFGKEY_EMU_THREAD = 75, CFGKEY_IMAGE_CPU_FILTER = 76,
+	CFGKEY_RUN_AHEAD = 77, CFGKEY_SHOW_FRAME_STATS = 78
 	// 256+ is reserved
 };
 
@@ -44,6 +44,7 @@ protected:
 	#endif
 	MultiChoiceSelectMenuItem frameSkip;
 	void frameSkipInit();
+	BoolMenuItem frameStats;
 	const char *aspectRatioStr[4];
 	MultiChoiceSelectMenuItem aspectRatio;
 	void aspectRatioInit();
@@ -56,6 +57,10 @@ protected:
 	MultiChoiceSelectMenuItem imgEffect;
 	void imgEffectInit();
 	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_CPU_FILTER
+	MultiChoiceSelectMenuItem imgCpuFilter;
+	void imgCpuFilterInit();
+	#endif
 	MultiChoiceSelectMenuItem overlayEffect;
 	void overlayEffectInit();
 	MultiChoiceSelectMenuItem overlayEffectLevel;
@@ -113,6 +118,19 @@ protected:
 	static constexpr uint MIN_FAST_FORWARD_SPEED = 2;
 	void fastForwardSpeedinit();
 	MultiChoiceSelectMenuItem fastForwardSpeed;
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	void rewindMemoryInit();
+	MultiChoiceSelectMenuItem rewindMemory;
+	void rewindIntervalInit();
+	MultiChoiceSelectMenuItem rewindInterval;
+	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+	void runAheadInit();
+	MultiChoiceSelectMenuItem runAhead;
+	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+	BoolMenuItem emuThread;
+	#endif
 	#if defined CONFIG_BASE_ANDROID
 	void processPriorityInit();
 	MultiChoiceSelectMenuItem processPriority;
@@ -0,0 +1,72 @@
+#pragma once
+
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#include <imagine/engine-globals.h>
+#include <imagine/util/time/sys.hh>
+
+// Keeps a history of in-memory save states for rewinding. The newest state is
+// stored whole and each older one as an XOR delta against its successor, zero-run
+// compressed into a ring of fixed size so the oldest history is discarded first.
+class RewindBuffer
+{
+public:
+	constexpr RewindBuffer() {}
+	bool init(uint memBytes, uint frameInterval);
+	void deinit();
+	void reset();
+	bool isInit() const { return memBytes; }
+	void frameComplete();
+	bool capture();
+	bool rewind();
+	uint snapshots() const { return entries + hasState; }
+	uint bytesUsed() const;
+	double avgCaptureMs() const { return captures ? (double)captureTime * 1000. / captures : 0; }
+	double avgRewindMs() const { return rewinds ? (double)rewindTime * 1000. / rewinds : 0; }
+
+private:
+	struct Entry
+	{
+		uint32 offset, size;
+		uint32 stateSize; // size of the state this delta reconstructs
+	};
+	static constexpr uint MAX_ENTRIES = 8192;
+
+	uint8 *state = nullptr; // newest snapshot
+	uint8 *scratch = nullptr;
+	uint8 *mem = nullptr;
+	Entry *entry = nullptr;
+	uint memBytes = 0, ringBytes = 0;
+	uint stateCapacity = 0, stateSize = 0;
+	uint writePos = 0;
+	uint firstEntry = 0, entries = 0;
+	uint frameInterval = 1, framesUntilCapture = 0;
+	bool hasState = false;
+	TimeSys captureTime, rewindTime;
+	uint captures = 0, rewinds = 0;
+
+	bool allocStateBuffers(uint size);
+	void freeStateBuffers();
+	Entry &entryAt(uint idx) { return entry[(firstEntry + idx) % MAX_ENTRIES]; }
+	void dropOldest();
+	void reserve(uint bytes);
+	void logStats();
+};
+
+extern RewindBuffer rewindBuffer;
+
+// re-initializes rewindBuffer from the rewind options
+void applyRewindOptions();
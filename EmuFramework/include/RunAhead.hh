@@ -0,0 +1,50 @@
+#pragma once
+
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#include <imagine/engine-globals.h>
+#include <imagine/util/time/sys.hh>
+
+// Hides the internal input lag of a game by emulating past the current frame
+// with the current input, displaying that future frame, then restoring the
+// state saved after the real frame. Only the real frame renders audio.
+class RunAhead
+{
+public:
+	static constexpr uint MAX_FRAMES = 4;
+
+	constexpr RunAhead() {}
+	void setFrames(uint frames);
+	uint frames() const { return frames_; }
+	bool isActive() const { return frames_; }
+	void deinit();
+	// runs the real frame plus the run-ahead frames, presenting the last one
+	void runFrame(bool renderAudio);
+	double avgExtraMs() const { return runs ? (double)extraTime * 1000. / runs : 0; }
+	void resetStats();
+
+private:
+	uint8 *state = nullptr;
+	uint stateCapacity = 0;
+	uint frames_ = 0;
+	TimeSys extraTime;
+	uint runs = 0;
+
+	uint saveState();
+	void logStats();
+};
+
+extern RunAhead runAhead;
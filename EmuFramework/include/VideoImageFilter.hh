@@ -0,0 +1,54 @@
+#pragma once
+
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#include <imagine/engine-globals.h>
+#include <imagine/pixmap/Pixmap.hh>
+
+// Upscales emulated frames on the CPU before they're written to the video
+// texture, for devices where the GPU effect is unavailable or too slow.
+// Each frame is split into horizontal bands processed by worker threads.
+class VideoImageFilter
+{
+public:
+	enum
+	{
+		NO_FILTER = 0,
+		SCALE2X = 1,
+		SCALE3X = 2,
+		HQ2X = 3,
+		XBR2X = 4,
+
+		MAX_FILTER_VAL = XBR2X
+	};
+
+	constexpr VideoImageFilter() {}
+	void setFilter(uint filter);
+	uint filter() const { return filter_; }
+	static uint scale(uint filter);
+	static bool supportsFormat(const PixelFormatDesc &format);
+	// returns the filtered frame, or pix itself when no filter applies
+	IG::Pixmap &apply(IG::Pixmap &pix);
+	void deinit();
+
+private:
+	uint filter_ = NO_FILTER;
+	char *outBuff = nullptr;
+	uint outBuffSize = 0;
+	int16 *yuvBuff = nullptr;
+	uint yuvBuffSize = 0;
+	IG::Pixmap outPix {PixelFormatRGB565};
+};
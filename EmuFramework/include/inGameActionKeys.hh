@@ -18,7 +18,11 @@
 namespace EmuControls
 {
 
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+static const uint gameActionKeys = 10;
+#else
 static const uint gameActionKeys = 9;
+#endif
 static const uint systemKeyMapStart = gameActionKeys;
 typedef uint GameActionKeyArray[gameActionKeys];
 
@@ -33,15 +37,26 @@ static const char *gameActionName[gameActionKeys] =
 	"Fast-forward",
 	"Game Screenshot",
 	"Exit",
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	"Rewind",
+	#endif
 };
 
 }
 
+// appends the rewind key to a profile when the action exists
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+#define EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(key) , key
+#else
+#define EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(key)
+#endif
+
 #define EMU_CONTROLS_IN_GAME_ACTIONS_CATEGORY_INIT \
 KeyCategory("Set In-Game Actions", gameActionName, 0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_UNBINDED_PROFILE_INIT \
-0, 0, 0, 0, 0, 0, 0, 0, 0
+0, 0, 0, 0, 0, 0, 0, 0, 0 \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_ICP_NUBS_PROFILE_INIT \
 Input::iControlPad::RNUB_DOWN, \
@@ -52,7 +67,8 @@ Input::iControlPad::RNUB_UP, \
 0, \
 Input::iControlPad::LNUB_UP, \
 0, \
-0
+0 \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_ICADE_PROFILE_INIT \
 0, \
@@ -63,7 +79,8 @@ Input::ICade::D, \
 0, \
 0, \
 0, \
-0
+0 \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_WIIMOTE_PROFILE_INIT \
 0, \
@@ -74,7 +91,8 @@ Input::Wiimote::HOME, \
 0, \
 0, \
 0, \
-0
+0 \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_WII_CC_PROFILE_INIT \
 0, \
@@ -85,7 +103,8 @@ Input::WiiCC::HOME, \
 0, \
 Input::WiiCC::ZR, \
 0, \
-0
+0 \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_WEBOS_KB_PROFILE_INIT \
 Input::Keycode::LSHIFT, \
@@ -96,7 +115,8 @@ Input::Keycode::asciiKey('a'), \
 0, \
 Input::Keycode::asciiKey('@'), \
 0, \
-0
+0 \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_WEBOS_KB_8WAY_DIRECTION_PROFILE_INIT \
 Input::Keycode::asciiKey('r'), \
@@ -117,7 +137,8 @@ Input::Keycode::MENU, \
 0, \
 Input::Keycode::SEARCH, \
 0, \
-Input::Keycode::ESCAPE
+Input::Keycode::ESCAPE \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_ANDROID_GENERIC_GAMEPAD_PROFILE_INIT \
 0, \
@@ -128,7 +149,8 @@ Input::Keycode::JS2_YAXIS_NEG, \
 0, \
 Input::Keycode::JS_RTRIGGER_AXIS, \
 0, \
-0
+0 \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_OUYA_PROFILE_INIT \
 0, \
@@ -139,7 +161,8 @@ Input::Keycode::MENU, \
 0, \
 Input::Keycode::Ouya::R2, \
 0, \
-0
+0 \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_OUYA_MINIMAL_PROFILE_INIT \
 0, \
@@ -150,7 +173,8 @@ Input::Keycode::MENU, \
 0, \
 0, \
 0, \
-0
+0 \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_NVIDIA_SHIELD_PROFILE_INIT \
 0, \
@@ -161,7 +185,8 @@ Input::Keycode::MENU, \
 0, \
 Input::Keycode::JS_RTRIGGER_AXIS, \
 0, \
-Input::Keycode::ESCAPE
+Input::Keycode::ESCAPE \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_NVIDIA_SHIELD_MINIMAL_PROFILE_INIT \
 0, \
@@ -172,7 +197,8 @@ Input::Keycode::ESCAPE
 0, \
 Input::Keycode::JS_RTRIGGER_AXIS, \
 0, \
-Input::Keycode::ESCAPE
+Input::Keycode::ESCAPE \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_ANDROID_PS3_GAMEPAD_PROFILE_INIT \
 0, \
@@ -183,7 +209,8 @@ Input::Keycode::GAME_1, \
 0, \
 Input::Keycode::GAME_R2, \
 0, \
-0
+0 \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_ANDROID_PS3_GAMEPAD_MINIMAL_PROFILE_INIT \
 0, \
@@ -194,7 +221,8 @@ Input::Keycode::GAME_1, \
 0, \
 0, \
 0, \
-0
+0 \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_GENERIC_KB_PROFILE_INIT \
 Input::Keycode::asciiKey('l'), \
@@ -205,7 +233,8 @@ Input::Keycode::asciiKey('['), \
 Input::Keycode::asciiKey(']'), \
 Input::Keycode::asciiKey('`'), \
 0, \
-Input::Keycode::ESCAPE
+Input::Keycode::ESCAPE \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(Input::Keycode::BACK_SPACE)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_GENERIC_KB_ALT_PROFILE_INIT \
 Input::Keycode::asciiKey('l'), \
@@ -216,7 +245,8 @@ Input::Keycode::asciiKey('['), \
 Input::Keycode::asciiKey(']'), \
 Input::Keycode::asciiKey('`'), \
 0, \
-Input::Keycode::ESCAPE
+Input::Keycode::ESCAPE \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(Input::Keycode::BACK_SPACE)
 
 #ifdef CONFIG_BASE_ANDROID
 #define EMU_CONTROLS_IN_GAME_ACTIONS_GENERIC_KB_MINIMAL_PROFILE_INIT \
@@ -228,7 +258,8 @@ Input::Keycode::MENU, \
 0, \
 Input::Keycode::SEARCH, \
 0, \
-0
+0 \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 #else
 #define EMU_CONTROLS_IN_GAME_ACTIONS_GENERIC_KB_MINIMAL_PROFILE_INIT \
 0, \
@@ -239,7 +270,8 @@ Input::Keycode::MENU, \
 0, \
 Input::Keycode::F11, \
 0, \
-0
+0 \
+EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 #endif
 
 #ifdef CONFIG_BASE_PS3
@@ -257,7 +289,8 @@ Input::Keycode::F11, \
 	0, \
 	Input::PS3::R2, \
 	0, \
-	0
+	0 \
+	EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_GENERIC_PS3PAD_ALT_MINIMAL_PROFILE_INIT \
 	0, \
@@ -268,7 +301,8 @@ Input::Keycode::F11, \
 	0, \
 	0, \
 	0, \
-	0
+	0 \
+	EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_PANDORA_PROFILE_INIT \
 	Input::Keycode::asciiKey('l'), \
@@ -279,7 +313,8 @@ Input::Keycode::F11, \
 	Input::Keycode::asciiKey('6'), \
 	Input::Keycode::Pandora::R, \
 	0, \
-	Input::Keycode::BACK_SPACE
+	Input::Keycode::BACK_SPACE \
+	EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_PANDORA_ALT_PROFILE_INIT \
 	Input::Keycode::asciiKey('l'), \
@@ -290,7 +325,8 @@ Input::Keycode::F11, \
 	Input::Keycode::asciiKey('6'), \
 	Input::Keycode::asciiKey('0'), \
 	0, \
-	Input::Keycode::BACK_SPACE
+	Input::Keycode::BACK_SPACE \
+	EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
 
 #define EMU_CONTROLS_IN_GAME_ACTIONS_PANDORA_ALT_MINIMAL_PROFILE_INIT \
 	0, \
@@ -301,4 +337,5 @@ Input::Keycode::F11, \
 	0, \
 	Input::Keycode::Pandora::R, \
 	0, \
-	0
+	0 \
+	EMU_CONTROLS_IN_GAME_ACTIONS_REWIND_INIT(0)
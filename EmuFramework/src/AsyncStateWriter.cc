@@ -0,0 +1,295 @@
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#define LOGTAG "AsyncState"
+#include <AsyncStateWriter.hh>
+#include <EmuSystem.hh>
+#include <MsgPopup.hh>
+#include <imagine/io/sys.hh>
+#include <imagine/mem/mem.h>
+#include <algorithm>
+#include <zlib.h>
+
+AsyncStateWriter stateWriter;
+extern MsgPopup popup;
+
+// file layout: magic, uncompressed size as 32-bit little endian, zlib stream,
+// states the core compressed itself are written as-is in its own format
+static const char stateMagic[8] {'E', 'M', 'U', 'S', 'T', 'Z', '0', '1'};
+static constexpr uint HEADER_SIZE = sizeof(stateMagic) + 4;
+static constexpr uint MIN_STATE_BUFFER_SIZE = 0x40000;
+static constexpr uint MAX_STATE_BUFFER_SIZE = 0x4000000;
+static constexpr uint IO_CHUNK_SIZE = 0x10000;
+
+bool AsyncStateWriter::init()
+{
+	if(thread.running)
+		return true;
+	resultPipe.init(
+		[this](Base::Pipe &pipe)
+		{
+			while(resultPipe.hasData())
+			{
+				Result msg;
+				if(!resultPipe.read(&msg, sizeof(Result)))
+				{
+					logErr("error reading result from pipe");
+					return 1;
+				}
+				if(msg.result != STATE_RESULT_OK)
+					popup.postError(stateResultToStr(msg.result));
+				else if(msg.notify)
+					popup.post("State Saved");
+			}
+			return 1;
+		});
+	mutex.create();
+	workCond.create(mutex);
+	idleCond.create(mutex);
+	mutex.lock();
+	if(!thread.create(1,
+		[this](ThreadPThread &thread)
+		{
+			run();
+			return 0;
+		}))
+	{
+		mutex.unlock();
+		logErr("unable to create writer thread");
+		return false;
+	}
+	while(!started)
+		idleCond.wait();
+	mutex.unlock();
+	return true;
+}
+
+uint AsyncStateWriter::captureState()
+{
+	uint size = snapshotCapacity ? EmuSystem::saveStateFileToMemory(snapshot, snapshotCapacity, snapshotCompressed) : 0;
+	if(size)
+		return size;
+	// grow the buffer until the state fits
+	for(uint newCapacity = std::max(snapshotCapacity * 2, MIN_STATE_BUFFER_SIZE);
+		newCapacity <= MAX_STATE_BUFFER_SIZE; newCapacity *= 2)
+	{
+		auto newSnapshot = (uint8*)mem_realloc(snapshot, newCapacity);
+		if(!newSnapshot)
+			break;
+		snapshot = newSnapshot;
+		snapshotCapacity = newCapacity;
+		size = EmuSystem::saveStateFileToMemory(snapshot, snapshotCapacity, snapshotCompressed);
+		if(size)
+			return size;
+	}
+	return 0;
+}
+
+int AsyncStateWriter::save(const char *path, bool notify)
+{
+	#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+	emuThread.waitForIdle();
+	#endif
+	if(!init())
+		return STATE_RESULT_OTHER_ERROR;
+	uint size = captureState();
+	if(!size)
+	{
+		logErr("unable to capture state");
+		return STATE_RESULT_OTHER_ERROR;
+	}
+	mutex.lock();
+	// only one queued state, wait for the previous one to be picked up
+	while(hasPending)
+		idleCond.wait();
+	std::swap(snapshot, pending);
+	std::swap(snapshotCapacity, pendingCapacity);
+	pendingSize = size;
+	pendingCompressed = snapshotCompressed;
+	string_copy(pendingPath, path);
+	pendingNotify = notify;
+	hasPending = true;
+	workCond.signal();
+	mutex.unlock();
+	logMsg("queued %u byte%s state for %s", size, snapshotCompressed ? " compressed" : "", path);
+	return STATE_RESULT_OK;
+}
+
+void AsyncStateWriter::waitForIdle()
+{
+	if(!thread.running)
+		return;
+	mutex.lock();
+	while(hasPending || busy)
+		idleCond.wait();
+	mutex.unlock();
+}
+
+void AsyncStateWriter::run()
+{
+	uint8 *state = nullptr;
+	uint stateCapacity = 0;
+	FsSys::cPath path;
+	mutex.lock();
+	started = true;
+	idleCond.broadcast();
+	for(;;)
+	{
+		while(!hasPending)
+			workCond.wait();
+		// take ownership of the queued buffer, leaving ours for the next capture
+		std::swap(state, pending);
+		std::swap(stateCapacity, pendingCapacity);
+		uint size = pendingSize;
+		bool compressed = pendingCompressed;
+		string_copy(path, pendingPath);
+		Result msg {0, pendingNotify};
+		hasPending = false;
+		busy = true;
+		idleCond.broadcast();
+		mutex.unlock();
+		auto startTime = TimeSys::now();
+		msg.result = writeState(path, state, size, compressed);
+		logMsg("wrote %s in %.3fms", path, (TimeSys::now() - startTime).toNs() / 1000000.);
+		resultPipe.write(&msg, sizeof(Result));
+		mutex.lock();
+		busy = false;
+		idleCond.broadcast();
+	}
+}
+
+// writes the header followed by the deflated state
+static bool writeDeflated(IOFile &file, const uint8 *state, uint size)
+{
+	uint8 header[HEADER_SIZE];
+	memcpy(header, stateMagic, sizeof(stateMagic));
+	iterateTimes(4, i)
+	{
+		header[sizeof(stateMagic) + i] = size >> (i * 8);
+	}
+	if(file.fwrite(header, sizeof(header), 1) != 1)
+		return false;
+	z_stream stream {};
+	if(deflateInit(&stream, Z_BEST_SPEED) != Z_OK)
+		return false;
+	uint8 out[IO_CHUNK_SIZE];
+	stream.next_in = (Bytef*)state;
+	stream.avail_in = size;
+	int res;
+	do
+	{
+		stream.next_out = out;
+		stream.avail_out = sizeof(out);
+		res = deflate(&stream, Z_FINISH);
+		uint outSize = sizeof(out) - stream.avail_out;
+		if(outSize && file.fwrite(out, outSize, 1) != 1)
+			break;
+	} while(res == Z_OK);
+	deflateEnd(&stream);
+	return res == Z_STREAM_END;
+}
+
+int AsyncStateWriter::writeState(const char *path, const uint8 *state, uint size, bool compressed)
+{
+	FsSys::cPath tempPath;
+	string_printf(tempPath, "%s.tmp", path);
+	{
+		auto file = IOFile(IoSys::create(tempPath));
+		if(!file)
+		{
+			logErr("unable to create %s", tempPath);
+			return STATE_RESULT_NO_FILE_ACCESS;
+		}
+		// a state the core already compressed is in its own file format and loads without our header
+		bool ok = compressed ? file.fwrite(state, size, 1) == 1 : writeDeflated(file, state, size);
+		if(ok)
+			file.sync();
+		if(!ok)
+		{
+			logErr("error writing %s", tempPath);
+			file.close();
+			FsSys::remove(tempPath);
+			return STATE_RESULT_IO_ERROR;
+		}
+	}
+	if(FsSys::rename(tempPath, path) != OK)
+	{
+		logErr("error renaming %s", tempPath);
+		FsSys::remove(tempPath);
+		return STATE_RESULT_IO_ERROR;
+	}
+	return STATE_RESULT_OK;
+}
+
+bool AsyncStateWriter::isCompressedState(const char *path)
+{
+	auto file = IOFile(IoSys::open(path));
+	if(!file)
+		return false;
+	char magic[sizeof(stateMagic)];
+	return file.read(magic, sizeof(magic)) == OK && !memcmp(magic, stateMagic, sizeof(magic));
+}
+
+int AsyncStateWriter::loadState(const char *path)
+{
+	auto file = IOFile(IoSys::open(path));
+	if(!file)
+		return STATE_RESULT_NO_FILE;
+	uint8 header[HEADER_SIZE];
+	if(file.read(header, sizeof(header)) != OK || memcmp(header, stateMagic, sizeof(stateMagic)))
+		return STATE_RESULT_INVALID_DATA;
+	uint size = 0;
+	iterateTimes(4, i)
+	{
+		size |= (uint)header[sizeof(stateMagic) + i] << (i * 8);
+	}
+	if(!size || size > MAX_STATE_BUFFER_SIZE)
+		return STATE_RESULT_INVALID_DATA;
+	auto state = (uint8*)mem_alloc(size);
+	if(!state)
+		return STATE_RESULT_OTHER_ERROR;
+	// inflate the file a chunk at a time straight into the state buffer
+	z_stream stream {};
+	if(inflateInit(&stream) != Z_OK)
+	{
+		mem_free(state);
+		return STATE_RESULT_OTHER_ERROR;
+	}
+	uint8 in[IO_CHUNK_SIZE];
+	stream.next_out = state;
+	stream.avail_out = size;
+	int res = Z_OK;
+	while(res == Z_OK)
+	{
+		if(!stream.avail_in)
+		{
+			auto bytesRead = file.readUpTo(in, sizeof(in));
+			if(bytesRead <= 0)
+				break;
+			stream.next_in = in;
+			stream.avail_in = bytesRead;
+		}
+		res = inflate(&stream, Z_NO_FLUSH);
+	}
+	bool complete = res == Z_STREAM_END && !stream.avail_out;
+	inflateEnd(&stream);
+	int result = STATE_RESULT_INVALID_DATA;
+	if(complete)
+		result = EmuSystem::loadStateFromMemory(state, size);
+	else
+		logErr("truncated or corrupt state %s", path);
+	mem_free(state);
+	return result;
+}
@@ -0,0 +1,573 @@
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#define LOGTAG "CheatSearch"
+#include <CheatSearch.hh>
+#include <EmuApp.hh>
+#include <TextEntry.hh>
+#include <imagine/mem/mem.h>
+#include <imagine/util/time/sys.hh>
+#include <stdlib.h>
+#include <errno.h>
+#if defined __x86_64__ || defined __i386__
+#include <emmintrin.h>
+#define SEARCH_SSE2
+#elif defined __ARM_NEON__ || defined __ARM_NEON
+#include <arm_neon.h>
+#define SEARCH_NEON
+#endif
+
+CheatSearch cheatSearch;
+
+// Each Vec type compares N values at once, eq() & gt() return one bit per value
+
+template <class Type>
+struct VecScalar
+{
+	using T = Type;
+	using V = Type;
+	static constexpr uint N = 1;
+	static V load(const T *p) { T v; memcpy(&v, p, sizeof(T)); return v; }
+	static V splat(T v) { return v; }
+	static uint eq(V a, V b) { return a == b; }
+	static uint gt(V a, V b) { return a > b; }
+};
+
+#if defined SEARCH_SSE2
+// SSE2 only has signed compares, unsigned values get their sign bit flipped
+// so they order the same way
+template <class Type, bool isUnsigned>
+struct VecSSE2_8
+{
+	using T = Type;
+	using V = __m128i;
+	static constexpr uint N = 16;
+	static V bias() { return _mm_set1_epi8(isUnsigned ? (char)0x80 : 0); }
+	static V load(const T *p) { return _mm_xor_si128(_mm_loadu_si128((const V*)p), bias()); }
+	static V splat(T v) { return _mm_xor_si128(_mm_set1_epi8(v), bias()); }
+	static uint eq(V a, V b) { return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)); }
+	static uint gt(V a, V b) { return _mm_movemask_epi8(_mm_cmpgt_epi8(a, b)); }
+};
+
+template <class Type, bool isUnsigned>
+struct VecSSE2_16
+{
+	using T = Type;
+	using V = __m128i;
+	static constexpr uint N = 8;
+	static V bias() { return _mm_set1_epi16(isUnsigned ? (short)0x8000 : 0); }
+	static V load(const T *p) { return _mm_xor_si128(_mm_loadu_si128((const V*)p), bias()); }
+	static V splat(T v) { return _mm_xor_si128(_mm_set1_epi16(v), bias()); }
+	static uint mask(V m) { return _mm_movemask_epi8(_mm_packs_epi16(m, _mm_setzero_si128())); }
+	static uint eq(V a, V b) { return mask(_mm_cmpeq_epi16(a, b)); }
+	static uint gt(V a, V b) { return mask(_mm_cmpgt_epi16(a, b)); }
+};
+
+template <class Type, bool isUnsigned>
+struct VecSSE2_32
+{
+	using T = Type;
+	using V = __m128i;
+	static constexpr uint N = 4;
+	static V bias() { return _mm_set1_epi32(isUnsigned ? (int)0x80000000 : 0); }
+	static V load(const T *p) { return _mm_xor_si128(_mm_loadu_si128((const V*)p), bias()); }
+	static V splat(T v) { return _mm_xor_si128(_mm_set1_epi32(v), bias()); }
+	static uint mask(V m) { return _mm_movemask_ps(_mm_castsi128_ps(m)); }
+	static uint eq(V a, V b) { return mask(_mm_cmpeq_epi32(a, b)); }
+	static uint gt(V a, V b) { return mask(_mm_cmpgt_epi32(a, b)); }
+};
+
+using VecU8 = VecSSE2_8<uint8, true>;
+using VecS8 = VecSSE2_8<int8, false>;
+using VecU16 = VecSSE2_16<uint16, true>;
+using VecS16 = VecSSE2_16<int16, false>;
+using VecU32 = VecSSE2_32<uint32, true>;
+using VecS32 = VecSSE2_32<int32, false>;
+#elif defined SEARCH_NEON
+// NEON has no movemask, lanes are weighted by their bit and summed pairwise
+static uint maskNEON8(uint8x16_t m)
+{
+	static const uint8 weight[16] {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+	auto t = vandq_u8(m, vld1q_u8(weight));
+	auto p = vpadd_u8(vget_low_u8(t), vget_high_u8(t));
+	p = vpadd_u8(p, p);
+	p = vpadd_u8(p, p);
+	return vget_lane_u8(p, 0) | (vget_lane_u8(p, 1) << 8);
+}
+
+static uint maskNEON16(uint16x8_t m)
+{
+	static const uint8 weight[8] {1, 2, 4, 8, 16, 32, 64, 128};
+	auto p = vand_u8(vmovn_u16(m), vld1_u8(weight));
+	p = vpadd_u8(p, p);
+	p = vpadd_u8(p, p);
+	p = vpadd_u8(p, p);
+	return vget_lane_u8(p, 0);
+}
+
+static uint maskNEON32(uint32x4_t m)
+{
+	static const uint16 weight[4] {1, 2, 4, 8};
+	auto p = vand_u16(vmovn_u32(m), vld1_u16(weight));
+	p = vpadd_u16(p, p);
+	p = vpadd_u16(p, p);
+	return vget_lane_u16(p, 0);
+}
+
+struct VecU8
+{
+	using T = uint8;
+	using V = uint8x16_t;
+	static constexpr uint N = 16;
+	static V load(const T *p) { return vld1q_u8(p); }
+	static V splat(T v) { return vdupq_n_u8(v); }
+	static uint eq(V a, V b) { return maskNEON8(vceqq_u8(a, b)); }
+	static uint gt(V a, V b) { return maskNEON8(vcgtq_u8(a, b)); }
+};
+
+struct VecS8
+{
+	using T = int8;
+	using V = int8x16_t;
+	static constexpr uint N = 16;
+	static V load(const T *p) { return vld1q_s8(p); }
+	static V splat(T v) { return vdupq_n_s8(v); }
+	static uint eq(V a, V b) { return maskNEON8(vceqq_s8(a, b)); }
+	static uint gt(V a, V b) { return maskNEON8(vcgtq_s8(a, b)); }
+};
+
+struct VecU16
+{
+	using T = uint16;
+	using V = uint16x8_t;
+	static constexpr uint N = 8;
+	static V load(const T *p) { return vld1q_u16(p); }
+	static V splat(T v) { return vdupq_n_u16(v); }
+	static uint eq(V a, V b) { return maskNEON16(vceqq_u16(a, b)); }
+	static uint gt(V a, V b) { return maskNEON16(vcgtq_u16(a, b)); }
+};
+
+struct VecS16
+{
+	using T = int16;
+	using V = int16x8_t;
+	static constexpr uint N = 8;
+	static V load(const T *p) { return vld1q_s16(p); }
+	static V splat(T v) { return vdupq_n_s16(v); }
+	static uint eq(V a, V b) { return maskNEON16(vceqq_s16(a, b)); }
+	static uint gt(V a, V b) { return maskNEON16(vcgtq_s16(a, b)); }
+};
+
+struct VecU32
+{
+	using T = uint32;
+	using V = uint32x4_t;
+	static constexpr uint N = 4;
+	static V load(const T *p) { return vld1q_u32(p); }
+	static V splat(T v) { return vdupq_n_u32(v); }
+	static uint eq(V a, V b) { return maskNEON32(vceqq_u32(a, b)); }
+	static uint gt(V a, V b) { return maskNEON32(vcgtq_u32(a, b)); }
+};
+
+struct VecS32
+{
+	using T = int32;
+	using V = int32x4_t;
+	static constexpr uint N = 4;
+	static V load(const T *p) { return vld1q_s32(p); }
+	static V splat(T v) { return vdupq_n_s32(v); }
+	static uint eq(V a, V b) { return maskNEON32(vceqq_s32(a, b)); }
+	static uint gt(V a, V b) { return maskNEON32(vcgtq_s32(a, b)); }
+};
+#else
+using VecU8 = VecScalar<uint8>;
+using VecS8 = VecScalar<int8>;
+using VecU16 = VecScalar<uint16>;
+using VecS16 = VecScalar<int16>;
+using VecU32 = VecScalar<uint32>;
+using VecS32 = VecScalar<int32>;
+#endif
+
+// every comparison is one of these, optionally with the result inverted
+enum { OP_EQ, OP_GT, OP_LT };
+
+template <class Vec, uint OP, bool usePrevious>
+static uint64 matchValues(const typename Vec::T *cur, const typename Vec::T *prev, typename Vec::V value, uint values)
+{
+	uint64 match = 0;
+	for(uint i = 0; i < values; i += Vec::N)
+	{
+		auto a = Vec::load(cur + i);
+		auto b = usePrevious ? Vec::load(prev + i) : value;
+		uint64 m = OP == OP_EQ ? Vec::eq(a, b) : OP == OP_GT ? Vec::gt(a, b) : Vec::gt(b, a);
+		match |= m << i;
+	}
+	return match;
+}
+
+template <class Vec, uint OP, bool usePrevious>
+static void filterValues(const uint8 *data, const uint8 *saved, uint64 *bits, uint values,
+	uint32 value, uint64 invert)
+{
+	using T = typename Vec::T;
+	using Scalar = VecScalar<T>;
+	auto cur = (const T*)data;
+	auto prev = (const T*)saved;
+	auto v = Vec::splat(value);
+	uint words = values / 64;
+	iterateTimes(words, w)
+	{
+		if(!bits[w])
+			continue;
+		bits[w] &= matchValues<Vec, OP, usePrevious>(cur + w * 64, prev + w * 64, v, 64) ^ invert;
+	}
+	if(uint tail = values % 64)
+	{
+		bits[words] &= matchValues<Scalar, OP, usePrevious>(cur + words * 64, prev + words * 64, value, tail) ^ invert;
+	}
+}
+
+using FilterFunc = void (*)(const uint8 *data, const uint8 *saved, uint64 *bits, uint values,
+	uint32 value, uint64 invert);
+
+template <class Vec>
+static FilterFunc filterFunc(uint op, bool usePrevious)
+{
+	static const FilterFunc func[3][2]
+	{
+		{filterValues<Vec, OP_EQ, false>, filterValues<Vec, OP_EQ, true>},
+		{filterValues<Vec, OP_GT, false>, filterValues<Vec, OP_GT, true>},
+		{filterValues<Vec, OP_LT, false>, filterValues<Vec, OP_LT, true>}
+	};
+	return func[op][usePrevious];
+}
+
+static uint valueBytes(CheatSearch::Size size)
+{
+	return size == CheatSearch::BITS_8 ? 1 : size == CheatSearch::BITS_16 ? 2 : 4;
+}
+
+static uint32 readValue(const uint8 *data, CheatSearch::Size size, bool isSigned)
+{
+	switch(size)
+	{
+		case CheatSearch::BITS_8:
+			return isSigned ? (uint32)(int32)(int8)data[0] : data[0];
+		case CheatSearch::BITS_16:
+		{
+			uint16 v;
+			memcpy(&v, data, 2);
+			return isSigned ? (uint32)(int32)(int16)v : v;
+		}
+		default:
+		{
+			uint32 v;
+			memcpy(&v, data, 4);
+			return v;
+		}
+	}
+}
+
+static void waitForEmuThread()
+{
+	#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+	emuThread.waitForIdle();
+	#endif
+}
+
+bool CheatSearch::start(Size size, bool isSigned)
+{
+	end();
+	waitForEmuThread();
+	CheatSearchRegion sysRegion[MAX_REGIONS];
+	uint sysRegions = EmuSystem::cheatSearchRegions(sysRegion, MAX_REGIONS);
+	uint bytes = valueBytes(size);
+	iterateTimes(sysRegions, i)
+	{
+		auto &src = sysRegion[i];
+		auto &r = region[regions];
+		r.address = src.address;
+		r.values = src.size / bytes;
+		r.data = src.data;
+		uint words = (r.values + 63) / 64;
+		r.saved = (uint8*)mem_alloc(r.values * bytes);
+		r.bits = (uint64*)mem_alloc(words * sizeof(uint64));
+		if(!r.values || !r.saved || !r.bits)
+		{
+			mem_free(r.saved);
+			mem_free(r.bits);
+			continue;
+		}
+		memcpy(r.saved, r.data, r.values * bytes);
+		memset(r.bits, 0xff, words * sizeof(uint64));
+		if(r.values % 64)
+			r.bits[words - 1] = ((uint64)1 << (r.values % 64)) - 1;
+		logMsg("searching %s, %u bytes @ 0x%X", src.name, src.size, src.address);
+		regions++;
+	}
+	var_selfs(size);
+	var_selfs(isSigned);
+	return regions;
+}
+
+void CheatSearch::filter(Compare compare, bool usePrevious, uint32 value)
+{
+	if(!regions)
+		return;
+	waitForEmuThread();
+	static const uint op[] {OP_EQ, OP_EQ, OP_LT, OP_GT, OP_GT, OP_LT};
+	// NE, LE, and GE keep what EQ, GT, and LT reject
+	uint64 invert = (compare == NE || compare == LE || compare == GE) ? ~(uint64)0 : 0;
+	FilterFunc func;
+	switch(size)
+	{
+		bcase BITS_8: func = isSigned ? filterFunc<VecS8>(op[compare], usePrevious) : filterFunc<VecU8>(op[compare], usePrevious);
+		bcase BITS_16: func = isSigned ? filterFunc<VecS16>(op[compare], usePrevious) : filterFunc<VecU16>(op[compare], usePrevious);
+		bdefault: func = isSigned ? filterFunc<VecS32>(op[compare], usePrevious) : filterFunc<VecU32>(op[compare], usePrevious);
+	}
+	auto startTime = TimeSys::now();
+	iterateTimes(regions, i)
+	{
+		auto &r = region[i];
+		func(r.data, r.saved, r.bits, r.values, value, invert);
+		memcpy(r.saved, r.data, r.values * valueBytes(size));
+	}
+	logMsg("%u candidates left after %.3fms", candidates(), (TimeSys::now() - startTime).toNs() / 1000000.);
+}
+
+void CheatSearch::filterPrevious(Compare compare)
+{
+	filter(compare, true, 0);
+}
+
+void CheatSearch::filterValue(Compare compare, uint32 value)
+{
+	filter(compare, false, value);
+}
+
+uint CheatSearch::candidates() const
+{
+	uint count = 0;
+	iterateTimes(regions, i)
+	{
+		auto &r = region[i];
+		iterateTimes((r.values + 63) / 64, w)
+		{
+			count += __builtin_popcountll(r.bits[w]);
+		}
+	}
+	return count;
+}
+
+uint CheatSearch::results(Result *result, uint max) const
+{
+	uint count = 0;
+	uint bytes = valueBytes(size);
+	iterateTimes(regions, i)
+	{
+		auto &r = region[i];
+		iterateTimes((r.values + 63) / 64, w)
+		{
+			for(uint64 bits = r.bits[w]; bits; bits &= bits - 1)
+			{
+				if(count == max)
+					return count;
+				uint idx = w * 64 + __builtin_ctzll(bits);
+				result[count++] = {r.address + idx * bytes, readValue(r.data + idx * bytes, size, isSigned)};
+			}
+		}
+	}
+	return count;
+}
+
+void CheatSearch::end()
+{
+	iterateTimes(regions, i)
+	{
+		mem_free(region[i].saved);
+		mem_free(region[i].bits);
+	}
+	regions = 0;
+}
+
+static const char *compareStr[]
+{
+	"Equal", "Not Equal", "Less Than", "Less Than or Equal", "Greater Than", "Greater Than or Equal"
+};
+
+static int searchSize = CheatSearch::BITS_8;
+static bool searchSigned = false;
+
+CheatSearchView::CheatSearchView(Base::Window &win):
+	BaseMenuView("Search RAM", win),
+	valueSize
+	{
+		"Value Size",
+		[](MultiChoiceMenuItem &, int val)
+		{
+			searchSize = val;
+		}
+	},
+	isSigned
+	{
+		"Signed Values",
+		[this](BoolMenuItem &item, const Input::Event &e)
+		{
+			item.toggle(*this);
+			searchSigned = item.on;
+		}
+	},
+	start
+	{
+		"Start New Search",
+		[this](TextMenuItem &, const Input::Event &e)
+		{
+			if(!cheatSearch.start((CheatSearch::Size)searchSize, searchSigned))
+			{
+				popup.postError("No RAM to search");
+				return;
+			}
+			updateResults();
+		}
+	},
+	comparePrevious
+	{
+		"Compare to Last Search",
+		[this](TextMenuItem &, const Input::Event &e)
+		{
+			pickCompare("Compare to Last Search", e, true);
+		}
+	},
+	compareValue
+	{
+		"Compare to Value",
+		[this](TextMenuItem &, const Input::Event &e)
+		{
+			pickCompare("Compare to Value", e, false);
+		}
+	},
+	results
+	{
+		"Results",
+		[this](DualTextMenuItem &, const Input::Event &e)
+		{
+			if(!cheatSearch.candidates())
+				return;
+			auto &resultsView = *menuAllocator.allocNew<CheatSearchResultsView>(window());
+			resultsView.init(!e.isPointer());
+			viewStack.pushAndShow(resultsView, &menuAllocator);
+		}
+	}
+{}
+
+void CheatSearchView::init(bool highlightFirst)
+{
+	static const char *sizeStr[] {"8-bit", "16-bit", "32-bit"};
+	uint i = 0;
+	valueSize.init(sizeStr, searchSize, sizeofArray(sizeStr)); item[i++] = &valueSize;
+	isSigned.init(searchSigned); item[i++] = &isSigned;
+	start.init(); item[i++] = &start;
+	comparePrevious.init(); item[i++] = &comparePrevious;
+	compareValue.init(); item[i++] = &compareValue;
+	results.init(resultsStr); item[i++] = &results;
+	updateResults();
+	assert(i <= sizeofArray(item));
+	BaseMenuView::init(item, i, highlightFirst);
+}
+
+void CheatSearchView::updateResults()
+{
+	comparePrevious.active = compareValue.active = cheatSearch.isActive();
+	if(cheatSearch.isActive())
+		string_printf(resultsStr, "%u", cheatSearch.candidates());
+	else
+		string_copy(resultsStr, "None");
+	results.t2.setString(resultsStr);
+	results.compile();
+	window().postDraw();
+}
+
+void CheatSearchView::pickCompare(const char *name, const Input::Event &e, bool usePrevious)
+{
+	if(!cheatSearch.isActive())
+		return;
+	auto &multiChoiceView = *menuAllocator.allocNew<MultiChoiceView>(name, window());
+	multiChoiceView.init(compareStr, sizeofArray(compareStr), !e.isPointer());
+	multiChoiceView.onSelect() =
+		[this, usePrevious](int i, const Input::Event &e)
+		{
+			viewStack.popAndShow();
+			auto compare = (CheatSearch::Compare)i;
+			if(usePrevious)
+			{
+				cheatSearch.filterPrevious(compare);
+				updateResults();
+				return 0;
+			}
+			auto &textInputView = *allocModalView<CollectTextInputView>(window());
+			textInputView.init("Input decimal or hex (0x) value", getCollectTextCloseAsset());
+			textInputView.onText() =
+				[this, compare](CollectTextInputView &view, const char *str)
+				{
+					if(str)
+					{
+						char *end;
+						errno = 0;
+						long long value = strtoll(str, &end, 0);
+						if(end == str || *end)
+						{
+							popup.postError("Invalid value");
+							window().postDraw();
+							return 1;
+						}
+						// reject constants the selected size can't hold instead of truncating them
+						uint bits = valueBytes(cheatSearch.valueSize()) * 8;
+						long long min = cheatSearch.valuesAreSigned() ? -(1ll << (bits - 1)) : 0;
+						long long max = cheatSearch.valuesAreSigned() ? (1ll << (bits - 1)) - 1 : (1ll << bits) - 1;
+						if(errno == ERANGE || value < min || value > max)
+						{
+							popup.printf(3, 1, "Value doesn't fit a %s %u-bit search",
+								cheatSearch.valuesAreSigned() ? "signed" : "unsigned", bits);
+							window().postDraw();
+							return 1;
+						}
+						cheatSearch.filterValue(compare, (uint32)value);
+						updateResults();
+					}
+					view.dismiss();
+					return 0;
+				};
+			modalViewController.pushAndShow(textInputView);
+			return 0;
+		};
+	viewStack.pushAndShow(multiChoiceView, &menuAllocator);
+}
+
+void CheatSearchResultsView::init(bool highlightFirst)
+{
+	CheatSearch::Result res[MAX_RESULTS];
+	uint results = cheatSearch.results(res, MAX_RESULTS);
+	uint digits = cheatSearch.valueSize() == CheatSearch::BITS_8 ? 2 : cheatSearch.valueSize() == CheatSearch::BITS_16 ? 4 : 8;
+	iterateTimes(results, i)
+	{
+		string_printf(str[i][0], "%08X", res[i].address);
+		if(cheatSearch.valuesAreSigned())
+			string_printf(str[i][1], "%d", (int)res[i].value);
+		else
+			string_printf(str[i][1], "0x%0*X", digits, res[i].value);
+		result[i].init(str[i][0], str[i][1]); item[i] = &result[i];
+	}
+	BaseMenuView::init(item, results, highlightFirst);
+}
@@ -17,6 +17,9 @@
 #include <EmuApp.hh>
 #include <TextEntry.hh>
 #include <main/EmuCheatViews.hh>
+#ifdef CONFIG_EMUFRAMEWORK_CHEAT_SEARCH
+#include <CheatSearch.hh>
+#endif
 
 static StaticArrayList<RefreshCheatsDelegate*, 2> onRefreshCheatsList;
 
@@ -32,6 +35,18 @@ BaseCheatsView::BaseCheatsView(Base::Window &win):
 			pushAndShow(editCheatListView, &menuAllocator);
 		}
 	},
+	#ifdef CONFIG_EMUFRAMEWORK_CHEAT_SEARCH
+	search
+	{
+		"Search RAM",
+		[this](TextMenuItem &item, const Input::Event &e)
+		{
+			auto &searchView = *menuAllocator.allocNew<CheatSearchView>(window());
+			searchView.init(!e.isPointer());
+			pushAndShow(searchView, &menuAllocator);
+		}
+	},
+	#endif
 	onRefreshCheats
 	{
 		[this]()
@@ -49,6 +64,9 @@ void BaseCheatsView::init(bool highlightFirst)
 	onRefreshCheatsList.emplace_back(&onRefreshCheats);
 	uint i = 0;
 	edit.init(); item[i++] = &edit;
+	#ifdef CONFIG_EMUFRAMEWORK_CHEAT_SEARCH
+	search.init(); item[i++] = &search;
+	#endif
 	loadCheatItems(item, i);
 	assert(i <= sizeofArray(item));
 	BaseMenuView::init(item, i, highlightFirst);
@@ -191,6 +191,17 @@ static bool readConfig2(Io &io)
 			bcase CFGKEY_AUTO_SAVE_STATE: optionAutoSaveState.readFromIO(io, size);
 			bcase CFGKEY_CONFIRM_AUTO_LOAD_STATE: optionConfirmAutoLoadState.readFromIO(io, size);
 			bcase CFGKEY_FRAME_SKIP: optionFrameSkip.readFromIO(io, size);
+			bcase CFGKEY_SHOW_FRAME_STATS: optionShowFrameStats.readFromIO(io, size);
+			#ifdef CONFIG_EMUFRAMEWORK_REWIND
+			bcase CFGKEY_REWIND_MEMORY: optionRewindMemory.readFromIO(io, size);
+			bcase CFGKEY_REWIND_INTERVAL: optionRewindInterval.readFromIO(io, size);
+			#endif
+			#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+			bcase CFGKEY_RUN_AHEAD: optionRunAhead.readFromIO(io, size);
+			#endif
+			#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+			bcase CFGKEY_EMU_THREAD: optionEmuThread.readFromIO(io, size);
+			#endif
 			#if defined(CONFIG_BASE_ANDROID)
 			bcase CFGKEY_DITHER_IMAGE: optionDitherImage.readFromIO(io, size);
 			#endif
@@ -216,6 +227,9 @@ static bool readConfig2(Io &io)
 			#ifdef CONFIG_GFX_OPENGL_SHADER_PIPELINE
 			bcase CFGKEY_IMAGE_EFFECT: optionImgEffect.readFromIO(io, size);
 			#endif
+			#ifdef CONFIG_EMUFRAMEWORK_CPU_FILTER
+			bcase CFGKEY_IMAGE_CPU_FILTER: optionImgCpuFilter.readFromIO(io, size);
+			#endif
 			bcase CFGKEY_OVERLAY_EFFECT: optionOverlayEffect.readFromIO(io, size);
 			bcase CFGKEY_OVERLAY_EFFECT_LEVEL: optionOverlayEffectLevel.readFromIO(io, size);
 			bcase CFGKEY_TOUCH_CONTROL_VIRBRATE: optionVibrateOnPush.readFromIO(io, size);
@@ -428,6 +442,9 @@ static OptionBase *cfgFileOption[] =
 	#ifdef CONFIG_GFX_OPENGL_SHADER_PIPELINE
 	&optionImgEffect,
 	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_CPU_FILTER
+	&optionImgCpuFilter,
+	#endif
 	&optionOverlayEffect,
 	&optionOverlayEffectLevel,
 	#ifdef INPUT_SUPPORTS_RELATIVE_POINTER
@@ -459,6 +476,17 @@ static OptionBase *cfgFileOption[] =
 	&optionSwappedGamepadConfirm,
 	&optionConfirmOverwriteState,
 	&optionFastForwardSpeed,
+	&optionShowFrameStats,
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	&optionRewindMemory,
+	&optionRewindInterval,
+	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+	&optionRunAhead,
+	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+	&optionEmuThread,
+	#endif
 	#ifdef INPUT_HAS_SYSTEM_DEVICE_HOTSWAP
 	&optionNotifyInputDeviceChange,
 	#endif
@@ -22,6 +22,21 @@
 #include "ConfigFile.hh"
 #include <EmuView.hh>
 #include <imagine/gui/AlertView.hh>
+#ifdef CONFIG_EMUFRAMEWORK_HEADLESS_BENCHMARK
+#include <HeadlessBenchmark.hh>
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+#include <Rewind.hh>
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+#include <RunAhead.hh>
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+#include <AsyncStateWriter.hh>
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_LIBRARY_INDEX
+#include <LibraryIndex.hh>
+#endif
 #include <cmath>
 
 bool menuViewIsActive = true;
@@ -160,6 +175,9 @@ void startGameFromMenu()
 	Base::mainWindow().dispatchResize(); // TODO: only do this if needed
 	commonInitInput();
 	emuView.ffGuiKeyPush = emuView.ffGuiTouch = 0;
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	emuView.rewindGuiKeyPush = 0;
+	#endif
 
 	popup.clear();
 	Input::setKeyRepeat(false);
@@ -212,6 +230,12 @@ static void parseCmdLineArgs(int argc, char** argv)
 
 void mainInitCommon(int argc, char** argv)
 {
+	#ifdef CONFIG_EMUFRAMEWORK_HEADLESS_BENCHMARK
+	initOptions();
+	EmuSystem::initOptions();
+	EmuSystem::onOptionsLoaded();
+	::exit(runHeadlessBenchmark(argc, argv));
+	#endif
 	Base::registerInstance(CONFIG_APP_ID, argc, argv);
 	Base::setAcceptIPC(CONFIG_APP_ID, true);
 	initOptions();
@@ -222,6 +246,18 @@ void mainInitCommon(int argc, char** argv)
 	Base::Window::setPixelBestColorHint(optionBestColorModeHint);
 	#endif
 	EmuSystem::onOptionsLoaded();
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	applyRewindOptions();
+	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+	runAhead.setFrames(optionRunAhead);
+	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+	emuThread.setActive(optionEmuThread);
+	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_LIBRARY_INDEX
+	libraryIndex.startScan();
+	#endif
 	doOrAbort(Audio::init());
 	mainWin.init({0, 0}, {0, 0});
 	Base::setIdleDisplayPowerSave(optionIdleDisplayPowerSave);
@@ -321,6 +357,9 @@ void mainInitWindowCommon(Base::Window &win, const Gfx::LGradientStopDesc *navVi
 	#ifdef CONFIG_GFX_OPENGL_SHADER_PIPELINE
 	emuView.vidImgEffect.setEffect(optionImgEffect);
 	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_CPU_FILTER
+	emuView.vidImgFilter.setFilter(optionImgCpuFilter);
+	#endif
 	emuView.vidImgOverlay.setEffect(optionOverlayEffect);
 	emuView.vidImgOverlay.intensity = optionOverlayEffectLevel/100.;
 
@@ -514,6 +553,9 @@ void onExit(bool backgrounded)
 	else
 	{
 		EmuSystem::closeGame();
+		#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+		emuThread.setActive(false);
+		#endif
 	}
 
 	saveConfigFile();
@@ -523,6 +565,15 @@ void onExit(bool backgrounded)
 		Bluetooth::closeBT(bta);
 	#endif
 
+	#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+	stateWriter.waitForIdle();
+	#endif
+
+	#ifdef CONFIG_EMUFRAMEWORK_LIBRARY_INDEX
+	if(!backgrounded)
+		libraryIndex.cancelScan();
+	#endif
+
 	#ifdef CONFIG_BASE_IOS
 	if(backgrounded)
 		FsSys::remove("/private/var/mobile/Library/Caches/" CONFIG_APP_ID "/com.apple.opengl/shaders.maps");
@@ -197,7 +197,7 @@ void processRelPtr(const Input::Event &e)
 	{
 		//logMsg("reversed trackball X direction");
 		relPtr.x = e.x;
-		EmuSystem::handleInputAction(Input::RELEASED, relPtr.xAction);
+		EmuSystem::postInputAction(Input::RELEASED, relPtr.xAction);
 	}
 	else
 		relPtr.x += e.x;
@@ -205,14 +205,14 @@ void processRelPtr(const Input::Event &e)
 	if(e.x)
 	{
 		relPtr.xAction = EmuSystem::translateInputAction(e.x > 0 ? EmuControls::systemKeyMapStart+1 : EmuControls::systemKeyMapStart+3);
-		EmuSystem::handleInputAction(Input::PUSHED, relPtr.xAction);
+		EmuSystem::postInputAction(Input::PUSHED, relPtr.xAction);
 	}
 
 	if(relPtr.y != 0 && signOf(relPtr.y) != signOf(e.y))
 	{
 		//logMsg("reversed trackball Y direction");
 		relPtr.y = e.y;
-		EmuSystem::handleInputAction(Input::RELEASED, relPtr.yAction);
+		EmuSystem::postInputAction(Input::RELEASED, relPtr.yAction);
 	}
 	else
 		relPtr.y += e.y;
@@ -220,7 +220,7 @@ void processRelPtr(const Input::Event &e)
 	if(e.y)
 	{
 		relPtr.yAction = EmuSystem::translateInputAction(e.y > 0 ? EmuControls::systemKeyMapStart+2 : EmuControls::systemKeyMapStart);
-		EmuSystem::handleInputAction(Input::PUSHED, relPtr.yAction);
+		EmuSystem::postInputAction(Input::PUSHED, relPtr.yAction);
 	}
 
 	//logMsg("trackball event %d,%d, rel ptr %d,%d", e.x, e.y, relPtr.x, relPtr.y);
@@ -246,12 +246,12 @@ void commonUpdateInput()
 			if(turboClock == 0)
 			{
 				//logMsg("turbo push for player %d, action %d", e->player, e->action);
-				EmuSystem::handleInputAction(Input::PUSHED, e->action);
+				EmuSystem::postInputAction(Input::PUSHED, e->action);
 			}
 			else if(turboClock == turboFrames/2)
 			{
 				//logMsg("turbo release for player %d, action %d", e->player, e->action);
-				EmuSystem::handleInputAction(Input::RELEASED, e->action);
+				EmuSystem::postInputAction(Input::RELEASED, e->action);
 			}
 		}
 	}
@@ -263,13 +263,13 @@ void commonUpdateInput()
 	{
 		relPtr.x = clipToZeroSigned(relPtr.x, (int)optionRelPointerDecel * -signOf(relPtr.x));
 		if(!relPtr.x)
-			EmuSystem::handleInputAction(Input::RELEASED, relPtr.xAction);
+			EmuSystem::postInputAction(Input::RELEASED, relPtr.xAction);
 	}
 	if(relPtr.y)
 	{
 		relPtr.y = clipToZeroSigned(relPtr.y, (int)optionRelPointerDecel * -signOf(relPtr.y));
 		if(!relPtr.y)
-			EmuSystem::handleInputAction(Input::RELEASED, relPtr.yAction);
+			EmuSystem::postInputAction(Input::RELEASED, relPtr.yAction);
 	}
 #endif
 }
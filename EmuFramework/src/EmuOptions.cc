@@ -18,6 +18,12 @@
 #include <EmuSystem.hh>
 #include <EmuInput.hh>
 #include <VideoImageEffect.hh>
+#ifdef CONFIG_EMUFRAMEWORK_CPU_FILTER
+#include <VideoImageFilter.hh>
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+#include <RunAhead.hh>
+#endif
 #include "VController.hh"
 #ifdef CONFIG_EMUFRAMEWORK_VCONTROLS
 extern SysVController vController;
@@ -81,6 +87,17 @@ Byte1Option optionHideStatusBar(CFGKEY_HIDE_STATUS_BAR, 1, (!Config::envIsAndroi
 OptionSwappedGamepadConfirm optionSwappedGamepadConfirm(CFGKEY_SWAPPED_GAMEPAD_CONFIM, Input::SWAPPED_GAMEPAD_CONFIRM_DEFAULT);
 Byte1Option optionConfirmOverwriteState(CFGKEY_CONFIRM_OVERWRITE_STATE, 1, 0);
 Byte1Option optionFastForwardSpeed(CFGKEY_FAST_FORWARD_SPEED, 4, 0, optionIsValidWithMinMax<2, 7>);
+Byte1Option optionShowFrameStats(CFGKEY_SHOW_FRAME_STATS, 0, 0);
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+Byte1Option optionRewindMemory(CFGKEY_REWIND_MEMORY, 0, 0, optionIsValidWithMax<128>);
+Byte1Option optionRewindInterval(CFGKEY_REWIND_INTERVAL, 2, 0, optionIsValidWithMinMax<1, 8>);
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+Byte1Option optionRunAhead(CFGKEY_RUN_AHEAD, 0, 0, optionIsValidWithMax<RunAhead::MAX_FRAMES>);
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+Byte1Option optionEmuThread(CFGKEY_EMU_THREAD, 0);
+#endif
 #ifdef INPUT_HAS_SYSTEM_DEVICE_HOTSWAP
 Byte1Option optionNotifyInputDeviceChange(CFGKEY_NOTIFY_INPUT_DEVICE_CHANGE, Input::hasSystemDeviceHotswap, !Input::hasSystemDeviceHotswap);
 #endif
@@ -101,6 +118,9 @@ Byte4s1Option optionImgFilter(CFGKEY_GAME_IMG_FILTER, Gfx::BufferImage::LINEAR,
 #ifdef CONFIG_GFX_OPENGL_SHADER_PIPELINE
 Byte1Option optionImgEffect(CFGKEY_IMAGE_EFFECT, 0, 0, optionIsValidWithMax<VideoImageEffect::MAX_EFFECT_VAL>);
 #endif
+#ifdef CONFIG_EMUFRAMEWORK_CPU_FILTER
+Byte1Option optionImgCpuFilter(CFGKEY_IMAGE_CPU_FILTER, 0, 0, optionIsValidWithMax<VideoImageFilter::MAX_FILTER_VAL>);
+#endif
 Byte1Option optionOverlayEffect(CFGKEY_OVERLAY_EFFECT, 0, 0, optionIsValidWithMax<VideoImageOverlay::MAX_EFFECT_VAL>);
 Byte1Option optionOverlayEffectLevel(CFGKEY_OVERLAY_EFFECT_LEVEL, 25, 0, optionIsValidWithMax<100>);
 
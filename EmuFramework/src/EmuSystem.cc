@@ -17,7 +17,16 @@
 #include <EmuOptions.hh>
 #include <EmuApp.hh>
 #include <imagine/audio/Audio.hh>
+#include <imagine/io/IoZip.hh>
+#include <FrameSkip.hh>
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+#include <Rewind.hh>
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_CHEAT_SEARCH
+#include <CheatSearch.hh>
+#endif
 #include <algorithm>
+#include <cmath>
 
 EmuSystem::State EmuSystem::state = EmuSystem::State::OFF;
 FsSys::cPath EmuSystem::gamePath_ = "";
@@ -58,6 +67,92 @@ void EmuSystem::startAutoSaveStateTimer()
 	}
 }
 
+// Dynamic rate control: the emulated audio is stretched or shrunk by up to
+// 0.5% so the output buffer hovers around half full, absorbing the drift
+// between the video and audio clocks without underruns or overruns
+static constexpr double maxRateAdjust = 0.005;
+static uint audioBufferFrames = 0; // largest free space seen, approximates buffer size
+static double resamplePos = 0; // fractional position past the last frame of the previous block
+static int16 resampleLast[2]{};
+static int16 *resampleBuff = nullptr; // grows to fit the largest block written
+static uint resampleBuffFrames = 0;
+
+static void resetRateControl()
+{
+	audioBufferFrames = 0;
+	resamplePos = 0;
+	mem_zero(resampleLast);
+}
+
+// percent of the output buffer holding samples, -1 if unknown
+static int audioBufferFill()
+{
+	if(!Audio::isPlaying() || audioBufferFrames <= EmuSystem::audioFramesPerVideoFrame * 2)
+		return -1;
+	int framesFree = std::min(std::max(Audio::framesFree(), 0), (int)audioBufferFrames);
+	return (audioBufferFrames - framesFree) * 100 / audioBufferFrames;
+}
+
+static double rateControlStep()
+{
+	int framesFree = Audio::framesFree();
+	audioBufferFrames = std::max(audioBufferFrames, (uint)std::max(framesFree, 0));
+	if(!Audio::isPlaying() || audioBufferFrames <= EmuSystem::audioFramesPerVideoFrame * 2)
+		return 1.;
+	double half = audioBufferFrames / 2.;
+	double fill = audioBufferFrames - framesFree;
+	double error = std::min(std::max((fill - half) / half, -1.), 1.);
+	// consume input faster than real-time when the buffer is over half full
+	return 1. + error * maxRateAdjust;
+}
+
+// linear interpolation over 16-bit interleaved frames, returns frames output
+// most frames resample() can produce from inFrames, the step is never below 1 - maxRateAdjust
+// and the position carried over from the last block is under one step
+static uint maxResampledFrames(uint inFrames)
+{
+	return std::ceil(inFrames / (1. - maxRateAdjust)) + 1;
+}
+
+static bool reserveResampleBuff(uint frames, uint channels)
+{
+	if(frames <= resampleBuffFrames)
+		return true;
+	auto newBuff = (int16*)mem_realloc(resampleBuff, frames * channels * sizeof(int16));
+	if(!newBuff)
+		return false;
+	resampleBuff = newBuff;
+	resampleBuffFrames = frames;
+	return true;
+}
+
+static uint resample(const int16 *in, uint inFrames, int16 *out, uint maxOutFrames, uint channels, double step)
+{
+	uint outFrames = 0;
+	double pos = resamplePos;
+	// pos 0 corresponds to resampleLast, pos i to in[i-1]
+	while(pos < inFrames && outFrames < maxOutFrames)
+	{
+		uint i = pos;
+		auto frac = pos - i;
+		const int16 *a = i ? &in[(i-1)*channels] : resampleLast;
+		const int16 *b = &in[i*channels];
+		iterateTimes(channels, c)
+		{
+			out[outFrames*channels + c] = a[c] + (b[c] - a[c]) * frac;
+		}
+		outFrames++;
+		pos += step;
+	}
+	// input past a full output buffer is dropped
+	resamplePos = std::max(pos - inFrames, 0.);
+	iterateTimes(channels, c)
+	{
+		resampleLast[c] = in[(inFrames-1)*channels + c];
+	}
+	return outFrames;
+}
+
 void EmuSystem::startSound()
 {
 	assert(audioFramesPerVideoFrame);
@@ -71,6 +166,7 @@ void EmuSystem::startSound()
 			Audio::setHintOutputLatency(wantedLatency);
 			#endif
 			Audio::openPcm(pcmFormat);
+			resetRateControl();
 		}
 		else if(Audio::framesFree() <= (int)audioFramesPerVideoFrame)
 			Audio::resumePcm();
@@ -88,22 +184,36 @@ void EmuSystem::stopSound()
 
 void EmuSystem::writeSound(const void *samples, uint framesToWrite)
 {
-	Audio::writePcm(samples, framesToWrite);
+	// the benchmark runner only generates samples for timing purposes
+	#ifndef CONFIG_EMUFRAMEWORK_HEADLESS_BENCHMARK
+	auto step = rateControlStep();
+	uint channels = pcmFormat.channels;
+	if(framesToWrite && pcmFormat.sample.toBits() == 16 && channels <= 2
+		&& reserveResampleBuff(maxResampledFrames(framesToWrite), channels))
+	{
+		uint frames = resample((const int16*)samples, framesToWrite, resampleBuff, resampleBuffFrames, channels, step);
+		Audio::writePcm(resampleBuff, frames);
+	}
+	else
+		Audio::writePcm(samples, framesToWrite);
 	if(!Audio::isPlaying() && Audio::framesFree() <= (int)audioFramesPerVideoFrame)
 	{
 		logMsg("starting audio playback with %d frames free in buffer", Audio::framesFree());
 		Audio::resumePcm();
 	}
+	#endif
 }
 
 void EmuSystem::commitSound(Audio::BufferContext buffer, uint frames)
 {
+	#ifndef CONFIG_EMUFRAMEWORK_HEADLESS_BENCHMARK
 	Audio::commitPlayBuffer(buffer, frames);
 	if(!Audio::isPlaying() && Audio::framesFree() <= (int)audioFramesPerVideoFrame)
 	{
 		logMsg("starting audio playback with %d frames free in buffer", Audio::framesFree());
 		Audio::resumePcm();
 	}
+	#endif
 }
 
 bool EmuSystem::stateExists(int slot)
@@ -134,9 +244,20 @@ bool EmuSystem::shouldOverwriteExistingState()
 //static int autoFrameSkipLevel = 0;
 //static int lowBufferFrames = (audio_maxRate/60)*3, highBufferFrames = (audio_maxRate/60)*5;
 
+void EmuSystem::postInputAction(uint state, uint emuKey)
+{
+	#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+	if(emuThread.isActive())
+	{
+		emuThread.postInputAction(state, emuKey);
+		return;
+	}
+	#endif
+	handleInputAction(state, emuKey);
+}
+
 int EmuSystem::setupFrameSkip(uint optionVal, Base::FrameTimeBase frameTime)
 {
-	static const uint maxFrameSkip = 6;
 	static const double ntscNSecs = 1000000000./60., palNSecs = 1000000000./50.;
 	static const auto ntscFrameTime = Base::decimalFrameTimeBaseFromSec(1./60.),
 			palFrameTime = Base::decimalFrameTimeBaseFromSec(1./50.);
@@ -186,8 +307,10 @@ int EmuSystem::setupFrameSkip(uint optionVal, Base::FrameTimeBase frameTime)
 	}
 	else
 	{
-		uint skip = std::min((emuFrame - emuFrameNow) - 1, (int)maxFrameSkip);
-		emuFrameNow = emuFrame;
+		uint carriedFrames;
+		uint skip = frameSkipScheduler.framesToSkip(emuFrame - emuFrameNow, audioBufferFill(),
+			vidSysIsPAL() ? 20. : 1000./60., carriedFrames);
+		emuFrameNow = emuFrame - carriedFrames;
 		if(skip)
 		{
 			//logMsg("skipping %u frames", skip);
@@ -300,14 +423,25 @@ void EmuSystem::closeGame(bool allowAutosaveState)
 {
 	if(gameIsRunning())
 	{
+		#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+		emuThread.waitForIdle();
+		#endif
 		if(Audio::isOpen())
 			Audio::clearPcm();
 		if(allowAutosaveState)
 			saveAutoState();
 		logMsg("closing game %s", gameName_);
 		closeSystem();
+		// zip indexes only speed up a game opening several files from its archive
+		IoZip::clearIndexCache();
 		clearGamePaths();
 		cancelAutoSaveStateTimer();
+		#ifdef CONFIG_EMUFRAMEWORK_REWIND
+		rewindBuffer.reset();
+		#endif
+		#ifdef CONFIG_EMUFRAMEWORK_CHEAT_SEARCH
+		cheatSearch.end();
+		#endif
 		viewNav.setRightBtnActive(0);
 		state = State::OFF;
 	}
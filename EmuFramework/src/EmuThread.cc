@@ -0,0 +1,239 @@
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+
+#define LOGTAG "EmuThread"
+#include <EmuThread.hh>
+#include <EmuSystem.hh>
+#include <FrameSkip.hh>
+#include <imagine/mem/mem.h>
+#include <algorithm>
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+#include <Rewind.hh>
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+#include <RunAhead.hh>
+#endif
+
+EmuThread emuThread;
+
+bool EmuThread::setActive(bool on)
+{
+	if(on == active)
+		return true;
+	if(!on)
+	{
+		waitForIdle();
+		active = false;
+		stop();
+		applyInputActions();
+		logMsg("emulation moved to main thread");
+		return true;
+	}
+	if(!syncCreated)
+	{
+		mutex.create();
+		workCond.create(mutex);
+		idleCond.create(mutex);
+		syncCreated = true;
+	}
+	mutex.lock();
+	quit = false;
+	if(!thread.create(0,
+		[this](ThreadPThread &thread)
+		{
+			run();
+			return 0;
+		}))
+	{
+		mutex.unlock();
+		return false;
+	}
+	// wait for the thread to record its id
+	while(!started)
+		idleCond.wait();
+	mutex.unlock();
+	active = true;
+	logMsg("emulation moved to separate thread");
+	return true;
+}
+
+void EmuThread::stop()
+{
+	mutex.lock();
+	quit = true;
+	workCond.signal();
+	mutex.unlock();
+	thread.join();
+	started = false;
+}
+
+void EmuThread::requestFrames(FrameRequest req)
+{
+	mutex.lock();
+	if(req.rewind)
+	{
+		pending.rewind = true;
+		pending.fastForward = false;
+	}
+	else if(req.fastForward)
+	{
+		pending.fastForward = true;
+	}
+	else
+	{
+		pending.fastForward = false;
+		pending.frames = std::min(pending.frames + req.frames, MAX_PENDING_FRAMES);
+		pending.renderAudio = req.renderAudio;
+	}
+	workCond.signal();
+	mutex.unlock();
+}
+
+void EmuThread::waitForIdle()
+{
+	if(!active)
+		return;
+	mutex.lock();
+	pending = {};
+	while(busy)
+		idleCond.wait();
+	mutex.unlock();
+}
+
+void EmuThread::postInputAction(uint state, uint emuKey)
+{
+	mutex.lock();
+	if(inputActions == MAX_INPUT_ACTIONS)
+	{
+		logWarn("input action queue full");
+		mutex.unlock();
+		return;
+	}
+	inputAction[inputActions++] = {state, emuKey};
+	mutex.unlock();
+}
+
+void EmuThread::applyInputActions()
+{
+	mutex.lock();
+	uint actions = inputActions;
+	InputAction action[MAX_INPUT_ACTIONS];
+	std::copy(inputAction, inputAction + actions, action);
+	inputActions = 0;
+	mutex.unlock();
+	iterateTimes(actions, i)
+	{
+		EmuSystem::handleInputAction(action[i].state, action[i].emuKey);
+	}
+}
+
+void EmuThread::postFrame(const IG::Pixmap &pix)
+{
+	auto &s = slot[backSlot];
+	uint bytes = pix.sizeOfPixels(pix.x * pix.y);
+	if(s.capacity < bytes)
+	{
+		mem_freeSafe(s.data);
+		s.data = (char*)mem_alloc(bytes);
+		if(!s.data)
+		{
+			logErr("out of memory allocating frame buffer");
+			s.capacity = 0;
+			return;
+		}
+		s.capacity = bytes;
+	}
+	new(&s.pix) IG::Pixmap(pix.format);
+	s.pix.init(s.data, pix.x, pix.y);
+	pix.copy(0, 0, 0, 0, s.pix, 0, 0);
+	backSlot = readySlot.exchange(backSlot | FRAME_FRESH) & ~FRAME_FRESH;
+}
+
+IG::Pixmap *EmuThread::takeFrame()
+{
+	if(!(readySlot.load() & FRAME_FRESH))
+		return nullptr;
+	frontSlot = readySlot.exchange(frontSlot) & ~FRAME_FRESH;
+	auto &s = slot[frontSlot];
+	return s.data ? &s.pix : nullptr;
+}
+
+void EmuThread::run()
+{
+	mutex.lock();
+	threadId = pthread_self();
+	started = true;
+	idleCond.broadcast();
+	for(;;)
+	{
+		while(!quit && !pending.frames && !pending.fastForward && !pending.rewind)
+			workCond.wait();
+		if(quit)
+		{
+			mutex.unlock();
+			return;
+		}
+		auto req = pending;
+		pending.frames = 0;
+		pending.rewind = false;
+		busy = true;
+		mutex.unlock();
+		applyInputActions();
+		runRequest(req);
+		mutex.lock();
+		busy = false;
+		idleCond.broadcast();
+	}
+}
+
+void EmuThread::runRequest(FrameRequest req)
+{
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	if(req.rewind)
+	{
+		if(rewindBuffer.rewind())
+			EmuSystem::runFrame(1, 1, 0);
+		return;
+	}
+	#endif
+	if(req.fastForward)
+	{
+		// only render when the previous frame was presented
+		bool renderGfx = !(readySlot.load() & FRAME_FRESH);
+		EmuSystem::runFrame(renderGfx, renderGfx, 0);
+		return;
+	}
+	if(req.frames > 1)
+	{
+		auto skipStartTime = TimeSys::now();
+		iterateTimes(req.frames - 1, i)
+		{
+			EmuSystem::runFrame(0, 0, req.renderAudio);
+		}
+		frameSkipScheduler.addEmulateTime(false, req.frames - 1, TimeSys::now() - skipStartTime);
+	}
+	auto frameStartTime = TimeSys::now();
+	#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+	if(runAhead.isActive())
+		runAhead.runFrame(req.renderAudio);
+	else
+	#endif
+	EmuSystem::runFrame(1, 1, req.renderAudio);
+	frameSkipScheduler.addEmulateTime(true, 1, TimeSys::now() - frameStartTime);
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	rewindBuffer.frameComplete();
+	#endif
+}
@@ -20,6 +20,13 @@
 #include <imagine/gui/AlertView.hh>
 #include <FilePicker.hh>
 #include <Screenshot.hh>
+#include <FrameSkip.hh>
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+#include <Rewind.hh>
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+#include <RunAhead.hh>
+#endif
 #include <algorithm>
 
 extern bool touchControlsAreOn;
@@ -227,12 +234,50 @@ void EmuView::drawContent()
 		vController.draw(touchControlsAreOn && touchControlsApplicable(), ffGuiKeyPush || ffGuiTouch);
 	}
 	#endif
+	if(optionShowFrameStats && frameStatsText.str)
+		drawFrameStats();
 	popup.draw();
 }
 
 template void EmuView::drawContent<0>();
 template void EmuView::drawContent<1>();
 
+void EmuView::updateFrameStatsText()
+{
+	auto &stats = frameSkipScheduler.stats();
+	char audioFillStr[8] = "n/a";
+	if(stats.audioFill != -1)
+		snprintf(audioFillStr, sizeof(audioFillStr), "%d%%", stats.audioFill);
+	auto len = snprintf(frameStatsStr, sizeof(frameStatsStr), "skips/s %.1f\nemulate %.2fms (%.2fms)\npresent %.2fms\naudio %s",
+		stats.skipsPerSec, stats.emulateMs, stats.skipEmulateMs, stats.presentMs, audioFillStr);
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	if(rewindBuffer.isInit() && len > 0 && len < (int)sizeof(frameStatsStr))
+	{
+		snprintf(frameStatsStr + len, sizeof(frameStatsStr) - len, "\nrewind %.2fms/%.2fms",
+			rewindBuffer.avgCaptureMs(), rewindBuffer.avgRewindMs());
+	}
+	#endif
+	if(!frameStatsText.face)
+		frameStatsText.init(View::defaultFace);
+	frameStatsText.setString(frameStatsStr);
+	frameStatsText.compile();
+}
+
+void EmuView::drawFrameStats()
+{
+	using namespace Gfx;
+	noTexProgram.use(projP.makeTranslate());
+	setBlendMode(BLEND_MODE_ALPHA);
+	setColor(0., 0., 0., .5);
+	Gfx::GC pad = frameStatsText.nominalHeight * .25;
+	GCRect rect(-projP.wHalf(), projP.hHalf() - frameStatsText.ySize - pad * 2,
+		-projP.wHalf() + frameStatsText.xSize + pad * 2, projP.hHalf());
+	GeomRect::draw(rect);
+	setColor(1., 1., 1., 1.);
+	texAlphaProgram.use();
+	frameStatsText.draw(projP.alignToPixel(Gfx::GP{rect.x + pad, rect.yCenter()}), LC2DO);
+}
+
 void EmuView::draw(Base::FrameTimeBase frameTime)
 {
 	using namespace Gfx;
@@ -253,10 +298,69 @@ void EmuView::draw(Base::FrameTimeBase frameTime)
 	}
 }
 
+#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+void EmuView::requestThreadFrames(Base::FrameTimeBase frameTime, bool renderAudio)
+{
+	EmuThread::FrameRequest req;
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	if(unlikely(rewindGuiKeyPush))
+		req.rewind = true;
+	else
+	#endif
+	if(unlikely(ffGuiKeyPush || ffGuiTouch))
+		req.fastForward = true;
+	else
+	{
+		int framesToSkip = EmuSystem::setupFrameSkip(optionFrameSkip, frameTime);
+		if(framesToSkip == -1)
+			return;
+		req.frames = framesToSkip + 1;
+		req.renderAudio = renderAudio;
+	}
+	emuThread.requestFrames(req);
+}
+
+void EmuView::presentThreadFrame()
+{
+	auto startTime = TimeSys::now();
+	if(auto pix = emuThread.takeFrame())
+	{
+		writeVideoTexture(*pix);
+	}
+	drawContent<1>();
+	frameSkipScheduler.addPresentTime(TimeSys::now() - startTime, false);
+}
+#endif
+
 void EmuView::runFrame(Base::FrameTimeBase frameTime)
 {
 	commonUpdateInput();
 	bool renderAudio = optionSound;
+	if(frameSkipScheduler.updateStats() && optionShowFrameStats)
+		updateFrameStatsText();
+
+	#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+	if(emuThread.isActive())
+	{
+		requestThreadFrames(frameTime, renderAudio);
+		presentThreadFrame();
+		return;
+	}
+	#endif
+
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	if(unlikely(rewindGuiKeyPush))
+	{
+		if(!rewindBuffer.rewind())
+		{
+			// out of history, hold the current frame
+			drawContent<1>();
+			return;
+		}
+		EmuSystem::runFrame(1, 1, 0);
+		return;
+	}
+	#endif
 
 	if(unlikely(ffGuiKeyPush || ffGuiTouch))
 	{
@@ -270,10 +374,12 @@ void EmuView::runFrame(Base::FrameTimeBase frameTime)
 		int framesToSkip = EmuSystem::setupFrameSkip(optionFrameSkip, frameTime);
 		if(framesToSkip > 0)
 		{
+			auto skipStartTime = TimeSys::now();
 			iterateTimes(framesToSkip, i)
 			{
 				EmuSystem::runFrame(0, 0, renderAudio);
 			}
+			frameSkipScheduler.addEmulateTime(false, framesToSkip, TimeSys::now() - skipStartTime);
 		}
 		else if(framesToSkip == -1)
 		{
@@ -282,7 +388,17 @@ void EmuView::runFrame(Base::FrameTimeBase frameTime)
 		}
 	}
 
+	auto frameStartTime = TimeSys::now();
+	#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+	if(runAhead.isActive())
+		runAhead.runFrame(renderAudio);
+	else
+	#endif
 	EmuSystem::runFrame(1, 1, renderAudio);
+	frameSkipScheduler.addEmulateTime(true, 1, TimeSys::now() - frameStartTime);
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	rewindBuffer.frameComplete();
+	#endif
 }
 
 void EmuView::place()
@@ -400,6 +516,14 @@ void EmuView::inputEvent(const Input::Event &e)
 						logMsg("fast-forward key state: %d", ffGuiKeyPush);
 					}
 
+					#ifdef CONFIG_EMUFRAMEWORK_REWIND
+					bcase guiKeyIdxRewind:
+					{
+						rewindGuiKeyPush = e.state == Input::PUSHED;
+						logMsg("rewind key state: %d", rewindGuiKeyPush);
+					}
+					#endif
+
 					bcase guiKeyIdxLoadGame:
 					if(e.state == Input::PUSHED)
 					{
@@ -424,14 +548,19 @@ void EmuView::inputEvent(const Input::Event &e)
 					bcase guiKeyIdxSaveState:
 					if(e.state == Input::PUSHED)
 					{
+						#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+						emuThread.waitForIdle();
+						#endif
 						static auto doSaveState =
 							[]()
 							{
 								int ret = EmuSystem::saveState();
 								if(ret != STATE_RESULT_OK)
 									popup.postError(stateResultToStr(ret));
+								#ifndef CONFIG_EMUFRAMEWORK_ASYNC_STATE
 								else
 									popup.post("State Saved");
+								#endif
 							};
 
 						if(EmuSystem::shouldOverwriteExistingState())
@@ -462,6 +591,9 @@ void EmuView::inputEvent(const Input::Event &e)
 					bcase guiKeyIdxLoadState:
 					if(e.state == Input::PUSHED)
 					{
+						#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+						emuThread.waitForIdle();
+						#endif
 						int ret = EmuSystem::loadState();
 						if(ret != STATE_RESULT_OK && ret != STATE_RESULT_OTHER_ERROR)
 						{
@@ -492,6 +624,9 @@ void EmuView::inputEvent(const Input::Event &e)
 					bcase guiKeyIdxGameScreenshot:
 					if(e.state == Input::PUSHED)
 					{
+						#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+						emuThread.waitForIdle();
+						#endif
 						takeGameScreenshot();
 						return;
 					}
@@ -529,7 +664,7 @@ void EmuView::inputEvent(const Input::Event &e)
 								turboActions.removeEvent(sysAction);
 							}
 						}
-						EmuSystem::handleInputAction(e.state, sysAction);
+						EmuSystem::postInputAction(e.state, sysAction);
 					}
 				}
 			}
@@ -557,8 +692,34 @@ void EmuView::placeEffect()
 
 void EmuView::updateAndDrawContent()
 {
-	vidImg.write(vidPix, vidPixAlign);
+	// the benchmark runner has no graphics context
+	#ifndef CONFIG_EMUFRAMEWORK_HEADLESS_BENCHMARK
+	#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+	if(emuThread.onEmuThread())
+	{
+		emuThread.postFrame(vidPix);
+		return;
+	}
+	#endif
+	auto startTime = TimeSys::now();
+	writeVideoTexture(vidPix);
 	drawContent<1>();
+	frameSkipScheduler.addPresentTime(TimeSys::now() - startTime, true);
+	#endif
+}
+
+void EmuView::writeVideoTexture(IG::Pixmap &pix)
+{
+	IG::Pixmap *texPix = &pix;
+	#ifdef CONFIG_EMUFRAMEWORK_CPU_FILTER
+	texPix = &vidImgFilter.apply(pix);
+	#endif
+	if(texPix->x != vidImgX || texPix->y != vidImgY)
+	{
+		resizeVideoTexture(*texPix);
+		compileDefaultPrograms();
+	}
+	vidImg.write(*texPix, texPix == &vidPix ? vidPixAlign : Gfx::BufferImage::bestAlignment(*texPix));
 }
 
 void EmuView::initPixmap(char *pixBuff, const PixelFormatDesc *format, uint x, uint y, uint pitch)
@@ -573,6 +734,11 @@ void EmuView::initPixmap(char *pixBuff, const PixelFormatDesc *format, uint x, u
 
 void EmuView::compileDefaultPrograms()
 {
+	#ifndef CONFIG_EMUFRAMEWORK_HEADLESS_BENCHMARK
+	#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+	if(emuThread.onEmuThread())
+		return; // compiled by the renderer when it resizes the texture
+	#endif
 	auto compiled = disp.compileDefaultProgram(Gfx::IMG_MODE_REPLACE);
 	compiled |= disp.compileDefaultProgram(Gfx::IMG_MODE_MODULATE);
 	#ifdef CONFIG_GFX_OPENGL_SHADER_PIPELINE
@@ -584,11 +750,14 @@ void EmuView::compileDefaultPrograms()
 	#endif
 	if(compiled)
 		Gfx::autoReleaseShaderCompiler();
+	#endif
 }
 
 void EmuView::reinitImage()
 {
 	vidImg.init(vidPix, 0, optionImgFilter);
+	vidImgX = vidPix.x;
+	vidImgY = vidPix.y;
 	disp.setImg(&vidImg);
 	compileDefaultPrograms();
 }
@@ -606,9 +775,23 @@ void EmuView::resizeImage(uint xO, uint yO, uint x, uint y, uint totalX, uint to
 	else
 		basePix.init(pixBuff, totalX, totalY);
 	vidPix.initSubPixmap(basePix, xO, yO, x, y);
-	vidImg.init(vidPix, 0, optionImgFilter);
-	vidPixAlign = vidImg.bestAlignment(vidPix);
-	logMsg("using %d:%d:%d:%d region of %d,%d pixmap for EmuView, aligned to min %d bytes", xO, yO, x, y, totalX, totalY, vidPixAlign);
+	#ifndef CONFIG_EMUFRAMEWORK_HEADLESS_BENCHMARK
+	logMsg("using %d:%d:%d:%d region of %d,%d pixmap for EmuView", xO, yO, x, y, totalX, totalY);
+	#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+	if(emuThread.onEmuThread())
+		return; // texture is resized when the renderer presents the frame
+	#endif
+	resizeVideoTexture(vidPix);
+	#endif
+}
+
+void EmuView::resizeVideoTexture(IG::Pixmap &pix)
+{
+	vidImg.init(pix, 0, optionImgFilter);
+	vidPixAlign = vidImg.bestAlignment(pix);
+	logMsg("video texture %dx%d, aligned to min %d bytes", pix.x, pix.y, vidPixAlign);
+	vidImgX = pix.x;
+	vidImgY = pix.y;
 	disp.setImg(&vidImg);
 	if((uint)optionImageZoom > 100)
 		placeEmu();
@@ -19,17 +19,27 @@
 #include <EmuOptions.hh>
 #include <EmuApp.hh>
 #include <Recent.hh>
+#ifdef CONFIG_EMUFRAMEWORK_LIBRARY_INDEX
+#include <LibraryIndex.hh>
+#endif
 #include <imagine/gui/FSPicker.hh>
 #include <imagine/gui/AlertView.hh>
 
 void EmuFilePicker::init(bool highlightFirst, bool pickingDir, FsDirFilterFunc filter, bool singleDir)
 {
+	#ifdef CONFIG_EMUFRAMEWORK_LIBRARY_INDEX
+	// the index only holds listings made with the default filter
+	if(filter == defaultFsFilter)
+		listDir() = [](const char *path, FsSys &dir) { return libraryIndex.listDir(path, dir); };
+	else
+		listDir() = {};
+	#endif
 	FSPicker::init(".", needsUpDirControl ? &getAsset(ASSET_ARROW) : nullptr,
 		pickingDir ? &getAsset(ASSET_ACCEPT) : View::needsBackControl ? &getAsset(ASSET_CLOSE) : nullptr, filter, singleDir);
 	onSelectFile() = [this](FSPicker &picker, const char* name, const Input::Event &e){GameFilePicker::onSelectFile(name, e);};
-	if(highlightFirst && tbl.cells)
+	if(highlightFirst)
 	{
-		tbl.selected = 0;
+		highlightFirstEntry();
 	}
 }
 
@@ -0,0 +1,127 @@
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#define LOGTAG "FrameSkip"
+#include <FrameSkip.hh>
+#include <imagine/logger/logger.h>
+#include <algorithm>
+
+FrameSkipScheduler frameSkipScheduler;
+
+static constexpr float AVG_WEIGHT = 1./16.; // weight of each new sample in the moving averages
+static constexpr int AUDIO_LOW_FILL = 25, AUDIO_HIGH_FILL = 75;
+static constexpr uint STATS_LOG_PERIODS = 10;
+
+static void addSample(std::atomic<float> &avg, float sample)
+{
+	auto prev = avg.load(std::memory_order_relaxed);
+	avg.store(prev ? prev + (sample - prev) * AVG_WEIGHT : sample, std::memory_order_relaxed);
+}
+
+static float toMs(TimeSys time)
+{
+	return time.toNs() / 1000000.;
+}
+
+void FrameSkipScheduler::reset()
+{
+	emulateMs = skipEmulateMs = presentMs = 0;
+	nestedPresentMs = 0;
+	skips = 0;
+	lastAudioFill = -1;
+	periodStart = {};
+	periods = 0;
+	stats_ = {};
+}
+
+uint FrameSkipScheduler::framesToSkip(uint framesDue, int audioFill, double framePeriodMs, uint &carriedFrames)
+{
+	assert(framesDue);
+	lastAudioFill = audioFill;
+	uint skip = framesDue - 1;
+	if(skip)
+	{
+		// frames without video that fit in the time left after the video frame
+		float emuMs = emulateMs.load(std::memory_order_relaxed), skipMs = skipEmulateMs.load(std::memory_order_relaxed);
+		float spareMs = framePeriodMs - emuMs - presentMs.load(std::memory_order_relaxed);
+		uint affordable = skipMs > 0 ? std::max(spareMs, 0.f) / skipMs : skip;
+		if(audioFill != -1 && audioFill < AUDIO_LOW_FILL)
+		{
+			// audio is about to run dry, catch up even if it overruns the host frame
+		}
+		else if(audioFill >= AUDIO_HIGH_FILL)
+		{
+			// enough audio queued to absorb a late frame, render one more instead
+			skip = std::min(skip - 1, affordable);
+		}
+		else
+			skip = std::min(skip, affordable);
+	}
+	skip = std::min(skip, MAX_FRAME_SKIP);
+	uint deferred = framesDue - 1 - skip;
+	// frames beyond the carry limit are dropped to resync with the host clock
+	carriedFrames = std::min(deferred, MAX_FRAME_SKIP);
+	skips += skip;
+	return skip;
+}
+
+void FrameSkipScheduler::addEmulateTime(bool video, uint frames, TimeSys time)
+{
+	if(!frames)
+		return;
+	float ms = toMs(time) / frames;
+	if(video)
+	{
+		ms = std::max(ms - nestedPresentMs, 0.f);
+		nestedPresentMs = 0;
+		addSample(emulateMs, ms);
+	}
+	else
+		addSample(skipEmulateMs, ms);
+}
+
+void FrameSkipScheduler::addPresentTime(TimeSys time, bool nested)
+{
+	float ms = toMs(time);
+	if(nested)
+		nestedPresentMs += ms;
+	addSample(presentMs, ms);
+}
+
+bool FrameSkipScheduler::updateStats()
+{
+	auto now = TimeSys::now();
+	if(!periodStart)
+	{
+		periodStart = now;
+		return false;
+	}
+	double secs = (now - periodStart).toNs() / 1000000000.;
+	if(secs < 1.)
+		return false;
+	stats_.skipsPerSec = skips / secs;
+	stats_.emulateMs = emulateMs.load(std::memory_order_relaxed);
+	stats_.skipEmulateMs = skipEmulateMs.load(std::memory_order_relaxed);
+	stats_.presentMs = presentMs.load(std::memory_order_relaxed);
+	stats_.audioFill = lastAudioFill;
+	skips = 0;
+	periodStart = now;
+	if(++periods % STATS_LOG_PERIODS == 0)
+	{
+		logMsg("skips/s %.1f, emulate %.2fms (%.2fms without video), present %.2fms, audio fill %d%%",
+			stats_.skipsPerSec, stats_.emulateMs, stats_.skipEmulateMs, stats_.presentMs, stats_.audioFill);
+	}
+	return true;
+}
@@ -0,0 +1,248 @@
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+
+#define LOGTAG "HeadlessBenchmark"
+#include <HeadlessBenchmark.hh>
+#include <EmuSystem.hh>
+#include <EmuOptions.hh>
+#include <imagine/base/Base.hh>
+#include <imagine/util/time/sys.hh>
+#include <imagine/pixmap/Pixmap.hh>
+#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+#include <RunAhead.hh>
+#endif
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+struct BenchmarkArgs
+{
+	const char *gamePath = nullptr;
+	int gamePathArg = 0;
+	uint frames = 1800;
+	uint warmupFrames = 60;
+	bool processGfx = true;
+	bool renderAudio = false;
+	uint runAheadFrames = 0;
+};
+
+static void printUsage(const char *exe)
+{
+	fprintf(stderr, "usage: %s [--frames N] [--warmup N] [--no-video] [--audio] [--run-ahead N] <game path>\n", exe);
+	fprintf(stderr, "       %s --pixmap-bench [--frames N]\n", exe);
+	fprintf(stderr, "       %s --system-bench [--frames N]\n", exe);
+}
+
+static bool parseArgs(int argc, char** argv, BenchmarkArgs &args)
+{
+	for(int i = 1; i < argc; i++)
+	{
+		auto arg = argv[i];
+		if(string_equal(arg, "--frames") && i + 1 < argc)
+			args.frames = std::max(atoi(argv[++i]), 1);
+		else if(string_equal(arg, "--warmup") && i + 1 < argc)
+			args.warmupFrames = std::max(atoi(argv[++i]), 0);
+		else if(string_equal(arg, "--no-video"))
+			args.processGfx = false;
+		else if(string_equal(arg, "--video"))
+			args.processGfx = true;
+		else if(string_equal(arg, "--audio"))
+			args.renderAudio = true;
+		else if(string_equal(arg, "--no-audio"))
+			args.renderAudio = false;
+		#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+		else if(string_equal(arg, "--run-ahead") && i + 1 < argc)
+			args.runAheadFrames = std::min(atoi(argv[++i]), (int)RunAhead::MAX_FRAMES);
+		#endif
+		else if(arg[0] != '-' && !args.gamePath)
+		{
+			args.gamePath = arg;
+			args.gamePathArg = i;
+		}
+		else
+			return false;
+	}
+	return args.gamePath;
+}
+
+// nearest-rank percentile of sorted frame times
+static double percentileMs(const int64 *sortedNs, uint count, uint percent)
+{
+	uint rank = std::max((count * percent + 99) / 100, 1u);
+	return sortedNs[rank - 1] / 1000000.;
+}
+
+static void printJSONString(const char *str)
+{
+	putchar('"');
+	for(; *str; str++)
+	{
+		if(*str == '"' || *str == '\\')
+			putchar('\\');
+		if((uchar)*str < 0x20)
+			printf("\\u%.4x", (uint)*str);
+		else
+			putchar(*str);
+	}
+	putchar('"');
+}
+
+// times IG::convertPixels on a 320x240 frame for common format pairs
+static int runPixmapConvertBenchmark(uint frames)
+{
+	static const PixelFormatDesc *formats[][2]
+	{
+		{&PixelFormatRGB565, &PixelFormatRGBA8888},
+		{&PixelFormatRGB565, &PixelFormatBGRA8888},
+		{&PixelFormatRGB565, &PixelFormatRGB888},
+		{&PixelFormatRGBA8888, &PixelFormatBGRA8888},
+		{&PixelFormatRGBA8888, &PixelFormatRGB565},
+		{&PixelFormatBGRA8888, &PixelFormatRGB888},
+		{&PixelFormatARGB1555, &PixelFormatRGB565},
+	};
+	static const IG::PixelConvertKernel kernels[]
+		{IG::PixelConvertKernel::SCALAR, IG::PixelConvertKernel::SIMD128, IG::PixelConvertKernel::AUTO};
+	const uint pixels = 320 * 240;
+	auto src = (char*)mem_alloc(pixels * 4);
+	auto dest = (char*)mem_alloc(pixels * 4);
+	iterateTimes(pixels * 4, i)
+	{
+		src[i] = i * 7 + (i >> 8);
+	}
+	for(auto &f : formats)
+	{
+		for(auto kernel : kernels)
+		{
+			auto startTime = TimeSys::now();
+			iterateTimes(frames, i)
+			{
+				IG::convertPixels(*f[0], src, *f[1], dest, pixels, kernel);
+			}
+			double ms = (TimeSys::now() - startTime).toNs() / 1000000. / frames;
+			printf("{\"src\":\"%s\",\"dest\":\"%s\",\"kernel\":\"%s\",\"pixels\":%u,\"frameMs\":%.4f,\"mpixPerSec\":%.1f}\n",
+				f[0]->name, f[1]->name, IG::pixelConvertKernelName(kernel), pixels, ms, pixels / ms / 1000.);
+		}
+	}
+	fflush(stdout);
+	mem_free(src);
+	mem_free(dest);
+	return 0;
+}
+
+// overridden by systems that have their own micro-benchmarks
+[[gnu::weak]] int runSystemBenchmark(uint frames)
+{
+	fprintf(stderr, "no system benchmark for %s\n", EmuSystem::shortSystemName());
+	return 2;
+}
+
+[[gnu::weak]] void resetSystemBenchmarkStats() {}
+[[gnu::weak]] void printSystemBenchmarkStats(uint frames) {}
+
+int runHeadlessBenchmark(int argc, char** argv)
+{
+	if(argc > 1 && (string_equal(argv[1], "--pixmap-bench") || string_equal(argv[1], "--system-bench")))
+	{
+		uint frames = 1000;
+		if(argc > 3 && string_equal(argv[2], "--frames"))
+			frames = std::max(atoi(argv[3]), 1);
+		if(string_equal(argv[1], "--system-bench"))
+			return runSystemBenchmark(frames);
+		return runPixmapConvertBenchmark(frames);
+	}
+	BenchmarkArgs args;
+	if(!parseArgs(argc, argv, args))
+	{
+		printUsage(argv[0]);
+		return 2;
+	}
+	EmuSystem::audioFramesPerVideoFrame = optionSoundRate / 60;
+	EmuSystem::configAudioRate();
+	auto res = EmuSystem::loadGame(args.gamePath);
+	if(res != 1)
+	{
+		// games needing asynchronous loading require the main event loop
+		fprintf(stderr, "%s: unable to load %s%s\n", argv[0], args.gamePath,
+			res == -1 ? " (asynchronous loading not supported headless)" : "");
+		return 1;
+	}
+
+	iterateTimes(args.warmupFrames, i)
+	{
+		EmuSystem::runFrame(0, args.processGfx, args.renderAudio);
+	}
+	#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+	runAhead.setFrames(args.runAheadFrames);
+	#endif
+	resetSystemBenchmarkStats();
+	auto frameNs = (int64*)mem_alloc(sizeof(int64) * args.frames);
+	auto startTime = TimeSys::now();
+	auto prevTime = startTime;
+	iterateTimes(args.frames, i)
+	{
+		#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+		if(runAhead.isActive())
+			runAhead.runFrame(args.renderAudio);
+		else
+		#endif
+		EmuSystem::runFrame(0, args.processGfx, args.renderAudio);
+		auto now = TimeSys::now();
+		frameNs[i] = (now - prevTime).toNs();
+		prevTime = now;
+	}
+	double totalSecs = (prevTime - startTime).toNs() / 1000000000.;
+
+	std::sort(frameNs, frameNs + args.frames);
+	int64 sumNs = 0;
+	iterateTimes(args.frames, i)
+	{
+		sumNs += frameNs[i];
+	}
+	printf("{\"system\":");
+	printJSONString(EmuSystem::shortSystemName());
+	printf(",\"game\":");
+	printJSONString(args.gamePath);
+	printf(",\"frames\":%u,\"warmupFrames\":%u,\"video\":%s,\"audio\":%s",
+		args.frames, args.warmupFrames, args.processGfx ? "true" : "false", args.renderAudio ? "true" : "false");
+	printf(",\"totalSeconds\":%.6f,\"fps\":%.3f", totalSecs, args.frames / totalSecs);
+	#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+	printf(",\"runAheadFrames\":%u,\"runAheadExtraMs\":%.4f", runAhead.frames(), runAhead.avgExtraMs());
+	#endif
+	printSystemBenchmarkStats(args.frames);
+	printf(",\"frameTimeMs\":{\"min\":%.4f,\"mean\":%.4f,\"p50\":%.4f,\"p95\":%.4f,\"p99\":%.4f,\"max\":%.4f}}\n",
+		frameNs[0] / 1000000., (sumNs / args.frames) / 1000000.,
+		percentileMs(frameNs, args.frames, 50), percentileMs(frameNs, args.frames, 95),
+		percentileMs(frameNs, args.frames, 99), frameNs[args.frames - 1] / 1000000.);
+	fflush(stdout);
+	mem_free(frameNs);
+	EmuSystem::closeGame(false);
+	return 0;
+}
+
+namespace Base
+{
+
+bool runsHeadless(int argc, char** argv)
+{
+	// resolve the game path while still in the launch directory
+	static FsSys::cPath gameRealPath;
+	BenchmarkArgs args;
+	if(parseArgs(argc, argv, args) && realpath(args.gamePath, gameRealPath))
+		argv[args.gamePathArg] = gameRealPath;
+	return true;
+}
+
+}
@@ -0,0 +1,767 @@
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#define LOGTAG "LibraryIndex"
+#include <LibraryIndex.hh>
+#include <FilePicker.hh>
+#include <Recent.hh>
+#include <EmuSystem.hh>
+#include <imagine/io/sys.hh>
+#include <imagine/mem/mem.h>
+#include <imagine/util/time/sys.hh>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/mman.h>
+#include <zlib.h>
+#include <unzip.h>
+
+LibraryIndex libraryIndex;
+
+// file layout: header, records sorted by path hash, path, then member name,
+// followed by the null-terminated strings they point to. Besides the hashes
+// of files and zip members, a scanned directory gets a record per entry the
+// picker would show, and files that can't be hashed get a record without
+// one so they aren't opened again on the next scan.
+struct IndexHeader
+{
+	char magic[8];
+	uint32 records;
+	uint32 stringBytes;
+};
+
+struct LibraryIndex::Record
+{
+	uint32 pathHash;
+	uint32 pathOffset;
+	uint32 memberOffset; // 0 (the empty string) if not a zip member
+	uint32 crc32;
+	uint64 fileSize;
+	int64 mtime;
+	uint32 size;
+	uint8 md5[16];
+	uint32 flags;
+};
+
+enum
+{
+	RECORD_NO_HASH = 1 << 0, // seen but nothing hashable, like a zip without usable members
+	RECORD_DIR_ENTRY = 1 << 1, // member is an entry of the directory at path, or "" for the directory itself
+	RECORD_SUBDIR = 1 << 2, // with RECORD_DIR_ENTRY, the entry is a directory
+};
+
+static_assert(sizeof(IndexHeader) == 16, "unexpected index header size");
+
+static const char indexMagic[8] {'E', 'M', 'U', 'L', 'I', 'B', '0', '1'};
+static constexpr uint MAX_SCAN_DEPTH = 4;
+static constexpr uint MAX_HASH_SIZE = 64 * 1024 * 1024;
+static constexpr uint IO_CHUNK_SIZE = 0x10000;
+
+// records and strings for the index being built by a scan
+struct LibraryIndex::Builder
+{
+	static_assert(sizeof(Record) == 56, "unexpected index record size");
+
+	Record *rec = nullptr;
+	uint records = 0, recCapacity = 0;
+	char *str = nullptr;
+	uint strSize = 0, strCapacity = 0;
+	uint hashed = 0, reused = 0;
+
+	~Builder()
+	{
+		mem_free(rec);
+		mem_free(str);
+	}
+
+	Record *addRecord()
+	{
+		if(records == recCapacity)
+		{
+			uint newCapacity = std::max(recCapacity * 2, 256u);
+			auto newRec = (Record*)mem_realloc(rec, newCapacity * sizeof(Record));
+			if(!newRec)
+				return nullptr;
+			rec = newRec;
+			recCapacity = newCapacity;
+		}
+		auto &r = rec[records++];
+		r = {};
+		return &r;
+	}
+
+	bool addString(const char *s, uint32 &offset)
+	{
+		uint len = strlen(s) + 1;
+		if(strSize + len > strCapacity)
+		{
+			uint newCapacity = std::max(strCapacity * 2, strSize + len + 0x4000);
+			auto newStr = (char*)mem_realloc(str, newCapacity);
+			if(!newStr)
+				return false;
+			str = newStr;
+			strCapacity = newCapacity;
+		}
+		offset = strSize;
+		memcpy(&str[strSize], s, len);
+		strSize += len;
+		return true;
+	}
+};
+
+static uint32 pathHash(const char *path)
+{
+	// FNV-1a
+	uint32 hash = 2166136261u;
+	for(; *path; path++)
+	{
+		hash = (hash ^ (uint8)*path) * 16777619u;
+	}
+	return hash;
+}
+
+static void indexPath(FsSys::cPath &path)
+{
+	#ifdef CONFIG_BASE_USES_SHARED_DOCUMENTS_DIR
+	// every app shares this directory, so name the index after the app's config file
+	string_printf(path, "%s/explusalpha.com/" CONFIG_FILE_NAME ".library.idx", Base::documentsPath());
+	#else
+	string_printf(path, "%s/library.idx", Base::documentsPath());
+	#endif
+}
+
+// RFC 1321 MD5, only what's needed to hash a stream of bytes
+class MD5Hash
+{
+public:
+	MD5Hash() {}
+
+	void update(const uint8 *data, uint size)
+	{
+		uint used = total % 64;
+		total += size;
+		if(used)
+		{
+			uint copy = std::min(64 - used, size);
+			memcpy(&block[used], data, copy);
+			data += copy;
+			size -= copy;
+			if(used + copy < 64)
+				return;
+			transform(block);
+		}
+		for(; size >= 64; data += 64, size -= 64)
+		{
+			transform(data);
+		}
+		memcpy(block, data, size);
+	}
+
+	void finish(uint8 (&digest)[16])
+	{
+		uint64 bits = total * 8;
+		uint8 pad[72] {0x80};
+		uint padSize = ((total % 64) < 56 ? 56 : 120) - (total % 64);
+		iterateTimes(8, i)
+		{
+			pad[padSize + i] = bits >> (i * 8);
+		}
+		update(pad, padSize + 8);
+		iterateTimes(16, i)
+		{
+			digest[i] = state[i / 4] >> ((i % 4) * 8);
+		}
+	}
+
+private:
+	uint32 state[4] {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+	uint64 total = 0;
+	uint8 block[64] {0};
+
+	static uint32 rotl(uint32 x, uint n) { return (x << n) | (x >> (32 - n)); }
+
+	void transform(const uint8 *data)
+	{
+		static const uint32 k[64]
+		{
+			0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+			0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+			0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+			0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+			0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+			0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+			0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+			0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+		};
+		static const uint8 r[16] {7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21};
+		uint32 m[16];
+		iterateTimes(16, i)
+		{
+			m[i] = data[i * 4] | (data[i * 4 + 1] << 8) | (data[i * 4 + 2] << 16) | ((uint32)data[i * 4 + 3] << 24);
+		}
+		uint32 a = state[0], b = state[1], c = state[2], d = state[3];
+		iterateTimes(64, i)
+		{
+			uint32 f;
+			uint g, round = i / 16;
+			switch(round)
+			{
+				case 0: f = (b & c) | (~b & d); g = i; break;
+				case 1: f = (d & b) | (~d & c); g = (5 * i + 1) % 16; break;
+				case 2: f = b ^ c ^ d; g = (3 * i + 5) % 16; break;
+				default: f = c ^ (b | ~d); g = (7 * i) % 16; break;
+			}
+			uint32 temp = d;
+			d = c;
+			c = b;
+			b += rotl(a + f + k[i] + m[g], r[round * 4 + i % 4]);
+			a = temp;
+		}
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+	}
+};
+
+const char *LibraryIndex::str(uint32 offset) const
+{
+	auto &header = *(const IndexHeader*)map;
+	return map + sizeof(IndexHeader) + header.records * sizeof(Record) + offset;
+}
+
+const LibraryIndex::Record *LibraryIndex::findRecord(const char *path, uint32 hash) const
+{
+	if(!map)
+		return nullptr;
+	auto &header = *(const IndexHeader*)map;
+	auto start = (const Record*)(map + sizeof(IndexHeader));
+	auto end = start + header.records;
+	auto rec = std::lower_bound(start, end, hash,
+		[](const Record &r, uint32 hash) { return r.pathHash < hash; });
+	for(; rec != end && rec->pathHash == hash; rec++)
+	{
+		if(string_equal(str(rec->pathOffset), path))
+			return rec;
+	}
+	return nullptr;
+}
+
+bool LibraryIndex::find(const char *path, const char *member, LibraryEntry &entry)
+{
+	struct stat s;
+	if(!init || ::stat(path, &s) != 0)
+		return false;
+	uint32 hash = pathHash(path);
+	mutex.lock();
+	auto rec = findRecord(path, hash);
+	bool found = false;
+	if(rec && rec->fileSize == (uint64)s.st_size && rec->mtime == (int64)s.st_mtime)
+	{
+		// all of a file's records are next to each other
+		auto end = (const Record*)(map + sizeof(IndexHeader)) + ((const IndexHeader*)map)->records;
+		for(auto pathOffset = rec->pathOffset; rec != end && rec->pathOffset == pathOffset; rec++)
+		{
+			if(!rec->flags && string_equal(str(rec->memberOffset), member ? member : ""))
+			{
+				entry.crc32 = rec->crc32;
+				entry.size = rec->size;
+				memcpy(entry.md5, rec->md5, sizeof(entry.md5));
+				found = true;
+				break;
+			}
+		}
+	}
+	mutex.unlock();
+	return found;
+}
+
+bool LibraryIndex::listDir(const char *path, FsSys &dir)
+{
+	struct stat s;
+	if(!init || ::stat(path, &s) != 0)
+		return false;
+	uint32 hash = pathHash(path);
+	mutex.lock();
+	auto rec = findRecord(path, hash);
+	bool listed = false;
+	if(rec && (rec->flags & RECORD_DIR_ENTRY) && rec->mtime == (int64)s.st_mtime)
+	{
+		listed = true;
+		auto end = (const Record*)(map + sizeof(IndexHeader)) + ((const IndexHeader*)map)->records;
+		for(auto pathOffset = rec->pathOffset; rec != end && rec->pathOffset == pathOffset; rec++)
+		{
+			auto name = str(rec->memberOffset);
+			if(!strlen(name))
+				continue;
+			if(!dir.addEntry(name, (rec->flags & RECORD_SUBDIR) ? Fs::TYPE_DIR : Fs::TYPE_FILE))
+			{
+				listed = false;
+				break;
+			}
+		}
+	}
+	mutex.unlock();
+	return listed;
+}
+
+bool LibraryIndex::hasFile(const char *path)
+{
+	if(!init)
+		return false;
+	mutex.lock();
+	auto rec = findRecord(path, pathHash(path));
+	bool found = rec && !(rec->flags & RECORD_DIR_ENTRY);
+	mutex.unlock();
+	return found;
+}
+
+void LibraryIndex::md5ToStr(const uint8 md5[16], char (&str)[33])
+{
+	static const char hex[] = "0123456789abcdef";
+	iterateTimes(16, i)
+	{
+		str[i * 2] = hex[md5[i] >> 4];
+		str[i * 2 + 1] = hex[md5[i] & 0xf];
+	}
+	str[32] = 0;
+}
+
+bool LibraryIndex::mapIndex()
+{
+	FsSys::cPath path;
+	indexPath(path);
+	int fd = open(path, O_RDONLY);
+	if(fd == -1)
+	{
+		logMsg("no index at %s", path);
+		return false;
+	}
+	struct stat s;
+	void *data = MAP_FAILED;
+	if(fstat(fd, &s) == 0 && s.st_size >= (off_t)sizeof(IndexHeader))
+		data = mmap(nullptr, s.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED)
+	{
+		logErr("unable to map %s", path);
+		return false;
+	}
+	auto &header = *(const IndexHeader*)data;
+	if(memcmp(header.magic, indexMagic, sizeof(indexMagic))
+		|| sizeof(IndexHeader) + (uint64)header.records * sizeof(Record) + header.stringBytes != (uint64)s.st_size)
+	{
+		logErr("invalid index %s", path);
+		munmap(data, s.st_size);
+		return false;
+	}
+	// every string offset must point inside the null-terminated string block
+	auto rec = (const Record*)((const char*)data + sizeof(IndexHeader));
+	auto strings = (const char*)(rec + header.records);
+	bool validStrings = !header.records || (header.stringBytes && !strings[header.stringBytes - 1]);
+	for(uint i = 0; validStrings && i < header.records; i++)
+	{
+		validStrings = rec[i].pathOffset < header.stringBytes && rec[i].memberOffset < header.stringBytes;
+	}
+	if(!validStrings)
+	{
+		logErr("invalid string offsets in index %s", path);
+		munmap(data, s.st_size);
+		return false;
+	}
+	map = (const char*)data;
+	mapSize = s.st_size;
+	logMsg("mapped index with %u entries", header.records);
+	return true;
+}
+
+void LibraryIndex::unmapIndex()
+{
+	if(!map)
+		return;
+	munmap((void*)map, mapSize);
+	map = nullptr;
+	mapSize = 0;
+}
+
+bool LibraryIndex::cancelled()
+{
+	mutex.lock();
+	bool ret = quit;
+	mutex.unlock();
+	return ret;
+}
+
+void LibraryIndex::startScan()
+{
+	if(init)
+		return;
+	if(!mutex.create())
+		return;
+	init = true;
+	mapIndex();
+	// the directory last browsed in the picker, then the ones holding recent games
+	auto addRoot =
+		[this](const char *path)
+		{
+			if(!strlen(path) || roots == MAX_ROOTS)
+				return;
+			iterateTimes(roots, i)
+			{
+				if(string_equal(root[i], path))
+					return;
+			}
+			string_copy(root[roots++], path);
+		};
+	addRoot(FsSys::workDir());
+	for(auto &e : recentGameList)
+	{
+		FsSys::cPath dir;
+		string_copy(dir, e.path);
+		addRoot(dirname(dir));
+	}
+	quit = false;
+	scanning = true;
+	if(!thread.create(0,
+		[this](ThreadPThread &thread)
+		{
+			run();
+			return 0;
+		}))
+	{
+		logErr("unable to create scan thread");
+		scanning = false;
+	}
+}
+
+void LibraryIndex::cancelScan()
+{
+	if(!scanning)
+		return;
+	mutex.lock();
+	quit = true;
+	mutex.unlock();
+	thread.join();
+	scanning = false;
+	mutex.lock();
+	unmapIndex();
+	mutex.unlock();
+}
+
+bool LibraryIndex::copyRecords(Builder &builder, const char *path, uint32 hash, const struct stat &s)
+{
+	auto rec = findRecord(path, hash);
+	if(!rec || (rec->flags & RECORD_DIR_ENTRY)
+		|| rec->fileSize != (uint64)s.st_size || rec->mtime != (int64)s.st_mtime)
+		return false;
+	uint32 pathOffset;
+	if(!builder.addString(path, pathOffset))
+		return false;
+	auto end = (const Record*)(map + sizeof(IndexHeader)) + ((const IndexHeader*)map)->records;
+	for(auto oldPathOffset = rec->pathOffset; rec != end && rec->pathOffset == oldPathOffset; rec++)
+	{
+		// add the string first so a failure can't leave a half-filled record behind
+		uint32 memberOffset = 0;
+		if(rec->memberOffset && !builder.addString(str(rec->memberOffset), memberOffset))
+			return false;
+		auto newRec = builder.addRecord();
+		if(!newRec)
+			return false;
+		*newRec = *rec;
+		newRec->pathOffset = pathOffset;
+		newRec->memberOffset = memberOffset;
+		builder.reused++;
+	}
+	return true;
+}
+
+static bool hashFile(const char *path, uint32 &crc, uint8 (&md5)[16])
+{
+	auto file = IOFile(IoSys::open(path));
+	if(!file)
+		return false;
+	MD5Hash hash;
+	crc = crc32(0, nullptr, 0);
+	uint8 buff[IO_CHUNK_SIZE];
+	ssize_t bytesRead;
+	while((bytesRead = file.readUpTo(buff, sizeof(buff))) > 0)
+	{
+		crc = crc32(crc, buff, bytesRead);
+		hash.update(buff, bytesRead);
+	}
+	hash.finish(md5);
+	return bytesRead == 0;
+}
+
+static bool hashZipMember(unzFile zip, uint8 (&md5)[16])
+{
+	if(unzOpenCurrentFile(zip) != UNZ_OK)
+		return false;
+	MD5Hash hash;
+	uint8 buff[IO_CHUNK_SIZE];
+	int bytesRead;
+	while((bytesRead = unzReadCurrentFile(zip, buff, sizeof(buff))) > 0)
+	{
+		hash.update(buff, bytesRead);
+	}
+	hash.finish(md5);
+	// also checks the CRC stored in the zip
+	return unzCloseCurrentFile(zip) == UNZ_OK && bytesRead == 0;
+}
+
+void LibraryIndex::scanFile(Builder &builder, const char *path)
+{
+	struct stat s;
+	if(::stat(path, &s) != 0 || !S_ISREG(s.st_mode))
+		return;
+	uint32 hash = pathHash(path);
+	if(copyRecords(builder, path, hash, s))
+		return;
+	uint32 pathOffset;
+	if(!builder.addString(path, pathOffset))
+		return;
+	auto initRecord =
+		[&](Record &r)
+		{
+			r.pathHash = hash;
+			r.pathOffset = pathOffset;
+			r.fileSize = s.st_size;
+			r.mtime = s.st_mtime;
+		};
+	auto addNoHashRecord =
+		[&]()
+		{
+			auto r = builder.addRecord();
+			if(!r)
+				return;
+			initRecord(*r);
+			r->flags = RECORD_NO_HASH;
+		};
+	if(!string_hasDotExtension(path, "zip"))
+	{
+		if((uint64)s.st_size > MAX_HASH_SIZE)
+		{
+			addNoHashRecord();
+			return;
+		}
+		uint32 crc;
+		uint8 md5[16];
+		if(!hashFile(path, crc, md5))
+		{
+			logErr("error reading %s", path);
+			return;
+		}
+		auto r = builder.addRecord();
+		if(!r)
+			return;
+		initRecord(*r);
+		r->crc32 = crc;
+		r->size = s.st_size;
+		memcpy(r->md5, md5, sizeof(md5));
+		builder.hashed++;
+		return;
+	}
+	auto zip = unzOpen(path);
+	if(!zip)
+	{
+		logErr("error opening zip %s", path);
+		addNoHashRecord();
+		return;
+	}
+	uint zipRecords = 0;
+	for(int res = unzGoToFirstFile(zip); res == UNZ_OK && !cancelled(); res = unzGoToNextFile(zip))
+	{
+		unz_file_info info;
+		FsSys::cPath name;
+		if(unzGetCurrentFileInfo(zip, &info, name, sizeof(name), nullptr, 0, nullptr, 0) != UNZ_OK)
+			break;
+		uint nameLen = strlen(name);
+		if(!nameLen || name[nameLen - 1] == '/' || info.uncompressed_size > MAX_HASH_SIZE)
+			continue;
+		uint8 md5[16];
+		if(!hashZipMember(zip, md5))
+		{
+			logErr("error reading %s in %s", name, path);
+			continue;
+		}
+		uint32 memberOffset;
+		if(!builder.addString(name, memberOffset))
+			break;
+		auto r = builder.addRecord();
+		if(!r)
+			break;
+		initRecord(*r);
+		r->memberOffset = memberOffset;
+		r->crc32 = info.crc;
+		r->size = info.uncompressed_size;
+		memcpy(r->md5, md5, sizeof(md5));
+		builder.hashed++;
+		zipRecords++;
+	}
+	unzClose(zip);
+	if(!zipRecords && !cancelled())
+		addNoHashRecord();
+}
+
+void LibraryIndex::addDirListing(Builder &builder, const char *path, const struct stat &s, FsSys &dir)
+{
+	uint32 hash = pathHash(path), pathOffset;
+	if(!builder.addString(path, pathOffset))
+		return;
+	// one record for the directory itself, so empty ones are listed too
+	iterateTimes(dir.numEntries() + 1, i)
+	{
+		uint32 memberOffset = 0;
+		if(i && !builder.addString(dir.entryFilename(i - 1), memberOffset))
+			return;
+		auto r = builder.addRecord();
+		if(!r)
+			return;
+		r->pathHash = hash;
+		r->pathOffset = pathOffset;
+		r->memberOffset = memberOffset;
+		r->mtime = s.st_mtime;
+		r->flags = RECORD_DIR_ENTRY;
+		if(i && dir.entryType(i - 1) == Fs::TYPE_DIR)
+			r->flags |= RECORD_SUBDIR;
+	}
+}
+
+void LibraryIndex::scanDir(Builder &builder, const char *path, uint depth)
+{
+	struct stat s;
+	if(::stat(path, &s) != 0)
+		return;
+	FsSys dir;
+	if(dir.beginDir(path) != OK)
+		return;
+	dir.readDir(UINT_MAX, EmuFilePicker::defaultFsFilter);
+	// the modification time only has second granularity, so don't cache a
+	// listing that could still change within the same second
+	if(s.st_mtime < scanStartTime)
+		addDirListing(builder, path, s, dir);
+	iterateTimes(dir.numEntries(), i)
+	{
+		if(cancelled())
+			break;
+		auto name = dir.entryFilename(i);
+		if(name[0] == '.')
+			continue;
+		FsSys::cPath entryPath;
+		if(!string_printf(entryPath, "%s/%s", path, name))
+			continue;
+		if(dir.entryType(i) == Fs::TYPE_DIR)
+		{
+			if(depth < MAX_SCAN_DEPTH)
+				scanDir(builder, entryPath, depth + 1);
+		}
+		else
+			scanFile(builder, entryPath);
+	}
+	dir.closeDir();
+}
+
+bool LibraryIndex::writeIndex(Builder &builder, const char *path)
+{
+	FsSys::cPath tempPath;
+	string_printf(tempPath, "%s.tmp", path);
+	{
+		auto file = IOFile(IoSys::create(tempPath));
+		if(!file)
+		{
+			logErr("unable to create %s", tempPath);
+			return false;
+		}
+		IndexHeader header;
+		memcpy(header.magic, indexMagic, sizeof(indexMagic));
+		header.records = builder.records;
+		header.stringBytes = builder.strSize;
+		if(file.fwrite(&header, sizeof(header), 1) != 1
+			|| (builder.records && file.fwrite(builder.rec, sizeof(Record) * builder.records, 1) != 1)
+			|| file.fwrite(builder.str, builder.strSize, 1) != 1)
+		{
+			logErr("error writing %s", tempPath);
+			file.close();
+			FsSys::remove(tempPath);
+			return false;
+		}
+		file.sync();
+	}
+	if(FsSys::rename(tempPath, path) != OK)
+	{
+		logErr("error renaming %s", tempPath);
+		FsSys::remove(tempPath);
+		return false;
+	}
+	return true;
+}
+
+void LibraryIndex::run()
+{
+	auto startTime = TimeSys::now();
+	scanStartTime = time(nullptr);
+	Builder builder;
+	uint32 emptyStr;
+	builder.addString("", emptyStr);
+	iterateTimes(roots, i)
+	{
+		scanDir(builder, root[i], 0);
+	}
+	if(cancelled())
+	{
+		logMsg("scan cancelled");
+		return;
+	}
+	auto str = builder.str;
+	std::sort(builder.rec, builder.rec + builder.records,
+		[str](const Record &r1, const Record &r2)
+		{
+			if(r1.pathHash != r2.pathHash)
+				return r1.pathHash < r2.pathHash;
+			int cmp = strcmp(&str[r1.pathOffset], &str[r2.pathOffset]);
+			if(cmp)
+				return cmp < 0;
+			return strcmp(&str[r1.memberOffset], &str[r2.memberOffset]) < 0;
+		});
+	// roots can overlap, drop files that were scanned more than once and
+	// point the remaining records of a file at the same path string
+	uint records = 0;
+	iterateTimes(builder.records, i)
+	{
+		auto &r = builder.rec[i];
+		if(records)
+		{
+			auto &prev = builder.rec[records - 1];
+			if(prev.pathHash == r.pathHash && string_equal(&str[prev.pathOffset], &str[r.pathOffset]))
+			{
+				if(string_equal(&str[prev.memberOffset], &str[r.memberOffset]))
+					continue;
+				r.pathOffset = prev.pathOffset;
+			}
+		}
+		builder.rec[records++] = r;
+	}
+	builder.records = records;
+	FsSys::cPath path;
+	indexPath(path);
+	bool written = writeIndex(builder, path);
+	mutex.lock();
+	unmapIndex();
+	mapIndex();
+	mutex.unlock();
+	logMsg("indexed %u entries, %u hashed, %u unchanged%s, in %.3fms", records, builder.hashed, builder.reused,
+		written ? "" : " (not saved)", (TimeSys::now() - startTime).toNs() / 1000000.);
+}
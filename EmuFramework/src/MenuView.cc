@@ -16,6 +16,9 @@
 #include <meta.h>
 #include <MenuView.hh>
 #include <Recent.hh>
+#ifdef CONFIG_EMUFRAMEWORK_LIBRARY_INDEX
+#include <LibraryIndex.hh>
+#endif
 #include <imagine/gui/AlertView.hh>
 #include <EmuApp.hh>
 #include <EmuSystem.hh>
@@ -585,7 +588,13 @@ void RecentGameView::init(bool highlightFirst)
 	int rIdx = 0;
 	for(auto &e : recentGameList)
 	{
-		recentGame[rIdx].init(e.name, FsSys::fileExists(e.path)); item[i++] = &recentGame[rIdx];
+		#ifdef CONFIG_EMUFRAMEWORK_LIBRARY_INDEX
+		// recent game directories are indexed, so most entries don't need a stat
+		bool exists = libraryIndex.hasFile(e.path) || FsSys::fileExists(e.path);
+		#else
+		bool exists = FsSys::fileExists(e.path);
+		#endif
+		recentGame[rIdx].init(e.name, exists); item[i++] = &recentGame[rIdx];
 		recentGame[rIdx].onSelect() = [&](TextMenuItem &t, const Input::Event &ev) {e.handleMenuSelection(t,ev);};
 		rIdx++;
 	}
@@ -52,6 +52,8 @@ void MsgPopup::unpost()
 void MsgPopup::post(const char *msg, int secs, bool error)
 {
 	logMsg("%s", msg);
+	if(!text.face)
+		return; // not initialized, no window
 	text.setString(msg);
 	text.compile();
 	this->error = error;
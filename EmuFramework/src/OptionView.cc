@@ -16,6 +16,12 @@
 #include <OptionView.hh>
 #include <EmuApp.hh>
 #include <FilePicker.hh>
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+#include <Rewind.hh>
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+#include <RunAhead.hh>
+#endif
 #include <algorithm>
 
 void BiosSelectMenu::onSelectFile(const char* name, const Input::Event &e)
@@ -102,6 +108,53 @@ void OptionView::fastForwardSpeedinit()
 	fastForwardSpeed.init(str, val, sizeofArray(str));
 }
 
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+static const uint rewindMemoryVal[] {0, 16, 32, 64, 128};
+static const uint rewindIntervalVal[] {1, 2, 4, 8};
+
+void OptionView::rewindMemoryInit()
+{
+	static const char *str[] =
+	{
+		"Off", "16MB", "32MB", "64MB", "128MB"
+	};
+	int val = 0;
+	iterateTimes(sizeofArray(rewindMemoryVal), i)
+	{
+		if(optionRewindMemory == rewindMemoryVal[i])
+			val = i;
+	}
+	rewindMemory.init(str, val, sizeofArray(str));
+}
+
+void OptionView::rewindIntervalInit()
+{
+	static const char *str[] =
+	{
+		"Every Frame", "Every 2 Frames", "Every 4 Frames", "Every 8 Frames"
+	};
+	int val = 0;
+	iterateTimes(sizeofArray(rewindIntervalVal), i)
+	{
+		if(optionRewindInterval == rewindIntervalVal[i])
+			val = i;
+	}
+	rewindInterval.init(str, val, sizeofArray(str));
+}
+#endif
+
+#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+void OptionView::runAheadInit()
+{
+	static const char *str[] =
+	{
+		"Off", "1 Frame", "2 Frames", "3 Frames", "4 Frames"
+	};
+	static_assert(sizeofArray(str) == RunAhead::MAX_FRAMES + 1, "missing run-ahead menu strings");
+	runAhead.init(str, std::min((uint)optionRunAhead, RunAhead::MAX_FRAMES), sizeofArray(str));
+}
+#endif
+
 
 static void uiVisibiltyInit(const Byte1Option &option, MultiChoiceSelectMenuItem &menuItem)
 {
@@ -302,6 +355,14 @@ void OptionView::imgEffectInit()
 }
 #endif
 
+#ifdef CONFIG_EMUFRAMEWORK_CPU_FILTER
+void OptionView::imgCpuFilterInit()
+{
+	static const char *str[] {"Off", "Scale2x", "Scale3x", "hq2x", "xBR 2x"};
+	imgCpuFilter.init(str, optionImgCpuFilter, sizeofArray(str));
+}
+#endif
+
 void OptionView::overlayEffectInit()
 {
 	static const char *str[] = { "Off", "Scanlines", "Scanlines 2x", "CRT Mask", "CRT", "CRT 2x" };
@@ -506,12 +567,16 @@ void OptionView::loadVideoItems(MenuItem *item[], uint &items)
 {
 	name_ = "Video Options";
 	if(!optionFrameSkip.isConst) { frameSkipInit(); item[items++] = &frameSkip; }
+	frameStats.init(optionShowFrameStats); item[items++] = &frameStats;
 	if(!optionGameOrientation.isConst) { gameOrientationInit(); item[items++] = &gameOrientation; }
 	aspectRatioInit(); item[items++] = &aspectRatio;
 	imgFilter.init(optionImgFilter); item[items++] = &imgFilter;
 	#ifdef CONFIG_GFX_OPENGL_SHADER_PIPELINE
 	imgEffectInit(); item[items++] = &imgEffect;
 	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_CPU_FILTER
+	imgCpuFilterInit(); item[items++] = &imgCpuFilter;
+	#endif
 	overlayEffectInit(); item[items++] = &overlayEffect;
 	overlayEffectLevelInit(); item[items++] = &overlayEffectLevel;
 	zoomInit(); item[items++] = &zoom;
@@ -595,6 +660,16 @@ void OptionView::loadSystemItems(MenuItem *item[], uint &items)
 	printPathMenuEntryStr(savePathStr);
 	savePath.init(savePathStr, true); item[items++] = &savePath;
 	fastForwardSpeedinit(); item[items++] = &fastForwardSpeed;
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	rewindMemoryInit(); item[items++] = &rewindMemory;
+	rewindIntervalInit(); item[items++] = &rewindInterval;
+	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+	runAheadInit(); item[items++] = &runAhead;
+	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+	emuThread.init(optionEmuThread); item[items++] = &emuThread;
+	#endif
 	#if defined(CONFIG_INPUT_ANDROID) && CONFIG_ENV_ANDROID_MINSDK >= 9
 	processPriorityInit(); item[items++] = &processPriority;
 	#endif
@@ -740,6 +815,15 @@ OptionView::OptionView(Base::Window &win):
 			EmuSystem::configAudioPlayback();
 		}
 	},
+	frameStats
+	{
+		"Show Frame Timing Stats",
+		[this](BoolMenuItem &item, const Input::Event &e)
+		{
+			item.toggle(*this);
+			optionShowFrameStats = item.on;
+		}
+	},
 	aspectRatio
 	{
 		"Aspect Ratio",
@@ -820,6 +904,17 @@ OptionView::OptionView(Base::Window &win):
 		}
 	},
 	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_CPU_FILTER
+	imgCpuFilter
+	{
+		"CPU Image Filter",
+		[](MultiChoiceMenuItem &, int val)
+		{
+			optionImgCpuFilter.val = val;
+			emuView.vidImgFilter.setFilter(val);
+		}
+	},
+	#endif
 	overlayEffect
 	{
 		"Overlay Effect",
@@ -1116,6 +1211,49 @@ OptionView::OptionView(Base::Window &win):
 			optionFastForwardSpeed = val + MIN_FAST_FORWARD_SPEED;
 		}
 	},
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	rewindMemory
+	{
+		"Rewind Memory",
+		[](MultiChoiceMenuItem &, int val)
+		{
+			optionRewindMemory = rewindMemoryVal[val];
+			applyRewindOptions();
+		}
+	},
+	rewindInterval
+	{
+		"Rewind Snapshot Interval",
+		[](MultiChoiceMenuItem &, int val)
+		{
+			optionRewindInterval = rewindIntervalVal[val];
+			applyRewindOptions();
+		}
+	},
+	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+	runAhead
+	{
+		"Run-ahead",
+		[](MultiChoiceMenuItem &, int val)
+		{
+			optionRunAhead = val;
+			::runAhead.setFrames(val);
+		}
+	},
+	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_EMU_THREAD
+	emuThread
+	{
+		"Run Emulation On Separate Thread",
+		[this](BoolMenuItem &item, const Input::Event &e)
+		{
+			item.toggle(*this);
+			optionEmuThread = item.on;
+			::emuThread.setActive(item.on);
+		}
+	},
+	#endif
 	#if defined CONFIG_BASE_ANDROID && CONFIG_ENV_ANDROID_MINSDK >= 9
 	processPriority
 	{
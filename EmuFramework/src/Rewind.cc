@@ -0,0 +1,313 @@
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#define LOGTAG "Rewind"
+#include <Rewind.hh>
+#include <EmuSystem.hh>
+#include <EmuOptions.hh>
+#include <imagine/mem/mem.h>
+#include <algorithm>
+
+RewindBuffer rewindBuffer;
+
+static constexpr uint MIN_STATE_BUFFER_SIZE = 0x40000;
+
+static uint8 *writeVarint(uint8 *p, uint32 val)
+{
+	while(val >= 0x80)
+	{
+		*p++ = val | 0x80;
+		val >>= 7;
+	}
+	*p++ = val;
+	return p;
+}
+
+static const uint8 *readVarint(const uint8 *p, uint32 &val)
+{
+	val = 0;
+	for(uint shift = 0; ; shift += 7)
+	{
+		uint8 byte = *p++;
+		val |= (uint32)(byte & 0x7F) << shift;
+		if(!(byte & 0x80))
+			return p;
+	}
+}
+
+// worst case encoded size of a delta of the given size
+static uint deltaBound(uint size)
+{
+	return size + 16;
+}
+
+// Writes the XOR of two word-aligned buffers as runs of unchanged words
+// followed by runs of changed words, trailing unchanged words are omitted
+static uint encodeXORDelta(const uint32 *a, const uint32 *b, uint words, uint8 *out)
+{
+	auto p = out;
+	uint i = 0;
+	while(i < words)
+	{
+		uint runStart = i;
+		while(i < words && a[i] == b[i])
+			i++;
+		if(i == words)
+			break;
+		uint zeros = i - runStart;
+		runStart = i;
+		while(i < words && a[i] != b[i])
+			i++;
+		p = writeVarint(p, zeros);
+		p = writeVarint(p, i - runStart);
+		for(uint j = runStart; j < i; j++)
+		{
+			uint32 x = a[j] ^ b[j];
+			memcpy(p, &x, 4);
+			p += 4;
+		}
+	}
+	return p - out;
+}
+
+static void applyXORDelta(uint32 *dest, const uint8 *delta, uint size)
+{
+	auto end = delta + size;
+	while(delta < end)
+	{
+		uint32 zeros, changed;
+		delta = readVarint(delta, zeros);
+		delta = readVarint(delta, changed);
+		dest += zeros;
+		iterateTimes(changed, i)
+		{
+			uint32 x;
+			memcpy(&x, delta, 4);
+			*dest++ ^= x;
+			delta += 4;
+		}
+	}
+}
+
+static uint deltaLength(uint stateSize1, uint stateSize2)
+{
+	return IG::alignRoundedUp(std::max(stateSize1, stateSize2), 4);
+}
+
+void applyRewindOptions()
+{
+	if(optionRewindMemory)
+		rewindBuffer.init(optionRewindMemory * 1024 * 1024, optionRewindInterval);
+	else
+		rewindBuffer.deinit();
+}
+
+bool RewindBuffer::init(uint memBytes, uint frameInterval)
+{
+	deinit();
+	if(!memBytes)
+		return false;
+	this->memBytes = memBytes;
+	this->frameInterval = std::max(frameInterval, 1u);
+	logMsg("using %u bytes for rewind, capturing every %u frame(s)", memBytes, this->frameInterval);
+	return true;
+}
+
+void RewindBuffer::deinit()
+{
+	reset();
+	memBytes = 0;
+}
+
+void RewindBuffer::reset()
+{
+	logStats();
+	freeStateBuffers();
+	hasState = false;
+	framesUntilCapture = 0;
+	captureTime = {};
+	rewindTime = {};
+	captures = rewinds = 0;
+}
+
+void RewindBuffer::logStats()
+{
+	if(!captures)
+		return;
+	logMsg("%u captures, avg %.3fms, %u rewinds, avg %.3fms, %u snapshots in %u bytes",
+		captures, avgCaptureMs(), rewinds, avgRewindMs(), snapshots(), bytesUsed());
+}
+
+bool RewindBuffer::allocStateBuffers(uint size)
+{
+	freeStateBuffers();
+	stateCapacity = IG::alignRoundedUp(size, 8);
+	if(stateCapacity * 2 + deltaBound(stateCapacity) * 2 > memBytes)
+	{
+		logWarn("state buffer size %u too large for %u byte rewind buffer", stateCapacity, memBytes);
+		stateCapacity = 0;
+		return false;
+	}
+	ringBytes = memBytes - stateCapacity * 2;
+	state = (uint8*)mem_alloc(stateCapacity);
+	scratch = (uint8*)mem_alloc(stateCapacity);
+	mem = (uint8*)mem_alloc(ringBytes);
+	entry = (Entry*)mem_alloc(sizeof(Entry) * MAX_ENTRIES);
+	if(!state || !scratch || !mem || !entry)
+	{
+		logErr("out of memory allocating rewind buffers");
+		freeStateBuffers();
+		return false;
+	}
+	return true;
+}
+
+void RewindBuffer::freeStateBuffers()
+{
+	mem_freeSafe(state);
+	mem_freeSafe(scratch);
+	mem_freeSafe(mem);
+	mem_freeSafe(entry);
+	state = scratch = mem = nullptr;
+	entry = nullptr;
+	stateCapacity = stateSize = 0;
+	ringBytes = writePos = 0;
+	firstEntry = entries = 0;
+	hasState = false;
+}
+
+uint RewindBuffer::bytesUsed() const
+{
+	uint bytes = hasState ? stateSize : 0;
+	iterateTimes(entries, i)
+	{
+		bytes += entry[(firstEntry + i) % MAX_ENTRIES].size;
+	}
+	return bytes;
+}
+
+void RewindBuffer::dropOldest()
+{
+	assert(entries);
+	firstEntry = (firstEntry + 1) % MAX_ENTRIES;
+	entries--;
+}
+
+void RewindBuffer::reserve(uint bytes)
+{
+	assert(bytes <= ringBytes);
+	if(entries == MAX_ENTRIES)
+		dropOldest();
+	if(writePos + bytes > ringBytes)
+	{
+		// entries past the write position are the oldest, drop them and wrap around
+		while(entries && entryAt(0).offset >= writePos)
+			dropOldest();
+		writePos = 0;
+	}
+	while(entries)
+	{
+		auto &e = entryAt(0);
+		if(e.offset >= writePos + bytes || e.offset + e.size <= writePos)
+			break;
+		dropOldest();
+	}
+}
+
+void RewindBuffer::frameComplete()
+{
+	if(!memBytes)
+		return;
+	if(framesUntilCapture)
+	{
+		framesUntilCapture--;
+		return;
+	}
+	framesUntilCapture = frameInterval - 1;
+	capture();
+}
+
+bool RewindBuffer::capture()
+{
+	if(!memBytes)
+		return false;
+	auto startTime = TimeSys::now();
+	uint size = stateCapacity ? EmuSystem::saveStateToMemory(scratch, stateCapacity) : 0;
+	if(!size)
+	{
+		// grow the state buffers until the state fits, history is lost
+		uint newCapacity = std::max(stateCapacity * 2, MIN_STATE_BUFFER_SIZE);
+		for(; ; newCapacity *= 2)
+		{
+			if(!allocStateBuffers(newCapacity))
+			{
+				logErr("unable to capture state, disabling rewind");
+				deinit();
+				return false;
+			}
+			size = EmuSystem::saveStateToMemory(scratch, stateCapacity);
+			if(size)
+				break;
+		}
+		logMsg("state size %u, using %u byte buffers", size, stateCapacity);
+	}
+	if(hasState)
+	{
+		uint length = deltaLength(stateSize, size);
+		memset(scratch + size, 0, length - size);
+		memset(state + stateSize, 0, length - stateSize);
+		reserve(deltaBound(length));
+		uint deltaSize = encodeXORDelta((uint32*)state, (uint32*)scratch, length / 4, &mem[writePos]);
+		entryAt(entries) = {writePos, deltaSize, stateSize};
+		entries++;
+		writePos += deltaSize;
+	}
+	std::swap(state, scratch);
+	stateSize = size;
+	hasState = true;
+	captureTime += TimeSys::now() - startTime;
+	captures++;
+	return true;
+}
+
+bool RewindBuffer::rewind()
+{
+	if(!hasState)
+		return false;
+	auto startTime = TimeSys::now();
+	auto res = EmuSystem::loadStateFromMemory(state, stateSize);
+	if(res != STATE_RESULT_OK)
+	{
+		logErr("error %d loading rewind state", res);
+		reset();
+		return false;
+	}
+	if(entries)
+	{
+		auto &e = entryAt(entries - 1);
+		uint length = deltaLength(stateSize, e.stateSize);
+		memset(state + stateSize, 0, length - stateSize);
+		applyXORDelta((uint32*)state, &mem[e.offset], e.size);
+		stateSize = e.stateSize;
+		writePos = e.offset;
+		entries--;
+	}
+	else
+		hasState = false;
+	framesUntilCapture = 0;
+	rewindTime += TimeSys::now() - startTime;
+	rewinds++;
+	return true;
+}
@@ -0,0 +1,113 @@
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#define LOGTAG "RunAhead"
+#include <RunAhead.hh>
+#include <EmuSystem.hh>
+#include <imagine/mem/mem.h>
+#include <algorithm>
+
+RunAhead runAhead;
+
+static constexpr uint MIN_STATE_BUFFER_SIZE = 0x40000;
+static constexpr uint STATS_LOG_INTERVAL = 600;
+
+void RunAhead::setFrames(uint frames)
+{
+	frames = std::min(frames, MAX_FRAMES);
+	if(frames == frames_)
+		return;
+	frames_ = frames;
+	resetStats();
+	if(!frames)
+	{
+		deinit();
+		return;
+	}
+	logMsg("running %u frame(s) ahead", frames);
+}
+
+void RunAhead::deinit()
+{
+	mem_freeSafe(state);
+	state = nullptr;
+	stateCapacity = 0;
+	frames_ = 0;
+}
+
+void RunAhead::resetStats()
+{
+	extraTime = {};
+	runs = 0;
+}
+
+uint RunAhead::saveState()
+{
+	uint size = stateCapacity ? EmuSystem::saveStateToMemory(state, stateCapacity) : 0;
+	if(size)
+		return size;
+	// grow the buffer until the state fits
+	for(uint newCapacity = std::max(stateCapacity * 2, MIN_STATE_BUFFER_SIZE); newCapacity <= 0x4000000; newCapacity *= 2)
+	{
+		auto newState = (uint8*)mem_realloc(state, newCapacity);
+		if(!newState)
+			break;
+		state = newState;
+		stateCapacity = newCapacity;
+		size = EmuSystem::saveStateToMemory(state, stateCapacity);
+		if(size)
+		{
+			logMsg("state size %u, using %u byte buffer", size, stateCapacity);
+			return size;
+		}
+	}
+	return 0;
+}
+
+void RunAhead::runFrame(bool renderAudio)
+{
+	assert(frames_);
+	EmuSystem::runFrame(0, 0, renderAudio);
+	auto startTime = TimeSys::now();
+	uint size = saveState();
+	if(!size)
+	{
+		logErr("unable to save state, disabling run-ahead");
+		deinit();
+		// the real frame already ran, present the following one instead
+		EmuSystem::runFrame(1, 1, 0);
+		return;
+	}
+	iterateTimes(frames_ - 1, i)
+	{
+		EmuSystem::runFrame(0, 0, 0);
+	}
+	EmuSystem::runFrame(1, 1, 0);
+	auto res = EmuSystem::loadStateFromMemory(state, size);
+	if(res != STATE_RESULT_OK)
+	{
+		logErr("error %d restoring state, disabling run-ahead", res);
+		deinit();
+		return;
+	}
+	extraTime += TimeSys::now() - startTime;
+	if(++runs % STATS_LOG_INTERVAL == 0)
+		logStats();
+}
+
+void RunAhead::logStats()
+{
+	logMsg("%u frame(s) ahead costs %.3fms extra per frame", frames_, avgExtraMs());
+}
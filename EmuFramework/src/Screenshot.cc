@@ -23,24 +23,10 @@
 
 bool writeScreenshot(const IG::Pixmap &vidPix, const char *fname)
 {
-	auto screen = vidPix.data;
 	auto tempImgBuff = (char*)mem_alloc(vidPix.x * vidPix.y * 3);
 	IG::Pixmap tempPix(PixelFormatRGB888);
 	tempPix.init(tempImgBuff, vidPix.x, vidPix.y);
-	for(uint y = 0; y < vidPix.y; y++, screen += vidPix.pitch, tempImgBuff += tempPix.pitch)
-	{
-		auto rowpix = tempImgBuff;
-		for(uint x = 0; x < vidPix.x; x++)
-		{
-			// assumes RGB565
-			uint16 pixVal = *(uint16 *)(screen+2*x);
-			uint32 r = pixVal >> 11, g = (pixVal >> 5) & 0x3f, b = pixVal & 0x1f;
-			r *= 8; g *= 4; b *= 8;
-			*(rowpix++) = r;
-			*(rowpix++) = g;
-			*(rowpix++) = b;
-		}
-	}
+	vidPix.copy(0, 0, 0, 0, tempPix, 0, 0);
 	Quartz2dImage::writeImage(tempPix, fname);
 	mem_free(tempPix.data);
 	logMsg("%s saved.", fname);
@@ -166,26 +152,8 @@ bool writeScreenshot(const IG::Pixmap &vidPix, const char *fname)
 	auto screen = vidPix.data;
 	for(uint y=0; y < vidPix.y; y++, screen+=vidPix.pitch)
 	{
-		png_byte *rowpix = rowPtr;
-		for(uint x=0; x < vidPix.x; x++)
-		{
-			// assumes RGB565
-			uint16 pixVal = *(uint16 *)(screen+2*x);
-			uint32 r = pixVal >> 11, g = (pixVal >> 5) & 0x3f, b = pixVal & 0x1f;
-			r *= 8; g *= 4; b *= 8;
-			*(rowpix++) = r;
-			*(rowpix++) = g;
-			*(rowpix++) = b;
-			if(imgwidth!=vidPix.x)
-			{
-				*(rowpix++) = r;
-				*(rowpix++) = g;
-				*(rowpix++) = b;
-			}
-		}
+		IG::convertPixels(vidPix.format, screen, PixelFormatRGB888, rowPtr, vidPix.x);
 		png_write_row(pngPtr, rowPtr);
-		if(imgheight!=vidPix.y)
-			png_write_row(pngPtr, rowPtr);
 	}
 
 	mem_free(rowPtr);
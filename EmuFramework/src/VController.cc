@@ -715,7 +715,7 @@ void VController::inputAction(uint action, uint vBtn)
 	if(kbMode)
 	{
 		assert(vBtn < sizeofArray(kbMap));
-		EmuSystem::handleInputAction(action, kbMap[vBtn]);
+		EmuSystem::postInputAction(action, kbMap[vBtn]);
 	}
 	else
 	#endif
@@ -734,7 +734,7 @@ void VController::inputAction(uint action, uint vBtn)
 				turboActions.removeEvent(keyCode);
 			}
 		}
-		EmuSystem::handleInputAction(action, keyCode);
+		EmuSystem::postInputAction(action, keyCode);
 	}
 }
 
@@ -0,0 +1,937 @@
+/*  This file is part of EmuFramework.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with EmuFramework.  If not, see <http://www.gnu.org/licenses/> */
+
+#define LOGTAG "VideoImageFilter"
+#include <VideoImageFilter.hh>
+#include <imagine/util/thread/pthread.hh>
+#include <imagine/mem/mem.h>
+#include <algorithm>
+#include <new>
+#include <unistd.h>
+#if defined __x86_64__ || defined __i386__
+#include <emmintrin.h>
+#define FILTER_SSE2
+#elif defined __ARM_NEON__ || defined __ARM_NEON
+#include <arm_neon.h>
+#define FILTER_NEON
+#endif
+
+struct BandJob
+{
+	void (*func)(const BandJob &job, int yStart, int yEnd);
+	const IG::Pixmap *src;
+	IG::Pixmap *dest;
+	int16 *yuv;
+};
+
+// Runs a job over a frame's lines, one band on the calling thread and
+// one on each worker, returning once every band is done
+class BandThreadPool
+{
+public:
+	constexpr BandThreadPool() {}
+	void run(const BandJob &job, uint lines);
+	void deinit();
+
+private:
+	static constexpr uint MAX_WORKERS = 3;
+	ThreadPThread thread[MAX_WORKERS];
+	MutexPThread mutex;
+	CondVarPThread workCond, doneCond;
+	const BandJob *job = nullptr;
+	uint lines = 0;
+	uint workers = 0, pendingWorkers = 0, generation = 0;
+	bool init = false, quit = false;
+
+	void initWorkers();
+	void workerLoop(uint idx);
+	void runBand(uint band);
+};
+
+static BandThreadPool pool;
+
+void BandThreadPool::initWorkers()
+{
+	init = true;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	uint requested = std::min(cpus > 1 ? (uint)cpus - 1 : 0u, MAX_WORKERS);
+	if(!requested || !mutex.create())
+	{
+		logMsg("filtering on the calling thread only");
+		return;
+	}
+	workCond.create(mutex);
+	doneCond.create(mutex);
+	// workers don't read the count until the first job, and run() only
+	// waits on the threads that actually started
+	iterateTimes(requested, i)
+	{
+		if(!thread[i].create(0,
+			[this](ThreadPThread &thread)
+			{
+				workerLoop(&thread - this->thread);
+				return (ptrsize)0;
+			}))
+		{
+			break;
+		}
+		workers++;
+	}
+	logMsg("using %d of %d filter worker threads", workers, requested);
+	if(!workers)
+		mutex.destroy();
+}
+
+void BandThreadPool::workerLoop(uint idx)
+{
+	uint seenGeneration = 0;
+	mutex.lock();
+	for(;;)
+	{
+		while(generation == seenGeneration && !quit)
+			workCond.wait();
+		if(quit)
+			break;
+		seenGeneration = generation;
+		mutex.unlock();
+		runBand(idx + 1);
+		mutex.lock();
+		if(!--pendingWorkers)
+			doneCond.signal();
+	}
+	mutex.unlock();
+}
+
+void BandThreadPool::runBand(uint band)
+{
+	uint bands = workers + 1;
+	job->func(*job, lines * band / bands, lines * (band + 1) / bands);
+}
+
+void BandThreadPool::run(const BandJob &job, uint lines)
+{
+	if(!init)
+		initWorkers();
+	if(!workers)
+	{
+		job.func(job, 0, lines);
+		return;
+	}
+	mutex.lock();
+	this->job = &job;
+	this->lines = lines;
+	pendingWorkers = workers;
+	generation++;
+	workCond.broadcast();
+	mutex.unlock();
+	runBand(0);
+	mutex.lock();
+	while(pendingWorkers)
+		doneCond.wait();
+	mutex.unlock();
+}
+
+void BandThreadPool::deinit()
+{
+	if(!init)
+		return;
+	if(workers)
+	{
+		mutex.lock();
+		quit = true;
+		workCond.broadcast();
+		mutex.unlock();
+		iterateTimes(workers, i)
+		{
+			thread[i].join();
+		}
+		mutex.destroy();
+	}
+	init = quit = false;
+	workers = generation = 0;
+}
+
+// pixel formats the filters operate on directly
+
+struct PixRGB565
+{
+	using Type = uint16;
+
+	static void rgb(Type p, int &r, int &g, int &b)
+	{
+		r = ((p >> 11) << 3) | (p >> 13);
+		g = (((p >> 5) & 0x3f) << 2) | ((p >> 9) & 0x3);
+		b = ((p & 0x1f) << 3) | ((p >> 2) & 0x7);
+	}
+
+	static Type make(int r, int g, int b)
+	{
+		return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+	}
+
+	// mix weight/256 of src into dst
+	static Type blend(Type dst, Type src, uint weight)
+	{
+		uint inv = 256 - weight;
+		uint rb = (((dst & 0xF81F) * inv + (src & 0xF81F) * weight) >> 8) & 0xF81F;
+		uint g = (((dst & 0x07E0) * inv + (src & 0x07E0) * weight) >> 8) & 0x07E0;
+		return rb | g;
+	}
+};
+
+// RGBA8888 or BGRA8888, color channels in the first three bytes
+struct Pix8888
+{
+	using Type = uint32;
+
+	static void rgb(Type p, int &r, int &g, int &b)
+	{
+		r = p & 0xff;
+		g = (p >> 8) & 0xff;
+		b = (p >> 16) & 0xff;
+	}
+
+	static Type make(int r, int g, int b)
+	{
+		return r | (g << 8) | (b << 16) | (0xff << 24);
+	}
+
+	static Type blend(Type dst, Type src, uint weight)
+	{
+		uint inv = 256 - weight;
+		uint rb = (((dst & 0x00FF00FF) * inv + (src & 0x00FF00FF) * weight) >> 8) & 0x00FF00FF;
+		uint ga = (((dst >> 8) & 0x00FF00FF) * inv + ((src >> 8) & 0x00FF00FF) * weight) & 0xFF00FF00;
+		return rb | ga;
+	}
+};
+
+template <class T>
+static const T *srcLine(const IG::Pixmap &pix, int y)
+{
+	return (const T*)pix.getPixel(0, IG::clipToBounds(y, 0, (int)pix.y - 1));
+}
+
+template <class T>
+static T *destLine(IG::Pixmap &pix, int y)
+{
+	return (T*)pix.getPixel(0, y);
+}
+
+// Scale2x/Scale3x (AdvanceMAME), B above, D left, F right, H below
+
+template <class T>
+static void scale2xPixel(const T *lineB, const T *lineE, const T *lineH, int x, int w, T *out0, T *out1)
+{
+	T B = lineB[x], H = lineH[x], E = lineE[x];
+	T D = lineE[std::max(x - 1, 0)], F = lineE[std::min(x + 1, w - 1)];
+	if(B != H && D != F)
+	{
+		out0[x*2] = D == B ? D : E;
+		out0[x*2+1] = B == F ? F : E;
+		out1[x*2] = D == H ? D : E;
+		out1[x*2+1] = H == F ? F : E;
+	}
+	else
+	{
+		out0[x*2] = out0[x*2+1] = out1[x*2] = out1[x*2+1] = E;
+	}
+}
+
+#if defined FILTER_SSE2
+// SSE2 has no 3-way interleave, so spill the vectors and interleave in scalar code
+template <class Vec>
+static void storeZip3Scalar(typename Vec::T *p, typename Vec::V a, typename Vec::V b, typename Vec::V c)
+{
+	alignas(16) typename Vec::T v[3][Vec::N];
+	_mm_store_si128((typename Vec::V*)v[0], a);
+	_mm_store_si128((typename Vec::V*)v[1], b);
+	_mm_store_si128((typename Vec::V*)v[2], c);
+	iterateTimes(Vec::N, i)
+	{
+		p[i*3] = v[0][i];
+		p[i*3+1] = v[1][i];
+		p[i*3+2] = v[2][i];
+	}
+}
+
+struct VecSSE2_32
+{
+	using T = uint32;
+	using V = __m128i;
+	static constexpr int N = 4;
+	static V load(const T *p) { return _mm_loadu_si128((const V*)p); }
+	static V eq(V a, V b) { return _mm_cmpeq_epi32(a, b); }
+	static void storeZip(T *p, V a, V b)
+	{
+		_mm_storeu_si128((V*)p, _mm_unpacklo_epi32(a, b));
+		_mm_storeu_si128((V*)(p + N), _mm_unpackhi_epi32(a, b));
+	}
+	static V andV(V a, V b) { return _mm_and_si128(a, b); }
+	static V orV(V a, V b) { return _mm_or_si128(a, b); }
+	static V andNot(V a, V b) { return _mm_andnot_si128(a, b); }
+	static V neither(V a, V b) { return _mm_andnot_si128(_mm_or_si128(a, b), _mm_set1_epi32(-1)); }
+	static V select(V mask, V a, V b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+	static void storeZip3(T *p, V a, V b, V c) { storeZip3Scalar<VecSSE2_32>(p, a, b, c); }
+};
+
+struct VecSSE2_16
+{
+	using T = uint16;
+	using V = __m128i;
+	static constexpr int N = 8;
+	static V load(const T *p) { return _mm_loadu_si128((const V*)p); }
+	static V eq(V a, V b) { return _mm_cmpeq_epi16(a, b); }
+	static void storeZip(T *p, V a, V b)
+	{
+		_mm_storeu_si128((V*)p, _mm_unpacklo_epi16(a, b));
+		_mm_storeu_si128((V*)(p + N), _mm_unpackhi_epi16(a, b));
+	}
+	static V andV(V a, V b) { return _mm_and_si128(a, b); }
+	static V orV(V a, V b) { return _mm_or_si128(a, b); }
+	static V andNot(V a, V b) { return _mm_andnot_si128(a, b); }
+	static V neither(V a, V b) { return _mm_andnot_si128(_mm_or_si128(a, b), _mm_set1_epi32(-1)); }
+	static V select(V mask, V a, V b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+	static void storeZip3(T *p, V a, V b, V c) { storeZip3Scalar<VecSSE2_16>(p, a, b, c); }
+};
+#elif defined FILTER_NEON
+struct VecNEON_32
+{
+	using T = uint32;
+	using V = uint32x4_t;
+	static constexpr int N = 4;
+	static V load(const T *p) { return vld1q_u32(p); }
+	static V eq(V a, V b) { return vceqq_u32(a, b); }
+	static void storeZip(T *p, V a, V b)
+	{
+		auto zip = vzipq_u32(a, b);
+		vst1q_u32(p, zip.val[0]);
+		vst1q_u32(p + N, zip.val[1]);
+	}
+	static V andV(V a, V b) { return vandq_u32(a, b); }
+	static V orV(V a, V b) { return vorrq_u32(a, b); }
+	static V andNot(V a, V b) { return vbicq_u32(b, a); }
+	static V neither(V a, V b) { return vmvnq_u32(vorrq_u32(a, b)); }
+	static V select(V mask, V a, V b) { return vbslq_u32(mask, a, b); }
+	static void storeZip3(T *p, V a, V b, V c) { vst3q_u32(p, uint32x4x3_t{{a, b, c}}); }
+};
+
+struct VecNEON_16
+{
+	using T = uint16;
+	using V = uint16x8_t;
+	static constexpr int N = 8;
+	static V load(const T *p) { return vld1q_u16(p); }
+	static V eq(V a, V b) { return vceqq_u16(a, b); }
+	static void storeZip(T *p, V a, V b)
+	{
+		auto zip = vzipq_u16(a, b);
+		vst1q_u16(p, zip.val[0]);
+		vst1q_u16(p + N, zip.val[1]);
+	}
+	static V andV(V a, V b) { return vandq_u16(a, b); }
+	static V orV(V a, V b) { return vorrq_u16(a, b); }
+	static V andNot(V a, V b) { return vbicq_u16(b, a); }
+	static V neither(V a, V b) { return vmvnq_u16(vorrq_u16(a, b)); }
+	static V select(V mask, V a, V b) { return vbslq_u16(mask, a, b); }
+	static void storeZip3(T *p, V a, V b, V c) { vst3q_u16(p, uint16x8x3_t{{a, b, c}}); }
+};
+#endif
+
+// handles pixels [x, w-1) in vector sized blocks, returning the next x
+template <class Vec>
+static int scale2xLineSIMD(const typename Vec::T *lineB, const typename Vec::T *lineE, const typename Vec::T *lineH,
+	int x, int w, typename Vec::T *out0, typename Vec::T *out1)
+{
+	for(; x + Vec::N < w; x += Vec::N)
+	{
+		auto B = Vec::load(lineB + x), H = Vec::load(lineH + x), E = Vec::load(lineE + x);
+		auto D = Vec::load(lineE + x - 1), F = Vec::load(lineE + x + 1);
+		auto active = Vec::neither(Vec::eq(B, H), Vec::eq(D, F));
+		auto e0 = Vec::select(Vec::andV(active, Vec::eq(D, B)), D, E);
+		auto e1 = Vec::select(Vec::andV(active, Vec::eq(B, F)), F, E);
+		auto e2 = Vec::select(Vec::andV(active, Vec::eq(D, H)), D, E);
+		auto e3 = Vec::select(Vec::andV(active, Vec::eq(H, F)), F, E);
+		Vec::storeZip(out0 + x*2, e0, e1);
+		Vec::storeZip(out1 + x*2, e2, e3);
+	}
+	return x;
+}
+
+template <class T>
+static int scale2xLineVector(const T *lineB, const T *lineE, const T *lineH, int x, int w, T *out0, T *out1);
+
+template <>
+int scale2xLineVector<uint16>(const uint16 *lineB, const uint16 *lineE, const uint16 *lineH, int x, int w, uint16 *out0, uint16 *out1)
+{
+	#if defined FILTER_SSE2
+	return scale2xLineSIMD<VecSSE2_16>(lineB, lineE, lineH, x, w, out0, out1);
+	#elif defined FILTER_NEON
+	return scale2xLineSIMD<VecNEON_16>(lineB, lineE, lineH, x, w, out0, out1);
+	#else
+	return x;
+	#endif
+}
+
+template <>
+int scale2xLineVector<uint32>(const uint32 *lineB, const uint32 *lineE, const uint32 *lineH, int x, int w, uint32 *out0, uint32 *out1)
+{
+	#if defined FILTER_SSE2
+	return scale2xLineSIMD<VecSSE2_32>(lineB, lineE, lineH, x, w, out0, out1);
+	#elif defined FILTER_NEON
+	return scale2xLineSIMD<VecNEON_32>(lineB, lineE, lineH, x, w, out0, out1);
+	#else
+	return x;
+	#endif
+}
+
+template <class Pix>
+static void scale2xBand(const BandJob &job, int yStart, int yEnd)
+{
+	using T = typename Pix::Type;
+	int w = job.src->x;
+	for(int y = yStart; y < yEnd; y++)
+	{
+		auto lineB = srcLine<T>(*job.src, y - 1), lineE = srcLine<T>(*job.src, y), lineH = srcLine<T>(*job.src, y + 1);
+		auto out0 = destLine<T>(*job.dest, y*2), out1 = destLine<T>(*job.dest, y*2 + 1);
+		scale2xPixel(lineB, lineE, lineH, 0, w, out0, out1);
+		int x = scale2xLineVector<T>(lineB, lineE, lineH, 1, w, out0, out1);
+		for(; x < w; x++)
+			scale2xPixel(lineB, lineE, lineH, x, w, out0, out1);
+	}
+}
+
+template <class T>
+static void scale3xPixel(const T *line0, const T *line1, const T *line2, int x, int w, T *out0, T *out1, T *out2)
+{
+	int xL = std::max(x - 1, 0), xR = std::min(x + 1, w - 1);
+	T A = line0[xL], B = line0[x], C = line0[xR];
+	T D = line1[xL], E = line1[x], F = line1[xR];
+	T G = line2[xL], H = line2[x], I = line2[xR];
+	T *o0 = &out0[x*3], *o1 = &out1[x*3], *o2 = &out2[x*3];
+	if(B != H && D != F)
+	{
+		o0[0] = D == B ? D : E;
+		o0[1] = (D == B && E != C) || (B == F && E != A) ? B : E;
+		o0[2] = B == F ? F : E;
+		o1[0] = (D == B && E != G) || (D == H && E != A) ? D : E;
+		o1[1] = E;
+		o1[2] = (B == F && E != I) || (H == F && E != C) ? F : E;
+		o2[0] = D == H ? D : E;
+		o2[1] = (D == H && E != I) || (H == F && E != G) ? H : E;
+		o2[2] = H == F ? F : E;
+	}
+	else
+	{
+		o0[0] = o0[1] = o0[2] = E;
+		o1[0] = o1[1] = o1[2] = E;
+		o2[0] = o2[1] = o2[2] = E;
+	}
+}
+
+// same rules as scale3xPixel, handles pixels [x, w-1) in vector sized blocks, returning the next x
+template <class Vec>
+static int scale3xLineSIMD(const typename Vec::T *line0, const typename Vec::T *line1, const typename Vec::T *line2,
+	int x, int w, typename Vec::T *out0, typename Vec::T *out1, typename Vec::T *out2)
+{
+	for(; x + Vec::N < w; x += Vec::N)
+	{
+		auto A = Vec::load(line0 + x - 1), B = Vec::load(line0 + x), C = Vec::load(line0 + x + 1);
+		auto D = Vec::load(line1 + x - 1), E = Vec::load(line1 + x), F = Vec::load(line1 + x + 1);
+		auto G = Vec::load(line2 + x - 1), H = Vec::load(line2 + x), I = Vec::load(line2 + x + 1);
+		auto active = Vec::neither(Vec::eq(B, H), Vec::eq(D, F));
+		auto DB = Vec::andV(active, Vec::eq(D, B)), BF = Vec::andV(active, Vec::eq(B, F)),
+			DH = Vec::andV(active, Vec::eq(D, H)), HF = Vec::andV(active, Vec::eq(H, F));
+		auto EA = Vec::eq(E, A), EC = Vec::eq(E, C), EG = Vec::eq(E, G), EI = Vec::eq(E, I);
+		Vec::storeZip3(out0 + x*3,
+			Vec::select(DB, D, E),
+			Vec::select(Vec::orV(Vec::andNot(EC, DB), Vec::andNot(EA, BF)), B, E),
+			Vec::select(BF, F, E));
+		Vec::storeZip3(out1 + x*3,
+			Vec::select(Vec::orV(Vec::andNot(EG, DB), Vec::andNot(EA, DH)), D, E),
+			E,
+			Vec::select(Vec::orV(Vec::andNot(EI, BF), Vec::andNot(EC, HF)), F, E));
+		Vec::storeZip3(out2 + x*3,
+			Vec::select(DH, D, E),
+			Vec::select(Vec::orV(Vec::andNot(EI, DH), Vec::andNot(EG, HF)), H, E),
+			Vec::select(HF, F, E));
+	}
+	return x;
+}
+
+template <class T>
+static int scale3xLineVector(const T *line0, const T *line1, const T *line2, int x, int w, T *out0, T *out1, T *out2);
+
+template <>
+int scale3xLineVector<uint16>(const uint16 *line0, const uint16 *line1, const uint16 *line2, int x, int w, uint16 *out0, uint16 *out1, uint16 *out2)
+{
+	#if defined FILTER_SSE2
+	return scale3xLineSIMD<VecSSE2_16>(line0, line1, line2, x, w, out0, out1, out2);
+	#elif defined FILTER_NEON
+	return scale3xLineSIMD<VecNEON_16>(line0, line1, line2, x, w, out0, out1, out2);
+	#else
+	return x;
+	#endif
+}
+
+template <>
+int scale3xLineVector<uint32>(const uint32 *line0, const uint32 *line1, const uint32 *line2, int x, int w, uint32 *out0, uint32 *out1, uint32 *out2)
+{
+	#if defined FILTER_SSE2
+	return scale3xLineSIMD<VecSSE2_32>(line0, line1, line2, x, w, out0, out1, out2);
+	#elif defined FILTER_NEON
+	return scale3xLineSIMD<VecNEON_32>(line0, line1, line2, x, w, out0, out1, out2);
+	#else
+	return x;
+	#endif
+}
+
+template <class Pix>
+static void scale3xBand(const BandJob &job, int yStart, int yEnd)
+{
+	using T = typename Pix::Type;
+	int w = job.src->x;
+	for(int y = yStart; y < yEnd; y++)
+	{
+		auto line0 = srcLine<T>(*job.src, y - 1), line1 = srcLine<T>(*job.src, y), line2 = srcLine<T>(*job.src, y + 1);
+		auto out0 = destLine<T>(*job.dest, y*3), out1 = destLine<T>(*job.dest, y*3 + 1), out2 = destLine<T>(*job.dest, y*3 + 2);
+		scale3xPixel(line0, line1, line2, 0, w, out0, out1, out2);
+		int x = scale3xLineVector<T>(line0, line1, line2, 1, w, out0, out1, out2);
+		for(; x < w; x++)
+			scale3xPixel(line0, line1, line2, x, w, out0, out1, out2);
+	}
+}
+
+// HQ2x, a CPU version of the GLSL effect in hq2x-f.txt evaluated at exactly
+// 2x with nearest sampling so both produce the same image
+
+#if defined FILTER_SSE2
+struct Color
+{
+	__m128 v;
+
+	Color() {}
+	Color(__m128 v): v(v) {}
+	Color(float r, float g, float b): v(_mm_set_ps(0, b, g, r)) {}
+	Color operator+(Color c) const { return _mm_add_ps(v, c.v); }
+	Color operator*(float f) const { return _mm_mul_ps(v, _mm_set1_ps(f)); }
+	float sum() const
+	{
+		__m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+		s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+		return _mm_cvtss_f32(s);
+	}
+	float diff(Color c) const
+	{
+		return Color(_mm_andnot_ps(_mm_set1_ps(-0.f), _mm_sub_ps(v, c.v))).sum();
+	}
+	void get(float *out) const { _mm_storeu_ps(out, v); }
+};
+#elif defined FILTER_NEON
+struct Color
+{
+	float32x4_t v;
+
+	Color() {}
+	Color(float32x4_t v): v(v) {}
+	Color(float r, float g, float b) { float c[4] {r, g, b, 0}; v = vld1q_f32(c); }
+	Color operator+(Color c) const { return vaddq_f32(v, c.v); }
+	Color operator*(float f) const { return vmulq_n_f32(v, f); }
+	float sum() const
+	{
+		float32x2_t s = vpadd_f32(vget_low_f32(v), vget_high_f32(v));
+		return vget_lane_f32(vpadd_f32(s, s), 0);
+	}
+	float diff(Color c) const { return Color(vabdq_f32(v, c.v)).sum(); }
+	void get(float *out) const { vst1q_f32(out, v); }
+};
+#else
+struct Color
+{
+	float r = 0, g = 0, b = 0;
+
+	Color() {}
+	Color(float r, float g, float b): r(r), g(g), b(b) {}
+	Color operator+(Color c) const { return {r + c.r, g + c.g, b + c.b}; }
+	Color operator*(float f) const { return {r * f, g * f, b * f}; }
+	float sum() const { return r + g + b; }
+	float diff(Color c) const { return std::abs(r - c.r) + std::abs(g - c.g) + std::abs(b - c.b); }
+	void get(float *out) const { out[0] = r; out[1] = g; out[2] = b; }
+};
+#endif
+
+template <class Pix>
+static Color toColor(typename Pix::Type p)
+{
+	int r, g, b;
+	Pix::rgb(p, r, g, b);
+	const float scale = 1.f / 255.f;
+	return {r * scale, g * scale, b * scale};
+}
+
+template <class Pix>
+static typename Pix::Type fromColor(Color c)
+{
+	float v[4];
+	c.get(v);
+	auto toByte = [](float f) { return (int)(IG::clipToBounds(f, 0.f, 1.f) * 255.f + .5f); };
+	return Pix::make(toByte(v[0]), toByte(v[1]), toByte(v[2]));
+}
+
+static Color hq2xSubPixel(const Color (&n)[3][3], int sx, int sy)
+{
+	const float mx = 0.325f, k = -0.250f, maxW = 0.25f, minW = -0.05f, lumAdd = 0.25f;
+	// the neighbour half a texel toward the sub-pixel's side is the center pixel itself
+	const Color &c00 = n[sy][sx], &c10 = n[sy][1], &c20 = n[sy][sx+1];
+	const Color &c01 = n[1][sx], &c21 = n[1][sx+1];
+	const Color &c02 = n[sy+1][sx], &c12 = n[sy+1][1], &c22 = n[sy+1][sx+1];
+	Color c11 = n[1][1];
+
+	float md1 = c00.diff(c22);
+	float md2 = c02.diff(c20);
+	float w1 = c22.diff(c11) * md2;
+	float w2 = c02.diff(c11) * md1;
+	float w3 = c00.diff(c11) * md2;
+	float w4 = c20.diff(c11) * md1;
+	float t1 = w1 + w3;
+	float t2 = w2 + w4;
+	float ww = std::max(t1, t2) + 0.0001f;
+	c11 = (c00 * w1 + c20 * w2 + c22 * w3 + c02 * w4 + c11 * ww) * (1.f / (t1 + t2 + ww));
+
+	float lc1 = k / (0.12f * (c10 + c12 + c11).sum() + lumAdd);
+	float lc2 = k / (0.12f * (c01 + c21 + c11).sum() + lumAdd);
+	w1 = IG::clipToBounds(lc1 * c11.diff(c10) + mx, minW, maxW);
+	w2 = IG::clipToBounds(lc2 * c11.diff(c21) + mx, minW, maxW);
+	w3 = IG::clipToBounds(lc1 * c11.diff(c12) + mx, minW, maxW);
+	w4 = IG::clipToBounds(lc2 * c11.diff(c01) + mx, minW, maxW);
+	return c10 * w1 + c21 * w2 + c12 * w3 + c01 * w4 + c11 * (1.f - w1 - w2 - w3 - w4);
+}
+
+template <class Pix>
+static void hq2xBand(const BandJob &job, int yStart, int yEnd)
+{
+	using T = typename Pix::Type;
+	int w = job.src->x;
+	for(int y = yStart; y < yEnd; y++)
+	{
+		const T *line[3] {srcLine<T>(*job.src, y - 1), srcLine<T>(*job.src, y), srcLine<T>(*job.src, y + 1)};
+		T *out[2] {destLine<T>(*job.dest, y*2), destLine<T>(*job.dest, y*2 + 1)};
+		Color n[3][3];
+		// slide the 3x3 window, converting only the new column
+		iterateTimes(3, i)
+		{
+			n[i][0] = n[i][1] = toColor<Pix>(line[i][0]);
+			n[i][2] = toColor<Pix>(line[i][std::min(1, w - 1)]);
+		}
+		for(int x = 0; x < w; x++)
+		{
+			if(x)
+			{
+				int xR = std::min(x + 1, w - 1);
+				iterateTimes(3, i)
+				{
+					n[i][0] = n[i][1];
+					n[i][1] = n[i][2];
+					n[i][2] = toColor<Pix>(line[i][xR]);
+				}
+			}
+			iterateTimes(2, sy)
+			{
+				out[sy][x*2] = fromColor<Pix>(hq2xSubPixel(n, 0, sy));
+				out[sy][x*2+1] = fromColor<Pix>(hq2xSubPixel(n, 1, sy));
+			}
+		}
+	}
+}
+
+// 2xBR (Hyllian), edges found by comparing weighted YUV distances over
+// the 5x5 neighbourhood minus corners, evaluated once per rotation. The
+// rules branch per pixel and blend with varying weights, so there's no
+// vector kernel, only the band threading speeds it up
+
+static constexpr int xbrEqThreshold = 48 * 6; // about 6 steps of luma
+
+template <class Pix>
+static void xbrYUVBand(const BandJob &job, int yStart, int yEnd)
+{
+	using T = typename Pix::Type;
+	int w = job.src->x;
+	bool bgr = job.src->format.isBGROrder();
+	for(int y = yStart; y < yEnd; y++)
+	{
+		auto line = srcLine<T>(*job.src, y);
+		auto yuv = &job.yuv[y * w * 3];
+		for(int x = 0; x < w; x++, yuv += 3)
+		{
+			int r, g, b;
+			Pix::rgb(line[x], r, g, b);
+			if(bgr)
+				std::swap(r, b);
+			yuv[0] = (299 * r + 587 * g + 114 * b) / 1000;
+			yuv[1] = (-169 * r - 331 * g + 500 * b) / 1000;
+			yuv[2] = (500 * r - 419 * g - 81 * b) / 1000;
+		}
+	}
+}
+
+template <class T>
+struct XbrNeighbours
+{
+	T pix[5][5];
+	const int16 *yuv[5][5];
+
+	// rotates so the same rules apply to each output corner
+	template <int ROTATION>
+	static void offset(int dx, int dy, int &x, int &y)
+	{
+		switch(ROTATION)
+		{
+			case 0: x = dx; y = dy; return;
+			case 1: x = dy; y = -dx; return;
+			case 2: x = -dx; y = -dy; return;
+			default: x = -dy; y = dx; return;
+		}
+	}
+
+	template <int ROTATION>
+	T p(int dx, int dy) const
+	{
+		int x, y;
+		offset<ROTATION>(dx, dy, x, y);
+		return pix[y+2][x+2];
+	}
+
+	template <int ROTATION>
+	int df(int dx1, int dy1, int dx2, int dy2) const
+	{
+		int x1, y1, x2, y2;
+		offset<ROTATION>(dx1, dy1, x1, y1);
+		offset<ROTATION>(dx2, dy2, x2, y2);
+		auto a = yuv[y1+2][x1+2], b = yuv[y2+2][x2+2];
+		return 48 * std::abs(a[0] - b[0]) + 7 * std::abs(a[1] - b[1]) + 6 * std::abs(a[2] - b[2]);
+	}
+
+	template <int ROTATION>
+	bool eq(int dx1, int dy1, int dx2, int dy2) const
+	{
+		return df<ROTATION>(dx1, dy1, dx2, dy2) < xbrEqThreshold;
+	}
+
+	template <int ROTATION>
+	static uint corner(int dx, int dy)
+	{
+		int x, y;
+		offset<ROTATION>(dx, dy, x, y);
+		return (y > 0 ? 2 : 0) | (x > 0 ? 1 : 0);
+	}
+};
+
+template <class Pix, int ROTATION>
+static void xbrCorner(const XbrNeighbours<typename Pix::Type> &n, typename Pix::Type (&out)[4])
+{
+	// PE center, PI bottom right, PH below, PF right, PG bottom left,
+	// PC top right, PD left, PB above, F4/I4/H5/I5 two pixels out
+	enum { X, Y };
+	static const int PE[2] {0, 0}, PI[2] {1, 1}, PH[2] {0, 1}, PF[2] {1, 0}, PG[2] {-1, 1},
+		PC[2] {1, -1}, PD[2] {-1, 0}, PB[2] {0, -1}, F4[2] {2, 0}, I4[2] {2, 1}, H5[2] {0, 2}, I5[2] {1, 2};
+	#define XBR_DF(a, b) n.template df<ROTATION>(a[X], a[Y], b[X], b[Y])
+	#define XBR_EQ(a, b) n.template eq<ROTATION>(a[X], a[Y], b[X], b[Y])
+	#define XBR_P(a) n.template p<ROTATION>(a[X], a[Y])
+	if(XBR_P(PE) == XBR_P(PH) || XBR_P(PE) == XBR_P(PF))
+		return;
+	int e = XBR_DF(PE, PC) + XBR_DF(PE, PG) + XBR_DF(PI, H5) + XBR_DF(PI, F4) + (XBR_DF(PH, PF) << 2);
+	int i = XBR_DF(PH, PD) + XBR_DF(PH, I5) + XBR_DF(PF, I4) + XBR_DF(PF, PB) + (XBR_DF(PE, PI) << 2);
+	uint n3 = n.template corner<ROTATION>(1, 1), n2 = n.template corner<ROTATION>(-1, 1), n1 = n.template corner<ROTATION>(1, -1);
+	auto px = XBR_DF(PE, PF) <= XBR_DF(PE, PH) ? XBR_P(PF) : XBR_P(PH);
+	if(e < i && ((!XBR_EQ(PF, PB) && !XBR_EQ(PH, PD))
+		|| (XBR_EQ(PE, PI) && !XBR_EQ(PF, I4) && !XBR_EQ(PH, I5))
+		|| XBR_EQ(PE, PG) || XBR_EQ(PE, PC)))
+	{
+		int ke = XBR_DF(PF, PG), ki = XBR_DF(PH, PC);
+		bool ex2 = XBR_P(PE) != XBR_P(PC) && XBR_P(PB) != XBR_P(PC);
+		bool ex3 = XBR_P(PE) != XBR_P(PG) && XBR_P(PD) != XBR_P(PG);
+		bool shallow = (ke << 1) <= ki && ex3, steep = ke >= (ki << 1) && ex2;
+		if(shallow && steep)
+		{
+			out[n3] = Pix::blend(out[n3], px, 224);
+			out[n2] = Pix::blend(out[n2], px, 64);
+			out[n1] = out[n2];
+		}
+		else if(shallow)
+		{
+			out[n3] = Pix::blend(out[n3], px, 192);
+			out[n2] = Pix::blend(out[n2], px, 64);
+		}
+		else if(steep)
+		{
+			out[n3] = Pix::blend(out[n3], px, 192);
+			out[n1] = Pix::blend(out[n1], px, 64);
+		}
+		else
+			out[n3] = Pix::blend(out[n3], px, 128);
+	}
+	else if(e <= i)
+		out[n3] = Pix::blend(out[n3], px, 128);
+	#undef XBR_DF
+	#undef XBR_EQ
+	#undef XBR_P
+}
+
+template <class Pix>
+static void xbr2xBand(const BandJob &job, int yStart, int yEnd)
+{
+	using T = typename Pix::Type;
+	int w = job.src->x, h = job.src->y;
+	XbrNeighbours<T> n;
+	for(int y = yStart; y < yEnd; y++)
+	{
+		const T *line[5];
+		const int16 *yuvLine[5];
+		iterateTimes(5, i)
+		{
+			int lineY = IG::clipToBounds(y + (int)i - 2, 0, h - 1);
+			line[i] = srcLine<T>(*job.src, lineY);
+			yuvLine[i] = &job.yuv[lineY * w * 3];
+		}
+		auto out0 = destLine<T>(*job.dest, y*2), out1 = destLine<T>(*job.dest, y*2 + 1);
+		for(int x = 0; x < w; x++)
+		{
+			iterateTimes(5, col)
+			{
+				int srcX = IG::clipToBounds(x + (int)col - 2, 0, w - 1);
+				iterateTimes(5, row)
+				{
+					n.pix[row][col] = line[row][srcX];
+					n.yuv[row][col] = &yuvLine[row][srcX * 3];
+				}
+			}
+			T e[4];
+			e[0] = e[1] = e[2] = e[3] = n.pix[2][2];
+			xbrCorner<Pix, 0>(n, e);
+			xbrCorner<Pix, 1>(n, e);
+			xbrCorner<Pix, 2>(n, e);
+			xbrCorner<Pix, 3>(n, e);
+			out0[x*2] = e[0];
+			out0[x*2+1] = e[1];
+			out1[x*2] = e[2];
+			out1[x*2+1] = e[3];
+		}
+	}
+}
+
+template <class Pix>
+static void runFilter(uint filter, BandJob &job)
+{
+	switch(filter)
+	{
+		bcase VideoImageFilter::SCALE2X: job.func = scale2xBand<Pix>;
+		bcase VideoImageFilter::SCALE3X: job.func = scale3xBand<Pix>;
+		bcase VideoImageFilter::HQ2X: job.func = hq2xBand<Pix>;
+		bcase VideoImageFilter::XBR2X:
+			job.func = xbrYUVBand<Pix>;
+			pool.run(job, job.src->y);
+			job.func = xbr2xBand<Pix>;
+		bdefault:
+			return;
+	}
+	pool.run(job, job.src->y);
+}
+
+void VideoImageFilter::setFilter(uint filter)
+{
+	filter_ = filter;
+	if(!filter)
+		deinit();
+}
+
+uint VideoImageFilter::scale(uint filter)
+{
+	switch(filter)
+	{
+		case SCALE2X:
+		case HQ2X:
+		case XBR2X:
+			return 2;
+		case SCALE3X:
+			return 3;
+		default:
+			return 1;
+	}
+}
+
+bool VideoImageFilter::supportsFormat(const PixelFormatDesc &format)
+{
+	return format.id == PIXEL_RGB565 || format.id == PIXEL_RGBA8888 || format.id == PIXEL_BGRA8888;
+}
+
+IG::Pixmap &VideoImageFilter::apply(IG::Pixmap &pix)
+{
+	if(!filter_ || !pix.x || !pix.y)
+		return pix;
+	if(!supportsFormat(pix.format))
+	{
+		logWarn("no filter support for %s pixel format", pix.format.name);
+		filter_ = NO_FILTER;
+		return pix;
+	}
+	uint s = scale(filter_);
+	uint outX = pix.x * s, outY = pix.y * s;
+	uint bytes = outX * outY * pix.format.bytesPerPixel;
+	if(bytes > outBuffSize)
+	{
+		auto buff = (char*)mem_realloc(outBuff, bytes);
+		if(!buff)
+		{
+			logErr("unable to allocate %d bytes for filtered frame", bytes);
+			return pix;
+		}
+		outBuff = buff;
+		outBuffSize = bytes;
+	}
+	BandJob job {nullptr, &pix, &outPix, nullptr};
+	if(filter_ == XBR2X)
+	{
+		uint yuvSize = pix.x * pix.y * 3;
+		if(yuvSize > yuvBuffSize)
+		{
+			auto buff = (int16*)mem_realloc(yuvBuff, yuvSize * sizeof(int16));
+			if(!buff)
+			{
+				logErr("unable to allocate xBR color buffer");
+				return pix;
+			}
+			yuvBuff = buff;
+			yuvBuffSize = yuvSize;
+		}
+		job.yuv = yuvBuff;
+	}
+	new(&outPix) IG::Pixmap(pix.format);
+	outPix.init(outBuff, outX, outY);
+	if(pix.format.bytesPerPixel == 2)
+		runFilter<PixRGB565>(filter_, job);
+	else
+		runFilter<Pix8888>(filter_, job);
+	return outPix;
+}
+
+void VideoImageFilter::deinit()
+{
+	pool.deinit();
+	mem_freeSafe(outBuff);
+	outBuff = nullptr;
+	outBuffSize = 0;
+	mem_freeSafe(yuvBuff);
+	yuvBuff = nullptr;
+	yuvBuffSize = 0;
+}
@@ -4,6 +4,10 @@ inc_main := 1
 include $(IMAGINE_PATH)/make/imagineAppBase.mk
 
 emuFramework_cheats := 1
+emuFramework_cheatSearch := 1
+emuFramework_rewind := 1
+emuFramework_runAhead := 1
+emuFramework_asyncState := 1
 include $(EMUFRAMEWORK_PATH)/common.mk
 
 CPPFLAGS += -DHAVE_ZLIB_H -DFINAL_VERSION -DC_CORE -DNO_PNG -DNO_LINK -DNO_DEBUGGER -DBLIP_BUFFER_FAST=1 \
@@ -13,7 +17,7 @@ vbamSrc := gba/GBA-thumb.cpp gba/bios.cpp gba/Globals.cpp \
 gba/Cheats.cpp gba/Mode0.cpp gba/CheatSearch.cpp gba/Mode1.cpp \
 gba/EEprom.cpp gba/Mode2.cpp gba/Mode3.cpp gba/Flash.cpp gba/Mode4.cpp \
 gba/GBA-arm.cpp gba/Mode5.cpp gba/GBA.cpp gba/gbafilter.cpp gba/RTC.cpp \
-gba/Sound.cpp gba/Sram.cpp common/memgzio.c common/Patch.cpp Util.cpp
+gba/Sound.cpp gba/Sram.cpp gba/GBAGfxThread.cpp common/memgzio.c common/Patch.cpp Util.cpp
 #gba/remote.cpp gba/GBASockClient.cpp gba/GBALink.cpp gba/agbprint.cpp
 # 7z_C/7zHeader.c 7z_C/7zItem.c gba/armdis.cpp gba/elf.cpp
 
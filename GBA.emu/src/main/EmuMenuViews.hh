@@ -34,6 +34,33 @@ class SystemOptionView : public OptionView
 		rtc.init(str, optionRtcEmulation, sizeofArray(str));
 	}
 
+	MultiChoiceSelectMenuItem renderThread
+	{
+		"Threaded Rendering",
+		[this](MultiChoiceMenuItem &item, int val)
+		{
+			if(!gfxThreadSetActive(gGba, val != RENDER_THREAD_OFF, val == RENDER_THREAD_VERIFY))
+			{
+				popup.postError("Requires a multi-core CPU");
+				optionRenderThread = RENDER_THREAD_OFF;
+				item.updateVal(RENDER_THREAD_OFF, *this);
+				return;
+			}
+			optionRenderThread = val;
+		}
+	};
+
+	void renderThreadInit()
+	{
+		static const char *str[] =
+		{
+			"Off",
+			"On",
+			"On, Verify Frames"
+		};
+		renderThread.init(str, optionRenderThread, sizeofArray(str));
+	}
+
 public:
 
 
@@ -44,6 +71,7 @@ public:
 	{
 		OptionView::loadSystemItems(item, items);
 		rtcInit(); item[items++] = &rtc;
+		renderThreadInit(); item[items++] = &renderThread;
 	}
 };
 
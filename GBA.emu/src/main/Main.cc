@@ -16,11 +16,18 @@
 #define LOGTAG "main"
 #include <EmuSystem.hh>
 #include <CommonFrameworkIncludes.hh>
+#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+#include <AsyncStateWriter.hh>
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_CHEAT_SEARCH
+#include <CheatSearch.hh>
+#endif
 #include <main/Main.hh>
 #include <main/Cheats.hh>
 #include <vbam/gba/GBA.h>
 #include <vbam/gba/Sound.h>
 #include <vbam/gba/RTC.h>
+#include <vbam/gba/GBAGfxThread.h>
 #include <vbam/common/SoundDriver.h>
 #include <vbam/common/Patch.h>
 #include <vbam/Util.h>
@@ -191,10 +198,11 @@ void EmuSystem::handleInputAction(uint state, uint emuKey)
 
 enum
 {
-	CFGKEY_RTC_EMULATION = 256
+	CFGKEY_RTC_EMULATION = 256, CFGKEY_RENDER_THREAD = 257
 };
 
 Byte1Option optionRtcEmulation(CFGKEY_RTC_EMULATION, RTC_EMU_AUTO, 0, optionIsValidWithMax<2>);
+Byte1Option optionRenderThread(CFGKEY_RENDER_THREAD, RENDER_THREAD_OFF, 0, optionIsValidWithMax<2>);
 bool detectedRtcGame = 0;
 
 bool EmuSystem::readConfig(Io &io, uint key, uint readSize)
@@ -203,6 +211,7 @@ bool EmuSystem::readConfig(Io &io, uint key, uint readSize)
 	{
 		default: return 0;
 		bcase CFGKEY_RTC_EMULATION: optionRtcEmulation.readFromIO(io, readSize);
+		bcase CFGKEY_RENDER_THREAD: optionRenderThread.readFromIO(io, readSize);
 	}
 	return 1;
 }
@@ -210,6 +219,7 @@ bool EmuSystem::readConfig(Io &io, uint key, uint readSize)
 void EmuSystem::writeConfig(Io *io)
 {
 	optionRtcEmulation.writeWithKeyIfNotDefault(io);
+	optionRenderThread.writeWithKeyIfNotDefault(io);
 }
 
 static bool isGBAExtension(const char *name)
@@ -249,7 +259,14 @@ void EmuSystem::initOptions()
 	#endif
 }
 
-void EmuSystem::onOptionsLoaded() {}
+void EmuSystem::onOptionsLoaded()
+{
+	if(optionRenderThread != RENDER_THREAD_OFF
+		&& !gfxThreadSetActive(gGba, true, optionRenderThread == RENDER_THREAD_VERIFY))
+	{
+		optionRenderThread = RENDER_THREAD_OFF;
+	}
+}
 
 void EmuSystem::resetGame()
 {
@@ -278,22 +295,75 @@ int EmuSystem::saveState()
 	sprintStateFilename(saveStr, saveStateSlot);
 	if(Config::envIsIOSJB)
 		fixFilePermissions(saveStr);
+	#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+	return stateWriter.save(saveStr);
+	#else
 	if(CPUWriteState(gGba, saveStr))
 		return STATE_RESULT_OK;
 	else
 		return STATE_RESULT_IO_ERROR;
+	#endif
 }
 
 int EmuSystem::loadState(int saveStateSlot)
 {
 	FsSys::cPath saveStr;
 	sprintStateFilename(saveStr, saveStateSlot);
+	#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+	stateWriter.waitForIdle();
+	if(AsyncStateWriter::isCompressedState(saveStr))
+		return AsyncStateWriter::loadState(saveStr);
+	#endif
 	if(CPUReadState(gGba, saveStr))
 		return STATE_RESULT_OK;
 	else
 		return STATE_RESULT_IO_ERROR;
 }
 
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+uint EmuSystem::saveStateToMemory(void *buff, uint size)
+{
+	return CPUWriteMemState(gGba, (char*)buff, size, 0);
+}
+
+int EmuSystem::loadStateFromMemory(const void *buff, uint size)
+{
+	if(CPUReadMemState(gGba, (char*)buff, size))
+		return STATE_RESULT_OK;
+	else
+		return STATE_RESULT_INVALID_DATA;
+}
+#endif
+
+#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+uint EmuSystem::saveStateFileToMemory(void *buff, uint size, bool &compressed)
+{
+	// a memory state is an 8 byte "VBA " + size header followed by the same gzip stream
+	// CPUWriteState() writes, at gzopen()'s default level of 6
+	const uint memHeaderSize = 8;
+	uint stateSize = CPUWriteMemState(gGba, (char*)buff, size, 6);
+	if(stateSize <= memHeaderSize)
+		return 0;
+	memmove(buff, (char*)buff + memHeaderSize, stateSize - memHeaderSize);
+	compressed = true;
+	return stateSize - memHeaderSize;
+}
+#endif
+
+#ifdef CONFIG_EMUFRAMEWORK_CHEAT_SEARCH
+uint EmuSystem::cheatSearchRegions(CheatSearchRegion *region, uint max)
+{
+	const CheatSearchRegion ram[]
+	{
+		{"EWRAM", gGba.mem.workRAM, 0x2000000, sizeof(gGba.mem.workRAM)},
+		{"IWRAM", gGba.mem.internalRAM, 0x3000000, sizeof(gGba.mem.internalRAM)}
+	};
+	uint regions = std::min(max, (uint)sizeofArray(ram));
+	std::copy_n(ram, regions, region);
+	return regions;
+}
+#endif
+
 void EmuSystem::saveAutoState()
 {
 	if(gameIsRunning() && optionAutoSaveState)
@@ -302,7 +372,11 @@ void EmuSystem::saveAutoState()
 		sprintStateFilename(saveStr, -1);
 		if(Config::envIsIOSJB)
 			fixFilePermissions(saveStr);
+		#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+		stateWriter.save(saveStr, false);
+		#else
 		CPUWriteState(gGba, saveStr);
+		#endif
 	}
 }
 
@@ -3,6 +3,8 @@
 #include <Option.hh>
 
 static const uint RTC_EMU_AUTO = 0, RTC_EMU_OFF = 1, RTC_EMU_ON = 2;
+static const uint RENDER_THREAD_OFF = 0, RENDER_THREAD_ON = 1, RENDER_THREAD_VERIFY = 2;
 
 extern Byte1Option optionRtcEmulation;
+extern Byte1Option optionRenderThread;
 extern bool detectedRtcGame;
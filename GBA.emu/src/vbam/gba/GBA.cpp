@@ -676,34 +676,12 @@ inline int CPUUpdateTicks(ARM7TDMI &cpu)
 
 static void CPUUpdateWindow0(GBASys &gba)
 {
-  int x00 = gba.mem.ioMem.WIN0H>>8;
-  int x01 = gba.mem.ioMem.WIN0H & 255;
-
-  if(x00 <= x01) {
-    for(int i = 0; i < 240; i++) {
-      gba.lcd.gfxInWin0[i] = (i >= x00 && i < x01);
-    }
-  } else {
-    for(int i = 0; i < 240; i++) {
-    	gba.lcd.gfxInWin0[i] = (i >= x00 || i < x01);
-    }
-  }
+  gfxUpdateWindow(gba.lcd.gfxInWin0, gba.mem.ioMem.WIN0H);
 }
 
 static void CPUUpdateWindow1(GBASys &gba)
 {
-  int x00 = gba.mem.ioMem.WIN1H>>8;
-  int x01 = gba.mem.ioMem.WIN1H & 255;
-
-  if(x00 <= x01) {
-    for(int i = 0; i < 240; i++) {
-    	gba.lcd.gfxInWin1[i] = (i >= x00 && i < x01);
-    }
-  } else {
-    for(int i = 0; i < 240; i++) {
-    	gba.lcd.gfxInWin1[i] = (i >= x00 || i < x01);
-    }
-  }
+  gfxUpdateWindow(gba.lcd.gfxInWin1, gba.mem.ioMem.WIN1H);
 }
 
 static void CPUUpdateRenderBuffers(GBASys &gba, bool force)
@@ -720,6 +698,8 @@ static void CPUUpdateRenderBuffers(GBASys &gba, bool force)
   if(!(gba.lcd.layerEnable & 0x0800) || force) {
   	gfxClearArray(gba.lcd.line3);
   }
+  if(gfxThreadActive)
+    gfxThreadClearBuffers(force ? 0x0F00 : (~gba.lcd.layerEnable & 0x0F00));
 }
 
 static bool CPUWriteState(GBASys &gba, gzFile gzFile)
@@ -803,6 +783,30 @@ bool CPUWriteMemState(GBASys &gba, char *memory, int available)
   return res;
 }
 
+// returns the size of the state or 0 on error
+int CPUWriteMemState(GBASys &gba, char *memory, int available, int compressionLevel)
+{
+  const char mode[] = {'w', char('0' + compressionLevel), 0};
+  gzFile gzFile = utilMemGzOpen(memory, available, mode);
+
+  if(gzFile == NULL) {
+    return 0;
+  }
+
+  bool res = CPUWriteState(gba, gzFile);
+
+  utilGzClose(gzFile);
+
+  int size;
+  memcpy(&size, memory + 4, 4);
+  size += 8;
+
+  if(!res || size >= available)
+    return 0;
+
+  return size;
+}
+
 static bool CPUReadState(GBASys &gba, gzFile gzFile)
 {
   int version = utilReadInt(gzFile);
@@ -981,6 +985,8 @@ static bool CPUReadState(GBASys &gba, gzFile gzFile)
 
   CPUUpdateRegister(gba.cpu, 0x204, CPUReadHalfWordQuick(gba.cpu, 0x4000204));
 
+  gfxThreadResync(gba);
+
   return true;
 }
 
@@ -1432,6 +1438,8 @@ bool CPUIsELF(const char *file)
 
 void CPUCleanUp()
 {
+  gfxThreadSync();
+
 #ifdef PROFILING
   if(profilingTicksReload) {
     profCleanup();
@@ -3016,6 +3024,7 @@ void CPUInit(GBASys &gba, const char *biosFileName, bool useBiosFile)
 
 void CPUReset(GBASys &gba)
 {
+  gfxThreadSync();
   if(gbaSaveType == 0) {
     if(eepromInUse)
       gbaSaveType = 3;
@@ -3196,6 +3205,8 @@ void CPUReset(GBASys &gba)
 
   gba.dma.cpuDmaHack = false;
 
+  gfxThreadResync(gba);
+
   //SWITicks = 0;
 }
 
@@ -3423,7 +3434,10 @@ void CPULoop(GBASys &gba, bool renderGfx, bool processGfx, bool renderAudio)
             	{
             	}*/
 
-              (*gba.lcd.renderLine)(gba.lcd.lineMix, gba.lcd, ioMem);
+              if(unlikely(gfxThreadActive))
+                gfxThreadQueueLine(gba);
+              else
+                (*gba.lcd.renderLine)(gba.lcd.lineMix, gba.lcd, ioMem);
               /*switch(systemColorDepth) {
 				#ifdef SUPPORT_PIX_16BIT
                 case 16:
@@ -3465,6 +3479,8 @@ void CPULoop(GBASys &gba, bool renderGfx, bool processGfx, bool renderAudio)
             }
             if(ioMem.VCOUNT == 159 && likely(renderGfx))
             {
+            	if(unlikely(gfxThreadActive))
+            		gfxThreadEndFrame(gba, processGfx);
             	if(likely(processGfx) && !directColorLookup)
             	{
             		for(int x = 0; x < 240*160; x++)
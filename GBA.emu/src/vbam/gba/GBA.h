@@ -1026,6 +1026,7 @@ extern void CPUUpdateRender(GBASys &gba);
 extern bool CPUReadMemState(GBASys &gba, char *, int);
 extern bool CPUReadState(GBASys &gba, const char *);
 extern bool CPUWriteMemState(GBASys &gba, char *, int);
+extern int CPUWriteMemState(GBASys &gba, char *, int, int compressionLevel);
 extern bool CPUWriteState(GBASys &gba, const char *);
 extern int CPULoadRom(GBASys &gba, const char *);
 extern int CPULoadRomWithIO(GBASys &gba, Io &);
@@ -115,6 +115,22 @@ static inline void gfxClearArray(u32 *array)
   }
 }
 
+static inline void gfxUpdateWindow(bool inWin[240], u16 WINH)
+{
+  int x00 = WINH>>8;
+  int x01 = WINH & 255;
+
+  if(x00 <= x01) {
+    for(int i = 0; i < 240; i++) {
+      inWin[i] = (i >= x00 && i < x01);
+    }
+  } else {
+    for(int i = 0; i < 240; i++) {
+      inWin[i] = (i >= x00 || i < x01);
+    }
+  }
+}
+
 static inline void gfxDrawTextScreen(u8 vram[0x20000], u16 control, u16 hofs, u16 vofs,
 				     u32 *line, const u16 VCOUNT, const u16 MOSAIC, const u16 *palette)
 {
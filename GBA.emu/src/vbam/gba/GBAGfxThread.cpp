@@ -0,0 +1,303 @@
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include "GBA.h"
+#include "Globals.h"
+#include "GBAGfx.h"
+#include "GBAGfxThread.h"
+#include "../common/Port.h"
+#include <imagine/util/thread/pthread.hh>
+
+bool gfxThreadActive = false;
+
+struct GfxThreadLine
+{
+	GBALCD::RenderLineFunc renderLine;
+	MixColorType *lineMix;
+	uint layerEnable;
+	int bg2Changed, bg3Changed;
+	uint clearLayers;
+	uint writeLogEnd;
+	u8 io[0x60] __attribute__ ((aligned(4))); // DISPCNT through COLY
+};
+
+struct GfxThreadWrite
+{
+	u32 dest; // size << 28 | region << 24 | offset
+	u32 value;
+};
+
+static const uint MAX_QUEUED_LINES = 256; // powers of 2
+static const uint WRITE_LOG_SIZE = 0x10000;
+
+// worker-side copy of the LCD, only touched by the emulation thread when idle
+static GBALCD rlcd;
+static GBAMem::IoMem rioMem;
+static u16 rWIN0H, rWIN1H;
+
+static GfxThreadLine queue[MAX_QUEUED_LINES];
+static GfxThreadWrite writeLog[WRITE_LOG_SIZE];
+static uint linesQueued = 0, linesDone = 0; // guarded by mutex
+static uint writeLogPos = 0; // emulation thread only
+static std::atomic_uint writeLogDone {0};
+static uint pendingClear = 0;
+static bool verifyFrames = false, quit = false, waiting = false;
+static uint verifiedFrames = 0, mismatchedFrames = 0;
+
+static ThreadPThread thread;
+static MutexPThread mutex;
+static CondVarPThread workCond, doneCond;
+
+static void applyWrites(uint start, uint end)
+{
+	for(uint i = start; i != end; i++)
+	{
+		auto &w = writeLog[i & (WRITE_LOG_SIZE-1)];
+		u32 offset = w.dest & 0x1FFFF;
+		u8 *mem = nullptr;
+		switch((w.dest >> 24) & 0xF)
+		{
+			bcase 5: mem = rlcd.paletteRAM;
+			bcase 6: mem = rlcd.vram;
+			bcase 7: mem = rlcd.oam;
+		}
+		switch(w.dest >> 28)
+		{
+			bcase 1: mem[offset] = w.value;
+			bcase 2: WRITE16LE(((u16 *)&mem[offset]), w.value);
+			bcase 4: WRITE32LE(((u32 *)&mem[offset]), w.value);
+		}
+	}
+	writeLogDone.store(end, std::memory_order_release);
+}
+
+static void clearLayers(uint layers)
+{
+	if(layers & 0x0100)
+		gfxClearArray(rlcd.line0);
+	if(layers & 0x0200)
+		gfxClearArray(rlcd.line1);
+	if(layers & 0x0400)
+		gfxClearArray(rlcd.line2);
+	if(layers & 0x0800)
+		gfxClearArray(rlcd.line3);
+}
+
+static void renderLine(const GfxThreadLine &cmd)
+{
+	applyWrites(writeLogDone.load(std::memory_order_relaxed), cmd.writeLogEnd);
+	clearLayers(cmd.clearLayers);
+	memcpy(rioMem.b, cmd.io, sizeof(cmd.io));
+	// gfxInWin0/1 only depend on WIN0H/WIN1H
+	if(rioMem.WIN0H != rWIN0H)
+	{
+		rWIN0H = rioMem.WIN0H;
+		gfxUpdateWindow(rlcd.gfxInWin0, rWIN0H);
+	}
+	if(rioMem.WIN1H != rWIN1H)
+	{
+		rWIN1H = rioMem.WIN1H;
+		gfxUpdateWindow(rlcd.gfxInWin1, rWIN1H);
+	}
+	rlcd.layerEnable = cmd.layerEnable;
+	rlcd.gfxBG2Changed |= cmd.bg2Changed;
+	rlcd.gfxBG3Changed |= cmd.bg3Changed;
+	cmd.renderLine(cmd.lineMix, rlcd, rioMem);
+}
+
+static void *threadEntry(void *)
+{
+	mutex.lock();
+	for(;;)
+	{
+		while(linesDone == linesQueued && !quit)
+			workCond.wait();
+		if(quit)
+			break;
+		auto &cmd = queue[linesDone & (MAX_QUEUED_LINES-1)];
+		mutex.unlock();
+		renderLine(cmd);
+		mutex.lock();
+		linesDone++;
+		if(waiting)
+			doneCond.signal();
+	}
+	mutex.unlock();
+	return nullptr;
+}
+
+// waits until at most maxLines lines are still queued
+static void waitForLines(uint maxLines)
+{
+	mutex.lock();
+	while(linesQueued - linesDone > maxLines)
+	{
+		waiting = true;
+		doneCond.wait();
+	}
+	waiting = false;
+	mutex.unlock();
+}
+
+void gfxThreadSync()
+{
+	if(gfxThreadActive)
+		waitForLines(0);
+}
+
+static void flushWriteLog()
+{
+	waitForLines(0);
+	applyWrites(writeLogDone.load(std::memory_order_relaxed), writeLogPos);
+}
+
+void gfxThreadPushWrite(uint region, u32 offset, u32 value, uint size)
+{
+	if(region < 5 || region > 7)
+		return;
+	if(writeLogPos - writeLogDone.load(std::memory_order_acquire) == WRITE_LOG_SIZE)
+	{
+		flushWriteLog();
+	}
+	writeLog[writeLogPos & (WRITE_LOG_SIZE-1)] = {(size << 28) | (region << 24) | offset, value};
+	writeLogPos++;
+}
+
+void gfxThreadClearBuffers(uint layers)
+{
+	pendingClear |= layers;
+}
+
+void gfxThreadQueueLine(GBASys &gba)
+{
+	waitForLines(MAX_QUEUED_LINES - 1);
+	auto &cmd = queue[linesQueued & (MAX_QUEUED_LINES-1)];
+	cmd.renderLine = gba.lcd.renderLine;
+	cmd.lineMix = verifyFrames ? rlcd.pix + (gba.lcd.lineMix - gba.lcd.pix) : gba.lcd.lineMix;
+	cmd.layerEnable = gba.lcd.layerEnable;
+	cmd.bg2Changed = gba.lcd.gfxBG2Changed;
+	cmd.bg3Changed = gba.lcd.gfxBG3Changed;
+	cmd.clearLayers = pendingClear;
+	cmd.writeLogEnd = writeLogPos;
+	memcpy(cmd.io, gba.mem.ioMem.b, sizeof(cmd.io));
+	pendingClear = 0;
+	if(verifyFrames)
+	{
+		// the reference renderer consumes the change flags itself
+		(*gba.lcd.renderLine)(gba.lcd.lineMix, gba.lcd, gba.mem.ioMem);
+	}
+	else
+	{
+		gba.lcd.gfxBG2Changed = 0;
+		gba.lcd.gfxBG3Changed = 0;
+	}
+	mutex.lock();
+	linesQueued++;
+	workCond.signal();
+	mutex.unlock();
+}
+
+static u32 frameHash(const u16 *pix)
+{
+	u32 hash = 2166136261u;
+	for(uint i = 0; i < 240 * 160; i++)
+		hash = (hash ^ pix[i]) * 16777619u;
+	return hash;
+}
+
+void gfxThreadEndFrame(GBASys &gba, bool processGfx)
+{
+	waitForLines(0);
+	if(verifyFrames && processGfx)
+	{
+		u32 hash = frameHash(gba.lcd.pix);
+		u32 threadHash = frameHash(rlcd.pix);
+		verifiedFrames++;
+		if(hash != threadHash)
+		{
+			mismatchedFrames++;
+			logMsg("frame %u: threaded render hash %08X, expected %08X (%u mismatches)",
+				verifiedFrames, threadHash, hash, mismatchedFrames);
+		}
+	}
+}
+
+void gfxThreadResync(GBASys &gba)
+{
+	if(!gfxThreadActive)
+		return;
+	waitForLines(0);
+	memcpy(rlcd.paletteRAM, gba.lcd.paletteRAM, sizeof(rlcd.paletteRAM));
+	memcpy(rlcd.vram, gba.lcd.vram, sizeof(rlcd.vram));
+	memcpy(rlcd.oam, gba.lcd.oam, sizeof(rlcd.oam));
+	writeLogDone.store(writeLogPos, std::memory_order_release);
+}
+
+bool gfxThreadSetActive(GBASys &gba, bool on, bool verify)
+{
+	if(on == gfxThreadActive && verify == verifyFrames)
+		return true;
+	if(gfxThreadActive)
+	{
+		flushWriteLog();
+		clearLayers(pendingClear);
+		if(!verifyFrames)
+		{
+			// hand the renderer's own state back to the synchronous path
+			memcpy(gba.lcd.line0, rlcd.line0, sizeof(rlcd.line0));
+			memcpy(gba.lcd.line1, rlcd.line1, sizeof(rlcd.line1));
+			memcpy(gba.lcd.line2, rlcd.line2, sizeof(rlcd.line2));
+			memcpy(gba.lcd.line3, rlcd.line3, sizeof(rlcd.line3));
+			memcpy(gba.lcd.lineOBJ, rlcd.lineOBJ, sizeof(rlcd.lineOBJ));
+			memcpy(gba.lcd.lineOBJWin, rlcd.lineOBJWin, sizeof(rlcd.lineOBJWin));
+			memcpy(gba.lcd.lineOBJpixleft, rlcd.lineOBJpixleft, sizeof(rlcd.lineOBJpixleft));
+			gba.lcd.gfxBG2Changed |= rlcd.gfxBG2Changed;
+			gba.lcd.gfxBG3Changed |= rlcd.gfxBG3Changed;
+			gba.lcd.gfxBG2X = rlcd.gfxBG2X;
+			gba.lcd.gfxBG2Y = rlcd.gfxBG2Y;
+			gba.lcd.gfxBG3X = rlcd.gfxBG3X;
+			gba.lcd.gfxBG3Y = rlcd.gfxBG3Y;
+			gba.lcd.gfxLastVCOUNT = rlcd.gfxLastVCOUNT;
+		}
+		else
+		{
+			logMsg("threaded rendering verified %u frames, %u mismatches", verifiedFrames, mismatchedFrames);
+		}
+		mutex.lock();
+		quit = true;
+		workCond.signal();
+		mutex.unlock();
+		thread.join();
+		mutex.destroy();
+		gfxThreadActive = false;
+	}
+	if(!on)
+		return true;
+	if(sysconf(_SC_NPROCESSORS_ONLN) < 2)
+	{
+		logMsg("not using threaded rendering on a single CPU");
+		return false;
+	}
+	rlcd = gba.lcd;
+	rWIN0H = gba.mem.ioMem.WIN0H;
+	rWIN1H = gba.mem.ioMem.WIN1H;
+	linesQueued = linesDone = 0;
+	writeLogPos = 0;
+	writeLogDone.store(0, std::memory_order_relaxed);
+	pendingClear = 0;
+	verifyFrames = verify;
+	verifiedFrames = mismatchedFrames = 0;
+	quit = false;
+	if(!mutex.create())
+		return false;
+	workCond.create(mutex);
+	doneCond.create(mutex);
+	if(!thread.create(0, threadEntry, nullptr))
+	{
+		mutex.destroy();
+		return false;
+	}
+	gfxThreadActive = true;
+	logMsg("started threaded rendering%s", verify ? " with frame verification" : "");
+	return true;
+}
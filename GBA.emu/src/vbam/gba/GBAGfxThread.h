@@ -0,0 +1,31 @@
+#ifndef GBAGFXTHREAD_H
+#define GBAGFXTHREAD_H
+
+#include "GBA.h"
+
+// Pipelined scanline rendering. At each HBlank the emulation thread queues
+// the LCD registers for the line instead of drawing it, and palette, VRAM,
+// and OAM writes are logged so the worker can replay them into its own copy
+// of the LCD state right before the line they precede. The worker draws into
+// gba.lcd.pix and CPULoop only waits for it at the end of the frame.
+
+extern bool gfxThreadActive;
+
+// verify also renders every line synchronously and compares frame hashes
+bool gfxThreadSetActive(GBASys &gba, bool on, bool verify = false);
+void gfxThreadQueueLine(GBASys &gba);
+void gfxThreadEndFrame(GBASys &gba, bool processGfx);
+// waits for all queued lines to finish
+void gfxThreadSync();
+// waits, then reloads palette, VRAM, and OAM after a bulk change
+void gfxThreadResync(GBASys &gba);
+void gfxThreadClearBuffers(uint layers);
+void gfxThreadPushWrite(uint region, u32 offset, u32 value, uint size);
+
+static inline void gfxThreadLogWrite(uint region, u32 offset, u32 value, uint size)
+{
+	if(unlikely(gfxThreadActive))
+		gfxThreadPushWrite(region, offset, value, size);
+}
+
+#endif // GBAGFXTHREAD_H
@@ -8,6 +8,7 @@
 #include "agbprint.h"
 #include "GBAcpu.h"
 #include "GBALink.h"
+#include "GBAGfxThread.h"
 
 static const u32  objTilesAddress [3] = {0x010000, 0x014000, 0x014000};
 
@@ -623,7 +624,10 @@ static inline void CPUWriteMemory(ARM7TDMI &cpu, u32 address, u32 value)
       value);
     else
 #endif
+    {
       WRITE32LE(((u32 *)&paletteRAM[address & 0x3FC]), value);
+      gfxThreadLogWrite(5, address & 0x3FC, value, 4);
+    }
     break;
   case 0x06:
     address = (address & 0x1fffc);
@@ -638,7 +642,10 @@ static inline void CPUWriteMemory(ARM7TDMI &cpu, u32 address, u32 value)
     else
 #endif
 
+    {
       WRITE32LE(((u32 *)&vram[address]), value);
+      gfxThreadLogWrite(6, address, value, 4);
+    }
     break;
   case 0x07:
 #ifdef BKPT_SUPPORT
@@ -647,7 +654,10 @@ static inline void CPUWriteMemory(ARM7TDMI &cpu, u32 address, u32 value)
       value);
     else
 #endif
+    {
       WRITE32LE(((u32 *)&oam[address & 0x3fc]), value);
+      gfxThreadLogWrite(7, address & 0x3fc, value, 4);
+    }
       //oamUpdated = 1;
     break;
   case 0x0D:
@@ -723,7 +733,10 @@ static inline void CPUWriteHalfWord(ARM7TDMI &cpu, u32 address, u16 value)
       value);
     else
 #endif
+    {
       WRITE16LE(((u16 *)&paletteRAM[address & 0x3fe]), value);
+      gfxThreadLogWrite(5, address & 0x3fe, value, 2);
+    }
     break;
   case 6:
     address = (address & 0x1fffe);
@@ -737,7 +750,10 @@ static inline void CPUWriteHalfWord(ARM7TDMI &cpu, u32 address, u16 value)
       value);
     else
 #endif
+    {
       WRITE16LE(((u16 *)&vram[address]), value);
+      gfxThreadLogWrite(6, address, value, 2);
+    }
     break;
   case 7:
 #ifdef BKPT_SUPPORT
@@ -746,7 +762,10 @@ static inline void CPUWriteHalfWord(ARM7TDMI &cpu, u32 address, u16 value)
       value);
     else
 #endif
+    {
       WRITE16LE(((u16 *)&oam[address & 0x3fe]), value);
+      gfxThreadLogWrite(7, address & 0x3fe, value, 2);
+    }
       //oamUpdated = 1;
     break;
   case 8:
@@ -879,6 +898,7 @@ static inline void CPUWriteByte(ARM7TDMI &cpu, u32 address, u8 b)
   case 5:
     // no need to switch
   	*((uint16a *)&cpu.gba->lcd.paletteRAM[address & 0x3FE]) = (b << 8) | b;
+    gfxThreadLogWrite(5, address & 0x3FE, (b << 8) | b, 2);
     break;
   case 6:
     address = (address & 0x1fffe);
@@ -896,7 +916,10 @@ static inline void CPUWriteByte(ARM7TDMI &cpu, u32 address, u8 b)
         cheatsWriteByte(address + 0x06000000, b);
       else
 #endif
+      {
       	*((uint16a *)&vram[address]) = (b << 8) | b;
+      	gfxThreadLogWrite(6, address, (b << 8) | b, 2);
+      }
     }
     break;
   case 7:
@@ -124,7 +124,11 @@ void makeSincKernel(short *const kernel, int const phases, int const phaseLen, S
 	for (int ph = 0; ph < phases; ++ph) {
 		short *k = kernel + std::size_t((phases - ph) % phases) * phaseLen;
 		short *km = kernel + phaseLen - 1 + std::size_t((ph + 1) % phases) * phaseLen;
-		for (long i = ph; i < M / 2 + 1; i += phases)
-			*km-- = *k++ = static_cast<short>(std::floor(*dk++ * gain + 0.5));
+		for (long i = ph; i < M / 2 + 1; i += phases) {
+			// -32768 is left out so two taps times two samples can't overflow
+			// the paired 32-bit multiply-add of polyphaseFirStereo()
+			SysDDec const tap = std::floor(*dk++ * gain + 0.5);
+			*km-- = *k++ = static_cast<short>(tap < -32767 ? -32767 : tap > 32767 ? 32767 : tap);
+		}
 	}
 }
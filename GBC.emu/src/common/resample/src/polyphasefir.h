@@ -23,6 +23,84 @@
 #include "rshift16_round.h"
 #include <algorithm>
 #include <cstring>
+#if defined __SSE2__
+#include <emmintrin.h>
+#define POLYPHASEFIR_SSE2
+#elif defined __ARM_NEON__ || defined __ARM_NEON
+#include <arm_neon.h>
+#define POLYPHASEFIR_NEON
+#endif
+
+#if defined POLYPHASEFIR_SSE2 || defined POLYPHASEFIR_NEON
+#define POLYPHASEFIR_SIMD
+
+/**
+  * Whether stereo filters use the SIMD inner loop. Only meant to be turned off
+  * to compare against the scalar loop.
+  */
+inline bool & polyphaseFirSimd() {
+	static bool enabled = true;
+	return enabled;
+}
+
+/**
+  * Stereo dot product of n kernel taps with the interleaved samples at s.
+  * Accumulates in 64 bits, so it matches the scalar loop where long is 64 bits,
+  * and its truncation to a 32-bit long matches the scalar loop's wraparound.
+  */
+inline void polyphaseFirStereo(short const *k, short const *s, std::size_t n,
+                               long &accl, long &accr)
+{
+#ifdef POLYPHASEFIR_SSE2
+	__m128i acc = _mm_setzero_si128(); // 64-bit l, r
+	for (; n >= 8; n -= 8, k += 8, s += 16) {
+		__m128i const kv = _mm_loadu_si128(reinterpret_cast<__m128i const *>(k));
+		// k0 k1 k0 k1 k2 k3 k2 k3, matching samples l0 l1 r0 r1 l2 l3 r2 r3
+		__m128i const klo = _mm_unpacklo_epi32(kv, kv);
+		__m128i const khi = _mm_unpackhi_epi32(kv, kv);
+		__m128i slo = _mm_loadu_si128(reinterpret_cast<__m128i const *>(s));
+		__m128i shi = _mm_loadu_si128(reinterpret_cast<__m128i const *>(s + 8));
+		slo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(slo, _MM_SHUFFLE(3, 1, 2, 0)),
+		                          _MM_SHUFFLE(3, 1, 2, 0));
+		shi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(shi, _MM_SHUFFLE(3, 1, 2, 0)),
+		                          _MM_SHUFFLE(3, 1, 2, 0));
+		// each pair sum fits 32 bits since makeSincKernel keeps taps above -32768,
+		// sign extend them to l r l r in 64 bits before accumulating
+		__m128i const m[2] = { _mm_madd_epi16(klo, slo), _mm_madd_epi16(khi, shi) };
+		for (int i = 0; i < 2; ++i) {
+			__m128i const sign = _mm_srai_epi32(m[i], 31);
+			acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(m[i], sign));
+			acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(m[i], sign));
+		}
+	}
+	long long sum[2];
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(sum), acc);
+	long long l = sum[0];
+	long long r = sum[1];
+#else
+	int64x2_t accvl = vdupq_n_s64(0);
+	int64x2_t accvr = vdupq_n_s64(0);
+	for (; n >= 8; n -= 8, k += 8, s += 16) {
+		int16x8_t const kv = vld1q_s16(k);
+		int16x8x2_t const sv = vld2q_s16(s);
+		// products are exact in 32 bits, pairs of them are added into 64-bit lanes
+		accvl = vpadalq_s32(accvl, vmull_s16(vget_low_s16(sv.val[0]), vget_low_s16(kv)));
+		accvl = vpadalq_s32(accvl, vmull_s16(vget_high_s16(sv.val[0]), vget_high_s16(kv)));
+		accvr = vpadalq_s32(accvr, vmull_s16(vget_low_s16(sv.val[1]), vget_low_s16(kv)));
+		accvr = vpadalq_s32(accvr, vmull_s16(vget_high_s16(sv.val[1]), vget_high_s16(kv)));
+	}
+	long long l = vgetq_lane_s64(accvl, 0) + vgetq_lane_s64(accvl, 1);
+	long long r = vgetq_lane_s64(accvr, 0) + vgetq_lane_s64(accvr, 1);
+#endif
+	for (; n; --n, ++k, s += 2) {
+		l += *k * s[0];
+		r += *k * s[1];
+	}
+
+	accl = static_cast<long>(l);
+	accr = static_cast<long>(r);
+}
+#endif
 
 template<int channels, unsigned phases>
 class PolyphaseFir {
@@ -119,6 +197,20 @@ std::size_t PolyphaseFir<channels, phases>::filter(short *out,
 	// k and s pointers incrementally. However, we currently only use powers of 2
 	// and we would end up referencing more variables which often compiles to bad
 	// code on x86, which is why I'm also hesitant to get rid of the template arguments.
+#ifdef POLYPHASEFIR_SIMD
+	if (channels == 2 && polyphaseFirSimd()) {
+		for (; x < inlen; x += div_) {
+			long accl, accr;
+			polyphaseFirStereo(kernel_ + ((x + 1) % phases) * phaseLen,
+			                   in + (x / phases + 1 - phaseLen) * channels,
+			                   phaseLen, accl, accr);
+			out[0] = rshift16_round(accl);
+			out[1] = rshift16_round(accr);
+			out += 2;
+		}
+	}
+#endif
+
 	for (; x < inlen; x += div_) {
 		for (int c = 0; c < channels-1; c += 2) {
 			// adjust phase so we do not start on a virtual 0 sample
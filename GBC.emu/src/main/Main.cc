@@ -19,6 +19,10 @@
 #include <gambatte.h>
 #include <resample/resampler.h>
 #include <resample/resamplerinfo.h>
+#ifdef CONFIG_EMUFRAMEWORK_HEADLESS_BENCHMARK
+#include <HeadlessBenchmark.hh>
+#include <resample/src/polyphasefir.h>
+#endif
 #include <main/Cheats.hh>
 #include <main/Palette.hh>
 
@@ -481,6 +485,61 @@ void EmuSystem::runFrame(bool renderGfx, bool processGfx, bool renderAudio)
 	}
 }
 
+#ifdef CONFIG_EMUFRAMEWORK_HEADLESS_BENCHMARK
+// times each resampler on a frame's worth of synthetic 2MHz audio at
+// common output rates, with the scalar and SIMD FIR loops when available
+int runSystemBenchmark(uint frames)
+{
+	const long inputRate = std::round(2097152. * 1.004605);
+	const long outputRates[] {44100, 48000};
+	const uint samples = 35112;
+	auto snd = (short*)mem_alloc(samples * 4);
+	uint seed = 1;
+	iterateTimes(samples * 2, i)
+	{
+		// square wave plus noise, similar in spectrum to the APU output
+		seed = seed * 1103515245 + 12345;
+		snd[i] = ((i / 2) % 4096 < 2048 ? 8000 : -8000) + (int)((seed >> 16) & 0x7FF) - 1024;
+	}
+	#ifdef POLYPHASEFIR_SIMD
+	const bool simdModes[] {false, true};
+	#else
+	const bool simdModes[] {false};
+	#endif
+	iterateTimes(ResamplerInfo::num(), r)
+	{
+		for(auto outputRate : outputRates)
+		{
+			for(auto simd : simdModes)
+			{
+				#ifdef POLYPHASEFIR_SIMD
+				polyphaseFirSimd() = simd;
+				#endif
+				auto res = ResamplerInfo::get(r).create(inputRate, outputRate, samples + 2064);
+				auto dest = (short*)mem_alloc(res->maxOut(samples) * 4);
+				uint outFrames = 0;
+				auto startTime = TimeSys::now();
+				iterateTimes(frames, i)
+				{
+					outFrames += res->resample(dest, snd, samples);
+				}
+				double ms = (TimeSys::now() - startTime).toNs() / 1000000. / frames;
+				printf("{\"resampler\":\"%s\",\"outRate\":%ld,\"simd\":%s,\"frameMs\":%.4f,\"framesOut\":%u}\n",
+					ResamplerInfo::get(r).desc, outputRate, simd ? "true" : "false", ms, outFrames);
+				mem_free(dest);
+				delete res;
+			}
+		}
+	}
+	#ifdef POLYPHASEFIR_SIMD
+	polyphaseFirSimd() = true;
+	#endif
+	fflush(stdout);
+	mem_free(snd);
+	return 0;
+}
+#endif
+
 namespace Base
 {
 void onInputEvent(Base::Window &win, const Input::Event &e)
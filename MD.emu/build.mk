@@ -7,6 +7,9 @@ HIGH_OPTIMIZE_CFLAGS := -O3 $(HIGH_OPTIMIZE_CFLAGS_MISC)
 include $(IMAGINE_PATH)/make/imagineAppBase.mk
 
 emuFramework_cheats := 1
+emuFramework_rewind := 1
+emuFramework_runAhead := 1
+emuFramework_asyncState := 1
 include $(EMUFRAMEWORK_PATH)/common.mk
 
 gplusPath := genplus-gx
@@ -51,7 +54,7 @@ endif
 
 ifdef hasSCD
  SRC += scd/scd.cc scd/LC89510.cc scd/cd_sys.cc scd/gfx_cd.cc scd/pcm.cc scd/cd_file.cc \
- scd/memMain.cc scd/memSub.cc
+ scd/cd_prefetch.cc scd/memMain.cc scd/memSub.cc
 
  CPPFLAGS += -I$(EMUFRAMEWORK_PATH)/../PCE.emu/src/include -I$(EMUFRAMEWORK_PATH)/../PCE.emu/src
  VPATH += $(EMUFRAMEWORK_PATH)/../PCE.emu/src/mednafen $(EMUFRAMEWORK_PATH)/../PCE.emu/src/common
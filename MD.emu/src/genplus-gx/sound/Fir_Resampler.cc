@@ -342,6 +342,73 @@ int Fir_Resampler_input_needed( long output_count )
   return (input_extra >> 1);
 }
 
+/* Position-only copy of the resampler. It only counts buffered input and */
+/* tracks the impulse phase, so another thread can own the sample data.    */
+static long shadow_written = 0;
+static int shadow_imp_phase = 0;
+
+/* steps through input like Fir_Resampler_read(), returns the new input position */
+static long shadow_advance( long end, long max_count, long *count_out, int *phase )
+{
+  long count = 0;
+  long in = 0;
+  unsigned long skip = skip_bits >> *phase;
+  int remain = res - *phase;
+
+  if ( end - in >= WIDTH * STEREO )
+  {
+    end -= WIDTH * STEREO;
+    do
+    {
+      if ( count == max_count )
+        break;
+
+      count++;
+      remain--;
+      in += (skip * STEREO) & STEREO;
+      skip >>= 1;
+      in += step;
+
+      if ( !remain )
+      {
+        skip = skip_bits;
+        remain = res;
+      }
+    }
+    while ( in <= end );
+  }
+
+  *count_out = count;
+  *phase = res - remain;
+  return in;
+}
+
+void Fir_Resampler_shadow_sync( void )
+{
+  shadow_written = buffer ? write_pos - buffer : 0;
+  shadow_imp_phase = imp_phase;
+}
+
+void Fir_Resampler_shadow_write( long count )
+{
+  shadow_written += count;
+}
+
+int Fir_Resampler_shadow_avail( void )
+{
+  long count;
+  int phase = shadow_imp_phase;
+  shadow_advance( shadow_written, -1, &count, &phase );
+  return count;
+}
+
+void Fir_Resampler_shadow_read( long count )
+{
+  long read;
+  long in = shadow_advance( shadow_written, count, &read, &shadow_imp_phase );
+  shadow_written -= in;
+}
+
 int Fir_Resampler_skip_input( long count )
 {
   int remain = write_pos - buffer;
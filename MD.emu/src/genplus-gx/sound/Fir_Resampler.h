@@ -41,5 +41,9 @@ extern void Fir_Resampler_write( long count );
 extern int Fir_Resampler_read( sample_t* out, long count );
 extern int Fir_Resampler_input_needed( long output_count );
 extern int Fir_Resampler_skip_input( long count );
+extern void Fir_Resampler_shadow_sync( void );
+extern void Fir_Resampler_shadow_write( long count );
+extern int Fir_Resampler_shadow_avail( void );
+extern void Fir_Resampler_shadow_read( long count );
 
 #endif
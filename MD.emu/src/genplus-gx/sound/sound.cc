@@ -23,6 +23,8 @@
 
 #include "shared.h"
 #include "Fir_Resampler.h"
+#include <imagine/util/thread/pthread.hh>
+#include <unistd.h>
 
 /* Cycle-accurate samples */
 static unsigned int psg_cycles_ratio;
@@ -33,29 +35,49 @@ static unsigned int fm_cycles_count;
 /* YM chip function pointers */
 static void (*YM_Reset)(void);
 static void (*YM_Update)(FMSampleType *buffer, int length);
+static void (*YM_Skip)(int length);
 static void (*YM_Write)(unsigned int a, unsigned int v);
 
-/* Run FM chip for required M-cycles */
-static inline void fm_update(unsigned int cycles)
+static void YM_NoSkip(int length) {}
+
+/* Advance a chip cycle count, returns the number of samples to run */
+static inline unsigned int run_cycles(unsigned int *count, unsigned int cycles, unsigned int ratio)
 {
-  if (cycles > fm_cycles_count)
-  {
-    /* period to run */
-    cycles -= fm_cycles_count;
+  if (cycles <= *count)
+    return 0;
+
+  /* period to run */
+  cycles -= *count;
 
-    /* update cycle count */
-    fm_cycles_count += cycles;
+  /* update cycle count */
+  *count += cycles;
 
-    /* number of samples during period */
-    unsigned int cnt = cycles / fm_cycles_ratio;
+  /* number of samples during period */
+  unsigned int cnt = cycles / ratio;
 
-    /* remaining cycles */
-    unsigned int remain = cycles % fm_cycles_ratio;
-    if (remain)
+  /* remaining cycles */
+  unsigned int remain = cycles % ratio;
+  if (remain)
+  {
+    /* one sample ahead */
+    *count += ratio - remain;
+    cnt++;
+  }
+
+  return cnt;
+}
+
+/* Run FM chip for required M-cycles */
+static inline void fm_update(unsigned int cycles)
+{
+  unsigned int cnt = run_cycles(&fm_cycles_count, cycles, fm_cycles_ratio);
+  if (cnt)
+  {
+    if (!snd.render)
     {
-      /* one sample ahead */
-      fm_cycles_count += fm_cycles_ratio - remain;
-      cnt++;
+      /* only keep timers running */
+      YM_Skip(cnt);
+      return;
     }
 
     /* select input sample buffer */
@@ -78,32 +100,22 @@ static inline void fm_update(unsigned int cycles)
 /* Run PSG chip for required M-cycles */
 static inline void psg_update(unsigned int cycles)
 {
-  if (cycles > psg_cycles_count)
+  unsigned int cnt = run_cycles(&psg_cycles_count, cycles, psg_cycles_ratio);
+  if (cnt)
   {
-    /* period to run */
-    cycles -= psg_cycles_count;
-
-    /* update cycle count */
-    psg_cycles_count += cycles;
-
-    /* number of samples during period */
-    unsigned int cnt = cycles / psg_cycles_ratio;
-
-    /* remaining cycles */
-    unsigned int remain = cycles % psg_cycles_ratio;
-    if (remain)
-    {
-      /* one sample ahead */
-      psg_cycles_count += psg_cycles_ratio - remain;
-      cnt++;
-    }
-
-    /* run PSG chip & get samples */
-    SN76489_Update(snd.psg.pos, cnt);
+    /* run PSG chip & get samples, the count is still needed when skipping */
+    if (snd.render)
+      SN76489_Update(snd.psg.pos, cnt);
     snd.psg.pos += cnt;
   }
 }
 
+static void fm_reset_direct(unsigned int cycles);
+static void fm_write_direct(unsigned int cycles, unsigned int address, unsigned int data);
+static void psg_write_direct(unsigned int cycles, unsigned int data);
+static void thread_sync(void);
+static bool thread_update(void);
+
 /* Initialize sound chips emulation */
 void sound_init(void)
 {
@@ -145,6 +157,7 @@ void sound_init(void)
 	YM2413Init(mclk/15.0,snd.sample_rate);
 	YM_Reset = YM2413ResetChip;
 	YM_Update = YM2413Update;
+	YM_Skip = YM_NoSkip;
 	YM_Write = YM2413Write;
 
 	/* In HQ mode, YM2413 is running at its original rate (one sample each 72*15 M-cycles)  */
@@ -162,6 +175,7 @@ void sound_init(void)
 	YM2612Init(mclk/7.0,snd.sample_rate);
 	YM_Reset = YM2612ResetChip;
 	YM_Update = YM2612Update;
+	YM_Skip = YM2612Skip;
 	YM_Write = YM2612Write;
 
 	/* In HQ mode, YM2612 is running at its original rate (one sample each 144*7 M-cycles)  */
@@ -177,15 +191,19 @@ void sound_init(void)
   error("%d mcycles per PSG samples\n", psg_cycles_ratio);
   error("%d mcycles per FM samples\n", fm_cycles_ratio);
 #endif
+
+  thread_update();
 }
 
 /* Reset sound chips emulation */
 void sound_reset(void)
 {
+  thread_sync();
   YM_Reset();
   SN76489_Reset();
   fm_cycles_count = 0;
   psg_cycles_count = 0;
+  sound_thread_reload();
 }
 
 void sound_restore()
@@ -193,6 +211,8 @@ void sound_restore()
   int size;
   uint8 *ptr, *temp;
 
+  thread_sync();
+
   /* save YM context */
   #ifndef NO_SYSTEM_PBC
   if (system_hw == SYSTEM_PBC)
@@ -230,11 +250,15 @@ void sound_restore()
     }
     free(temp);
   }
+
+  sound_thread_reload();
 }
 
 int sound_context_save(uint8 *state)
 {
   int bufferptr = 0;
+
+  thread_sync();
   
   #ifndef NO_SYSTEM_PBC
   if (system_hw == SYSTEM_PBC)
@@ -258,6 +282,8 @@ int sound_context_load(uint8 *state, char *version)
 {
   int bufferptr = 0;
 
+  thread_sync();
+
   #ifndef NO_SYSTEM_PBC
   //if ((system_hw != SYSTEM_PBC) || (version[15] == 0x30))
   if ((system_hw == SYSTEM_PBC) & (version[15] != 0x30))
@@ -276,6 +302,7 @@ int sound_context_load(uint8 *state, char *version)
   load_param(&psg_cycles_count,sizeof(psg_cycles_count));
   fm_cycles_count = psg_cycles_count;
 
+  sound_thread_reload();
   return bufferptr;
 }
 
@@ -294,7 +321,7 @@ int sound_update(unsigned int cycles)
 #endif
 
   /* FM resampling */
-  if (config_hq_fm)
+  if (config_hq_fm && snd.render)
   {
     /* get available FM samples */
     int avail = Fir_Resampler_avail();
@@ -343,22 +370,424 @@ int sound_update(unsigned int cycles)
 }
 
 /* Reset FM chip */
-void fm_reset(unsigned int cycles)
+static void fm_reset_direct(unsigned int cycles)
 {
   fm_update(cycles << 11);
   YM_Reset();
 }
 
 /* Write FM chip */
-void fm_write(unsigned int cycles, unsigned int address, unsigned int data)
+static void fm_write_direct(unsigned int cycles, unsigned int address, unsigned int data)
 {
   if (address & 1) fm_update(cycles << 11);
   YM_Write(address, data);
 }
 
+/* Write PSG chip */
+static void psg_write_direct(unsigned int cycles, unsigned int data)
+{
+  psg_update(cycles << 11);
+  SN76489_Write(data);
+}
+
+/****************************************************************
+ * Threaded synthesis
+ *
+ * FM & PSG accesses are logged with their cycle counts and replayed
+ * on a worker thread, which synthesizes and mixes one frame while
+ * the next one is emulated, so output lags by a frame. Since games
+ * read the YM2612 status for its timers, the emulation thread keeps
+ * a shadow of the timers and of the sample counts that drive them,
+ * including the resampler input position. The worker checks every
+ * status value it replays against the real chip.
+ ****************************************************************/
+
+enum
+{
+  CMD_FM_WRITE, CMD_FM_READ, CMD_FM_RESET, CMD_PSG_WRITE
+};
+
+typedef struct
+{
+  uint8 type;
+  uint8 address;
+  uint8 data;
+  uint32 cycles;
+} t_sound_cmd;
+
+typedef struct
+{
+  t_sound_cmd *cmd;
+  unsigned int count;
+  int render;
+  int frame_end;
+  unsigned int frame_cycles;
+  unsigned int expected_fm_cycles; /* shadow FM cycle count after the frame */
+} t_sound_job;
+
+static const unsigned int MAX_SOUND_CMDS = 8192;
+
+static bool threadRequested = false, threadActive = false;
+static t_sound_cmd cmdBuffer[2][MAX_SOUND_CMDS];
+static unsigned int cmdBufferIdx = 0, cmds = 0;
+static int pendingRender = 1;
+
+/* shared with the worker, guarded by mutex */
+static t_sound_job job;
+static bool jobQueued = false, quit = false, waiting = false;
+static int16 *mixBuffer = nullptr; /* samples of the last finished frame */
+static int mixBufferSize = 0, mixedSamples = 0;
+static unsigned int statusMismatches = 0, timingMismatches = 0;
+
+static ThreadPThread thread;
+static MutexPThread mutex;
+static CondVarPThread workCond, doneCond;
+
+/* emulation thread copy of the sample timing */
+static struct
+{
+  unsigned int fm_cycles_count;
+  unsigned int psg_cycles_count;
+  int psg_samples;
+} shadow;
+
+static void shadow_fm_update(unsigned int cycles)
+{
+  unsigned int cnt = run_cycles(&shadow.fm_cycles_count, cycles, fm_cycles_ratio);
+  if (cnt)
+  {
+    if (pendingRender && config_hq_fm)
+      Fir_Resampler_shadow_write(cnt << 1);
+    YM2612ShadowUpdate(cnt);
+  }
+}
+
+static void shadow_psg_update(unsigned int cycles)
+{
+  shadow.psg_samples += run_cycles(&shadow.psg_cycles_count, cycles, psg_cycles_ratio);
+}
+
+/* timing side of sound_update() and the mixing done by audio_update() */
+static void shadow_frame_end(unsigned int cycles)
+{
+  cycles <<= 11;
+  shadow_psg_update(cycles);
+  shadow_fm_update(cycles);
+
+  int size = shadow.psg_samples;
+  if (config_hq_fm && pendingRender)
+  {
+    int avail = Fir_Resampler_shadow_avail();
+    if (avail < size)
+    {
+      do
+      {
+        YM2612ShadowUpdate(1);
+        Fir_Resampler_shadow_write(2);
+        avail = Fir_Resampler_shadow_avail();
+      }
+      while (avail < size);
+    }
+    else
+    {
+      shadow.fm_cycles_count += (avail - size) * psg_cycles_ratio;
+    }
+  }
+
+  shadow.psg_cycles_count -= cycles;
+  shadow.fm_cycles_count -= cycles;
+
+  size &= ~7;
+  if (config_hq_fm && pendingRender)
+    Fir_Resampler_shadow_read(size);
+  shadow.psg_samples -= size;
+}
+
+static void run_job(const t_sound_job &j)
+{
+  snd.render = j.render;
+  for (unsigned int i = 0; i < j.count; i++)
+  {
+    const t_sound_cmd &c = j.cmd[i];
+    switch (c.type)
+    {
+      case CMD_FM_WRITE:
+        fm_write_direct(c.cycles, c.address, c.data);
+        break;
+      case CMD_FM_READ:
+      {
+        fm_update(c.cycles << 11);
+        unsigned int status = YM2612Read();
+        if (status != c.data && ++statusMismatches <= 16)
+          logMsg("FM status %02X, shadow returned %02X at cycle %u", status, c.data, c.cycles);
+        break;
+      }
+      case CMD_FM_RESET:
+        fm_reset_direct(c.cycles);
+        break;
+      case CMD_PSG_WRITE:
+        psg_write_direct(c.cycles, c.data);
+        break;
+    }
+  }
+  if (j.frame_end)
+  {
+    mixedSamples = audioUpdateAll<0>(mixBuffer, j.frame_cycles);
+    if (fm_cycles_count != j.expected_fm_cycles && ++timingMismatches <= 16)
+      logMsg("FM cycle count %u, shadow has %u", fm_cycles_count, j.expected_fm_cycles);
+  }
+}
+
+static void *threadEntry(void *)
+{
+  mutex.lock();
+  for(;;)
+  {
+    while (!jobQueued && !quit)
+      workCond.wait();
+    if (quit)
+      break;
+    mutex.unlock();
+    run_job(job);
+    mutex.lock();
+    jobQueued = false;
+    if (waiting)
+      doneCond.signal();
+  }
+  mutex.unlock();
+  return nullptr;
+}
+
+static void wait_for_job(void)
+{
+  mutex.lock();
+  while (jobQueued)
+  {
+    waiting = true;
+    doneCond.wait();
+  }
+  waiting = false;
+  mutex.unlock();
+}
+
+/* hands the logged commands to the worker */
+static void queue_job(int frame_end, unsigned int frame_cycles)
+{
+  wait_for_job();
+  job.cmd = cmdBuffer[cmdBufferIdx];
+  job.count = cmds;
+  job.render = pendingRender;
+  job.frame_end = frame_end;
+  job.frame_cycles = frame_cycles;
+  job.expected_fm_cycles = shadow.fm_cycles_count;
+  cmdBufferIdx ^= 1;
+  cmds = 0;
+  mutex.lock();
+  jobQueued = true;
+  workCond.signal();
+  mutex.unlock();
+}
+
+static inline void log_cmd(uint8 type, unsigned int cycles, unsigned int address, unsigned int data)
+{
+  if (cmds == MAX_SOUND_CMDS)
+    queue_job(0, 0);
+  cmdBuffer[cmdBufferIdx][cmds++] = {type, (uint8)address, (uint8)data, cycles};
+}
+
+/* waits until the worker is idle and runs any logged commands */
+static void thread_sync(void)
+{
+  if (!threadActive)
+    return;
+  if (cmds)
+    queue_job(0, 0);
+  wait_for_job();
+}
+
+static bool alloc_mix_buffer(void)
+{
+  if (mixBufferSize < snd.buffer_size)
+  {
+    free(mixBuffer);
+    mixBuffer = (int16*)calloc(snd.buffer_size * 2, sizeof(int16));
+    mixBufferSize = mixBuffer ? snd.buffer_size : 0;
+    mixedSamples = 0;
+  }
+  return mixBuffer;
+}
+
+void sound_thread_reload(void)
+{
+  if (!threadActive)
+    return;
+  thread_sync();
+  shadow.fm_cycles_count = fm_cycles_count;
+  shadow.psg_cycles_count = psg_cycles_count;
+  shadow.psg_samples = snd.psg.pos - snd.psg.buffer;
+  YM2612ShadowSync();
+  Fir_Resampler_shadow_sync();
+  alloc_mix_buffer();
+  snd.render = pendingRender;
+}
+
+void sound_thread_wait(void)
+{
+  thread_sync();
+}
+
+static bool thread_start(void)
+{
+  if (!alloc_mix_buffer())
+  {
+    logMsg("not enough memory for threaded sound");
+    return false;
+  }
+  cmdBufferIdx = 0;
+  cmds = 0;
+  mixedSamples = 0;
+  jobQueued = false;
+  quit = false;
+  waiting = false;
+  statusMismatches = timingMismatches = 0;
+  if (!mutex.create())
+    return false;
+  workCond.create(mutex);
+  doneCond.create(mutex);
+  if (!thread.create(0, threadEntry, nullptr))
+  {
+    mutex.destroy();
+    return false;
+  }
+  threadActive = true;
+  sound_thread_reload();
+  logMsg("started sound thread");
+  return true;
+}
+
+static void thread_stop(void)
+{
+  thread_sync();
+  mutex.lock();
+  quit = true;
+  workCond.signal();
+  mutex.unlock();
+  thread.join();
+  mutex.destroy();
+  threadActive = false;
+  free(mixBuffer);
+  mixBuffer = nullptr;
+  mixBufferSize = 0;
+  snd.render = pendingRender;
+  logMsg("stopped sound thread, %u status & %u timing mismatches", statusMismatches, timingMismatches);
+}
+
+/* YM2413 timing and Sega CD audio stay on the emulation thread */
+static bool thread_supported(void)
+{
+  #ifndef NO_SYSTEM_PBC
+  if (system_hw == SYSTEM_PBC)
+    return false;
+  #endif
+  #ifndef NO_SCD
+  if (sCD.isActive)
+    return false;
+  #endif
+  return snd.enabled;
+}
+
+static bool thread_update(void)
+{
+  bool on = threadRequested && thread_supported();
+  if (on == threadActive)
+  {
+    sound_thread_reload();
+    return true;
+  }
+  if (!on)
+  {
+    thread_stop();
+    return true;
+  }
+  return thread_start();
+}
+
+int sound_set_threaded(int on)
+{
+  if (on && sysconf(_SC_NPROCESSORS_ONLN) < 2)
+  {
+    logMsg("not using threaded sound on a single CPU");
+    return 0;
+  }
+  threadRequested = on;
+  if (!thread_update())
+  {
+    threadRequested = false;
+    return 0;
+  }
+  return 1;
+}
+
+int sound_threaded(void)
+{
+  return threadActive;
+}
+
+void sound_set_render(int render)
+{
+  pendingRender = render;
+  if (!threadActive)
+    snd.render = render;
+}
+
+int sound_thread_frame(int16 *sb, unsigned int cycles)
+{
+  shadow_frame_end(cycles);
+  /* return the previous frame and start mixing this one */
+  wait_for_job();
+  int samples = mixedSamples;
+  mixedSamples = 0;
+  memcpy(sb, mixBuffer, samples * 2 * sizeof(int16));
+  queue_job(1, cycles);
+  return samples;
+}
+
+/* Reset FM chip */
+void fm_reset(unsigned int cycles)
+{
+  if (threadActive)
+  {
+    shadow_fm_update(cycles << 11);
+    YM2612ShadowReset();
+    log_cmd(CMD_FM_RESET, cycles, 0, 0);
+    return;
+  }
+  fm_reset_direct(cycles);
+}
+
+/* Write FM chip */
+void fm_write(unsigned int cycles, unsigned int address, unsigned int data)
+{
+  if (threadActive)
+  {
+    if (address & 1) shadow_fm_update(cycles << 11);
+    YM2612ShadowWrite(address, data);
+    log_cmd(CMD_FM_WRITE, cycles, address, data);
+    return;
+  }
+  fm_write_direct(cycles, address, data);
+}
+
 /* Read FM status (YM2612 only) */
 unsigned int fm_read(unsigned int cycles, unsigned int address)
 {
+  if (threadActive)
+  {
+    shadow_fm_update(cycles << 11);
+    unsigned int status = YM2612ShadowRead();
+    log_cmd(CMD_FM_READ, cycles, 0, status);
+    return status;
+  }
   fm_update(cycles << 11);
   return YM2612Read();
 }
@@ -366,6 +795,11 @@ unsigned int fm_read(unsigned int cycles, unsigned int address)
 /* Write PSG chip */
 void psg_write(unsigned int cycles, unsigned int data)
 {
-  psg_update(cycles << 11);
-  SN76489_Write(data);
+  if (threadActive)
+  {
+    shadow_psg_update(cycles << 11);
+    log_cmd(CMD_PSG_WRITE, cycles, 0, data);
+    return;
+  }
+  psg_write_direct(cycles, data);
 }
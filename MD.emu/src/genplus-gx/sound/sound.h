@@ -35,5 +35,11 @@ extern void fm_reset(unsigned int cycles);
 extern void fm_write(unsigned int cycles, unsigned int address, unsigned int data);
 extern unsigned int fm_read(unsigned int cycles, unsigned int address);
 extern void psg_write(unsigned int cycles, unsigned int data);
+extern void sound_set_render(int render);
+extern int sound_set_threaded(int on);
+extern int sound_threaded(void);
+extern int sound_thread_frame(int16 *sb, unsigned int cycles);
+extern void sound_thread_wait(void);
+extern void sound_thread_reload(void);
 
 #endif /* _SOUND_H_ */
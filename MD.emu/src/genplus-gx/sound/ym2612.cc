@@ -782,48 +782,120 @@ INLINE void CSMKeyControll(FM_CH *CH)
   ym2612.OPN.SL3.key_csm = 1;
 }
 
-INLINE void INTERNAL_TIMER_A()
+/* returns 1 when timer A overflows */
+INLINE int timer_a(FM_ST *ST)
 {
-  if (ym2612.OPN.ST.mode & 0x01)
+  if (ST->mode & 0x01)
   {
-    if ((ym2612.OPN.ST.TAC -= ym2612.OPN.ST.TimerBase) <= 0)
+    if ((ST->TAC -= ST->TimerBase) <= 0)
     {
       /* set status (if enabled) */
-      if (ym2612.OPN.ST.mode & 0x04)
-        ym2612.OPN.ST.status |= 0x01;
+      if (ST->mode & 0x04)
+        ST->status |= 0x01;
 
       /* reload the counter */
-      if (ym2612.OPN.ST.TAL)
-        ym2612.OPN.ST.TAC += ym2612.OPN.ST.TAL;
+      if (ST->TAL)
+        ST->TAC += ST->TAL;
       else
-        ym2612.OPN.ST.TAC = ym2612.OPN.ST.TAL;
+        ST->TAC = ST->TAL;
 
-      /* CSM mode auto key on */
-      if ((ym2612.OPN.ST.mode & 0xC0) == 0x80)
-        CSMKeyControll(&ym2612.CH[2]);
+      return 1;
     }
   }
+  return 0;
 }
 
-INLINE void INTERNAL_TIMER_B(int step)
+INLINE void timer_b(FM_ST *ST, int step)
 {
-  if (ym2612.OPN.ST.mode & 0x02)
+  if (ST->mode & 0x02)
   {
-    if ((ym2612.OPN.ST.TBC -= (ym2612.OPN.ST.TimerBase * step)) <= 0)
+    if ((ST->TBC -= (ST->TimerBase * step)) <= 0)
     {
       /* set status (if enabled) */
-      if (ym2612.OPN.ST.mode & 0x08)
-        ym2612.OPN.ST.status |= 0x02;
+      if (ST->mode & 0x08)
+        ST->status |= 0x02;
 
       /* reload the counter */
-      if (ym2612.OPN.ST.TBL)
-        ym2612.OPN.ST.TBC += ym2612.OPN.ST.TBL;
+      if (ST->TBL)
+        ST->TBC += ST->TBL;
       else
-        ym2612.OPN.ST.TBC = ym2612.OPN.ST.TBL;
+        ST->TBC = ST->TBL;
     }
   }
 }
 
+INLINE void INTERNAL_TIMER_A()
+{
+  if (timer_a(&ym2612.OPN.ST))
+  {
+    /* CSM mode auto key on */
+    if ((ym2612.OPN.ST.mode & 0xC0) == 0x80)
+      CSMKeyControll(&ym2612.CH[2]);
+  }
+}
+
+INLINE void INTERNAL_TIMER_B(int step)
+{
+  timer_b(&ym2612.OPN.ST, step);
+}
+
+/* timer A control, run once per sample */
+INLINE void advance_timer_a()
+{
+  /* CSM mode: if CSM Key ON has occured, CSM Key OFF need to be sent       */
+  /* only if Timer A does not overflow again (i.e CSM Key ON not set again) */
+  ym2612.OPN.SL3.key_csm <<= 1;
+
+  /* timer A control */
+  INTERNAL_TIMER_A();
+
+  /* CSM Mode Key ON still disabled */
+  if (ym2612.OPN.SL3.key_csm & 2)
+  {
+    /* CSM Mode Key OFF (verified by Nemesis on real hardware) */
+    FM_KEYOFF_CSM(&ym2612.CH[2],SLOT1);
+    FM_KEYOFF_CSM(&ym2612.CH[2],SLOT2);
+    FM_KEYOFF_CSM(&ym2612.CH[2],SLOT3);
+    FM_KEYOFF_CSM(&ym2612.CH[2],SLOT4);
+    ym2612.OPN.SL3.key_csm = 0;
+  }
+}
+
+/* timer A/B values (0x24-0x26) */
+INLINE void set_timer_reg(FM_ST *ST, int r, int v)
+{
+  switch(r)
+  {
+    case 0x24:  /* timer A High 8*/
+      ST->TA = (ST->TA & 0x03)|(((int)v)<<2);
+      ST->TAL = (1024 - ST->TA) << TIMER_SH;
+      break;
+    case 0x25:  /* timer A Low 2*/
+      ST->TA = (ST->TA & 0x3fc)|(v&3);
+      ST->TAL = (1024 - ST->TA) << TIMER_SH;
+      break;
+    case 0x26:  /* timer B */
+      ST->TB = v;
+      ST->TBL = (256 - ST->TB) << (TIMER_SH + 4);
+      break;
+  }
+}
+
+/* timer part of the mode register (0x27) */
+INLINE void set_timer_mode(FM_ST *ST, int v)
+{
+  /* reload Timers */
+  if ((v&1) && !(ST->mode&1))
+    ST->TAC = ST->TAL;
+  if ((v&2) && !(ST->mode&2))
+    ST->TBC = ST->TBL;
+
+  /* reset Timers flags */
+  ST->status &= (~v >> 4);
+
+  ST->mode = v;
+}
+
 /* OPN Mode Register Write */
 INLINE void set_timers(int v )
 {
@@ -853,16 +925,7 @@ INLINE void set_timers(int v )
     }
   }
 
-  /* reload Timers */
-  if ((v&1) && !(ym2612.OPN.ST.mode&1))
-    ym2612.OPN.ST.TAC = ym2612.OPN.ST.TAL;
-  if ((v&2) && !(ym2612.OPN.ST.mode&2))
-    ym2612.OPN.ST.TBC = ym2612.OPN.ST.TBL;
-  
-  /* reset Timers flags */
-  ym2612.OPN.ST.status &= (~v >> 4); 
-
-  ym2612.OPN.ST.mode = v;
+  set_timer_mode(&ym2612.OPN.ST, v);
 }
 
 /* set algorithm connection */
@@ -1520,16 +1583,9 @@ INLINE void OPNWriteMode(int r, int v)
 
       break;
     case 0x24:  /* timer A High 8*/
-      ym2612.OPN.ST.TA = (ym2612.OPN.ST.TA & 0x03)|(((int)v)<<2);
-      ym2612.OPN.ST.TAL = (1024 - ym2612.OPN.ST.TA) << TIMER_SH;
-      break;
     case 0x25:  /* timer A Low 2*/
-      ym2612.OPN.ST.TA = (ym2612.OPN.ST.TA & 0x3fc)|(v&3);
-      ym2612.OPN.ST.TAL = (1024 - ym2612.OPN.ST.TA) << TIMER_SH;
-      break;
     case 0x26:  /* timer B */
-      ym2612.OPN.ST.TB = v;
-      ym2612.OPN.ST.TBL = (256 - ym2612.OPN.ST.TB) << (TIMER_SH + 4);
+      set_timer_reg(&ym2612.OPN.ST, r, v);
       break;
     case 0x27:  /* mode, timer control */
       set_timers(v);
@@ -2144,27 +2200,84 @@ void YM2612Update(FMSampleType *buffer, int length)
     *buffer++ = lt;
     *buffer++ = rt;
 
-    /* CSM mode: if CSM Key ON has occured, CSM Key OFF need to be sent       */
-    /* only if Timer A does not overflow again (i.e CSM Key ON not set again) */
-    ym2612.OPN.SL3.key_csm <<= 1;
+    advance_timer_a();
+  }
 
-    /* timer A control */
-    INTERNAL_TIMER_A();
+  /* timer B control */
+  INTERNAL_TIMER_B(length);
+}
+
+/* Run timers for length samples without generating output */
+void YM2612Skip(int length)
+{
+  int i;
+  for(i=0; i < length ; i++)
+  {
+    advance_timer_a();
+  }
+  INTERNAL_TIMER_B(length);
+}
+
+/* Timer-only copy of the chip state. It follows the same writes and sample  */
+/* counts as the real chip so the status register can be read on the        */
+/* emulation thread while YM2612Update() runs on another one.                */
+static FM_ST shadow;
+
+void YM2612ShadowSync(void)
+{
+  shadow = ym2612.OPN.ST;
+}
+
+void YM2612ShadowReset(void)
+{
+  /* same timer changes as YM2612ResetChip() */
+  shadow.TAC = 0;
+  shadow.TBC = 0;
+  set_timer_mode(&shadow, 0x30);
+  set_timer_reg(&shadow, 0x26, 0);
+  set_timer_reg(&shadow, 0x25, 0);
+  set_timer_reg(&shadow, 0x24, 0);
+}
+
+void YM2612ShadowWrite(unsigned int a, unsigned int v)
+{
+  v &= 0xff;
+
+  switch( a )
+  {
+    case 0:
+      shadow.address = v;
+      break;
+
+    case 2:
+      shadow.address = v | 0x100;
+      break;
 
-    /* CSM Mode Key ON still disabled */
-    if (ym2612.OPN.SL3.key_csm & 2)
+    default:
+      if (shadow.address == 0x27)
+        set_timer_mode(&shadow, v);
+      else if ((shadow.address >= 0x24) && (shadow.address <= 0x26))
+        set_timer_reg(&shadow, shadow.address, v);
+      break;
+  }
+}
+
+void YM2612ShadowUpdate(int length)
+{
+  int i;
+  if (shadow.mode & 0x01)
+  {
+    for(i=0; i < length ; i++)
     {
-      /* CSM Mode Key OFF (verified by Nemesis on real hardware) */
-      FM_KEYOFF_CSM(&ym2612.CH[2],SLOT1);
-      FM_KEYOFF_CSM(&ym2612.CH[2],SLOT2);
-      FM_KEYOFF_CSM(&ym2612.CH[2],SLOT3);
-      FM_KEYOFF_CSM(&ym2612.CH[2],SLOT4);
-      ym2612.OPN.SL3.key_csm = 0;
+      timer_a(&shadow);
     }
   }
+  timer_b(&shadow, length);
+}
 
-  /* timer B control */
-  INTERNAL_TIMER_B(length);
+unsigned int YM2612ShadowRead(void)
+{
+  return shadow.status & 0xff;
 }
 
 unsigned char *YM2612GetContextPtr(void)
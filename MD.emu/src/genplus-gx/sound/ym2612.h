@@ -23,6 +23,12 @@ extern void YM2612ResetChip(void);
 extern void YM2612Update(FMSampleType *buffer, int length);
 extern void YM2612Write(unsigned int a, unsigned int v);
 extern unsigned int YM2612Read(void);
+extern void YM2612Skip(int length);
+extern void YM2612ShadowSync(void);
+extern void YM2612ShadowReset(void);
+extern void YM2612ShadowWrite(unsigned int a, unsigned int v);
+extern void YM2612ShadowUpdate(int length);
+extern unsigned int YM2612ShadowRead(void);
 extern unsigned char *YM2612GetContextPtr(void);
 extern unsigned int YM2612GetContextSize(void);
 extern void YM2612Restore(unsigned char *buffer);
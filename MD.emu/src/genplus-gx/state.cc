@@ -22,16 +22,12 @@
 
 #include "shared.h"
 #include <imagine/logger/logger.h>
-//static unsigned char state[STATE_SIZE] __attribute__ ((aligned (4)));
+// scratch space for the uncompressed state, kept for the life of the process since
+// rewind & run-ahead save and load states many times per second
+static unsigned char state[STATE_SIZE] __attribute__ ((aligned (4)));
 
 int state_load(const unsigned char *buffer)
 {
-	unsigned char *state = (unsigned char*)malloc(STATE_SIZE);
-	if(!state)
-	{
-		logErr("out of memory loading state");
-		return -1;
-	}
 
   /* buffer size */
   int bufferptr = 0;
@@ -48,7 +44,6 @@ int state_load(const unsigned char *buffer)
 		if(result != Z_OK)
 		{
 			logErr("error %d in uncompress loading state", result);
-			free(state);
 			return -1;
 		}
   }
@@ -60,7 +55,6 @@ int state_load(const unsigned char *buffer)
   if (strncmp(version,STATE_VERSION,11))
   {
   	logErr("bad signature loading state");
-  	free(state);
     return -1;
   }
 
@@ -68,7 +62,6 @@ int state_load(const unsigned char *buffer)
   if ((version[11] < 0x31) || ((version[11] == 0x31) && (version[13] < 0x35)))
   {
   	logErr("version too old loading state");
-  	free(state);
     return -1;
   }
 
@@ -188,15 +181,11 @@ int state_load(const unsigned char *buffer)
 	}
 	#endif
 
-	free(state);
   return 1;
 }
 
-int state_save(unsigned char *buffer)
+int state_save(unsigned char *buffer, int compressionLevel)
 {
-	unsigned char *state = (unsigned char*)malloc(STATE_SIZE);
-	if(!state)
-		return -1;
 
   /* buffer size */
   int bufferptr = 0;
@@ -296,9 +285,8 @@ int state_save(unsigned char *buffer)
   unsigned long inbytes   = bufferptr;
   unsigned long outbytes  = STATE_SIZE;
   logMsg("compressing %d bytes to buffer of %d size", (int)inbytes, (int)outbytes);
-  int ret = compress2 ((Bytef *)(buffer + 4), &outbytes, (Bytef *)state, inbytes, 9);
+  int ret = compress2 ((Bytef *)(buffer + 4), &outbytes, (Bytef *)state, inbytes, compressionLevel);
   logMsg("compress2 returned %d, reduced to %d bytes", ret, (int)outbytes);
-  free(state);
   uint32 outbytes32 = outbytes; // assumes no save states will ever be over 4GB
   memcpy(buffer, &outbytes32, 4);
 
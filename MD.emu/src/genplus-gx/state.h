@@ -41,6 +41,6 @@
 
 /* Function prototypes */
 extern int state_load(const unsigned char *buffer);
-extern int state_save(unsigned char *buffer);
+extern int state_save(unsigned char *buffer, int compressionLevel = 9);
 
 #endif
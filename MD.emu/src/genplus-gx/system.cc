@@ -39,7 +39,7 @@ uint32 mcycles_vdp;
 //uint32 mcycles_68k;
 uint8 system_hw;
 void (*system_frame)(int do_skip, uint renderGfx);
-int (*audioUpdateFunc)(int16 *sb);
+int (*audioUpdateFunc)(int16 *sb, unsigned int cycles);
 
 template <bool hasSegaCD = 0>
 static void system_frame_md(int do_skip, uint renderGfx);
@@ -64,6 +64,7 @@ int audio_init (int samplerate, float framerate)
   snd.sample_rate = samplerate;
   snd.frame_rate  = framerate;
   snd.cddaRatio = 44100./snd.sample_rate;
+  snd.render = 1;
 
   /* Calculate the sound buffer size (for one frame) */
   snd.buffer_size = (int)(samplerate / framerate) + 32;
@@ -94,6 +95,8 @@ int audio_init (int samplerate, float framerate)
 
 void audio_reset(void)
 {
+  sound_thread_wait();
+
   /* Low-Pass filter */
   llp = 0;
   rrp = 0;
@@ -109,6 +112,8 @@ void audio_reset(void)
   snd.fm.pos  = snd.fm.buffer;
   if (snd.psg.buffer) memset (snd.psg.buffer, 0, snd.buffer_size * sizeof(int16));
   if (snd.fm.buffer) memset (snd.fm.buffer, 0, snd.buffer_size * sizeof(FMSampleType) * 2);
+
+  sound_thread_reload();
 }
 
 void audio_set_equalizer(void)
@@ -121,6 +126,8 @@ void audio_set_equalizer(void)
 
 void audio_shutdown(void)
 {
+  sound_thread_wait();
+
   /* Sound buffers */
   if (snd.fm.buffer) free(snd.fm.buffer);
   if (snd.psg.buffer) free(snd.psg.buffer);
@@ -130,7 +137,7 @@ void audio_shutdown(void)
 }
 
 template <bool hasSegaCD>
-int audioUpdateAll(int16 *sb)
+int audioUpdateAll(int16 *sb, unsigned int cycles)
 {
   int32 i, l, r;
   int32 ll = llp;
@@ -146,7 +153,7 @@ int audioUpdateAll(int16 *sb)
   int16 *psg      = snd.psg.buffer;
 
   /* get number of available samples */
-  int size = sound_update(mcycles_vdp);
+  int size = sound_update(cycles);
 
   /* return an aligned number of samples */
   size &= ~7;
@@ -184,6 +191,14 @@ int audioUpdateAll(int16 *sb)
 	}
 	#endif
 
+  if (!snd.render)
+  {
+    /* nothing was synthesized, only drop the PSG sample count */
+    snd.psg.pos -= size;
+    memmove(snd.psg.buffer, snd.psg.buffer + size, (snd.psg.pos - snd.psg.buffer) * sizeof(int16));
+    return 0;
+  }
+
   if (config_hq_fm)
   {
     /* resample into FM output buffer */
@@ -284,12 +299,14 @@ int audioUpdateAll(int16 *sb)
   return size;
 }
 
-template int audioUpdateAll<0>(int16 *sb);
-template int audioUpdateAll<1>(int16 *sb);
+template int audioUpdateAll<0>(int16 *sb, unsigned int cycles);
+template int audioUpdateAll<1>(int16 *sb, unsigned int cycles);
 
 int audio_update(int16 *sb)
 {
-	return audioUpdateFunc(sb);
+	if(sound_threaded())
+		return sound_thread_frame(sb, mcycles_vdp);
+	return audioUpdateFunc(sb, mcycles_vdp);
 }
 
 /****************************************************************
@@ -62,6 +62,7 @@ typedef struct
   float frame_rate; /* Output Frame rate (usually 50 or 60 frames per second) */
   float cddaRatio;
   int enabled;      /* 1= sound emulation is enabled */
+  int render;       /* 0= chips only keep their timing, no samples are output */
   int buffer_size;  /* Size of sound buffer (in bytes) */
   struct
   {
@@ -89,6 +90,8 @@ extern int audio_init(int samplerate,float framerate);
 extern void audio_reset(void);
 extern void audio_shutdown(void);
 extern int audio_update(int16 *sb);
+template <bool hasSegaCD>
+int audioUpdateAll(int16 *sb, unsigned int cycles);
 extern void audio_set_equalizer(void);
 extern void system_init(void);
 extern void system_reset(void);
@@ -35,6 +35,20 @@ public:
 			config_ym2413_enabled = optionSmsFM;
 		}
 	},
+	threadedSound
+	{
+		[this](BoolMenuItem &item, const Input::Event &e)
+		{
+			optionThreadedSound = !item.on;
+			if(!updateThreadedSound())
+			{
+				optionThreadedSound = 0;
+				popup.postError("Requires a multi-core CPU");
+				return;
+			}
+			item.toggle(*this);
+		}
+	},
 	bigEndianSram
 	{
 		[this](BoolMenuItem &item, const Input::Event &e)
@@ -79,6 +93,16 @@ public:
 	}
 
 	#ifndef NO_SCD
+	BoolMenuItem cdReadAhead
+	{
+		[this](BoolMenuItem &item, const Input::Event &e)
+		{
+			item.toggle(*this);
+			optionCDReadAhead = item.on;
+			CD_Prefetch_Set_Enabled(item.on);
+		}
+	};
+
 	static constexpr const char *biosHeadingStr[3] = { "USA CD BIOS", "Japan CD BIOS", "Europe CD BIOS" };
 
 	static int regionCodeToIdx(int region)
@@ -226,6 +250,7 @@ public:
 	{
 		OptionView::loadAudioItems(item, items);
 		smsFM.init("MarkIII FM Sound Unit", optionSmsFM); item[items++] = &smsFM;
+		threadedSound.init("Threaded FM/PSG (Off With Rewind/Run-Ahead)", optionThreadedSound); item[items++] = &threadedSound;
 	}
 
 	void loadInputItems(MenuItem *item[], uint &items)
@@ -242,6 +267,7 @@ public:
 		bigEndianSram.init("Use Big-Endian SRAM", optionBigEndianSram); item[items++] = &bigEndianSram;
 		regionInit(); item[items++] = &region;
 		#ifndef NO_SCD
+		cdReadAhead.init("CD Read-ahead Thread", optionCDReadAhead); item[items++] = &cdReadAhead;
 		cdBiosPathInit(item, items);
 		#endif
 	}
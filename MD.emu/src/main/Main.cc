@@ -16,6 +16,9 @@
 #define LOGTAG "main"
 #include <EmuSystem.hh>
 #include <CommonFrameworkIncludes.hh>
+#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+#include <AsyncStateWriter.hh>
+#endif
 #include "system.h"
 #include "loadrom.h"
 #include "md_cart.h"
@@ -29,8 +32,15 @@
 #include "genplus-config.h"
 #ifndef NO_SCD
 #include <scd/scd.h>
+#include <scd/cd_prefetch.h>
 #endif
 #include <main/Cheats.hh>
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+#include <Rewind.hh>
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+#include <RunAhead.hh>
+#endif
 
 const char *creditsViewStr = CREDITS_INFO_STRING "(c) 2011-2014\nRobert Broglia\nwww.explusalpha.com\n\nPortions (c) the\nGenesis Plus Team\ncgfm2.emuviews.com";
 t_config config = { 0 };
@@ -107,6 +117,7 @@ enum {
 	CFGKEY_6_BTN_PAD = 280, CFGKEY_MD_CD_BIOS_USA_PATH = 281,
 	CFGKEY_MD_CD_BIOS_JPN_PATH = 282, CFGKEY_MD_CD_BIOS_EUR_PATH = 283,
 	CFGKEY_MD_REGION = 284, CFGKEY_VIDEO_SYSTEM = 285,
+	CFGKEY_THREADED_SOUND = 286, CFGKEY_CD_READ_AHEAD = 287,
 };
 
 static bool usingMultiTap = 0;
@@ -119,9 +130,34 @@ FsSys::cPath cdBiosUSAPath = "", cdBiosJpnPath = "", cdBiosEurPath = "";
 static PathOption optionCDBiosUsaPath(CFGKEY_MD_CD_BIOS_USA_PATH, cdBiosUSAPath, sizeof(cdBiosUSAPath), "");
 static PathOption optionCDBiosJpnPath(CFGKEY_MD_CD_BIOS_JPN_PATH, cdBiosJpnPath, sizeof(cdBiosJpnPath), "");
 static PathOption optionCDBiosEurPath(CFGKEY_MD_CD_BIOS_EUR_PATH, cdBiosEurPath, sizeof(cdBiosEurPath), "");
+static Byte1Option optionCDReadAhead(CFGKEY_CD_READ_AHEAD, 1);
 #endif
 static Byte1Option optionVideoSystem(CFGKEY_VIDEO_SYSTEM, 0);
+static Byte1Option optionThreadedSound(CFGKEY_THREADED_SOUND, 0);
 static uint autoDetectedVidSysPAL = 0;
+static bool threadedSoundOn = false;
+
+// rewind and run-ahead save a state every frame, which would wait for the sound
+// thread to finish each time, so synthesis stays inline while either is active
+static bool threadedSoundAllowed()
+{
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	if(rewindBuffer.isInit())
+		return false;
+	#endif
+	#ifdef CONFIG_EMUFRAMEWORK_RUN_AHEAD
+	if(runAhead.isActive())
+		return false;
+	#endif
+	return true;
+}
+
+// returns false if the sound thread was wanted but couldn't start
+static bool updateThreadedSound()
+{
+	threadedSoundOn = optionThreadedSound && threadedSoundAllowed();
+	return sound_set_threaded(threadedSoundOn);
+}
 
 const uint EmuSystem::maxPlayers = 4;
 const AspectRatioInfo EmuSystem::aspectRatioInfo[] =
@@ -156,6 +192,11 @@ void EmuSystem::onOptionsLoaded()
 	vController.gp.activeFaceBtns = option6BtnPad ? 6 : 3;
 	#endif
 	config_ym2413_enabled = optionSmsFM;
+	if(!updateThreadedSound())
+		optionThreadedSound = 0;
+	#ifndef NO_SCD
+	CD_Prefetch_Set_Enabled(optionCDReadAhead);
+	#endif
 }
 
 bool EmuSystem::readConfig(Io &io, uint key, uint readSize)
@@ -169,6 +210,7 @@ bool EmuSystem::readConfig(Io &io, uint key, uint readSize)
 		bcase CFGKEY_MD_CD_BIOS_USA_PATH: optionCDBiosUsaPath.readFromIO(io, readSize);
 		bcase CFGKEY_MD_CD_BIOS_JPN_PATH: optionCDBiosJpnPath.readFromIO(io, readSize);
 		bcase CFGKEY_MD_CD_BIOS_EUR_PATH: optionCDBiosEurPath.readFromIO(io, readSize);
+		bcase CFGKEY_CD_READ_AHEAD: optionCDReadAhead.readFromIO(io, readSize);
 		#endif
 		bcase CFGKEY_MD_REGION:
 		{
@@ -181,6 +223,7 @@ bool EmuSystem::readConfig(Io &io, uint key, uint readSize)
 				optionRegion = 0;
 		}
 		bcase CFGKEY_VIDEO_SYSTEM: optionVideoSystem.readFromIO(io, readSize);
+		bcase CFGKEY_THREADED_SOUND: optionThreadedSound.readFromIO(io, readSize);
 		bdefault: return 0;
 	}
 	return 1;
@@ -192,10 +235,12 @@ void EmuSystem::writeConfig(Io *io)
 	optionSmsFM.writeWithKeyIfNotDefault(io);
 	option6BtnPad.writeWithKeyIfNotDefault(io);
 	optionVideoSystem.writeWithKeyIfNotDefault(io);
+	optionThreadedSound.writeWithKeyIfNotDefault(io);
 	#ifndef NO_SCD
 	optionCDBiosUsaPath.writeToIO(io);
 	optionCDBiosJpnPath.writeToIO(io);
 	optionCDBiosEurPath.writeToIO(io);
+	optionCDReadAhead.writeWithKeyIfNotDefault(io);
 	#endif
 	optionRegion.writeWithKeyIfNotDefault(io);
 }
@@ -299,11 +344,15 @@ void EmuSystem::runFrame(bool renderGfx, bool processGfx, bool renderAudio)
 {
 	//logMsg("frame start");
 	RAMCheatUpdate();
+	if(threadedSoundOn != (optionThreadedSound && threadedSoundAllowed()))
+		updateThreadedSound();
+	sound_set_render(renderAudio);
 	system_frame(!processGfx, renderGfx);
 
 	int16 audioBuff[snd.buffer_size * 2];
+	// with threaded sound, this is the previous frame's audio
 	int frames = audio_update(audioBuff);
-	if(renderAudio)
+	if(frames)
 	{
 		//logMsg("%d frames", frames);
 		writeSound(audioBuff, frames);
@@ -364,6 +413,11 @@ static int saveMDState(const char *path)
 		return STATE_RESULT_IO_ERROR;
 	logMsg("saving state data");
 	int size = state_save(stateData);
+	if(size <= 0)
+	{
+		free(stateData);
+		return STATE_RESULT_OTHER_ERROR;
+	}
 	logMsg("writing to file");
 	CallResult ret;
 	if((ret = IoSys::writeToNewFile(path, stateData, size)) != OK)
@@ -413,6 +467,37 @@ static int loadMDState(const char *path)
 	return STATE_RESULT_OK;
 }
 
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+uint EmuSystem::saveStateToMemory(void *buff, uint size)
+{
+	if(size < maxSaveStateSize)
+		return 0;
+	int stateSize = state_save((uchar*)buff, 0);
+	return stateSize > 0 ? stateSize : 0;
+}
+
+int EmuSystem::loadStateFromMemory(const void *buff, uint size)
+{
+	if(state_load((const uchar*)buff) <= 0)
+		return STATE_RESULT_INVALID_DATA;
+	return STATE_RESULT_OK;
+}
+#endif
+
+#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+uint EmuSystem::saveStateFileToMemory(void *buff, uint size, bool &compressed)
+{
+	if(size < maxSaveStateSize)
+		return 0;
+	// same compressed data saveMDState() writes
+	int stateSize = state_save((uchar*)buff);
+	if(stateSize <= 0)
+		return 0;
+	compressed = true;
+	return stateSize;
+}
+#endif
+
 int EmuSystem::saveState()
 {
 	FsSys::cPath saveStr;
@@ -420,7 +505,11 @@ int EmuSystem::saveState()
 	if(Config::envIsIOSJB)
 		fixFilePermissions(saveStr);
 	logMsg("saving state %s", saveStr);
+	#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+	return stateWriter.save(saveStr);
+	#else
 	return saveMDState(saveStr);
+	#endif
 }
 
 int EmuSystem::loadState(int saveStateSlot)
@@ -428,6 +517,11 @@ int EmuSystem::loadState(int saveStateSlot)
 	FsSys::cPath saveStr;
 	sprintStateFilename(saveStr, saveStateSlot);
 	logMsg("loading state %s", saveStr);
+	#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+	stateWriter.waitForIdle();
+	if(AsyncStateWriter::isCompressedState(saveStr))
+		return AsyncStateWriter::loadState(saveStr);
+	#endif
 	return loadMDState(saveStr);
 }
 
@@ -493,7 +587,11 @@ void EmuSystem::saveAutoState()
 		sprintStateFilename(saveStr, -1);
 		if(Config::envIsIOSJB)
 			fixFilePermissions(saveStr);
+		#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+		stateWriter.save(saveStr, false);
+		#else
 		saveMDState(saveStr);
+		#endif
 	}
 }
 
@@ -10,6 +10,7 @@
 #include "scd.h"
 #include "cd_file.h"
 #include "cd_sys.h"
+#include "cd_prefetch.h"
 #include <imagine/logger/logger.h>
 #include <assert.h>
 #include <string.h>
@@ -50,12 +51,14 @@ int Load_ISO(CDAccess *cd)
 	sCD.TOC.Last_Track = toc.last_track;
 	LBA_to_MSF(currLBA, &sCD.TOC.Tracks[toc.last_track].MSF);
 	cdImage = cd;
+	CD_Prefetch_Start(cd);
 	return 0;
 }
 
 void Unload_ISO(void)
 {
 	sCD.Status_CDD = 0;
+	CD_Prefetch_Stop();
 	delete cdImage;
 	cdImage = nullptr;
 	memset(sCD.TOC.Tracks, 0, sizeof(sCD.TOC.Tracks));
@@ -63,12 +66,12 @@ void Unload_ISO(void)
 
 static void readLBA(void *dest, int lba)
 {
-	cdImage->Read_Sector((uint8*)dest, lba, 2048);
+	CD_Prefetch_Read(CD_PREFETCH_DATA, (uint8*)dest, lba, 2048);
 }
 
 static void readCddaLBA(void *dest, int lba)
 {
-	cdImage->Read_Sector((uint8*)dest, lba, 2352);
+	CD_Prefetch_Read(CD_PREFETCH_RAW, (uint8*)dest, lba, 2352);
 }
 
 int readCDDA(void *dest, uint size)
@@ -82,7 +85,7 @@ int readCDDA(void *dest, uint size)
 		{
 			//logMsg("reading %d frames of left-over CDDA", cddaDataLeftover);
 			int32 cddaSector[588];
-			cdImage->Read_Sector((uint8*)cddaSector, sCD.cddaLBA, 2352);
+			CD_Prefetch_Read(CD_PREFETCH_CDDA, (uint8*)cddaSector, sCD.cddaLBA, 2352);
 			uint copySize = std::min((uint)sCD.cddaDataLeftover, sizeToWrite);
 			memcpy(cddaBuffPos, cddaSector + (588-sCD.cddaDataLeftover), copySize*4);
 			sCD.cddaDataLeftover -= copySize;
@@ -94,7 +97,7 @@ int readCDDA(void *dest, uint size)
 		while(sizeToWrite >= 588)
 		{
 			//logMsg("reading 588 frames");
-			cdImage->Read_Sector((uint8*)cddaBuffPos, sCD.cddaLBA, 2352);
+			CD_Prefetch_Read(CD_PREFETCH_CDDA, (uint8*)cddaBuffPos, sCD.cddaLBA, 2352);
 			sCD.cddaLBA++;
 			cddaBuffPos += 588;
 			sizeToWrite -= 588;
@@ -103,7 +106,7 @@ int readCDDA(void *dest, uint size)
 		{
 			//logMsg("reading %d frames left", sizeToWrite);
 			int32 cddaSector[588];
-			cdImage->Read_Sector((uint8*)cddaSector, sCD.cddaLBA, 2352);
+			CD_Prefetch_Read(CD_PREFETCH_CDDA, (uint8*)cddaSector, sCD.cddaLBA, 2352);
 			memcpy(cddaBuffPos, cddaSector, sizeToWrite*4);
 			sCD.cddaDataLeftover = 588 - sizeToWrite;
 		}
@@ -0,0 +1,254 @@
+#define LOGTAG "cdPrefetch"
+#include "cd_prefetch.h"
+#include <imagine/logger/logger.h>
+#include <imagine/util/thread/pthread.hh>
+#include <imagine/util/time/sys.hh>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <exception>
+
+// 64 sectors is a bit under a second of 1x reading
+static const uint RING_SECTORS = 64;
+// sectors kept behind the last request for run-ahead & rewind
+static const uint HISTORY_SECTORS = 8;
+static const uint INITIAL_WINDOW = 4;
+static const uint MAX_WINDOW = RING_SECTORS - HISTORY_SECTORS;
+
+struct PrefetchStream
+{
+	int base; // LBA of the oldest buffered sector
+	uint first; // ring index of base
+	uint filled;
+	int nextLBA; // last requested LBA + 1
+	uint window; // sectors to read past nextLBA
+	uint size; // 0 until the first request
+	uint gen; // bumped on seek to drop the read in flight
+	bool valid[RING_SECTORS];
+	uint8 data[RING_SECTORS][2352];
+
+	bool hasSector(int lba) const
+	{
+		return lba >= base && lba < base + (int)filled;
+	}
+
+	int lead() const
+	{
+		return base + (int)filled - nextLBA;
+	}
+
+	bool needsSector() const
+	{
+		return size && base + (int)filled < nextLBA + (int)window;
+	}
+};
+
+static bool enabled = true, active = false, quit = false, waiting = false;
+static CDAccess *cdImage = nullptr;
+static PrefetchStream *stream = nullptr; // guarded by mutex while active
+static uint hits = 0, stalls = 0, seeks = 0;
+static uint minuteStalls = 0;
+static TimeSys minuteStart, minuteStallTime;
+
+static ThreadPThread thread;
+static MutexPThread mutex;
+static CondVarPThread workCond, doneCond;
+
+static bool readSector(uint8 *dest, int lba, uint size)
+{
+	try
+	{
+		return cdImage->Read_Sector(dest, lba, size);
+	}
+	catch(std::exception &e)
+	{
+		logErr("error reading sector %d: %s", lba, e.what());
+		return false;
+	}
+}
+
+// stream furthest behind its window, nullptr if all are full
+static PrefetchStream *nextStream()
+{
+	PrefetchStream *s = nullptr;
+	for(uint i = 0; i < CD_PREFETCH_STREAMS; i++)
+	{
+		if(stream[i].needsSector() && (!s || stream[i].lead() < s->lead()))
+			s = &stream[i];
+	}
+	return s;
+}
+
+static void *threadEntry(void *)
+{
+	uint8 buff[2352];
+	mutex.lock();
+	for(;;)
+	{
+		PrefetchStream *s;
+		while(!(s = nextStream()) && !quit)
+			workCond.wait();
+		if(quit)
+			break;
+		int lba = s->base + s->filled;
+		uint gen = s->gen;
+		uint size = s->size;
+		mutex.unlock();
+		bool valid = readSector(buff, lba, size);
+		mutex.lock();
+		if(gen != s->gen)
+			continue; // sought elsewhere during the read
+		if(s->filled == RING_SECTORS)
+		{
+			// the window never reaches into the history, so this is behind nextLBA
+			s->first = (s->first + 1) % RING_SECTORS;
+			s->base++;
+			s->filled--;
+		}
+		uint idx = (s->first + s->filled) % RING_SECTORS;
+		memcpy(s->data[idx], buff, size);
+		s->valid[idx] = valid;
+		s->filled++;
+		if(waiting)
+			doneCond.signal();
+	}
+	mutex.unlock();
+	return nullptr;
+}
+
+static void logMinuteStats()
+{
+	auto now = TimeSys::now();
+	if((now - minuteStart).toMs() < 60000)
+		return;
+	if(minuteStalls)
+		logMsg("%u stalls in the last minute, %ldms waiting", minuteStalls, minuteStallTime.toMs());
+	minuteStart = now;
+	minuteStallTime = {};
+	minuteStalls = 0;
+}
+
+bool CD_Prefetch_Read(uint streamIdx, uint8 *dest, int lba, uint size)
+{
+	if(!active)
+		return cdImage->Read_Sector(dest, lba, size);
+	auto &s = stream[streamIdx];
+	mutex.lock();
+	if(size != s.size || (!s.hasSector(lba) && (lba < s.base || lba >= s.nextLBA + (int)s.window)))
+	{
+		s.base = lba;
+		s.first = 0;
+		s.filled = 0;
+		s.window = INITIAL_WINDOW;
+		s.size = size;
+		s.gen++;
+		seeks++;
+	}
+	else if(lba == s.nextLBA)
+	{
+		s.window = std::min(s.window * 2, MAX_WINDOW);
+	}
+	s.nextLBA = lba + 1;
+	workCond.signal();
+	if(s.hasSector(lba))
+		hits++;
+	else
+	{
+		auto startTime = TimeSys::now();
+		waiting = true;
+		while(!s.hasSector(lba))
+			doneCond.wait();
+		waiting = false;
+		stalls++;
+		minuteStalls++;
+		minuteStallTime += TimeSys::now() - startTime;
+	}
+	uint idx = (s.first + (lba - s.base)) % RING_SECTORS;
+	bool valid = s.valid[idx];
+	if(valid)
+		memcpy(dest, s.data[idx], size);
+	else
+	{
+		// drop the failed sector and everything read after it so the next
+		// request retries it, the read in flight would land in its slot
+		s.filled = lba - s.base;
+		s.gen++;
+	}
+	mutex.unlock();
+	logMinuteStats();
+	return valid;
+}
+
+static bool startThread()
+{
+	stream = (PrefetchStream*)calloc(CD_PREFETCH_STREAMS, sizeof(PrefetchStream));
+	if(!stream)
+	{
+		logErr("not enough memory for CD read-ahead");
+		return false;
+	}
+	quit = false;
+	waiting = false;
+	hits = stalls = seeks = 0;
+	minuteStalls = 0;
+	minuteStart = TimeSys::now();
+	minuteStallTime = {};
+	if(!mutex.create())
+	{
+		free(stream);
+		stream = nullptr;
+		return false;
+	}
+	workCond.create(mutex);
+	doneCond.create(mutex);
+	if(!thread.create(0, threadEntry, nullptr))
+	{
+		mutex.destroy();
+		free(stream);
+		stream = nullptr;
+		return false;
+	}
+	active = true;
+	logMsg("started CD read-ahead thread");
+	return true;
+}
+
+static void stopThread()
+{
+	mutex.lock();
+	quit = true;
+	workCond.signal();
+	mutex.unlock();
+	thread.join();
+	mutex.destroy();
+	free(stream);
+	stream = nullptr;
+	active = false;
+	logMsg("stopped CD read-ahead thread, %u hits, %u stalls, %u seeks", hits, stalls, seeks);
+}
+
+void CD_Prefetch_Set_Enabled(bool on)
+{
+	enabled = on;
+	if(!cdImage || on == active)
+		return;
+	if(on)
+		startThread();
+	else
+		stopThread();
+}
+
+void CD_Prefetch_Start(CDAccess *cd)
+{
+	CD_Prefetch_Stop();
+	cdImage = cd;
+	if(enabled)
+		startThread();
+}
+
+void CD_Prefetch_Stop(void)
+{
+	if(active)
+		stopThread();
+	cdImage = nullptr;
+}
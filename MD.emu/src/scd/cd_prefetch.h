@@ -0,0 +1,19 @@
+#pragma once
+
+#include <mednafen/cdrom/CDAccess.h>
+
+// Background sector read-ahead. Each stream keeps a ring of sectors that a
+// worker thread fills ahead of the last requested LBA. The read-ahead window
+// grows while requests stay sequential, and a request outside the buffered
+// range is treated as a seek that drops the ring and cancels the read in
+// flight. A failed read is dropped from the ring so the next request for it
+// reads it again. Without the thread, reads go straight to the CDAccess.
+
+// cooked 2048 byte data reads, raw 2352 byte reads of the data track, and
+// CDDA playback each keep their own stream so they don't evict each other
+enum { CD_PREFETCH_DATA, CD_PREFETCH_RAW, CD_PREFETCH_CDDA, CD_PREFETCH_STREAMS };
+
+void CD_Prefetch_Set_Enabled(bool on);
+void CD_Prefetch_Start(CDAccess *cd);
+void CD_Prefetch_Stop(void);
+bool CD_Prefetch_Read(uint stream, uint8 *dest, int lba, uint size);
@@ -23,6 +23,9 @@ SRC += $(GEO)/debug.c $(GEO)/emu.c $(GEO)/fileio.c $(GEO)/mame_layer.c \
 $(GEO)/memory.c $(GEO)/neoboot.c $(GEO)/neocrypt.c $(GEO)/pd4990a.c $(GEO)/resfile.c $(GEO)/roms.c $(GEO)/state.c \
 $(GEO)/timer.c $(GEO)/video.c $(GEO)/unzip.c
 
+# decompress .gno sprite banks on a background thread
+CPPFLAGS += -DUSE_SPRITE_CACHE_THREAD
+
 ifeq ($(ENV), webos)
  LDLIBS += -lpthread
 endif
@@ -80,6 +80,9 @@
 /* Define to 1 if you have the `pow' function. */
 #define HAVE_POW 1
 
+/* Define to 1 if you have the <pthread.h> header file. */
+#define HAVE_PTHREAD_H 1
+
 /* Define to 1 if you have the `scandir' function. */
 #define HAVE_SCANDIR 1
 
@@ -325,6 +325,10 @@ void main_frame(void) {
 	Uint32 cpu_z80_timeslice_interlace = cpu_z80_timeslice
 			/ (float) nb_interlace;
 
+	/* decompress upcoming sprite banks while the CPUs run */
+	if (!skip_this_frame)
+		prefetch_sprite_cache();
+
 	// run one frame
 	{
 		#ifndef ENABLE_940T
@@ -15,6 +15,13 @@
 #include <strings.h>
 #include <string.h>
 #include <stdbool.h>
+#include <unistd.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 #include "roms.h"
 #include "emu.h"
 #include "memory.h"
@@ -922,9 +929,15 @@ static int allocate_region(ROM_REGION *r, Uint32 size, int region) {
 
 static void free_region(ROM_REGION *r) {
 	DEBUG_LOG("Free Region %p %p %d", r, r->p, r->size);
+#ifdef HAVE_MMAP
+	if (r->mapped_size)
+		munmap(r->p, r->mapped_size);
+	else
+#endif
 	if (r->p)
 		free(r->p);
 	r->size = 0;
+	r->mapped_size = 0;
 	r->p = NULL;
 }
 
@@ -1560,6 +1573,100 @@ int dr_load_game(char *name) {
 
 #if defined(HAVE_LIBZ)//&& defined (HAVE_MMAP)
 
+/* .gno v2 differs from v1 in:
+ * - uncompressed regions are preceded by their adler32 and aligned to
+ *   GNO_ALIGN in the file so they can be mapped directly
+ * - the sprite region is compressed at the fastest zlib level, blocks that
+ *   don't compress are stored as is, and the block table holds the
+ *   compressed size and adler32 of every block */
+#define GNO_ID_V1 "gnodmpv1"
+#define GNO_ID_V2 "gnodmpv2"
+#define GNO_ALIGN 4096
+#define GNO_BATCH_BLOCKS 1024
+#define GNO_MAX_THREADS 8
+
+static Uint32 gno_adler32(const Uint8 *data, Uint32 size) {
+	return adler32(adler32(0, NULL, 0), data, size);
+}
+
+static void gno_write_padding(FILE *gno) {
+	static const Uint8 zero[GNO_ALIGN];
+	long pos = ftell(gno);
+	if (pos % GNO_ALIGN)
+		fwrite(zero, GNO_ALIGN - pos % GNO_ALIGN, 1, gno);
+}
+
+typedef struct GNO_COMPRESS_JOB {
+	const Uint8 *in;
+	Uint8 *out;
+	uLongf out_stride;
+	Uint32 *out_len;
+	Uint32 *sum;
+	Uint32 block_size;
+	Uint32 first, count;
+}GNO_COMPRESS_JOB;
+
+static void *compress_blocks(void *arg) {
+	GNO_COMPRESS_JOB *job = arg;
+	Uint32 i;
+
+	for (i = job->first; i < job->first + job->count; i++) {
+		const Uint8 *in = job->in + i * job->block_size;
+		Uint8 *out = job->out + i * job->out_stride;
+		uLongf len = job->out_stride;
+
+		job->sum[i] = gno_adler32(in, job->block_size);
+		if (compress2(out, &len, in, job->block_size, Z_BEST_SPEED) != Z_OK
+				|| len >= job->block_size) {
+			memcpy(out, in, job->block_size);
+			len = job->block_size;
+		}
+		job->out_len[i] = len;
+	}
+	return NULL;
+}
+
+static int gno_thread_count(void) {
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpus < 1)
+		return 1;
+	return cpus > GNO_MAX_THREADS ? GNO_MAX_THREADS : cpus;
+}
+
+/* Compress count blocks, splitting them between the available cores */
+static void compress_batch(GNO_COMPRESS_JOB *base, Uint32 count, int threads) {
+	GNO_COMPRESS_JOB job[GNO_MAX_THREADS];
+#ifdef HAVE_PTHREAD_H
+	pthread_t thread[GNO_MAX_THREADS];
+	int started[GNO_MAX_THREADS] = {0};
+#endif
+	Uint32 per_job = (count + threads - 1) / threads;
+	Uint32 first = 0;
+	int i, jobs = 0;
+
+	for (i = 0; i < threads && first < count; i++) {
+		job[i] = *base;
+		job[i].first = first;
+		job[i].count = (count - first < per_job) ? count - first : per_job;
+		first += job[i].count;
+		jobs++;
+	}
+#ifdef HAVE_PTHREAD_H
+	for (i = 1; i < jobs; i++)
+		started[i] = pthread_create(&thread[i], NULL, compress_blocks, &job[i]) == 0;
+#endif
+	compress_blocks(&job[0]);
+	for (i = 1; i < jobs; i++) {
+#ifdef HAVE_PTHREAD_H
+		if (started[i]) {
+			pthread_join(thread[i], NULL);
+			continue;
+		}
+#endif
+		compress_blocks(&job[i]);
+	}
+}
+
 static int dump_region(FILE *gno, const ROM_REGION *rom, Uint8 id, Uint8 type,
 		Uint32 block_size, uint verbose) {
 	if (rom->p == NULL)
@@ -1568,21 +1675,19 @@ static int dump_region(FILE *gno, const ROM_REGION *rom, Uint8 id, Uint8 type,
 	fwrite(&id, sizeof (Uint8), 1, gno);
 	fwrite(&type, sizeof (Uint8), 1, gno);
 	if (type == 0) {
+		Uint32 sum = gno_adler32(rom->p, rom->size);
 		if(verbose) logMsg("Dump %d %08x", id, rom->size);
+		fwrite(&sum, sizeof (Uint32), 1, gno);
+		gno_write_padding(gno);
 		fwrite(rom->p, rom->size, 1, gno);
 	} else {
 		Uint32 nb_block = rom->size / block_size;
-		Uint32 *block_offset;
-		Uint32 cur_offset = 0;
+		Uint32 *block_offset, *block_size_tbl, *block_sum;
 		long offset_pos;
-		Uint32 i;
-		const Uint8 *inbuf = rom->p;
-		Uint8 *outbuf;
-		uLongf outbuf_len;
-		uLongf outlen;
-		Uint32 outlen32;
+		Uint32 i, j;
 		Uint32 cmpsize = 0;
-		int rc;
+		int threads = gno_thread_count();
+		GNO_COMPRESS_JOB job;
 		if(verbose) logMsg("nb_block=%d", nb_block);
 		fwrite(&block_size, sizeof (Uint32), 1, gno);
 		if ((rom->size & (block_size - 1)) != 0) {
@@ -1590,51 +1695,64 @@ static int dump_region(FILE *gno, const ROM_REGION *rom, Uint8 id, Uint8 type,
 					rom->size, block_size);
 		}
 		block_offset = malloc(nb_block * sizeof (Uint32));
-		/* Zlib compress output buffer need to be at least the size
-		 of inbuf + 0.1% + 12 byte */
-		outbuf_len = compressBound(block_size);
-		outbuf = malloc(outbuf_len);
+		block_size_tbl = malloc(nb_block * sizeof (Uint32));
+		block_sum = malloc(nb_block * sizeof (Uint32));
+		job.block_size = block_size;
+		job.out_stride = compressBound(block_size);
+		job.out = malloc(job.out_stride * GNO_BATCH_BLOCKS);
+		if (!block_offset || !block_size_tbl || !block_sum || !job.out) {
+			free(block_offset);
+			free(block_size_tbl);
+			free(block_sum);
+			free(job.out);
+			return false;
+		}
 		offset_pos = ftell(gno);
-		fseek(gno, nb_block * 4 + 4, SEEK_CUR); /* Skip all the offset table + the total compressed size */
-
-		for (i = 0; i < nb_block; i++) {
-			cur_offset = ftell(gno);
-			block_offset[i] = cur_offset;
-			outlen = outbuf_len;
-			rc = compress(outbuf, &outlen, inbuf, block_size);
-			if(verbose) logMsg("%d %ld", rc, outlen);
-			//cur_offset += outlen;
-			cmpsize += outlen;
-			if(verbose) logMsg("cmpsize=%d %ld", cmpsize, (long int)sizeof (uLongf));
-			inbuf += block_size;
-			outlen32 = (Uint32) outlen;
-			fwrite(&outlen32, sizeof (Uint32), 1, gno);
-			if(verbose) logMsg("bank %d outlen=%d offset=%d", i, outlen32, cur_offset);
-			fwrite(outbuf, outlen, 1, gno);
+		/* Skip the block tables + the total compressed size */
+		fseek(gno, nb_block * 3 * sizeof (Uint32) + sizeof (Uint32), SEEK_CUR);
+
+		for (i = 0; i < nb_block; i += GNO_BATCH_BLOCKS) {
+			Uint32 count = nb_block - i < GNO_BATCH_BLOCKS ? nb_block - i : GNO_BATCH_BLOCKS;
+			job.in = rom->p + i * block_size;
+			job.out_len = block_size_tbl + i;
+			job.sum = block_sum + i;
+			compress_batch(&job, count, threads);
+			for (j = 0; j < count; j++) {
+				block_offset[i + j] = ftell(gno);
+				fwrite(job.out + j * job.out_stride, block_size_tbl[i + j], 1, gno);
+				cmpsize += block_size_tbl[i + j];
+			}
 		}
-		free(outbuf);
-		/* Now, write the offset table */
+		free(job.out);
+		if(verbose) logMsg("cmpsize=%d with %d threads", cmpsize, threads);
+		/* Now, write the block tables */
 		fseek(gno, offset_pos, SEEK_SET);
 		fwrite(block_offset, sizeof (Uint32), nb_block, gno);
+		fwrite(block_size_tbl, sizeof (Uint32), nb_block, gno);
+		fwrite(block_sum, sizeof (Uint32), nb_block, gno);
 		free(block_offset);
+		free(block_size_tbl);
+		free(block_sum);
 		fwrite(&cmpsize, sizeof (Uint32), 1, gno);
-		if(verbose) logMsg("cmpsize=%d", cmpsize);
 		fseek(gno, 0, SEEK_END);
-		offset_pos = ftell(gno);
-		if(verbose) logMsg("currpos=%li", offset_pos);
 	}
 	return true;
 }
 
 int dr_save_gno(GAME_ROMS *r, char *filename) {
 	FILE *gno;
-	char *fid = "gnodmpv1";
+	char *fid = GNO_ID_V2;
 	char fname[9];
+	char *tmpname;
 	Uint8 nb_sec = 0;
 	int i;
+	int ok;
 
 	gn_init_pbar(PBAR_ACTION_SAVEGNO, 4);
-	gno = fopen(filename, "wb");
+	/* write to a temporary file so an interrupted dump can't be loaded */
+	tmpname = alloca(strlen(filename) + 5);
+	sprintf(tmpname, "%s.tmp", filename);
+	gno = fopen(tmpname, "wb");
 	if (!gno)
 		return false;
 
@@ -1696,14 +1814,61 @@ int dr_save_gno(GAME_ROMS *r, char *filename) {
 	gn_update_pbar(3);
 	/* TODO, there is a bug in the loading routine, only one compressed (type 1)
 	 * region can be present at the end of the file */
-	dump_region(gno, &r->tiles, REGION_SPRITES, 1, 4096, 0);
-
+	if (r->tiles.p && !dump_region(gno, &r->tiles, REGION_SPRITES, 1, 4096, 0)) {
+		fclose(gno);
+		remove(tmpname);
+		return false;
+	}
 
-	fclose(gno);
+	ok = !ferror(gno);
+	if (fclose(gno) != 0)
+		ok = false;
+	if (!ok || rename(tmpname, filename) != 0) {
+		logErr("error writing %s", filename);
+		remove(tmpname);
+		return false;
+	}
 	return true;
 }
 
-int read_region(FILE *gno, GAME_ROMS *roms) {
+/* Map an uncompressed region straight from the file, returns NULL if the
+ * offset isn't page aligned or mmap isn't available */
+static Uint8 *map_region(FILE *gno, long offset, Uint32 size) {
+#ifdef HAVE_MMAP
+	void *p;
+	long page_size = sysconf(_SC_PAGESIZE);
+
+	if (page_size <= 0 || offset % page_size)
+		return NULL;
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(gno), offset);
+	if (p == MAP_FAILED)
+		return NULL;
+	return p;
+#else
+	return NULL;
+#endif
+}
+
+static int can_map_region(int lid) {
+	switch (lid) {
+		case REGION_MAIN_CPU_CARTRIDGE:
+		case REGION_AUDIO_CPU_CARTRIDGE:
+		case REGION_AUDIO_DATA_1:
+		case REGION_AUDIO_DATA_2:
+		case REGION_FIXED_LAYER_CARTRIDGE:
+#ifdef GP2X
+			/* these need to live in the 940T shared memory */
+			return false;
+#else
+			return true;
+#endif
+		default:
+			/* usage tables may be free()'d directly */
+			return false;
+	}
+}
+
+static int read_region(FILE *gno, GAME_ROMS *roms, int version, long file_size) {
 	Uint32 size;
 	Uint8 lid, type;
 	ROM_REGION *r = NULL;
@@ -1715,6 +1880,8 @@ int read_region(FILE *gno, GAME_ROMS *roms) {
 	totread = fread(&size, sizeof (Uint32), 1, gno);
 	totread += fread(&lid, sizeof (Uint8), 1, gno);
 	totread += fread(&type, sizeof (Uint8), 1, gno);
+	if (totread != 3)
+		return false;
 
 	switch (lid) {
 		case REGION_MAIN_CPU_CARTRIDGE:
@@ -1754,25 +1921,72 @@ int read_region(FILE *gno, GAME_ROMS *roms) {
 
 	logMsg("Read region %d %08X type %d\n", lid, size, type);
 	if (type == 0) {
-		/* TODO: Support ADPCM streaming for platform with less that 64MB of Mem */
-		allocate_region(r, size, lid);
-		logMsg("Load %d %08x\n", lid, r->size);
-		totread += fread(r->p, r->size, 1, gno);
+		Uint32 sum = 0;
+		long offset;
+		if (version == 2) {
+			if (fread(&sum, sizeof (Uint32), 1, gno) != 1)
+				return false;
+			offset = ftell(gno);
+			if (offset % GNO_ALIGN)
+				offset += GNO_ALIGN - offset % GNO_ALIGN;
+		} else
+			offset = ftell(gno);
+		if (offset + (long)size > file_size)
+			return false;
+		if (version == 2 && can_map_region(lid)
+				&& (r->p = map_region(gno, offset, size)) != NULL) {
+			logMsg("Map %d %08x\n", lid, size);
+			r->size = size;
+			r->mapped_size = size;
+			fseek(gno, offset + size, SEEK_SET);
+		} else {
+			/* TODO: Support ADPCM streaming for platform with less that 64MB of Mem */
+			allocate_region(r, size, lid);
+			logMsg("Load %d %08x\n", lid, r->size);
+			fseek(gno, offset, SEEK_SET);
+			if (size && fread(r->p, r->size, 1, gno) != 1)
+				return false;
+		}
+		if (version == 2 && gno_adler32(r->p, r->size) != sum) {
+			logErr("region %d failed checksum", lid);
+			return false;
+		}
 	} else {
+		GFX_CACHE *gcache = &memory.vid.spr_cache;
 		Uint32 nb_block, block_size;
 		Uint32 cmp_size;
-		totread += fread(&block_size, sizeof (Uint32), 1, gno);
+		totread = fread(&block_size, sizeof (Uint32), 1, gno);
+		if (totread != 1 || block_size == 0)
+			return false;
 		nb_block = size / block_size;
 
 		logMsg("Region size=%08X\n", size);
 		r->size = size;
 
 
-		memory.vid.spr_cache.offset = malloc(sizeof (Uint32) * nb_block);
-		totread += fread(memory.vid.spr_cache.offset, sizeof (Uint32), nb_block, gno);
-		memory.vid.spr_cache.gno = gno;
+		gcache->offset = malloc(sizeof (Uint32) * nb_block);
+		totread = fread(gcache->offset, sizeof (Uint32), nb_block, gno);
+		if (version == 2) {
+			gcache->cmp_size = malloc(sizeof (Uint32) * nb_block);
+			gcache->checksum = malloc(sizeof (Uint32) * nb_block);
+			totread += fread(gcache->cmp_size, sizeof (Uint32), nb_block, gno);
+			totread += fread(gcache->checksum, sizeof (Uint32), nb_block, gno);
+			if (totread != nb_block * 3)
+				return false;
+			/* catch truncated files now rather than when the bank is used */
+			for (i = 0; i < nb_block; i++) {
+				if (gcache->cmp_size[i] > block_size ||
+						(long)gcache->offset[i] + gcache->cmp_size[i] > file_size) {
+					logErr("sprite bank %d is out of bounds", i);
+					return false;
+				}
+			}
+		} else if (totread != nb_block)
+			return false;
+		gcache->gno = gno;
 
-		totread += fread(&cmp_size, sizeof (Uint32), 1, gno);
+		if (fread(&cmp_size, sizeof (Uint32), 1, gno) != 1)
+			return false;
 
 		fseek(gno, cmp_size, SEEK_CUR);
 
@@ -1787,13 +2001,23 @@ int read_region(FILE *gno, GAME_ROMS *roms) {
 	return true;
 }
 
+static int gno_version(const char *fid) {
+	if (strncmp(fid, GNO_ID_V2, 8) == 0)
+		return 2;
+	if (strncmp(fid, GNO_ID_V1, 8) == 0)
+		return 1;
+	return 0;
+}
+
 int dr_open_gno(char *filename) {
 	FILE *gno;
-	char fid[9]; // = "gnodmpv1";
+	char fid[9]; // = "gnodmpv2";
 	char name[9] = {0,};
 	GAME_ROMS *r = &memory.rom;
 	Uint8 nb_sec;
 	int i;
+	int version;
+	long file_size;
 	char *a;
 	size_t totread = 0;
 
@@ -1809,9 +2033,13 @@ int dr_open_gno(char *filename) {
 		sprintf(romerror, "Can't open %s", filename);
 		return false;
 	}
+	fseek(gno, 0, SEEK_END);
+	file_size = ftell(gno);
+	fseek(gno, 0, SEEK_SET);
 
 	totread += fread(fid, 8, 1, gno);
-	if (strncmp(fid, "gnodmpv1", 8) != 0) {
+	version = gno_version(fid);
+	if (!version) {
 		fclose(gno);
 		sprintf(romerror, "Invalid GNO file");
 		return false;
@@ -1827,7 +2055,15 @@ int dr_open_gno(char *filename) {
 	gn_init_pbar(PBAR_ACTION_LOADGNO, nb_sec);
 	for (i = 0; i < nb_sec; i++) {
 		gn_update_pbar(i);
-		read_region(gno, r);
+		if (!read_region(gno, r, version, file_size)) {
+			gn_terminate_pbar();
+			sprintf(romerror, "GNO file is truncated or corrupt");
+			if (!memory.vid.spr_cache.gno)
+				fclose(gno);
+			memory.fix_game_usage = r->gfix_usage.p;
+			dr_free_roms(r);
+			return false;
+		}
 	}
 	gn_terminate_pbar();
 
@@ -1835,7 +2071,9 @@ int dr_open_gno(char *filename) {
 		r->adpcmb.p = r->adpcma.p;
 		r->adpcmb.size = r->adpcma.size;
 	}
-	//fclose(gno);
+	/* Keep the file open for the sprite cache, mapped regions don't need it */
+	if (!memory.vid.spr_cache.gno)
+		fclose(gno);
 
 	memory.fix_game_usage = r->gfix_usage.p;
 	/*	memory.pen_usage = malloc((r->tiles.size >> 11) * sizeof(Uint32));
@@ -1860,7 +2098,7 @@ int dr_open_gno(char *filename) {
 
 char *dr_gno_romname(char *filename) {
 	FILE *gno;
-	char fid[9]; // = "gnodmpv1";
+	char fid[9]; // = "gnodmpv2";
 	char name[9] = {0,};
 	size_t totread = 0;
 
@@ -1869,7 +2107,7 @@ char *dr_gno_romname(char *filename) {
 		return NULL;
 
 	totread += fread(fid, 8, 1, gno);
-	if (strncmp(fid, "gnodmpv1", 8) != 0) {
+	if (!gno_version(fid)) {
 		fclose(gno);
 		logMsg("Invalid GNO file");
 		return NULL;
@@ -1900,10 +2138,18 @@ void dr_free_roms(GAME_ROMS *r) {
 		logMsg("Free tiles\n");
 		free_region(&r->tiles);
 	} else {
-		fclose(memory.vid.spr_cache.gno);
 		free_sprite_cache();
-		free(memory.vid.spr_cache.offset);
 	}
+	if (memory.vid.spr_cache.gno) {
+		fclose(memory.vid.spr_cache.gno);
+		memory.vid.spr_cache.gno = NULL;
+	}
+	free(memory.vid.spr_cache.offset);
+	free(memory.vid.spr_cache.cmp_size);
+	free(memory.vid.spr_cache.checksum);
+	memory.vid.spr_cache.offset = NULL;
+	memory.vid.spr_cache.cmp_size = NULL;
+	memory.vid.spr_cache.checksum = NULL;
 	free_region(&r->game_sfix);
 
 #ifndef ENABLE_940T
@@ -1924,6 +2170,10 @@ void dr_free_roms(GAME_ROMS *r) {
 
 	free(memory.ng_lo);
 	free(memory.fix_game_usage);
+	memory.ng_lo = NULL;
+	memory.fix_game_usage = NULL;
+	r->gfix_usage.p = NULL;
+	r->gfix_usage.size = 0;
 	free_region(&r->spr_usage);
 
 	//free(r->info.name);
@@ -50,6 +50,7 @@ typedef struct GAME_INFO {
 typedef struct ROM_REGION {
 	Uint8* p;
 	Uint32 size;
+	Uint32 mapped_size; /* non-zero if p is mapped from a .gno file */
 }ROM_REGION;
 
 
@@ -23,6 +23,9 @@
 #include <string.h>
 #include <stdlib.h>
 #include <zlib.h>
+#ifdef USE_SPRITE_CACHE_THREAD
+#include <pthread.h>
+#endif
 #include "video.h"
 #include "memory.h"
 #include "emu.h"
@@ -132,14 +135,201 @@ static Uint16 fix_addr[40][32];
 static Uint8 fix_shift[40];
 
 
+#ifdef USE_SPRITE_CACHE_THREAD
+/* Banks referenced by the sprite list are decompressed by a background
+ * thread while the next frame is emulated. Only the render thread changes
+ * the cache layout: it reserves a slot for each prefetched bank and
+ * publishes gcache->ptr[bank] once the thread has filled it. */
+#define PREFETCH_MAX 64
+
+enum {
+	PREFETCH_FREE = 0,
+	PREFETCH_QUEUED,
+	PREFETCH_LOADING,
+	PREFETCH_DONE
+};
+
+typedef struct {
+	int bank;
+	int slot;
+	int state;
+} PREFETCH_REQ;
+
+static PREFETCH_REQ prefetch_req[PREFETCH_MAX];
+static int prefetch_pending;
+static int prefetch_quit;
+static int prefetch_running;
+static pthread_t prefetch_thread;
+static pthread_mutex_t prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t prefetch_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t prefetch_done = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t gno_lock = PTHREAD_MUTEX_INITIALIZER;
+static Uint8 *prefetch_in_buf;
+#endif
+
+static void load_sprite_bank(GFX_CACHE *gcache, int bank, int slot, Uint8 *in_buf) {
+	Uint8 *dst = gcache->data + slot * gcache->slot_size;
+	Uint32 cmp_size;
+	uLongf dst_size;
+	int r;
+
+#ifdef USE_SPRITE_CACHE_THREAD
+	pthread_mutex_lock(&gno_lock);
+#endif
+	fseek(gcache->gno, gcache->offset[bank], SEEK_SET);
+	if (gcache->cmp_size) {
+		cmp_size = gcache->cmp_size[bank];
+		/* stored banks are read straight into the cache */
+		r = fread(cmp_size == gcache->slot_size ? dst : in_buf, cmp_size, 1, gcache->gno);
+	} else {
+		r = fread(&cmp_size, sizeof (Uint32), 1, gcache->gno);
+		r = fread(in_buf, cmp_size, 1, gcache->gno);
+	}
+#ifdef USE_SPRITE_CACHE_THREAD
+	pthread_mutex_unlock(&gno_lock);
+#endif
+	if (!gcache->cmp_size || cmp_size != gcache->slot_size) {
+		dst_size = gcache->slot_size;
+		r = uncompress(dst, &dst_size, in_buf, cmp_size);
+	}
+	if (gcache->checksum &&
+			adler32(adler32(0, NULL, 0), dst, gcache->slot_size) != gcache->checksum[bank]) {
+		logErr("sprite bank %d failed checksum, .gno file may be corrupt", bank);
+		memset(dst, 0, gcache->slot_size);
+	}
+}
+
+/* CLOCK replacement: skip (and clear) recently used banks */
+static int find_free_slot(GFX_CACHE *gcache) {
+	for (;;) {
+		int slot = gcache->hand;
+		int bank = gcache->usage[slot];
+
+		if (++gcache->hand >= gcache->max_slot) gcache->hand = 0;
+		if (bank == -1)
+			return slot;
+		if (!gcache->ptr[bank]) /* still being prefetched */
+			continue;
+		if (gcache->ref[bank]) {
+			gcache->ref[bank] = 0;
+			continue;
+		}
+		gcache->ptr[bank] = 0;
+		gcache->usage[slot] = -1;
+		return slot;
+	}
+}
+
+#ifdef USE_SPRITE_CACHE_THREAD
+static void *prefetch_thread_func(void *arg) {
+	GFX_CACHE *gcache = &memory.vid.spr_cache;
+	int i;
+
+	pthread_mutex_lock(&prefetch_lock);
+	while (!prefetch_quit) {
+		PREFETCH_REQ *req = NULL;
+
+		for (i = 0; i < PREFETCH_MAX; i++) {
+			if (prefetch_req[i].state == PREFETCH_QUEUED) {
+				req = &prefetch_req[i];
+				break;
+			}
+		}
+		if (!req) {
+			pthread_cond_wait(&prefetch_work, &prefetch_lock);
+			continue;
+		}
+		req->state = PREFETCH_LOADING;
+		pthread_mutex_unlock(&prefetch_lock);
+		load_sprite_bank(gcache, req->bank, req->slot, prefetch_in_buf);
+		pthread_mutex_lock(&prefetch_lock);
+		req->state = PREFETCH_DONE;
+		gcache->prefetch++;
+		pthread_cond_broadcast(&prefetch_done);
+	}
+	pthread_mutex_unlock(&prefetch_lock);
+	return NULL;
+}
+
+static void install_prefetched_bank(GFX_CACHE *gcache, PREFETCH_REQ *req) {
+	gcache->ptr[req->bank] = gcache->data + req->slot * gcache->slot_size;
+	req->state = PREFETCH_FREE;
+	prefetch_pending--;
+}
+
+/* Publish finished banks, called with prefetch_lock held */
+static void install_prefetched_banks(GFX_CACHE *gcache) {
+	int i;
+
+	for (i = 0; i < PREFETCH_MAX && prefetch_pending; i++) {
+		if (prefetch_req[i].state == PREFETCH_DONE)
+			install_prefetched_bank(gcache, &prefetch_req[i]);
+	}
+}
+
+/* Wait for the thread and drop everything it had queued */
+static void flush_prefetch(GFX_CACHE *gcache) {
+	int i;
+
+	pthread_mutex_lock(&prefetch_lock);
+	for (i = 0; i < PREFETCH_MAX; i++) {
+		PREFETCH_REQ *req = &prefetch_req[i];
+
+		while (req->state == PREFETCH_LOADING)
+			pthread_cond_wait(&prefetch_done, &prefetch_lock);
+		if (req->state != PREFETCH_FREE) {
+			gcache->usage[req->slot] = -1;
+			req->state = PREFETCH_FREE;
+		}
+	}
+	prefetch_pending = 0;
+	pthread_mutex_unlock(&prefetch_lock);
+}
+
+static void start_prefetch_thread(Uint32 bsize) {
+	prefetch_in_buf = malloc(compressBound(bsize));
+	if (prefetch_in_buf == NULL)
+		return;
+	prefetch_quit = 0;
+	prefetch_pending = 0;
+	memset(prefetch_req, 0, sizeof (prefetch_req));
+	if (pthread_create(&prefetch_thread, NULL, prefetch_thread_func, NULL) != 0) {
+		logMsg("error creating sprite prefetch thread\n");
+		free(prefetch_in_buf);
+		prefetch_in_buf = NULL;
+		return;
+	}
+	prefetch_running = 1;
+}
+
+static void stop_prefetch_thread(void) {
+	if (!prefetch_running)
+		return;
+	pthread_mutex_lock(&prefetch_lock);
+	prefetch_quit = 1;
+	pthread_cond_signal(&prefetch_work);
+	pthread_mutex_unlock(&prefetch_lock);
+	pthread_join(prefetch_thread, NULL);
+	prefetch_running = 0;
+	free(prefetch_in_buf);
+	prefetch_in_buf = NULL;
+}
+#endif
+
 int init_sprite_cache(Uint32 size, Uint32 bsize) {
 	GFX_CACHE *gcache = &memory.vid.spr_cache;
 	int i;
 
 	if (gcache->data != NULL) { /* We allready have a cache, just reset it */
+#ifdef USE_SPRITE_CACHE_THREAD
+		if (prefetch_running)
+			flush_prefetch(gcache);
+#endif
 		memset(gcache->ptr, 0, gcache->total_bank * sizeof (Uint8*));
+		memset(gcache->ref, 0, gcache->total_bank);
 		for (i = 0; i < gcache->max_slot; i++)
 			gcache->usage[i] = -1;
+		gcache->hand = 0;
 		return 0;
 	}
 
@@ -152,11 +342,17 @@ int init_sprite_cache(Uint32 size, Uint32 bsize) {
 		return 1;
 	//gcache->z_pos=malloc(gcache->total_bank*sizeof(unz_file_pos ));
 	memset(gcache->ptr, 0, gcache->total_bank * sizeof (Uint8*));
+	gcache->ref = calloc(gcache->total_bank, 1);
+	if (gcache->ref == NULL) {
+		free(gcache->ptr);
+		return 1;
+	}
 
 	gcache->size = size;
 	gcache->data = malloc(gcache->size);
 	if (gcache->data == NULL) {
 		free(gcache->ptr);
+		free(gcache->ref);
 		return 1;
 	}
 	logMsg("INIT CACHE %p\n", gcache->data);
@@ -169,18 +365,28 @@ int init_sprite_cache(Uint32 size, Uint32 bsize) {
 	gcache->usage = malloc(gcache->max_slot * sizeof (Uint32));
 	for (i = 0; i < gcache->max_slot; i++)
 		gcache->usage[i] = -1;
+	gcache->hand = 0;
+	gcache->hit = gcache->miss = gcache->stall = gcache->prefetch = 0;
 	//printf("inbuf size= %d\n",compressBound(bsize));
 #ifdef WIZ
 	gcache->in_buf = malloc(bsize + 1024);
 #else
 	gcache->in_buf = malloc(compressBound(bsize));
+#endif
+#ifdef USE_SPRITE_CACHE_THREAD
+	start_prefetch_thread(bsize);
 #endif
 	return 0;
 }
 
 void free_sprite_cache(void) {
 	GFX_CACHE *gcache = &memory.vid.spr_cache;
+#ifdef USE_SPRITE_CACHE_THREAD
+	stop_prefetch_thread();
+#endif
 	if (gcache->data) {
+		logMsg("sprite cache: %u hits, %u misses, %u stalls, %u prefetched\n",
+			gcache->hit, gcache->miss, gcache->stall, gcache->prefetch);
 		free(gcache->data);
 		gcache->data = NULL;
 	}
@@ -188,6 +394,10 @@ void free_sprite_cache(void) {
 		free(gcache->ptr);
 		gcache->ptr = NULL;
 	}
+	if (gcache->ref) {
+		free(gcache->ref);
+		gcache->ref = NULL;
+	}
 	if (gcache->usage) {
 		free(gcache->usage);
 		gcache->usage = NULL;
@@ -200,41 +410,136 @@ void free_sprite_cache(void) {
 
 Uint8 *get_cached_sprite_ptr(Uint32 tileno) {
 	GFX_CACHE *gcache = &memory.vid.spr_cache;
-	static int pos = 0;
-	static int init = 1;
 	int tile_sh = ~((gcache->slot_size >> 7) - 1);
 
 	int bank = ((tileno & tile_sh) / (gcache->slot_size >> 7));
 	int a;
-	int r;
-	Uint32 cmp_size;
-	uLongf dst_size;
 
+	gcache->ref[bank] = 1;
 	if (gcache->ptr[bank]) {
 		/* The bank is present in the cache */
+		gcache->hit++;
 		return gcache->ptr[bank];
 	}
+#ifdef USE_SPRITE_CACHE_THREAD
+	if (prefetch_pending) {
+		int i;
+
+		pthread_mutex_lock(&prefetch_lock);
+		for (i = 0; i < PREFETCH_MAX; i++) {
+			PREFETCH_REQ *req = &prefetch_req[i];
+
+			if (req->state == PREFETCH_FREE || req->bank != bank)
+				continue;
+			if (req->state == PREFETCH_QUEUED) {
+				/* not started yet, faster to load it here */
+				req->state = PREFETCH_LOADING;
+				pthread_mutex_unlock(&prefetch_lock);
+				load_sprite_bank(gcache, bank, req->slot, gcache->in_buf);
+				pthread_mutex_lock(&prefetch_lock);
+				req->state = PREFETCH_DONE;
+				gcache->miss++;
+			} else if (req->state == PREFETCH_LOADING) {
+				gcache->stall++;
+				while (req->state == PREFETCH_LOADING)
+					pthread_cond_wait(&prefetch_done, &prefetch_lock);
+			}
+			install_prefetched_bank(gcache, req);
+			break;
+		}
+		install_prefetched_banks(gcache);
+		pthread_mutex_unlock(&prefetch_lock);
+		if (gcache->ptr[bank])
+			return gcache->ptr[bank];
+	}
+#endif
 	/* We have to find a slot for this bank */
-	a = pos;
-	pos++;
-	if (pos >= gcache->max_slot) pos = 0;
+	gcache->miss++;
+	a = find_free_slot(gcache);
 	//printf("Offset for bank is %d\n",gcache->offset[bank]);
 
-	fseek(gcache->gno, gcache->offset[bank], SEEK_SET);
-	r = fread(&cmp_size, sizeof (Uint32), 1, gcache->gno);
-	r = fread(gcache->in_buf, cmp_size, 1, gcache->gno);
-	dst_size = gcache->slot_size;
-	r = uncompress(gcache->data + a * gcache->slot_size, &dst_size, gcache->in_buf, cmp_size);
+	load_sprite_bank(gcache, bank, a, gcache->in_buf);
 
 	gcache->ptr[bank] = gcache->data + a * gcache->slot_size;
-
-	if (gcache->usage[a] != -1) {
-		gcache->ptr[gcache->usage[a]] = 0;
-	}
 	gcache->usage[a] = bank;
 	return gcache->ptr[bank];
 }
 
+/* Queue the banks used by the current sprite list so they're ready
+ * by the time the frame is drawn */
+void prefetch_sprite_cache(void) {
+#ifdef USE_SPRITE_CACHE_THREAD
+	GFX_CACHE *gcache = &memory.vid.spr_cache;
+	Uint8 *vidram = memory.vid.ram;
+	int tiles_per_bank = gcache->slot_size >> 7;
+	int max_pending;
+	unsigned int count, y, my = 0;
+	int queued = 0;
+	int free_req = 0;
+
+	if (!gcache->data || !prefetch_running)
+		return;
+
+	/* leave most of the cache to banks already in use */
+	max_pending = gcache->max_slot / 4;
+	if (max_pending > PREFETCH_MAX) max_pending = PREFETCH_MAX;
+
+	pthread_mutex_lock(&prefetch_lock);
+	install_prefetched_banks(gcache);
+	for (count = 0; count < 0x300; count += 2) {
+		unsigned int t1 = READ_WORD(&vidram[0x10400 + count]);
+		unsigned int offs = count << 6;
+
+		if (!(t1 & 0x40)) {
+			my = t1 & 0x3f;
+			if (my > 0x20) my = 0x20;
+		}
+		for (y = 0; y < my; y++, offs += 4) {
+			unsigned int tileno = READ_WORD(&vidram[offs]);
+			unsigned int tileatr = READ_WORD(&vidram[offs + 2]);
+			unsigned int bank;
+
+			if (memory.nb_of_tiles > 0x10000 && tileatr & 0x10) tileno += 0x10000;
+			if (memory.nb_of_tiles > 0x20000 && tileatr & 0x20) tileno += 0x20000;
+			if (memory.nb_of_tiles > 0x40000 && tileatr & 0x40) tileno += 0x40000;
+			bank = tileno / tiles_per_bank;
+			if (bank >= gcache->total_bank)
+				continue;
+			if (gcache->ptr[bank]) {
+				/* keep it around for this frame */
+				gcache->ref[bank] = 1;
+				continue;
+			}
+			if (prefetch_pending >= max_pending)
+				continue;
+			{
+				int i, slot;
+
+				for (i = 0; i < PREFETCH_MAX; i++) {
+					if (prefetch_req[i].state != PREFETCH_FREE && prefetch_req[i].bank == bank)
+						break;
+				}
+				if (i != PREFETCH_MAX)
+					continue; /* already queued */
+				while (prefetch_req[free_req].state != PREFETCH_FREE)
+					free_req++;
+				slot = find_free_slot(gcache);
+				gcache->usage[slot] = bank;
+				gcache->ref[bank] = 1;
+				prefetch_req[free_req].bank = bank;
+				prefetch_req[free_req].slot = slot;
+				prefetch_req[free_req].state = PREFETCH_QUEUED;
+				prefetch_pending++;
+				queued = 1;
+			}
+		}
+	}
+	if (queued)
+		pthread_cond_signal(&prefetch_work);
+	pthread_mutex_unlock(&prefetch_lock);
+#endif
+}
+
 static void fix_value_init(void) {
 	int x, y;
 	for (x = 0; x < 40; x++) {
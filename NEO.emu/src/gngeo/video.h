@@ -35,10 +35,19 @@ typedef struct gfx_cache {
 	Uint8 **ptr/*[TOTAL_GFX_BANK]*/; /* ptr[i] Contain a pointer to cached data for bank i */
 	int max_slot; /* Maximal numer of bank that can be cached (depend on cache size) */
 	int slot_size;
-	int *usage;   /* contain index to the banks in used order */
+	int *usage;   /* usage[i] contain the bank cached in slot i, or -1 */
+	Uint8 *ref;   /* ref[i] is set when bank i was used since the clock hand last passed it */
+	int hand;     /* next slot considered for replacement */
 	FILE *gno;
     Uint32 *offset;
+    Uint32 *cmp_size; /* .gno v2 only: compressed size of each bank, equal to slot_size if stored */
+    Uint32 *checksum; /* .gno v2 only: adler32 of each uncompressed bank */
     Uint8* in_buf;
+	/* Statistics, useful to choose the cache size */
+	Uint32 hit;      /* bank was already in the cache */
+	Uint32 miss;     /* bank was decompressed in the render path */
+	Uint32 stall;    /* render path waited for the prefetch thread */
+	Uint32 prefetch; /* bank was decompressed ahead of time by the prefetch thread */
 }GFX_CACHE;
 
 typedef struct VIDEO {
@@ -81,5 +90,6 @@ void draw_screen(void);
 // void show_cache(void);
 int init_sprite_cache(Uint32 size,Uint32 bsize);
 void free_sprite_cache(void);
+void prefetch_sprite_cache(void);
 
 #endif
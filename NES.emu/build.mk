@@ -4,6 +4,10 @@ inc_main := 1
 include $(IMAGINE_PATH)/make/imagineAppBase.mk
 
 emuFramework_cheats := 1
+emuFramework_cheatSearch := 1
+emuFramework_rewind := 1
+emuFramework_runAhead := 1
+emuFramework_asyncState := 1
 include $(EMUFRAMEWORK_PATH)/common.mk
 
 SRC += main/Main.cc main/EmuControls.cc main/FceuApi.cc main/Cheats.cc
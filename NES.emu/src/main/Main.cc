@@ -16,6 +16,12 @@
 #define LOGTAG "main"
 #include <EmuSystem.hh>
 #include <CommonFrameworkIncludes.hh>
+#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+#include <AsyncStateWriter.hh>
+#endif
+#ifdef CONFIG_EMUFRAMEWORK_CHEAT_SEARCH
+#include <CheatSearch.hh>
+#endif
 
 const char *creditsViewStr = CREDITS_INFO_STRING "(c) 2011-2014\nRobert Broglia\nwww.explusalpha.com\n\nPortions (c) the\nFCEUX Team\nfceux.com";
 uint fceuCheats = 0;
@@ -280,16 +286,25 @@ int EmuSystem::saveState()
 	sprintStateFilename(saveStr, saveStateSlot);
 	if(Config::envIsIOSJB)
 		fixFilePermissions(saveStr);
+	#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+	return stateWriter.save(saveStr);
+	#else
 	if(!FCEUI_SaveState(saveStr))
 		return STATE_RESULT_IO_ERROR;
 	else
 		return STATE_RESULT_OK;
+	#endif
 }
 
 int EmuSystem::loadState(int saveStateSlot)
 {
 	FsSys::cPath saveStr;
 	sprintStateFilename(saveStr, saveStateSlot);
+	#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+	stateWriter.waitForIdle();
+	if(AsyncStateWriter::isCompressedState(saveStr))
+		return AsyncStateWriter::loadState(saveStr);
+	#endif
 	if(FsSys::fileExists(saveStr))
 	{
 		logMsg("loading state %s", saveStr);
@@ -302,6 +317,52 @@ int EmuSystem::loadState(int saveStateSlot)
 		return STATE_RESULT_NO_FILE;
 }
 
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+uint EmuSystem::saveStateToMemory(void *buff, uint size)
+{
+	EMUFILE_MEMORY ms;
+	if(!FCEUSS_SaveMS(&ms, 0))
+		return 0;
+	if((uint)ms.size() > size)
+		return 0;
+	memcpy(buff, ms.buf(), ms.size());
+	return ms.size();
+}
+
+int EmuSystem::loadStateFromMemory(const void *buff, uint size)
+{
+	EMUFILE_MEMORY ms((void*)buff, size);
+	if(!FCEUSS_LoadFP(&ms, SSLOADPARAM_NOBACKUP))
+		return STATE_RESULT_INVALID_DATA;
+	return STATE_RESULT_OK;
+}
+#endif
+
+#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+uint EmuSystem::saveStateFileToMemory(void *buff, uint size, bool &compressed)
+{
+	// same data FCEUI_SaveState() writes when no movie is active
+	EMUFILE_MEMORY ms;
+	if(!FCEUSS_SaveMS(&ms, -1))
+		return 0;
+	if((uint)ms.size() > size)
+		return 0;
+	memcpy(buff, ms.buf(), ms.size());
+	compressed = compressSavestates;
+	return ms.size();
+}
+#endif
+
+#ifdef CONFIG_EMUFRAMEWORK_CHEAT_SEARCH
+uint EmuSystem::cheatSearchRegions(CheatSearchRegion *region, uint max)
+{
+	if(!max)
+		return 0;
+	region[0] = {"RAM", RAM, 0, sizeof(RAM)};
+	return 1;
+}
+#endif
+
 void EmuSystem::saveBackupMem() // for manually saving when not closing game
 {
 	if(gameIsRunning())
@@ -324,7 +385,11 @@ void EmuSystem::saveAutoState()
 		sprintStateFilename(saveStr, -1);
 		if(Config::envIsIOSJB)
 			fixFilePermissions(saveStr);
+		#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+		stateWriter.save(saveStr, false);
+		#else
 		FCEUI_SaveState(saveStr);
+		#endif
 	}
 }
 
@@ -6,6 +6,9 @@ HIGH_OPTIMIZE_CFLAGS := -O3 $(HIGH_OPTIMIZE_CFLAGS_MISC)
 
 include $(IMAGINE_PATH)/make/imagineAppBase.mk
 
+emuFramework_rewind := 1
+emuFramework_runAhead := 1
+emuFramework_asyncState := 1
 include $(EMUFRAMEWORK_PATH)/common.mk
 
 SRC += main/Main.cc main/EmuControls.cc common/MDFNApi.cc main/PCEFast.cc
@@ -17,6 +17,9 @@
 #include "MDFN.hh"
 #include <EmuSystem.hh>
 #include <CommonFrameworkIncludes.hh>
+#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+#include <AsyncStateWriter.hh>
+#endif
 #include <mednafen/pce_fast/pce.h>
 #include <mednafen/pce_fast/vdc.h>
 
@@ -188,7 +191,11 @@ void EmuSystem::saveAutoState()
 		logMsg("saving autosave-state %s", statePath.c_str());
 		if(Config::envIsIOSJB)
 			fixFilePermissions(statePath.c_str());
+		#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+		stateWriter.save(statePath.c_str(), false);
+		#else
 		MDFNI_SaveState(statePath.c_str(), 0, 0, 0, 0);
+		#endif
 	}
 }
 
@@ -613,10 +620,14 @@ int EmuSystem::saveState()
 	logMsg("saving state %s", statePath.c_str());
 	if(Config::envIsIOSJB)
 		fixFilePermissions(statePath.c_str());
+	#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+	return stateWriter.save(statePath.c_str());
+	#else
 	if(!MDFNI_SaveState(statePath.c_str(), 0, 0, 0, 0))
 		return STATE_RESULT_IO_ERROR;
 	else
 		return STATE_RESULT_OK;
+	#endif
 }
 
 int EmuSystem::loadState(int saveStateSlot)
@@ -624,6 +635,11 @@ int EmuSystem::loadState(int saveStateSlot)
 	char ext[] = { "nc0" };
 	ext[2] = saveSlotChar(saveStateSlot);
 	std::string statePath = MDFN_MakeFName(MDFNMKF_STATE, 0, ext);
+	#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+	stateWriter.waitForIdle();
+	if(AsyncStateWriter::isCompressedState(statePath.c_str()))
+		return AsyncStateWriter::loadState(statePath.c_str());
+	#endif
 	if(FsSys::fileExists(statePath.c_str()))
 	{
 		logMsg("loading state %s", statePath.c_str());
@@ -635,6 +651,56 @@ int EmuSystem::loadState(int saveStateSlot)
 	return STATE_RESULT_NO_FILE;
 }
 
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+uint EmuSystem::saveStateToMemory(void *buff, uint size)
+{
+	StateMem st {};
+	st.initial_malloc = size;
+	if(!MDFNSS_SaveSM(&st, 0, 1) || st.len > size)
+	{
+		free(st.data);
+		return 0;
+	}
+	memcpy(buff, st.data, st.len);
+	free(st.data);
+	return st.len;
+}
+
+// rewind states are data-only, while ones from saveStateFileToMemory() have the full header
+static bool stateHasHeader(const void *buff, uint size)
+{
+	return size >= 32 && (!memcmp(buff, "MDFNSVST", 8) || !memcmp(buff, "MEDNAFENSVESTATE", 16));
+}
+
+int EmuSystem::loadStateFromMemory(const void *buff, uint size)
+{
+	StateMem st {};
+	st.data = (uint8*)buff;
+	st.len = size;
+	if(!MDFNSS_LoadSM(&st, 0, !stateHasHeader(buff, size)))
+		return STATE_RESULT_INVALID_DATA;
+	return STATE_RESULT_OK;
+}
+#endif
+
+#ifdef CONFIG_EMUFRAMEWORK_ASYNC_STATE
+uint EmuSystem::saveStateFileToMemory(void *buff, uint size, bool &compressed)
+{
+	// full header like MDFNI_SaveState() so the version is checked on load
+	StateMem st {};
+	st.initial_malloc = size;
+	if(!MDFNSS_SaveSM(&st, 0, 0) || st.len > size)
+	{
+		free(st.data);
+		return 0;
+	}
+	memcpy(buff, st.data, st.len);
+	free(st.data);
+	compressed = false;
+	return st.len;
+}
+#endif
+
 void EmuSystem::savePathChanged() { }
 
 namespace Base
@@ -34,9 +34,12 @@ ifeq ($(ARCH), arm)
   SRC += yabause/sh2_dynarec/linkage_arm.s yabause/sh2_dynarec/sh2_dynarec.c
  endif
 else ifeq ($(ARCH), x86_64)
- # TODO: x86_64 dynarec has 64/32-bit pointer conversion issues
- #CPPFLAGS += -DCPU_X64=1 -DUSE_DYNAREC=1 -DSH2_DYNAREC=1
- #SRC += yabause/sh2_dynarec/linkage_x64.s yabause/sh2_dynarec/sh2_dynarec.c
+ # x86_64 dynarec addresses its code cache and globals with 32-bit displacements,
+ # so link position-dependent to keep them in the low 2GB
+ CPPFLAGS += -DCPU_X64=1 -DUSE_DYNAREC=1 -DSH2_DYNAREC=1
+ COMPILE_FLAGS += -fno-pie
+ LDFLAGS += -no-pie
+ SRC += yabause/sh2_dynarec/linkage_x64.s yabause/sh2_dynarec/sh2_dynarec.c
 else ifeq ($(ARCH), x86)
  CPPFLAGS += -DCPU_X86=1 -DUSE_DYNAREC=1 -DSH2_DYNAREC=1
  SRC += yabause/sh2_dynarec/linkage_x86.s yabause/sh2_dynarec/sh2_dynarec.c
@@ -49,11 +52,18 @@ yabause/sh2idle.c yabause/sh2int.c yabause/sh2trace.c yabause/smpc.c yabause/snd
 yabause/vdp1.c yabause/vdp2.c yabause/vdp2debug.c yabause/vidshared.c yabause/vidsoft.c yabause/yabause.c \
 yabause/scsp.c yabause/japmodem.c
 
+# draw VDP2 layers & composite frames on worker threads in the software renderer
+CPPFLAGS += -DVIDSOFT_USE_THREADS=1
+
 #SRC += yabause/c68k/c68kexec.c yabause/c68k/c68k.c yabause/m68kc68k.c
 #CPPFLAGS += -DHAVE_C68K=1
 SRC += yabause/q68/q68.c yabause/q68/q68-core.c yabause/m68kq68.c
 CPPFLAGS += -DHAVE_Q68=1
-# TODO: -DQ68_USE_JIT=1
+ifneq ($(filter x86 x86_64, $(ARCH)),)
+ # Q68 only has x86 & PSP code generators, selected with CPU_X86/CPU_X64 above
+ CPPFLAGS += -DQ68_USE_JIT=1
+ SRC += yabause/q68/q68-jit.c yabause/q68/q68-jit-x86.S
+endif
 
 include $(IMAGINE_PATH)/make/imagineAppTarget.mk
 
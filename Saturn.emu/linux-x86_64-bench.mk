@@ -0,0 +1 @@
+include $(dir $(lastword $(MAKEFILE_LIST)))../EmuFramework/bench.mk
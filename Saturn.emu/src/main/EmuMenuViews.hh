@@ -60,6 +60,35 @@ public:
 		sh2Core.init(str, setting, cores);
 	}
 
+	MultiChoiceSelectMenuItem m68kCore
+	{
+		"68K",
+		[](MultiChoiceMenuItem &, int val)
+		{
+			assert(val < (int)sizeofArray(M68KCoreList)-1);
+			yinit.m68kcoretype = M68KCoreList[val]->id;
+			optionM68KCore = M68KCoreList[val]->id;
+		}
+	};
+
+	void m68kCoreInit()
+	{
+		static const char *str[4];
+
+		int setting = 0, cores = 0;
+		iterateTimes(sizeofArray(M68KCoreList)-1, i)
+		{
+			if(i == sizeofArray(str))
+				break;
+			str[i] = M68KCoreList[i]->Name;
+			if(M68KCoreList[i]->id == yinit.m68kcoretype)
+				setting = i;
+			cores++;
+		}
+
+		m68kCore.init(str, setting, cores);
+	}
+
 public:
 	SystemOptionView(Base::Window &win):
 		OptionView(win)
@@ -72,6 +101,10 @@ public:
 		{
 			sh2CoreInit(); item[items++] = &sh2Core;
 		}
+		if(sizeofArray(M68KCoreList) > 2)
+		{
+			m68kCoreInit(); item[items++] = &m68kCore;
+		}
 		printBiosMenuEntryStr(biosPathStr);
 		biosPath.init(biosPathStr); item[items++] = &biosPath;
 	}
@@ -1,6 +1,12 @@
 #define LOGTAG "main"
 #include <EmuSystem.hh>
 #include <CommonFrameworkIncludes.hh>
+#ifdef CONFIG_EMUFRAMEWORK_HEADLESS_BENCHMARK
+#include <HeadlessBenchmark.hh>
+#include <imagine/io/sys.hh>
+#include <imagine/mem/mem.h>
+#include <cstdio>
+#endif
 
 extern "C"
 {
@@ -9,6 +15,7 @@ extern "C"
 	#include <yabause/peripheral.h>
 	#include <yabause/sh2core.h>
 	#include <yabause/sh2int.h>
+	#include <yabause/memory.h>
 	#include <yabause/vidsoft.h>
 	#include <yabause/scsp.h>
 	#include <yabause/cdbase.h>
@@ -165,10 +172,22 @@ M68K_struct *M68KCoreList[] =
 	#endif
 	#ifdef HAVE_Q68
 	&M68KQ68,
+	#ifdef Q68_USE_JIT
+	&M68KQ68JIT,
+	#endif
 	#endif
 	nullptr
 };
 
+static const int defaultM68KCoreID =
+#if defined HAVE_Q68 && defined Q68_USE_JIT
+M68KCORE_Q68_JIT;
+#elif defined HAVE_Q68
+M68KCORE_Q68;
+#else
+M68KCORE_C68K;
+#endif
+
 // controls
 
 enum
@@ -200,7 +219,8 @@ enum
 };
 
 enum {
-	CFGKEY_BIOS_PATH = 279, CFGKEY_SH2_CORE = 280
+	CFGKEY_BIOS_PATH = 279, CFGKEY_SH2_CORE = 280,
+	CFGKEY_M68K_CORE = 281
 };
 
 static bool OptionSH2CoreIsValid(uint8 val)
@@ -217,9 +237,21 @@ static bool OptionSH2CoreIsValid(uint8 val)
 	return false;
 }
 
+static bool OptionM68KCoreIsValid(uint8 val)
+{
+	for(auto core = M68KCoreList; *core; core++)
+	{
+		if((*core)->id == val)
+			return true;
+	}
+	logMsg("68K core option not valid");
+	return false;
+}
+
 FsSys::cPath biosPath = "";
 static PathOption optionBiosPath(CFGKEY_BIOS_PATH, biosPath, sizeof(biosPath), "");
 static Byte1Option optionSH2Core(CFGKEY_SH2_CORE, defaultSH2CoreID, false, OptionSH2CoreIsValid);
+static Byte1Option optionM68KCore(CFGKEY_M68K_CORE, defaultM68KCoreID, false, OptionM68KCoreIsValid);
 
 static yabauseinit_struct yinit =
 {
@@ -227,11 +259,7 @@ static yabauseinit_struct yinit =
 	defaultSH2CoreID,
 	VIDCORE_SOFT,
 	SNDCORE_IMAGINE,
-	#if defined(HAVE_Q68)
-	M68KCORE_Q68,
-	#else
-	M68KCORE_C68K,
-	#endif
+	defaultM68KCoreID,
 	CDCORE_ISO,
 	CART_NONE,
 	REGION_AUTODETECT,
@@ -285,6 +313,7 @@ void EmuSystem::initOptions()
 void EmuSystem::onOptionsLoaded()
 {
 	yinit.sh2coretype = optionSH2Core;
+	yinit.m68kcoretype = optionM68KCore;
 }
 
 bool EmuSystem::readConfig(Io &io, uint key, uint readSize)
@@ -294,6 +323,7 @@ bool EmuSystem::readConfig(Io &io, uint key, uint readSize)
 		default: return 0;
 		bcase CFGKEY_BIOS_PATH: optionBiosPath.readFromIO(io, readSize);
 		bcase CFGKEY_SH2_CORE: optionSH2Core.readFromIO(io, readSize);
+		bcase CFGKEY_M68K_CORE: optionM68KCore.readFromIO(io, readSize);
 	}
 	return 1;
 }
@@ -302,6 +332,7 @@ void EmuSystem::writeConfig(Io *io)
 {
 	optionBiosPath.writeToIO(io);
 	optionSH2Core.writeWithKeyIfNotDefault(io);
+	optionM68KCore.writeWithKeyIfNotDefault(io);
 }
 
 FsDirFilterFunc EmuFilePicker::defaultFsFilter = ssFsFilter;
@@ -553,6 +584,9 @@ int EmuSystem::loadGame(const char *path)
 	pad[0] = PerPadAdd(&PORTDATA1);
 	pad[1] = PerPadAdd(&PORTDATA2);
 	ScspSetFrameAccurate(1);
+	#if !defined NDEBUG || defined CONFIG_EMUFRAMEWORK_HEADLESS_BENCHMARK
+	M68KSetMeasureTime(1);
+	#endif
 
 	logMsg("finished loading game");
 	return 1;
@@ -575,12 +609,185 @@ void EmuSystem::configAudioRate()
 	pcmFormat.rate = optionSoundRate;
 }
 
+#ifdef CONFIG_EMUFRAMEWORK_HEADLESS_BENCHMARK
+void resetSystemBenchmarkStats()
+{
+	M68KGetExecTicks();
+}
+
+// average host time per frame spent running the sound CPU, to compare 68K cores
+void printSystemBenchmarkStats(uint frames)
+{
+	printf(",\"m68kCore\":\"%s\",\"m68kFrameMs\":%.4f", M68K->Name,
+		(double)M68KGetExecTicks() * 1000. / yabsys.tickfreq / frames);
+}
+
+// SH2 test program booted from the reset vector of a synthetic BIOS, the master
+// runs an ALU/DIV1/DMULS/MAC.L/MAC.W mix with and without saturation plus
+// self-modifying code and cache-through mirrors, the slave a MULU/MAC loop,
+// both store their results to work RAM and write -1 to their progress word
+// when done
+static const u16 sh2LockstepProgram[]
+{
+	0xD00E, 0x6002, 0xD10E, 0x2018, 0x8901, 0xA097, 0x0009, 0xD00D, 0xE102, 0x2010, 0xD808, 0xD90C,
+	0xDA0C, 0xDE0D, 0xD20D, 0xD40E, 0xD10E, 0xE339, 0xD60E, 0xD50F, 0xE703, 0x6056, 0x2602, 0x4710,
+	0x8FFB, 0x7604, 0xA018, 0x0009, 0x0600, 0x0000, 0xFFFF, 0xFFE0, 0x0000, 0x8000, 0x2010, 0x001F,
+	0x0020, 0x0000, 0x260C, 0x8000, 0x060F, 0xFFFC, 0x41C6, 0x4E6D, 0x0000, 0x9C40, 0x0123, 0x4567,
+	0x060F, 0x0000, 0x0000, 0x0530, 0x0127, 0x011A, 0x313C, 0x6513, 0x4509, 0x251A, 0x6659, 0x666C,
+	0x356C, 0x351D, 0x070A, 0x001A, 0x270A, 0x6053, 0x4021, 0x4025, 0x3017, 0x375E, 0x6053, 0xCB01,
+	0x6C03, 0x6B13, 0xED00, 0x0019, 0x4B24, 0x3DC4, 0x4B24, 0x3DC4, 0x4B24, 0x3DC4, 0x4B24, 0x3DC4,
+	0x4B24, 0x3DC4, 0x4B24, 0x3DC4, 0x2972, 0x6092, 0x370C, 0x6B83, 0x7BF0, 0x6C83, 0x7CF4, 0x0028,
+	0x6043, 0xC908, 0x8800, 0x8902, 0x0002, 0xCB02, 0x400E, 0x0CBF, 0x0CBF, 0x4CBF, 0x4CCF, 0x0002,
+	0xC9FD, 0x400E, 0x000A, 0x2D0A, 0x001A, 0x3D0C, 0x0002, 0xC901, 0x3D0C, 0x2812, 0x7804, 0x2872,
+	0x7804, 0x28D2, 0x7804, 0x2A71, 0x60A0, 0x350C, 0x60A1, 0x600F, 0x350C, 0xD60A, 0x460B, 0x0009,
+	0x2852, 0x7804, 0x6043, 0xC90F, 0x8800, 0x8B02, 0xD605, 0x6013, 0x8061, 0x2E42, 0x4410, 0x8901,
+	0xAFA2, 0x0009, 0xE0FF, 0x2E02, 0xAFFE, 0x0009, 0x060F, 0x0000, 0xE011, 0x000B, 0x350C, 0x0009,
+	0x0009, 0x0009, 0xD810, 0xDE11, 0xD213, 0xD411, 0xD111, 0x0127, 0x011A, 0x714D, 0x6513, 0x4504,
+	0x251A, 0x3155, 0x060A, 0x356C, 0x2852, 0x7804, 0x6B83, 0x7BF8, 0x6C83, 0x7CFC, 0x0028, 0x4CBF,
+	0x0CBF, 0x001A, 0x2802, 0x7804, 0x4410, 0x8FE8, 0x2E42, 0xE0FF, 0x2E02, 0xAFFE, 0x0009, 0x0009,
+	0x0021, 0x0000, 0x002F, 0xFFFC, 0x0000, 0xEA60, 0x0246, 0x8ACE, 0x41C6, 0x4E6D
+};
+
+struct SH2LockstepResult
+{
+	u8 *wram; // high work RAM followed by low work RAM
+	sh2regs_struct regs;
+	u32 masterProgress, slaveProgress;
+};
+
+static bool writeSH2LockstepBios(const char *path)
+{
+	const uint biosSize = 0x80000, progAddr = 0x400;
+	auto bios = (u8*)mem_calloc(biosSize);
+	if(!bios)
+		return false;
+	// reset vector PC & SP
+	const u8 vectors[] {0x00, 0x00, 0x04, 0x00, 0x06, 0x0F, 0xFF, 0xF0};
+	memcpy(bios, vectors, sizeof(vectors));
+	iterateTimes(sizeofArray(sh2LockstepProgram), i)
+	{
+		bios[progAddr + i*2] = sh2LockstepProgram[i] >> 8;
+		bios[progAddr + i*2 + 1] = sh2LockstepProgram[i] & 0xFF;
+	}
+	bool written = false;
+	auto file = IOFile(IoSys::create(path));
+	if(file)
+		written = file.fwrite(bios, biosSize, 1) == 1;
+	mem_free(bios);
+	return written;
+}
+
+static bool runSH2Lockstep(int coreID, const char *biosPath, uint frames, SH2LockstepResult &result)
+{
+	auto init = yinit;
+	init.sh2coretype = coreID;
+	init.cdcoretype = CDCORE_DUMMY;
+	init.biospath = biosPath;
+	init.cdpath = nullptr;
+	init.buppath = nullptr;
+	if(YabauseInit(&init) != 0)
+	{
+		fprintf(stderr, "YabauseInit failed for SH2 core %d\n", coreID);
+		return false;
+	}
+	SNDImagine.UpdateAudio = SNDImagineUpdateAudioNull;
+	auto startTime = TimeSys::now();
+	iterateTimes(frames, i)
+	{
+		YabauseEmulate();
+	}
+	double ms = (TimeSys::now() - startTime).toNs() / 1000000. / frames;
+	memcpy(result.wram, HighWram, 0x100000);
+	memcpy(result.wram + 0x100000, LowWram, 0x100000);
+	SH2GetRegisters(MSH2, &result.regs);
+	result.masterProgress = T2ReadLong(HighWram, 0xFFFFC);
+	result.slaveProgress = T2ReadLong(LowWram, 0xFFFFC);
+	printf("{\"sh2Core\":\"%s\",\"frameMs\":%.4f,\"masterDone\":%s,\"slaveDone\":%s}\n",
+		SH2Core->Name, ms, result.masterProgress == 0xFFFFFFFF ? "true" : "false",
+		result.slaveProgress == 0xFFFFFFFF ? "true" : "false");
+	YabauseDeInit();
+	return true;
+}
+
+// runs the SH2 test program on every SH2 core and checks that work RAM and the
+// master's registers end up identical to the interpreter's
+int runSystemBenchmark(uint frames)
+{
+	FsSys::cPath biosPath;
+	string_printf(biosPath, "%s/sh2-lockstep.bin", Base::documentsPath());
+	if(!writeSH2LockstepBios(biosPath))
+	{
+		fprintf(stderr, "can't write %s\n", biosPath);
+		return 1;
+	}
+	const uint wramSize = 0x200000;
+	SH2LockstepResult ref {(u8*)mem_alloc(wramSize)}, res {(u8*)mem_alloc(wramSize)};
+	int exitCode = 0;
+	if(!runSH2Lockstep(SH2CORE_INTERPRETER, biosPath, frames, ref))
+		exitCode = 1;
+	for(auto coreI : SH2CoreList)
+	{
+		if(exitCode || !coreI || coreI->id == SH2CORE_INTERPRETER)
+			continue;
+		if(!runSH2Lockstep(coreI->id, biosPath, frames, res))
+		{
+			exitCode = 1;
+			break;
+		}
+		iterateTimes(wramSize / 4, i)
+		{
+			if(memcmp(&ref.wram[i*4], &res.wram[i*4], 4) != 0)
+			{
+				u32 addr = (i*4 < 0x100000 ? 0x06000000 : 0x00200000) + (i*4 & 0xFFFFF);
+				printf("{\"sh2Core\":\"%s\",\"mismatch\":\"%08X\",\"interpreter\":\"%08X\",\"value\":\"%08X\"}\n",
+					coreI->Name, addr, T2ReadLong(ref.wram, i*4), T2ReadLong(res.wram, i*4));
+				exitCode = 1;
+				break;
+			}
+		}
+		if(memcmp(ref.regs.R, res.regs.R, sizeof(ref.regs.R)) != 0
+			|| ref.regs.MACH != res.regs.MACH || ref.regs.MACL != res.regs.MACL || ref.regs.GBR != res.regs.GBR)
+		{
+			printf("{\"sh2Core\":\"%s\",\"mismatch\":\"registers\"}\n", coreI->Name);
+			exitCode = 1;
+		}
+	}
+	if(ref.masterProgress != 0xFFFFFFFF || ref.slaveProgress != 0xFFFFFFFF)
+	{
+		fprintf(stderr, "SH2 test program didn't finish, increase --frames\n");
+		exitCode = 1;
+	}
+	mem_free(ref.wram);
+	mem_free(res.wram);
+	FsSys::remove(biosPath);
+	fflush(stdout);
+	return exitCode;
+}
+#elif !defined NDEBUG
+// report the average host time per frame spent running the sound CPU
+static void log68KTime()
+{
+	static uint frames = 0;
+	static uint64 ticks = 0;
+	ticks += M68KGetExecTicks();
+	if(++frames == 300)
+	{
+		logMsg("68K (%s): %.3fms/frame", M68K->Name, (double)ticks * 1000. / yabsys.tickfreq / frames);
+		frames = 0;
+		ticks = 0;
+	}
+}
+#endif
+
 void EmuSystem::runFrame(bool renderGfx, bool processGfx, bool renderAudio)
 {
 	if(renderGfx)
 		renderToScreen = 1;
 	SNDImagine.UpdateAudio = renderAudio ? SNDImagineUpdateAudio : SNDImagineUpdateAudioNull;
 	YabauseEmulate();
+	#if !defined NDEBUG && !defined CONFIG_EMUFRAMEWORK_HEADLESS_BENCHMARK
+	log68KTime();
+	#endif
 }
 
 void EmuSystem::savePathChanged() { }
@@ -23,6 +23,12 @@
 
 #include "q68/q68.h"
 
+#ifdef Q68_USE_JIT
+# include <string.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
 /*************************************************************************/
 
 /**
@@ -52,6 +58,9 @@
 /* Interface function declarations (must come before interface definition) */
 
 static int m68kq68_init(void);
+#ifdef Q68_USE_JIT
+static int m68kq68_jit_init(void);
+#endif
 static void m68kq68_deinit(void);
 static void m68kq68_reset(void);
 
@@ -84,6 +93,12 @@ static void m68kq68_set_writew(M68K_WRITE *func);
 static uint32_t dummy_read(uint32_t address);
 static void dummy_write(uint32_t address, uint32_t data);
 
+#ifdef Q68_USE_JIT
+static void *jit_malloc(size_t size);
+static void *jit_realloc(void *ptr, size_t size);
+static void jit_free(void *ptr);
+#endif
+
 #ifdef NEED_TRAMPOLINE
 static uint32_t readb_trampoline(uint32_t address);
 static uint32_t readw_trampoline(uint32_t address);
@@ -130,6 +145,47 @@ M68K_struct M68KQ68 = {
     .SetWriteW   = m68kq68_set_writew,
 };
 
+#ifdef Q68_USE_JIT
+
+/* Same interface with dynamic translation enabled */
+
+M68K_struct M68KQ68JIT = {
+    .id          = M68KCORE_Q68_JIT,
+    .Name        = "Q68 68k Emulator Interface (JIT)",
+
+    .Init        = m68kq68_jit_init,
+    .DeInit      = m68kq68_deinit,
+    .Reset       = m68kq68_reset,
+
+    .Exec        = m68kq68_exec,
+    .Sync        = m68kq68_sync,
+
+    .GetDReg     = m68kq68_get_dreg,
+    .GetAReg     = m68kq68_get_areg,
+    .GetPC       = m68kq68_get_pc,
+    .GetSR       = m68kq68_get_sr,
+    .GetUSP      = m68kq68_get_usp,
+    .GetMSP      = m68kq68_get_ssp,
+
+    .SetDReg     = m68kq68_set_dreg,
+    .SetAReg     = m68kq68_set_areg,
+    .SetPC       = m68kq68_set_pc,
+    .SetSR       = m68kq68_set_sr,
+    .SetUSP      = m68kq68_set_usp,
+    .SetMSP      = m68kq68_set_ssp,
+
+    .SetIRQ      = m68kq68_set_irq,
+    .WriteNotify = m68kq68_write_notify,
+
+    .SetFetch    = m68kq68_set_fetch,
+    .SetReadB    = m68kq68_set_readb,
+    .SetReadW    = m68kq68_set_readw,
+    .SetWriteB   = m68kq68_set_writeb,
+    .SetWriteW   = m68kq68_set_writew,
+};
+
+#endif  // Q68_USE_JIT
+
 /*-----------------------------------------------------------------------*/
 
 /* Virtual processor state block */
@@ -174,6 +230,41 @@ static int m68kq68_init(void)
 
 /*-----------------------------------------------------------------------*/
 
+#ifdef Q68_USE_JIT
+
+/**
+ * m68kq68_jit_init:  Initialize the virtual processor with dynamic
+ * translation enabled.  Translated code is stored in separately mapped
+ * executable pages, while all other data uses the normal heap.  Falls
+ * back to interpretation if executable memory can't be obtained.
+ *
+ * [Parameters]
+ *     None
+ * [Return value]
+ *     Zero on success, negative on failure
+ */
+static int m68kq68_jit_init(void)
+{
+    void *test = jit_malloc(1);
+    if (!test) {
+        /* Executable memory unavailable, so run the interpreter instead */
+        return m68kq68_init();
+    }
+    jit_free(test);
+
+    if (m68kq68_init() < 0) {
+        return -1;
+    }
+    q68_set_jit_alloc_funcs(state, jit_malloc, jit_realloc, jit_free);
+    q68_set_jit_enabled(state, 1);
+
+    return 0;
+}
+
+#endif  // Q68_USE_JIT
+
+/*-----------------------------------------------------------------------*/
+
 /**
  * m68kq68_deinit:  Destroy the virtual processor.
  *
@@ -489,6 +580,92 @@ static void dummy_write(uint32_t address, uint32_t data)
 
 /*-----------------------------------------------------------------------*/
 
+#ifdef Q68_USE_JIT
+
+/* Bytes reserved at the start of each code mapping to hold its length
+ * (kept at 16 to preserve alignment of the returned block) */
+#define JIT_MAP_HEADER  16
+
+/**
+ * jit_map_length:  Return the mapping length needed for a code block.
+ *
+ * [Parameters]
+ *     size: Size of block in bytes
+ * [Return value]
+ *     Length of mapping in bytes, including the header
+ */
+static size_t jit_map_length(size_t size)
+{
+    const size_t page_mask = (size_t)sysconf(_SC_PAGESIZE) - 1;
+    return (size + JIT_MAP_HEADER + page_mask) & ~page_mask;
+}
+
+/**
+ * jit_malloc, jit_realloc, jit_free:  Code allocation functions passed to
+ * Q68 when dynamic translation is enabled.  Each block gets its own
+ * anonymous mapping, so making it executable never affects heap data.
+ *
+ * [Parameters]
+ *      ptr: Block to resize or free (jit_realloc() and jit_free() only)
+ *     size: Size of block in bytes (jit_malloc() and jit_realloc() only)
+ * [Return value]
+ *     Allocated block, or NULL on failure (jit_malloc() and jit_realloc()
+ *     only)
+ */
+
+static void *jit_malloc(size_t size)
+{
+    const size_t length = jit_map_length(size);
+    uint8_t *base = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+    if (mprotect(base, length, PROT_READ | PROT_WRITE | PROT_EXEC) != 0) {
+        munmap(base, length);
+        return NULL;
+    }
+    *(size_t *)base = length;
+    return base + JIT_MAP_HEADER;
+}
+
+static void *jit_realloc(void *ptr, size_t size)
+{
+    if (!ptr) {
+        return jit_malloc(size);
+    }
+    uint8_t *base = (uint8_t *)ptr - JIT_MAP_HEADER;
+    const size_t length = *(size_t *)base;
+    const size_t new_length = jit_map_length(size);
+    if (new_length <= length) {
+        /* Shrink in place, returning any unused pages */
+        if (new_length < length) {
+            munmap(base + new_length, length - new_length);
+            *(size_t *)base = new_length;
+        }
+        return ptr;
+    }
+    void *newptr = jit_malloc(size);
+    if (!newptr) {
+        return NULL;
+    }
+    memcpy(newptr, ptr, length - JIT_MAP_HEADER);
+    jit_free(ptr);
+    return newptr;
+}
+
+static void jit_free(void *ptr)
+{
+    if (ptr) {
+        uint8_t *base = (uint8_t *)ptr - JIT_MAP_HEADER;
+        munmap(base, *(size_t *)base);
+    }
+}
+
+#endif  // Q68_USE_JIT
+
+/*-----------------------------------------------------------------------*/
+
 #ifdef NEED_TRAMPOLINE
 
 /**
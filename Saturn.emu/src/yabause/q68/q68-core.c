@@ -263,7 +263,7 @@ int q68_run(Q68State *state, int cycles)
             }
         }
 #ifdef Q68_USE_JIT
-        if (!state->jit_running) {
+        if (state->jit_enabled && !state->jit_running) {
             state->jit_running = q68_jit_find(state, state->PC);
             if (UNLIKELY(!state->jit_running)) {
                 state->jit_running = q68_jit_translate(state, state->PC);
@@ -1595,19 +1595,23 @@ static int opshft(Q68State *state, uint32_t opcode)
             break;
           }
           default: {  // (case 3) ROL/ROR
+            /* C receives the last bit rotated out, which is the bit that
+             * wrapped around to the other end of the result */
             count %= nbits;
             if (is_left) {
-                data = (data << count) | (data >> (nbits - count));
-                if ((data >> (nbits-1)) & 1) {
+                if (count > 0) {
+                    data = (data << count) | (data >> (nbits - count));
+                }
+                if (data & 1) {
                     state->SR |= SR_C;
                 }
-                data <<= 1;
             } else {
-                data = (data >> count) | (data << (nbits - count));
-                if (data & 1) {
+                if (count > 0) {
+                    data = (data >> count) | (data << (nbits - count));
+                }
+                if ((data >> (nbits-1)) & 1) {
                     state->SR |= SR_C;
                 }
-                data = (int32_t)data >> 1;
             }
             break;
           }
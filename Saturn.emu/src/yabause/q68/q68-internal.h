@@ -236,6 +236,17 @@ struct Q68State_ {
     /* Buffer for tracking translated code blocks */
     uint8_t jit_pages[1<<(24-(Q68_JIT_PAGE_BITS+3))];
 
+    /**** Fields below aren't accessed by the JIT assembly, so adding ****
+     **** them here doesn't change its structure offsets            ****/
+
+    /* Nonzero if 68k code should be dynamically translated */
+    unsigned int jit_enabled;
+
+    /* Native memory allocation functions for translated code */
+    void *(*jit_malloc_func)(size_t size);
+    void *(*jit_realloc_func)(void *ptr, size_t size);
+    void (*jit_free_func)(void *ptr);
+
 };
 
 /*-----------------------------------------------------------------------*/
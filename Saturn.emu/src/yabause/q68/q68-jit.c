@@ -595,7 +595,7 @@ Q68JitEntry *q68_jit_translate(Q68State *state, uint32_t address)
 
     /* Initialize the new entry */
 
-    current_entry->native_code = state->malloc_func(Q68_JIT_BLOCK_EXPAND_SIZE);
+    current_entry->native_code = state->jit_malloc_func(Q68_JIT_BLOCK_EXPAND_SIZE);
     if (!current_entry->native_code) {
         DMSG("No memory for code at $%06X", address);
         current_entry = NULL;
@@ -663,8 +663,8 @@ Q68JitEntry *q68_jit_translate(Q68State *state, uint32_t address)
     ) {
         JIT_PAGE_SET(state, index);
     }
-    void *newptr = state->realloc_func(current_entry->native_code,
-                                       current_entry->native_length);
+    void *newptr = state->jit_realloc_func(current_entry->native_code,
+                                           current_entry->native_length);
     if (newptr) {
         current_entry->native_code = newptr;
         current_entry->native_size = current_entry->native_length;
@@ -1009,7 +1009,7 @@ static int translate_insn(Q68State *state, Q68JitEntry *entry)
 
     /* Emit a cycle count check if appropriate */
 #ifdef Q68_JIT_LOOSE_TIMING
-    if ((opcode & 0xFF00) == 0x6100  // Bcc
+    if ((opcode & 0xF000) == 0x6000  // Bcc/BRA/BSR
      || (opcode & 0xF0F8) == 0x50C8  // DBcc
      || (opcode & 0xFFF0) == 0x4E40  // TRAP
      || (opcode & 0xFF80) == 0x4E80  // JSR/JMP
@@ -1079,7 +1079,7 @@ static void clear_entry(Q68State *state, Q68JitEntry *entry)
 
     /* Free the native code */
     state->jit_total_data -= entry->native_size;
-    state->free_func(entry->native_code);
+    state->jit_free_func(entry->native_code);
     entry->native_code = NULL;
 
     /* Clear the entry from the table and hash chain */
@@ -1094,6 +1094,12 @@ static void clear_entry(Q68State *state, Q68JitEntry *entry)
 
     /* Mark the entry as free */
     entry->m68k_start = 0;
+
+    /* If the block was suspended at a cycle limit, resume by looking up
+     * the current PC instead */
+    if (state->jit_running == entry) {
+        state->jit_running = NULL;
+    }
 }
 
 /*-----------------------------------------------------------------------*/
@@ -1144,7 +1150,7 @@ static void clear_oldest_entry(Q68State *state)
 static int expand_buffer(Q68JitEntry *entry)
 {
     const uint32_t newsize = entry->native_size + Q68_JIT_BLOCK_EXPAND_SIZE;
-    void *newptr = entry->state->realloc_func(entry->native_code, newsize);
+    void *newptr = entry->state->jit_realloc_func(entry->native_code, newsize);
     if (!newptr) {
         DMSG("Out of memory");
         return 0;
@@ -89,6 +89,10 @@ Q68State *q68_create_ex(void *(*malloc_func)(size_t size),
     state->malloc_func  = malloc_func;
     state->realloc_func = realloc_func;
     state->free_func    = free_func;
+    state->jit_enabled  = 0;
+    state->jit_malloc_func  = malloc_func;
+    state->jit_realloc_func = realloc_func;
+    state->jit_free_func    = free_func;
 
 #ifdef Q68_USE_JIT
     if (!q68_jit_init(state)) {
@@ -197,6 +201,62 @@ void q68_set_jit_flush_func(Q68State *state, void (*flush_func)(void))
     state->jit_flush   = flush_func;
 }
 
+/*-----------------------------------------------------------------------*/
+
+/**
+ * q68_set_jit_alloc_funcs:  Set the functions used to allocate memory for
+ * translated native code, which must return executable memory.  By
+ * default the functions passed to q68_create_ex() are used.  Changing
+ * them discards all existing translations.  This function has no effect
+ * if dynamic translation is not compiled in.
+ *
+ * [Parameters]
+ *            state: Processor state block
+ *      malloc_func: Function for allocating a code block
+ *     realloc_func: Function for adjusting the size of a code block
+ *        free_func: Function for freeing a code block
+ * [Return value]
+ *     None
+ */
+void q68_set_jit_alloc_funcs(Q68State *state,
+                             void *(*malloc_func)(size_t size),
+                             void *(*realloc_func)(void *ptr, size_t size),
+                             void (*free_func)(void *ptr))
+{
+#ifdef Q68_USE_JIT
+    q68_jit_reset(state);
+    state->jit_running = NULL;
+    state->jit_malloc_func  = malloc_func;
+    state->jit_realloc_func = realloc_func;
+    state->jit_free_func    = free_func;
+#endif
+}
+
+/*-----------------------------------------------------------------------*/
+
+/**
+ * q68_set_jit_enabled:  Select whether 68k code is dynamically translated
+ * or interpreted.  Translation is disabled by default.  Disabling it
+ * discards all existing translations.  This function has no effect if
+ * dynamic translation is not compiled in.
+ *
+ * [Parameters]
+ *      state: Processor state block
+ *     enable: Nonzero to enable dynamic translation, zero to disable
+ * [Return value]
+ *     None
+ */
+void q68_set_jit_enabled(Q68State *state, int enable)
+{
+#ifdef Q68_USE_JIT
+    if (state->jit_enabled && !enable) {
+        q68_jit_reset(state);
+        state->jit_running = NULL;
+    }
+    state->jit_enabled = (enable != 0);
+#endif
+}
+
 /*************************************************************************/
 
 /**
@@ -265,6 +325,8 @@ void q68_set_areg(Q68State *state, int num, uint32_t value)
 void q68_set_pc(Q68State *state, uint32_t value)
 {
     state->PC = value;
+    /* Don't resume a translated block from the old PC */
+    state->jit_running = NULL;
 }
 
 void q68_set_sr(Q68State *state, uint16_t value)
@@ -153,6 +153,40 @@ extern void q68_set_writew_func(Q68State *state, Q68WriteFunc func);
  */
 extern void q68_set_jit_flush_func(Q68State *state, void (*flush_func)(void));
 
+/**
+ * q68_set_jit_alloc_funcs:  Set the functions used to allocate memory for
+ * translated native code, which must return executable memory.  By
+ * default the functions passed to q68_create_ex() are used.  Changing
+ * them discards all existing translations.  This function has no effect
+ * if dynamic translation is not compiled in.
+ *
+ * [Parameters]
+ *            state: Processor state block
+ *      malloc_func: Function for allocating a code block
+ *     realloc_func: Function for adjusting the size of a code block
+ *        free_func: Function for freeing a code block
+ * [Return value]
+ *     None
+ */
+extern void q68_set_jit_alloc_funcs(Q68State *state,
+                                    void *(*malloc_func)(size_t size),
+                                    void *(*realloc_func)(void *ptr, size_t size),
+                                    void (*free_func)(void *ptr));
+
+/**
+ * q68_set_jit_enabled:  Select whether 68k code is dynamically translated
+ * or interpreted.  Translation is disabled by default.  Disabling it
+ * discards all existing translations.  This function has no effect if
+ * dynamic translation is not compiled in.
+ *
+ * [Parameters]
+ *      state: Processor state block
+ *     enable: Nonzero to enable dynamic translation, zero to disable
+ * [Return value]
+ *     None
+ */
+extern void q68_set_jit_enabled(Q68State *state, int enable);
+
 /*----------------------------------*/
 
 /**
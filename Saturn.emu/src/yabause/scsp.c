@@ -3005,6 +3005,8 @@ scsp_alloc_bufs (void)
 static u8 IsM68KRunning;
 static s32 FASTCALL (*m68kexecptr)(s32 cycles);  // M68K->Exec or M68KExecBP
 static s32 savedcycles;  // Cycles left over from the last M68KExec() call
+static int m68kmeasure;  // Nonzero to measure host time spent in M68KExec()
+static u64 m68kticks;  // Ticks measured since the last M68KGetExecTicks() call
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -3369,12 +3371,40 @@ M68KExec (s32 cycles)
       if (LIKELY(newcycles < 0))
         {
           s32 cyclestoexec = -newcycles;
-          newcycles += (*m68kexecptr)(cyclestoexec);
+          if (UNLIKELY(m68kmeasure))
+            {
+              u64 start = YabauseGetTicks ();
+              newcycles += (*m68kexecptr)(cyclestoexec);
+              m68kticks += YabauseGetTicks () - start;
+            }
+          else
+            newcycles += (*m68kexecptr)(cyclestoexec);
         }
       savedcycles = newcycles;
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////
+
+void
+M68KSetMeasureTime (int on)
+{
+  m68kmeasure = on;
+  m68kticks = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Returns the host ticks (see yabsys.tickfreq) spent executing 68K code
+// since the previous call, when enabled by M68KSetMeasureTime()
+u64
+M68KGetExecTicks (void)
+{
+  u64 ticks = m68kticks;
+  m68kticks = 0;
+  return ticks;
+}
+
 //----------------------------------------------------------------------------
 
 static s32 FASTCALL
@@ -3924,6 +3954,8 @@ SoundLoadState (FILE *fp, int version, int size)
 
   // Lastly, sound ram
   yread (&check, (void *)SoundRam, 0x80000, 1, fp);
+  // Drop any code translated from the old contents
+  M68K->WriteNotify (0, 0x80000);
 
   if (version > 1)
     {
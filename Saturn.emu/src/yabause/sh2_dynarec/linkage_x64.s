@@ -101,7 +101,7 @@ newline:
 	sub	%edx, %ebx  /* sh2cycles(full line) - decilinecycles*9 */
 	mov	%rax, CurrentSH2
 	mov	%ebx, -52(%rbp) /* sh2cycles */
-	cmp	$0, (%rax, %rcx)
+	cmpl	$0, (%rax, %rcx)
 	jne	master_handle_interrupts
 	mov	master_cc, %esi
 	sub	%ebx, %esi
@@ -136,7 +136,7 @@ slave_entry:
 	mov	SSH2, %rax
 	mov	NumberOfInterruptsOffset, %ecx
 	mov	%rax, CurrentSH2
-	cmp	$0, (%rax, %rcx)
+	cmpl	$0, (%rax, %rcx)
 	jne	slave_handle_interrupts
 	mov	slave_cc, %esi
 	sub	%ebx, %esi
@@ -322,7 +322,10 @@ dyna_linker:
 	mov	%esi, %ebp
 	lea	4(%ebx,%edi,1), %esi
 	mov	%eax, %edi
+	mov	%rsp, %r13 /* Align stack, rsp parity differs for master/slave code */
+	and	$-16, %rsp
 	call	add_link
+	mov	%r13, %rsp
 	mov	8(%r12), %edi
 	mov	%ebp, %esi
 	lea	-4(%edi), %edx
@@ -369,7 +372,10 @@ dyna_linker:
 	mov	%eax, %edi
 	mov	%eax, %ebp /* Note: assumes %rbx and %rbp are callee-saved */
 	mov	%esi, %r12d
+	mov	%rsp, %r13 /* Align stack */
+	and	$-16, %rsp
 	call	sh2_recompile_block
+	mov	%r13, %rsp
 	test	%eax, %eax
 	mov	%ebp, %eax
 	mov	%r12d, %esi
@@ -467,7 +473,10 @@ jump_vaddr:
 	je	.C1
   /* No hit on hash table, call compiler */
 	mov	%esi, %ebx /* CCREG */
+	mov	%rsp, %r13 /* Align stack */
+	and	$-16, %rsp
 	call	get_addr
+	mov	%r13, %rsp
 	mov	%ebx, %esi
 	jmp	*%rax
 	.size	jump_vaddr, .-jump_vaddr
@@ -499,7 +508,10 @@ verify_code:
 	add	$8, %rsp /* pop return address, we're not returning */
 	mov	%r12d, %edi
 	mov	%esi, %ebx
+	mov	%rsp, %r13 /* Align stack */
+	and	$-16, %rsp
 	call	get_addr
+	mov	%r13, %rsp
 	mov	%ebx, %esi
 	jmp	*%rax
 	.size	verify_code, .-verify_code
@@ -645,10 +657,15 @@ macl:
 	mov	%eax, %r13d /* MACL */
 	mov	%ebp, %r14d
 	mov	%edi, %r15d
+	mov	%rsp, %rbp /* Align stack */
+	and	$-16, %rsp
+	sub	$16, %rsp
 	call	MappedMemoryReadLong
-	mov	%eax, %esi
+	mov	%eax, (%rsp) /* %esi is caller-save on x86-64 */
 	mov	%r14d, %edi
 	call	MappedMemoryReadLong
+	mov	(%rsp), %esi
+	mov	%rbp, %rsp
 	lea	4(%r14), %ebp
 	lea	4(%r15), %edi
 	imul	%esi
@@ -683,10 +700,16 @@ macw:
 	mov	%eax, %r13d /* MACL */
 	mov	%ebp, %r14d
 	mov	%edi, %r15d
+	mov	%rsp, %rbp /* Align stack */
+	and	$-16, %rsp
+	sub	$16, %rsp
 	call	MappedMemoryReadWord
-	movswl	%ax, %esi
+	movswl	%ax, %eax
+	mov	%eax, (%rsp) /* %esi is caller-save on x86-64 */
 	mov	%r14d, %edi
 	call	MappedMemoryReadWord
+	mov	(%rsp), %esi
+	mov	%rbp, %rsp
 	movswl	%ax, %eax
 	lea	2(%r14), %ebp
 	lea	2(%r15), %edi
@@ -5231,6 +5231,31 @@ void disassemble_inst(int i)
     }
 }
 
+#ifdef __x86_64__
+// Generated code and linkage_x64.s reach the code cache, hash_table and the
+// other dynarec globals through 32-bit displacements, so the executable is
+// linked position-dependent and the cache must sit at BASE_ADDR. Reserve it
+// without MAP_FIXED so an existing mapping is never replaced.
+static int reserve_code_cache(void)
+{
+  void *cache;
+  if((pointer)&hash_table+sizeof(hash_table)>0x7FFFFFFF) {
+    printf("dynarec: globals above 2GB, executable must be linked with -no-pie\n");
+    return -1;
+  }
+  cache=mmap((void *)BASE_ADDR, 1<<TARGET_SIZE_2,
+             PROT_READ | PROT_WRITE | PROT_EXEC,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(cache==MAP_FAILED) {printf("mmap() failed\n"); return -1;}
+  if(cache!=(void *)BASE_ADDR) {
+    printf("dynarec: code cache unavailable at %x\n",BASE_ADDR);
+    munmap(cache, 1<<TARGET_SIZE_2);
+    return -1;
+  }
+  return 0;
+}
+#endif
+
 void sh2_dynarec_init()
 {
   int n;
@@ -5238,6 +5263,8 @@ void sh2_dynarec_init()
   out=(u8 *)BASE_ADDR;
   #ifdef __arm__
   mprotect(out, 1<<TARGET_SIZE_2, PROT_READ | PROT_WRITE | PROT_EXEC);
+  #elif defined(__x86_64__)
+  // code cache reserved by SH2DynarecInit()
   #else
   if (mmap (out, 1<<TARGET_SIZE_2,
             PROT_READ | PROT_WRITE | PROT_EXEC,
@@ -5259,10 +5286,12 @@ void sh2_dynarec_init()
   expirep=16384; // Expiry pointer, +2 blocks
   literalcount=0;
   stop_after_jal=0;
+  #ifndef __x86_64__
   if (mmap ((void *)0x80000000, 4194304,
             PROT_READ | PROT_WRITE,
             MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS,
             -1, 0) == MAP_FAILED) {printf("mmap() failed\n");}
+  #endif
 
   // This has to be done after BiosRom etc are allocated
   for(n=0;n<1048576;n++) {
@@ -5323,7 +5352,9 @@ void sh2_dynarec_cleanup()
   #ifndef __arm__
   if (munmap ((void *)BASE_ADDR, 1<<TARGET_SIZE_2) < 0) {printf("munmap() failed\n");}
   #endif
+  #ifndef __x86_64__
   munmap ((void *)0x80000000, 4194304);
+  #endif
   for(n=0;n<2048;n++) ll_clear(jump_in+n);
   for(n=0;n<2048;n++) ll_clear(jump_out+n);
   for(n=0;n<2048;n++) ll_clear(jump_dirty+n);
@@ -8225,7 +8256,13 @@ int SH2InterpreterGetInterrupts(SH2_struct *context,
 void SH2InterpreterSetInterrupts(SH2_struct *context, int num_interrupts,
                                  const interrupt_struct interrupts[MAX_INTERRUPTS]);
 
-int SH2DynarecInit(void) {return 0;}
+int SH2DynarecInit(void) {
+  #ifdef __x86_64__
+  return reserve_code_cache();
+  #else
+  return 0;
+  #endif
+}
 
 void SH2DynarecDeInit() {
   sh2_dynarec_cleanup();
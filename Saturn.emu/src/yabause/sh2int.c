@@ -1096,22 +1096,22 @@ static void FASTCALL SH2macl(SH2_struct * sh)
    }
    if(sh->regs.SR.part.S == 1)
    {
+      // saturate the sum to 48 bits, H'FFFF8000 00000000 to H'00007FFF FFFFFFFF,
+      // the same as the dynarec backends
       Res0=sh->regs.MACL+Res0;
       if (sh->regs.MACL>Res0)
          Res2++;
-      if (sh->regs.MACH & 0x00008000);
-      else Res2 += sh->regs.MACH | 0xFFFF0000;
-      Res2+=(sh->regs.MACH&0x0000FFFF);
-      if(((s32)Res2<0)&&(Res2<0xFFFF8000))
+      Res2+=sh->regs.MACH;
+      if((s32)Res2<(s32)0xFFFF8000)
       {
-         Res2=0x00008000;
+         Res2=0xFFFF8000;
          Res0=0x00000000;
       }
-      if(((s32)Res2>0)&&(Res2>0x00007FFF))
+      else if((s32)Res2>0x00007FFF)
       {
          Res2=0x00007FFF;
          Res0=0xFFFFFFFF;
-      };
+      }
 
       sh->regs.MACH=Res2;
       sh->regs.MACL=Res0;
@@ -294,11 +294,18 @@ void TitanPutShadow(int priority, s32 x, s32 y)
 }
 
 void TitanRender(pixel_t * dispbuffer)
+{
+   TitanRenderLines(dispbuffer, 0, tt_context.vdp2height);
+}
+
+void TitanRenderLines(pixel_t * dispbuffer, int start_line, int end_line)
 {
    u32 dot;
    int i;
 
-   for (i = 0; i < (tt_context.vdp2width * tt_context.vdp2height); i++)
+   /* each pixel only touches its own position in the layer buffers,
+      so separate line ranges can be rendered concurrently */
+   for (i = start_line * tt_context.vdp2width; i < (tt_context.vdp2width * end_line); i++)
    {
       dot = TitanDigPixel(7, i);
       if (dot)
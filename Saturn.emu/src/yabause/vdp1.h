@@ -53,6 +53,8 @@ typedef struct
    void (*Vdp2DrawEnd)(void);
    void (*Vdp2DrawScreens)(void);
    void (*GetGlSize)(int *width, int *height);
+   // optional, waits for drawing the core runs asynchronously to finish
+   void (*Sync)(void);
 } VideoInterface_struct;
 
 extern VideoInterface_struct *VIDCore;
@@ -352,6 +352,9 @@ void Vdp2VBlankOUT(void) {
    else
       if (Vdp1Regs->PTMR == 2) Vdp1NoDraw();
 
+   if (VIDCore->Sync)
+      VIDCore->Sync();
+
    FPSDisplay();
    if ((Vdp1Regs->FBCR & 2) && (Vdp1Regs->TVMR & 8))
       Vdp1External.manualerase = 1;
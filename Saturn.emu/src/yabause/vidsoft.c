@@ -39,6 +39,11 @@
 #include <stdlib.h>
 #include <limits.h>
 
+#ifdef VIDSOFT_USE_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 #if defined(__APPLE__)
 // malloc pointers always 16-byte aligned
 #define memalign(align, size) malloc(size)
@@ -102,6 +107,7 @@ void FASTCALL VIDSoftVdp2SetPriorityNBG2(int priority);
 void FASTCALL VIDSoftVdp2SetPriorityNBG3(int priority);
 void FASTCALL VIDSoftVdp2SetPriorityRBG0(int priority);
 void VIDSoftGetGlSize(int *width, int *height);
+void VIDSoftSync(void);
 void VIDSoftVdp1SwapFrameBuffer(void);
 void VIDSoftVdp1EraseFrameBuffer(void);
 
@@ -133,6 +139,7 @@ VIDSoftVdp2DrawStart,
 VIDSoftVdp2DrawEnd,
 VIDSoftVdp2DrawScreens,
 VIDSoftGetGlSize,
+VIDSoftSync,
 };
 
 pixel_t *dispbuffer=NULL;
@@ -642,6 +649,23 @@ static u8 FASTCALL GetAlpha(vdp2draw_struct * info, u32 color)
 
 //////////////////////////////////////////////////////////////////////////////
 
+static int mosaic_table[16][1024];
+
+// filled once at init since layers may be drawn from several threads
+static void InitMosaicTable(void)
+{
+   int i, j;
+
+   for (i = 0; i < 16; i++)
+   {
+      int m = i + 1;
+      for (j = 0; j < 1024; j++)
+         mosaic_table[i][j] = j / m * m;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info)
 {
    int i, j;
@@ -667,22 +691,8 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info)
    ReadLineWindowData(&info->islinewindow, info->wctl, &linewnd0addr, &linewnd1addr);
    /* color calculation window: in => no color calc, out => color calc */
    ReadWindowData(Vdp2Regs->WCTLD >> 8, colorcalcwindow);
-   {
-	   static int tables_initialized = 0;
-	   static int mosaic_table[16][1024];
-	   if(!tables_initialized)
-	   {
-		   tables_initialized = 1;
-			for(i=0;i<16;i++)
-			{
-				int m = i+1;
-				for(j=0;j<1024;j++)
-					mosaic_table[i][j] = j/m*m;
-			}
-	   }
-	   mosaic_x = mosaic_table[info->mosaicxmask-1];
-	   mosaic_y = mosaic_table[info->mosaicymask-1];
-   }
+   mosaic_x = mosaic_table[info->mosaicxmask-1];
+   mosaic_y = mosaic_table[info->mosaicymask-1];
 
    for (j = 0; j < vdp2height; j++)
    {
@@ -1692,6 +1702,222 @@ static void LoadLineParamsSprite(vdp2draw_struct * info, int line)
 
 //////////////////////////////////////////////////////////////////////////////
 
+#ifdef VIDSOFT_USE_THREADS
+
+// VDP2 layers are drawn by a small pool of worker threads while the
+// emulation thread processes the VDP1 command list. Layers only write the
+// Titan buffers of their own priority pair (special priority mode can flip
+// the low bit), so layers are grouped by pair and each group is drawn in the
+// usual order by a single worker. Everything is joined in VIDSoftSync()
+// before Vdp2VBlankOUT() returns, so the emulated side never observes the
+// rendering threads.
+
+#define VIDSOFT_MAX_WORKERS 3
+
+typedef struct
+{
+   pthread_t thread;
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   void (*func)(int);
+   int busy;
+   int quit;
+} vidsoftworker_struct;
+
+static vidsoftworker_struct vidsoftworker[VIDSOFT_MAX_WORKERS];
+static int vidsoftworkers = 0;
+static int vidsoftworkerspending = 0;
+
+// layers assigned to each worker, in drawing order
+static void (*vdp2workerlayers[VIDSOFT_MAX_WORKERS][5])(void);
+static int vdp2workerlayercount[VIDSOFT_MAX_WORKERS];
+
+// lines composited by each worker, the emulation thread takes the last band
+static int titanbandstart[VIDSOFT_MAX_WORKERS + 1];
+
+static void *VIDSoftWorkerThread(void *data)
+{
+   vidsoftworker_struct *worker = (vidsoftworker_struct *)data;
+   int num = worker - vidsoftworker;
+
+   pthread_mutex_lock(&worker->mutex);
+   for (;;)
+   {
+      while (!worker->busy && !worker->quit)
+         pthread_cond_wait(&worker->cond, &worker->mutex);
+      if (worker->quit)
+         break;
+      pthread_mutex_unlock(&worker->mutex);
+      worker->func(num);
+      pthread_mutex_lock(&worker->mutex);
+      worker->busy = 0;
+      pthread_cond_broadcast(&worker->cond);
+   }
+   pthread_mutex_unlock(&worker->mutex);
+   return NULL;
+}
+
+static void VIDSoftWorkerStart(int num, void (*func)(int))
+{
+   vidsoftworker_struct *worker = &vidsoftworker[num];
+
+   pthread_mutex_lock(&worker->mutex);
+   worker->func = func;
+   worker->busy = 1;
+   pthread_cond_broadcast(&worker->cond);
+   pthread_mutex_unlock(&worker->mutex);
+}
+
+static void VIDSoftWorkerWait(int num)
+{
+   vidsoftworker_struct *worker = &vidsoftworker[num];
+
+   pthread_mutex_lock(&worker->mutex);
+   while (worker->busy)
+      pthread_cond_wait(&worker->cond, &worker->mutex);
+   pthread_mutex_unlock(&worker->mutex);
+}
+
+static void VIDSoftInitWorkers(void)
+{
+   long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   int workers = cpus > 1 ? (int)cpus - 1 : 0;
+   int i;
+
+   if (workers > VIDSOFT_MAX_WORKERS)
+      workers = VIDSOFT_MAX_WORKERS;
+
+   for (i = 0; i < workers; i++)
+   {
+      vidsoftworker_struct *worker = &vidsoftworker[i];
+
+      worker->busy = 0;
+      worker->quit = 0;
+      pthread_mutex_init(&worker->mutex, NULL);
+      pthread_cond_init(&worker->cond, NULL);
+      if (pthread_create(&worker->thread, NULL, VIDSoftWorkerThread, worker) != 0)
+      {
+         pthread_cond_destroy(&worker->cond);
+         pthread_mutex_destroy(&worker->mutex);
+         break;
+      }
+   }
+   vidsoftworkers = i;
+   vidsoftworkerspending = 0;
+}
+
+static void VIDSoftDeInitWorkers(void)
+{
+   int i;
+
+   for (i = 0; i < vidsoftworkers; i++)
+   {
+      vidsoftworker_struct *worker = &vidsoftworker[i];
+
+      pthread_mutex_lock(&worker->mutex);
+      worker->quit = 1;
+      pthread_cond_broadcast(&worker->cond);
+      pthread_mutex_unlock(&worker->mutex);
+      pthread_join(worker->thread, NULL);
+      pthread_cond_destroy(&worker->cond);
+      pthread_mutex_destroy(&worker->mutex);
+   }
+   vidsoftworkers = 0;
+   vidsoftworkerspending = 0;
+}
+
+static void Vdp2DrawLayersWorker(int num)
+{
+   int i;
+
+   for (i = 0; i < vdp2workerlayercount[num]; i++)
+      vdp2workerlayers[num][i]();
+}
+
+static void TitanRenderWorker(int num)
+{
+   TitanRenderLines(dispbuffer, titanbandstart[num], titanbandstart[num + 1]);
+}
+
+// Returns 1 if the layers were handed to the workers, 0 if they
+// should be drawn on the calling thread
+static int Vdp2DrawScreensThreaded(void)
+{
+   int pairgroup[4] = { 0, 1, 2, 3 };
+   int groupworker[4] = { -1, -1, -1, -1 };
+   int nextworker = 0;
+   int i;
+
+   if (vidsoftworkers == 0)
+      return 0;
+
+   // NBG0 used as RBG1 shares the rotation line color screens with RBG0,
+   // so keep both (and anything else in their pairs) on the same worker
+   if ((Vdp2Regs->BGON & 0x20) && nbg0priority && rbg0priority)
+   {
+      int from = pairgroup[nbg0priority >> 1];
+      int to = pairgroup[rbg0priority >> 1];
+      for (i = 0; i < 4; i++)
+      {
+         if (pairgroup[i] == from)
+            pairgroup[i] = to;
+      }
+   }
+
+   for (i = 0; i < vidsoftworkers; i++)
+      vdp2workerlayercount[i] = 0;
+
+#define QUEUELAYER(priority, func) \
+   if (priority == i) \
+   { \
+      int group = pairgroup[i >> 1]; \
+      if (groupworker[group] == -1) \
+         groupworker[group] = nextworker++ % vidsoftworkers; \
+      vdp2workerlayers[groupworker[group]][vdp2workerlayercount[groupworker[group]]++] = func; \
+   }
+
+   for (i = 7; i > 0; i--)
+   {
+      QUEUELAYER(nbg3priority, Vdp2DrawNBG3)
+      QUEUELAYER(nbg2priority, Vdp2DrawNBG2)
+      QUEUELAYER(nbg1priority, Vdp2DrawNBG1)
+      QUEUELAYER(nbg0priority, Vdp2DrawNBG0)
+      QUEUELAYER(rbg0priority, Vdp2DrawRBG0)
+   }
+
+#undef QUEUELAYER
+
+   for (i = 0; i < vidsoftworkers; i++)
+   {
+      if (vdp2workerlayercount[i])
+      {
+         VIDSoftWorkerStart(i, Vdp2DrawLayersWorker);
+         vidsoftworkerspending = 1;
+      }
+   }
+
+   return 1;
+}
+
+static void TitanRenderThreaded(void)
+{
+   int bands = vidsoftworkers + 1;
+   int i;
+
+   for (i = 0; i <= bands; i++)
+      titanbandstart[i] = vdp2height * i / bands;
+
+   for (i = 0; i < vidsoftworkers; i++)
+      VIDSoftWorkerStart(i, TitanRenderWorker);
+   TitanRenderLines(dispbuffer, titanbandstart[vidsoftworkers], titanbandstart[bands]);
+   for (i = 0; i < vidsoftworkers; i++)
+      VIDSoftWorkerWait(i);
+}
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+
 int VIDSoftInit(void)
 {
    if (TitanInit() == -1)
@@ -1713,6 +1939,12 @@ int VIDSoftInit(void)
    vdp2width = 320;
    vdp2height = 224;
 
+   InitMosaicTable();
+
+#ifdef VIDSOFT_USE_THREADS
+   VIDSoftInitWorkers();
+#endif
+
 #ifdef USE_OPENGL
    glClear(GL_COLOR_BUFFER_BIT);
 
@@ -1734,6 +1966,10 @@ int VIDSoftInit(void)
 
 void VIDSoftDeInit(void)
 {
+#ifdef VIDSOFT_USE_THREADS
+   VIDSoftDeInitWorkers();
+#endif
+
    if (dispbuffer)
    {
       free(dispbuffer);
@@ -3075,6 +3311,11 @@ void VIDSoftVdp2DrawEnd(void)
          }
       }
    }
+#ifdef VIDSOFT_USE_THREADS
+   if (vidsoftworkers)
+      TitanRenderThreaded();
+   else
+#endif
    TitanRender(dispbuffer);
 
    VIDSoftVdp1SwapFrameBuffer();
@@ -3112,6 +3353,11 @@ void VIDSoftVdp2DrawScreens(void)
    VIDSoftVdp2SetPriorityNBG3((Vdp2Regs->PRINB >> 8) & 0x7);
    VIDSoftVdp2SetPriorityRBG0(Vdp2Regs->PRIR & 0x7);
 
+#ifdef VIDSOFT_USE_THREADS
+   if (Vdp2DrawScreensThreaded())
+      return;
+#endif
+
    for (i = 7; i > 0; i--)
    {   
       if (nbg3priority == i)
@@ -3129,6 +3375,22 @@ void VIDSoftVdp2DrawScreens(void)
 
 //////////////////////////////////////////////////////////////////////////////
 
+void VIDSoftSync(void)
+{
+#ifdef VIDSOFT_USE_THREADS
+   int i;
+
+   if (!vidsoftworkerspending)
+      return;
+
+   for (i = 0; i < vidsoftworkers; i++)
+      VIDSoftWorkerWait(i);
+   vidsoftworkerspending = 0;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void VIDSoftVdp2DrawScreen(int screen)
 {
    VIDSoftVdp2SetResolution(Vdp2Regs->TVMD);
@@ -134,8 +134,10 @@ int YabauseInit(yabauseinit_struct *init)
    // Need to set this first, so init routines see it
    yabsys.UseThreads = init->usethreads;
 
-   // Initialize both cpu's
-   if (SH2Init(init->sh2coretype) != 0)
+   // Initialize both cpu's, falling back to the default core if the
+   // requested one can't start (a dynarec may fail to reserve its code cache)
+   if (SH2Init(init->sh2coretype) != 0 &&
+      (init->sh2coretype == SH2CORE_DEFAULT || SH2Init(SH2CORE_DEFAULT) != 0))
    {
       YabSetError(YAB_ERR_CANNOTINIT, _("SH2"));
       return -1;
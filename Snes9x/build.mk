@@ -9,6 +9,8 @@ endif
 include $(IMAGINE_PATH)/make/imagineAppBase.mk
 
 emuFramework_cheats := 1
+emuFramework_cheatSearch := 1
+emuFramework_rewind := 1
 include $(EMUFRAMEWORK_PATH)/common.mk
 
 snes9xPath := snes9x
@@ -28,6 +30,14 @@ apu/bapu/dsp/sdsp.cpp apu/bapu/dsp/SPC_DSP.cpp \
 apu/bapu/smp/smp.cpp apu/bapu/smp/smp_state.cpp
 # conffile.cpp crosshairs.cpp logger.cpp screenshot.cpp snes9x.cpp
 
+# optionally render PPU line ranges on a worker thread
+snes9xSrc += gfxthread.cpp
+CPPFLAGS += -DGFX_USE_THREADS
+
+ifeq ($(ENV), webos)
+ LDLIBS += -lpthread
+endif
+
 #SRC += jma/7zlzma.cpp unzip/crc32.cpp unzip/iiostrm.cpp \
 jma/inbyte.cpp unzip/jma.cpp unzip/lzma.cpp \
 jma/lzmadec.cpp unzip/s9x-jma.cpp unzip/winout.cpp
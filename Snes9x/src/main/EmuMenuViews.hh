@@ -85,6 +85,23 @@ public:
 	};
 	#endif
 
+	#ifdef GFX_USE_THREADS
+	BoolMenuItem renderThread
+	{
+		"Multithreaded Rendering",
+		[this](BoolMenuItem &item, const Input::Event &e)
+		{
+			if(!S9xSetRenderThread(!item.on))
+			{
+				popup.postError("Requires a multi-core CPU");
+				return;
+			}
+			item.toggle(*this);
+			optionRenderThread = item.on;
+		}
+	};
+	#endif
+
 public:
 	SystemOptionView(Base::Window &win): OptionView(win) {}
 
@@ -94,6 +111,9 @@ public:
 		#ifndef SNES9X_VERSION_1_4
 		blockInvalidVRAMAccess.init(optionBlockInvalidVRAMAccess); item[items++] = &blockInvalidVRAMAccess;
 		#endif
+		#ifdef GFX_USE_THREADS
+		renderThread.init(optionRenderThread); item[items++] = &renderThread;
+		#endif
 	}
 
 	void loadInputItems(MenuItem *item[], uint &items)
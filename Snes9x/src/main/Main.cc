@@ -13,6 +13,9 @@
 #include <memmap.h>
 #include <snapshot.h>
 #include <cheats.h>
+#ifdef CONFIG_EMUFRAMEWORK_CHEAT_SEARCH
+#include <CheatSearch.hh>
+#endif
 
 const char *creditsViewStr = CREDITS_INFO_STRING "(c) 2011-2014\nRobert Broglia\nwww.explusalpha.com\n\n(c) 1996-2011 the\nSnes9x Team\nwww.snes9x.com";
 #ifdef __clang__
@@ -62,13 +65,17 @@ enum
 };
 
 enum {
-	CFGKEY_MULTITAP = 276, CFGKEY_BLOCK_INVALID_VRAM_ACCESS = 277
+	CFGKEY_MULTITAP = 276, CFGKEY_BLOCK_INVALID_VRAM_ACCESS = 277,
+	CFGKEY_RENDER_THREAD = 278
 };
 
 static Byte1Option optionMultitap(CFGKEY_MULTITAP, 0);
 #ifndef SNES9X_VERSION_1_4
 static Byte1Option optionBlockInvalidVRAMAccess(CFGKEY_BLOCK_INVALID_VRAM_ACCESS, 1);
 #endif
+#ifdef GFX_USE_THREADS
+static Byte1Option optionRenderThread(CFGKEY_RENDER_THREAD, 0);
+#endif
 
 #include <CommonGui.hh>
 
@@ -127,6 +134,10 @@ void EmuSystem::onOptionsLoaded()
 	#ifndef SNES9X_VERSION_1_4
 	Settings.BlockInvalidVRAMAccessMaster = optionBlockInvalidVRAMAccess;
 	#endif
+	#ifdef GFX_USE_THREADS
+	if(optionRenderThread && !S9xSetRenderThread(TRUE))
+		optionRenderThread = 0;
+	#endif
 }
 
 bool EmuSystem::readConfig(Io &io, uint key, uint readSize)
@@ -138,6 +149,9 @@ bool EmuSystem::readConfig(Io &io, uint key, uint readSize)
 		#ifndef SNES9X_VERSION_1_4
 		bcase CFGKEY_BLOCK_INVALID_VRAM_ACCESS: optionBlockInvalidVRAMAccess.readFromIO(io, readSize);
 		#endif
+		#ifdef GFX_USE_THREADS
+		bcase CFGKEY_RENDER_THREAD: optionRenderThread.readFromIO(io, readSize);
+		#endif
 	}
 	return 1;
 }
@@ -148,6 +162,9 @@ void EmuSystem::writeConfig(Io *io)
 	#ifndef SNES9X_VERSION_1_4
 	optionBlockInvalidVRAMAccess.writeWithKeyIfNotDefault(io);
 	#endif
+	#ifdef GFX_USE_THREADS
+	optionRenderThread.writeWithKeyIfNotDefault(io);
+	#endif
 }
 
 static bool isROMExtension(const char *name)
@@ -418,6 +435,38 @@ int EmuSystem::loadState(int saveStateSlot)
 	return STATE_RESULT_NO_FILE;
 }
 
+#ifdef CONFIG_EMUFRAMEWORK_REWIND
+static uint32 freezeSize = 0; // fixed for a loaded game, found on first capture
+
+uint EmuSystem::saveStateToMemory(void *buff, uint size)
+{
+	if(!freezeSize)
+		freezeSize = S9xFreezeSize();
+	if(freezeSize > size)
+		return 0;
+	S9xFreezeGameMem((uint8*)buff, freezeSize);
+	return freezeSize;
+}
+
+int EmuSystem::loadStateFromMemory(const void *buff, uint size)
+{
+	if(S9xUnfreezeGameMem((const uint8*)buff, size) != SUCCESS)
+		return STATE_RESULT_INVALID_DATA;
+	IPPU.RenderThisFrame = TRUE;
+	return STATE_RESULT_OK;
+}
+#endif
+
+#ifdef CONFIG_EMUFRAMEWORK_CHEAT_SEARCH
+uint EmuSystem::cheatSearchRegions(CheatSearchRegion *region, uint max)
+{
+	if(!max)
+		return 0;
+	region[0] = {"WRAM", Memory.RAM, 0x7E0000, 0x20000};
+	return 1;
+}
+#endif
+
 void EmuSystem::saveBackupMem() // for manually saving when not closing game
 {
 	if(gameIsRunning())
@@ -615,6 +664,9 @@ static int loadGameCommon()
 	Memory.LoadSRAM(saveStr);
 
 	IPPU.RenderThisFrame = TRUE;
+	#ifdef CONFIG_EMUFRAMEWORK_REWIND
+	freezeSize = 0;
+	#endif
 	EmuSystem::configAudioPlayback();
 	logMsg("finished loading game");
 	return 1;
@@ -187,7 +187,11 @@
 #include "font.h"
 #include "display.h"
 
-extern struct SCheatData		Cheat;
+// threaded mode hooks, left out when gfxthread.cpp compiles the renderer for its worker
+#if defined(GFX_USE_THREADS) && !defined(GFX_THREAD_RENDERER)
+#define GFX_THREAD_HOOKS
+static bool8	OBJLinesChanged = FALSE;	// since the worker last got them
+#endif
 
 void S9xComputeClipWindows (void);
 
@@ -385,8 +389,15 @@ void S9xStartScreenRefresh (void)
 		PPU.RecomputeClipWindows = TRUE;
 		IPPU.PreviousLine = IPPU.CurrentLine = 0;
 
-		memset(GFX.ZBuffer, 0, GFX.ScreenSize);
-		memset(GFX.SubZBuffer, 0, GFX.ScreenSize);
+	#ifdef GFX_THREAD_HOOKS
+		if (S9xRenderThreaded)
+			S9xRenderThreadStartFrame();
+		else
+	#endif
+		{
+			memset(GFX.ZBuffer, 0, GFX.ScreenSize);
+			memset(GFX.SubZBuffer, 0, GFX.ScreenSize);
+		}
 	}
 
 	if (++IPPU.FrameCount % Memory.ROMFramesPerSecond == 0)
@@ -408,6 +419,11 @@ void S9xEndScreenRefresh (void)
 	{
 		FLUSH_REDRAW();
 
+	#ifdef GFX_THREAD_HOOKS
+		if (S9xRenderThreaded)
+			S9xRenderThreadSync();
+	#endif
+
 		if (GFX.DoInterlace && GFX.InterlaceFrame == 0)
 		{
 			S9xControlEOF();
@@ -643,8 +659,71 @@ static inline void RenderScreen (bool8 sub)
 	DrawBackdrop();
 }
 
+#ifdef GFX_THREAD_HOOKS
+// Queues the pending lines for the worker and applies the state changes
+// S9xUpdateScreen() would make, without drawing anything.
+static void UpdateScreenThreaded (void)
+{
+	// OBJ lines are set up here since the RTO flags are needed right away,
+	// the worker gets a copy whenever they changed
+	if (IPPU.OBJChanged || IPPU.InterlaceOBJ)
+		SetupOBJ();
+
+	PPU.RangeTimeOver |= GFX.OBJLines[GFX.EndY].RTOFlags;
+
+	S9xRenderThreadUpdateScreen(OBJLinesChanged);
+	OBJLinesChanged = FALSE;
+
+	GFX.StartY = IPPU.PreviousLine;
+	if ((GFX.EndY = IPPU.CurrentLine - 1) >= PPU.ScreenHeight)
+		GFX.EndY = PPU.ScreenHeight - 1;
+
+	if (!PPU.ForcedBlanking)
+	{
+		PPU.RecomputeClipWindows = FALSE;
+
+		if (Settings.SupportHiRes)
+		{
+			// the worker backs out the low res. speed hacks on its side
+			if (!IPPU.DoubleWidthPixels && (PPU.BGMode == 5 || PPU.BGMode == 6 || IPPU.PseudoHires))
+			{
+			#ifdef USE_OPENGL
+				if (Settings.OpenGLEnable && GFX.RealPPL == 256)
+				{
+					GFX.RealPPL = GFX.Pitch >> 1;
+					GFX.PPL = GFX.RealPPL;
+				}
+			#endif
+
+				IPPU.DoubleWidthPixels = TRUE;
+				IPPU.RenderedScreenWidth = 512;
+			}
+
+			if (!IPPU.DoubleHeightPixels && IPPU.Interlace && (PPU.BGMode == 5 || PPU.BGMode == 6))
+			{
+				IPPU.DoubleHeightPixels = TRUE;
+				IPPU.RenderedScreenHeight = PPU.ScreenHeight << 1;
+				GFX.PPL = GFX.RealPPL << 1;
+				GFX.DoInterlace = 2;
+			}
+		}
+	}
+
+	IPPU.DirectColourMapsNeedRebuild = FALSE;
+	IPPU.PreviousLine = IPPU.CurrentLine;
+}
+#endif
+
 void S9xUpdateScreen (void)
 {
+#ifdef GFX_THREAD_HOOKS
+	if (S9xRenderThreaded)
+	{
+		UpdateScreenThreaded();
+		return;
+	}
+#endif
+
 	if (IPPU.OBJChanged || IPPU.InterlaceOBJ)
 		SetupOBJ();
 
@@ -966,6 +1045,10 @@ static void SetupOBJ (void)
 	}
 
 	IPPU.OBJChanged = FALSE;
+
+#ifdef GFX_THREAD_HOOKS
+	OBJLinesChanged = TRUE;
+#endif
 }
 
 static void DrawOBJS (int D)
@@ -354,6 +354,15 @@ void S9xDisplayMessages (uint16 *, int, int, int, int);
 bool8 S9xSetRenderPixelFormat (int);
 #endif
 
+#ifdef GFX_USE_THREADS
+// deferred rendering on a worker thread, see gfxthread.cpp
+extern bool8	S9xRenderThreaded;
+bool8 S9xSetRenderThread (bool8);
+void S9xRenderThreadStartFrame (void);
+void S9xRenderThreadUpdateScreen (bool8);
+void S9xRenderThreadSync (void);
+#endif
+
 // external port interface which must be implemented or initialised for each port
 bool8 S9xGraphicsInit (void);
 void S9xGraphicsDeinit (void);
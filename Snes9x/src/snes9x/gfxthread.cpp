@@ -0,0 +1,374 @@
+// Deferred PPU rendering on a worker thread.
+//
+// The renderer in tile.cpp, clip.cpp and gfx.cpp is compiled a second time
+// below, inside namespace S9xRender, with PPU, IPPU, GFX and Memory
+// redirected to private copies owned by the worker. In threaded mode
+// S9xUpdateScreen() only snapshots the PPU registers, CGRAM, OAM and the
+// per-line scroll/matrix data of the pending line range into a command, and
+// the worker rasterizes it while the 65816/SPC700 keep running. Ranges are
+// only split where FLUSH_REDRAW() would render them serially, so each one is
+// drawn with exactly the state the serial renderer would have used.
+//
+// VRAM is mirrored at 16 byte granularity. Every VRAM write already clears
+// IPPU.TileCached[TILE_2BIT] for its 2bpp tile, and since the emulation
+// thread never fills its own tile cache in this mode, those flags double as
+// the dirty map: a cleared entry is copied to the worker's VRAM before the
+// next command and then set again.
+//
+// OBJ lines are still set up by the emulation thread, which needs the range
+// time over flags right away, and are passed along whenever they change.
+//
+// The worker only runs while a frame is being drawn, S9xEndScreenRefresh()
+// waits for it before the frame is handed to the port, so state saving,
+// cheats and everything outside the visible lines see no difference.
+
+#ifdef GFX_USE_THREADS
+
+#include <pthread.h>
+#include <unistd.h>
+#include "snes9x.h"
+#include "memmap.h"
+#include "ppu.h"
+#include "tile.h"
+#include "controls.h"
+#include "crosshairs.h"
+#include "cheats.h"
+#include "movie.h"
+#include "screenshot.h"
+#include "font.h"
+#include "display.h"
+
+#define RENDER_QUEUE_SIZE	16
+
+enum
+{
+	RENDER_FRAME_START,
+	RENDER_UPDATE
+};
+
+struct SRenderCommand
+{
+	uint8	Type;
+	uint8	DoInterlace;
+	uint8	InterlaceFrame;
+	bool8	OBJLinesChanged;
+	uint16	*Screen;
+	uint32	RealPPL;
+	uint32	PPL;
+	struct SPPU				PPU;
+	struct InternalPPU		IPPU;
+	uint8					FillRAM[0x100];	// $2100-$21ff
+	struct SLineData		LineData[240];
+	struct SLineMatrixData	LineMatrixData[240];
+	uint8					OBJWidths[128];
+	uint8					OBJVisibleTiles[128];
+	uint8					OBJLines[sizeof(SGFX::OBJLines)];
+};
+
+bool8	S9xRenderThreaded = FALSE;
+
+// state owned by the worker
+static struct SPPU			RPPU;
+static struct InternalPPU	RIPPU;
+static struct SGFX			RGFX;
+static uint16				RDirectColourMaps[8][256];
+static uint8				RVRAM[0x10000];
+static uint8				RFillRAM[0x2200];
+static uint8				*RTileCache[7];
+static uint8				*RTileCached[7];
+
+static struct
+{
+	uint8	*VRAM;
+	uint8	*FillRAM;
+	uint32	ROMFramesPerSecond;
+}	RMemory = { RVRAM, RFillRAM, 60 };
+
+// BG is only written while drawing, so the worker uses the real one
+#define GFX_THREAD_RENDERER
+#define PPU					RPPU
+#define IPPU				RIPPU
+#define GFX					RGFX
+#define Memory				RMemory
+#define DirectColourMaps	RDirectColourMaps
+
+namespace S9xRender
+{
+
+void S9xBuildDirectColourMaps (void);
+void S9xComputeClipWindows (void);
+
+#include "tile.cpp"
+#include "clip.cpp"
+#include "gfx.cpp"
+
+}
+
+#undef PPU
+#undef IPPU
+#undef GFX
+#undef Memory
+#undef DirectColourMaps
+
+static struct SRenderCommand	queue[RENDER_QUEUE_SIZE];
+static uint32					queueHead, queueTail;	// guarded by mutex
+static bool8					threadRunning = FALSE;
+static bool8					OBJLinesPending = FALSE;
+static pthread_t				thread;
+static pthread_mutex_t			mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t			workCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t			doneCond = PTHREAD_COND_INITIALIZER;
+
+static const uint32	tileCacheSize[7] =
+{
+	MAX_2BIT_TILES, MAX_4BIT_TILES, MAX_8BIT_TILES,
+	MAX_2BIT_TILES, MAX_2BIT_TILES, MAX_4BIT_TILES, MAX_4BIT_TILES
+};
+
+static void RunUpdate (const struct SRenderCommand *c)
+{
+	// change flags are cleared by the emulation thread once queued, but the
+	// worker may not consume them in this range (force blank, no direct colour BG)
+	bool8	recomputeClip = RPPU.RecomputeClipWindows || c->PPU.RecomputeClipWindows;
+	bool8	rebuildColourMaps = RIPPU.DirectColourMapsNeedRebuild || c->IPPU.DirectColourMapsNeedRebuild;
+	struct ClipData	clip[2][6];
+
+	memcpy(clip, RIPPU.Clip, sizeof(clip));
+	RPPU = c->PPU;
+	RIPPU = c->IPPU;
+	memcpy(RIPPU.Clip, clip, sizeof(clip));
+	memcpy(RIPPU.TileCache, RTileCache, sizeof(RTileCache));
+	memcpy(RIPPU.TileCached, RTileCached, sizeof(RTileCached));
+	RPPU.RecomputeClipWindows = recomputeClip;
+	RIPPU.DirectColourMapsNeedRebuild = rebuildColourMaps;
+
+	memcpy(RFillRAM + 0x2100, c->FillRAM, sizeof(c->FillRAM));
+	RGFX.Screen = c->Screen;
+	RGFX.RealPPL = c->RealPPL;
+	RGFX.PPL = c->PPL;
+	RGFX.DoInterlace = c->DoInterlace;
+	RGFX.InterlaceFrame = c->InterlaceFrame;
+
+	// earlier lines of the frame are kept since mosaic reads back to its start line
+	int	start = c->IPPU.PreviousLine, end = c->IPPU.CurrentLine;
+	if (end > 240)
+		end = 240;
+	if (end > start)
+	{
+		memcpy(RGFX.LineData + start, c->LineData + start, (end - start) * sizeof(struct SLineData));
+		memcpy(RGFX.LineMatrixData + start, c->LineMatrixData + start, (end - start) * sizeof(struct SLineMatrixData));
+	}
+
+	if (c->OBJLinesChanged)
+	{
+		memcpy(RGFX.OBJWidths, c->OBJWidths, sizeof(c->OBJWidths));
+		memcpy(RGFX.OBJVisibleTiles, c->OBJVisibleTiles, sizeof(c->OBJVisibleTiles));
+		memcpy(RGFX.OBJLines, c->OBJLines, sizeof(c->OBJLines));
+	}
+
+	S9xRender::S9xUpdateScreen();
+}
+
+static void *RenderThread (void *)
+{
+	pthread_mutex_lock(&mutex);
+
+	for (;;)
+	{
+		while (queueTail == queueHead)
+			pthread_cond_wait(&workCond, &mutex);
+
+		struct SRenderCommand	*c = &queue[queueTail % RENDER_QUEUE_SIZE];
+		pthread_mutex_unlock(&mutex);
+
+		if (c->Type == RENDER_FRAME_START)
+		{
+			memset(RGFX.ZBuffer, 0, RGFX.ScreenSize);
+			memset(RGFX.SubZBuffer, 0, RGFX.ScreenSize);
+		}
+		else
+			RunUpdate(c);
+
+		pthread_mutex_lock(&mutex);
+		queueTail++;
+		pthread_cond_signal(&doneCond);
+	}
+
+	return (NULL);
+}
+
+static struct SRenderCommand *AcquireCommand (void)
+{
+	pthread_mutex_lock(&mutex);
+	while (queueHead - queueTail == RENDER_QUEUE_SIZE)
+		pthread_cond_wait(&doneCond, &mutex);
+	pthread_mutex_unlock(&mutex);
+
+	return (&queue[queueHead % RENDER_QUEUE_SIZE]);
+}
+
+static void SubmitCommand (void)
+{
+	pthread_mutex_lock(&mutex);
+	queueHead++;
+	pthread_cond_signal(&workCond);
+	pthread_mutex_unlock(&mutex);
+}
+
+static void SyncVRAM (void)
+{
+	uint8	*dirty = IPPU.TileCached[TILE_2BIT];
+	uint8	*end = dirty + MAX_2BIT_TILES;
+	uint8	*p = (uint8 *) memchr(dirty, 0, MAX_2BIT_TILES);
+
+	if (!p)
+		return;
+
+	// the worker may still be reading the old contents
+	S9xRenderThreadSync();
+
+	for (; p; p = (uint8 *) memchr(p + 1, 0, end - (p + 1)))
+	{
+		uint32	i = p - dirty;
+
+		memcpy(RVRAM + (i << 4), Memory.VRAM + (i << 4), 16);
+		*p = TRUE;
+
+		// same invalidation as the VRAM write handlers in ppu.h
+		RTileCached[TILE_2BIT][i] = FALSE;
+		RTileCached[TILE_4BIT][i >> 1] = FALSE;
+		RTileCached[TILE_8BIT][i >> 2] = FALSE;
+		RTileCached[TILE_2BIT_EVEN][i] = FALSE;
+		RTileCached[TILE_2BIT_EVEN][(i - 1) & (MAX_2BIT_TILES - 1)] = FALSE;
+		RTileCached[TILE_2BIT_ODD] [i] = FALSE;
+		RTileCached[TILE_2BIT_ODD] [(i - 1) & (MAX_2BIT_TILES - 1)] = FALSE;
+		RTileCached[TILE_4BIT_EVEN][i >> 1] = FALSE;
+		RTileCached[TILE_4BIT_EVEN][((i >> 1) - 1) & (MAX_4BIT_TILES - 1)] = FALSE;
+		RTileCached[TILE_4BIT_ODD] [i >> 1] = FALSE;
+		RTileCached[TILE_4BIT_ODD] [((i >> 1) - 1) & (MAX_4BIT_TILES - 1)] = FALSE;
+	}
+}
+
+static bool8 StartThread (void)
+{
+	if (sysconf(_SC_NPROCESSORS_ONLN) < 2)
+		return (FALSE);
+
+	for (int t = 0; t < 7; t++)
+	{
+		RTileCache[t]  = (uint8 *) malloc(tileCacheSize[t] * 64);
+		RTileCached[t] = (uint8 *) calloc(tileCacheSize[t], 1);
+		if (!RTileCache[t] || !RTileCached[t])
+			goto fail;
+	}
+
+	S9xRender::S9xInitTileRenderer();
+
+	if (pthread_create(&thread, NULL, RenderThread, NULL))
+		goto fail;
+
+	threadRunning = TRUE;
+	return (TRUE);
+
+fail:
+	for (int t = 0; t < 7; t++)
+	{
+		free(RTileCache[t]);
+		free(RTileCached[t]);
+		RTileCache[t] = RTileCached[t] = NULL;
+	}
+
+	return (FALSE);
+}
+
+bool8 S9xSetRenderThread (bool8 enable)
+{
+	if (enable == S9xRenderThreaded)
+		return (TRUE);
+
+	if (enable)
+	{
+		if (!threadRunning && !StartThread())
+			return (FALSE);
+
+		memcpy(RGFX.X2, GFX.X2, sizeof(GFX.X2));
+		memcpy(RGFX.ZERO, GFX.ZERO, sizeof(GFX.ZERO));
+		for (int t = 0; t < 7; t++)
+			memset(RTileCached[t], 0, tileCacheSize[t]);
+		RPPU.RecomputeClipWindows = TRUE;
+		RIPPU.DirectColourMapsNeedRebuild = TRUE;
+		OBJLinesPending = TRUE;
+
+		// mirror all of VRAM before the next command
+		memset(IPPU.TileCached[TILE_2BIT], 0, MAX_2BIT_TILES);
+	}
+	else
+	{
+		S9xRenderThreadSync();
+
+		// the tile cache flags tracked VRAM mirroring, and the clip windows
+		// and colour maps were only kept up to date by the worker
+		for (int t = 0; t < 7; t++)
+			memset(IPPU.TileCached[t], 0, tileCacheSize[t]);
+		PPU.RecomputeClipWindows = TRUE;
+		IPPU.DirectColourMapsNeedRebuild = TRUE;
+	}
+
+	S9xRenderThreaded = enable;
+	return (TRUE);
+}
+
+void S9xRenderThreadStartFrame (void)
+{
+	struct SRenderCommand	*c = AcquireCommand();
+
+	c->Type = RENDER_FRAME_START;
+	SubmitCommand();
+}
+
+void S9xRenderThreadUpdateScreen (bool8 objLinesChanged)
+{
+	SyncVRAM();
+
+	struct SRenderCommand	*c = AcquireCommand();
+
+	c->Type = RENDER_UPDATE;
+	c->OBJLinesChanged = objLinesChanged || OBJLinesPending;
+	c->DoInterlace = GFX.DoInterlace;
+	c->InterlaceFrame = GFX.InterlaceFrame;
+	c->Screen = GFX.Screen;
+	c->RealPPL = GFX.RealPPL;
+	c->PPL = GFX.PPL;
+	c->PPU = PPU;
+	c->IPPU = IPPU;
+	memcpy(c->FillRAM, Memory.FillRAM + 0x2100, sizeof(c->FillRAM));
+
+	int	start = IPPU.PreviousLine, end = IPPU.CurrentLine;
+	if (end > 240)
+		end = 240;
+	if (end > start)
+	{
+		memcpy(c->LineData + start, GFX.LineData + start, (end - start) * sizeof(struct SLineData));
+		memcpy(c->LineMatrixData + start, GFX.LineMatrixData + start, (end - start) * sizeof(struct SLineMatrixData));
+	}
+
+	if (c->OBJLinesChanged)
+	{
+		memcpy(c->OBJWidths, GFX.OBJWidths, sizeof(c->OBJWidths));
+		memcpy(c->OBJVisibleTiles, GFX.OBJVisibleTiles, sizeof(c->OBJVisibleTiles));
+		memcpy(c->OBJLines, GFX.OBJLines, sizeof(c->OBJLines));
+		OBJLinesPending = FALSE;
+	}
+
+	SubmitCommand();
+}
+
+void S9xRenderThreadSync (void)
+{
+	pthread_mutex_lock(&mutex);
+	while (queueTail != queueHead)
+		pthread_cond_wait(&doneCond, &mutex);
+	pthread_mutex_unlock(&mutex);
+}
+
+#endif
@@ -133,6 +133,11 @@ void onExit(bool backgrounded);
 // Called on app startup, before the graphics context is initialized
 [[gnu::cold]] CallResult onInit(int argc, char** argv);
 
+// Called on app startup before changing to the app's directory and connecting to the
+// window system (X11 only), if it returns true, onInit() runs without a display
+// and the app exits afterwards
+bool runsHeadless(int argc, char** argv);
+
 } // Base
 
 namespace Config
@@ -30,6 +30,7 @@ public:
 	constexpr Fs() {}
 	virtual uint numEntries() const = 0;
 	virtual const char *entryFilename(uint index) const = 0;
+	virtual int entryType(uint index) const = 0;
 	virtual void closeDir() = 0;
 
 	static int sortMTime(const char *name1, long int mtime1, const char *name2, long int mtime2)
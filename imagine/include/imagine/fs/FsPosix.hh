@@ -35,8 +35,20 @@ public:
 	constexpr FsPosix() {}
 	uint numEntries() const override;
 	const char *entryFilename(uint index) const override;
+	int entryType(uint index) const override;
 	void closeDir() override;
 	CallResult openDir(const char* path, uint flags = 0, FsDirFilterFunc f = nullptr, FsDirSortFunc s = nullptr);
+	// incremental reading, doesn't change the working dir so it's safe off the main thread
+	CallResult beginDir(const char* path);
+	// reads up to maxEntries more entries, returns false once the directory is exhausted
+	bool readDir(uint maxEntries, FsDirFilterFunc f = nullptr);
+	// moves all of other's entries to the end of this list, names stay at the same address
+	bool appendEntries(FsPosix &other);
+	// appends other's entries and merges them in, both lists must be sorted
+	bool mergeEntries(FsPosix &other);
+	void sortEntries();
+	// adds an entry without reading a directory, for listings kept elsewhere
+	bool addEntry(const char *name, int type);
 	static int chdir(const char *dir);
 	static int fileType(const char *path);
 	static uint fileSize(const char *path);
@@ -56,7 +68,19 @@ public:
 	static CallResult changeToAppDir(const char *launchCmd);
 
 private:
-	char **entry = nullptr;
-	int numEntries_ = 0;
+	struct DirEntry
+	{
+		const char *name;
+		uint8 type;
+	};
+	struct NameBlock;
+
+	DirEntry *entry = nullptr;
+	uint numEntries_ = 0, entryCapacity = 0;
+	NameBlock *nameBlock = nullptr; // newest first
+	DIR *dir = nullptr;
 	static int workDirChanged;
+
+	bool reserveEntries(uint count);
+	static bool entryIsLess(const DirEntry &e1, const DirEntry &e2);
 };
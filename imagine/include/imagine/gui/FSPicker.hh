@@ -28,10 +28,15 @@
 #include <imagine/util/DelegateFunc.hh>
 #include <imagine/gui/View.hh>
 #include <imagine/gui/NavView.hh>
+#include <imagine/base/Pipe.hh>
+#include <imagine/util/thread/pthread.hh>
+#include <atomic>
 
 class FSPicker : public View, public GuiTableSource
 {
 public:
+	// also called from the scan thread while a large directory loads, so it
+	// must only look at its arguments
 	FsDirFilterFunc filter = nullptr;
 	ScrollableGuiTable1D tbl;
 	using OnSelectFileDelegate = DelegateFunc<void (FSPicker &picker, const char* name, const Input::Event &e)>;
@@ -45,8 +50,15 @@ public:
 		}
 	};
 	static const bool needsUpDirControl = !Config::envIsPS3;
+	// optional listing source checked before reading a directory, adds the
+	// unsorted entries of path to dir and returns true if it had them
+	using ListDirDelegate = DelegateFunc<bool (const char *path, FsSys &dir)>;
+	ListDirDelegate listDirD;
 
-	FSPicker(Base::Window &win): View(win) {}
+	FSPicker(Base::Window &win): View(win)
+	{
+		clearTextCache();
+	}
 	void init(const char *path, Gfx::BufferImage *backRes, Gfx::BufferImage *closeRes,
 			FsDirFilterFunc filter = 0, bool singleDir = 0, ResourceFace *face = View::defaultFace);
 	void deinit() override;
@@ -57,8 +69,11 @@ public:
 	void onSelectElement(const GuiTable1D *table, const Input::Event &e, uint i) override;
 	OnSelectFileDelegate &onSelectFile() { return onSelectFileD; }
 	OnCloseDelegate &onClose() { return onCloseD; }
+	ListDirDelegate &listDir() { return listDirD; }
 	void onLeftNavBtn(const Input::Event &e);
 	void onRightNavBtn(const Input::Event &e);
+	// selects the first entry, or the first one to arrive if the directory is still loading
+	void highlightFirstEntry();
 	IG::WindowRect &viewRect() { return viewFrame; }
 	void clearSelection()
 	{
@@ -84,8 +99,19 @@ private:
 		void draw(const Base::Window &win) override;
 	};
 
-	TextMenuItem *text = nullptr;
+	// text items are only built for the rows being drawn, indexed by entry % TEXT_CACHE_SIZE
+	static constexpr uint TEXT_CACHE_SIZE = 128;
+	mutable TextMenuItem text[TEXT_CACHE_SIZE];
+	mutable int textEntry[TEXT_CACHE_SIZE]; // -1 when the slot holds no entry
 	FsSys dir;
+	// directories too large to list in one go are finished on a worker
+	// thread that posts sorted batches of entries through scanPipe
+	FsSys scanReader;
+	ThreadPThread scanThread;
+	Base::Pipe scanPipe;
+	std::atomic_bool cancelScan {false};
+	bool scanning = false;
+	bool selectFirstEntry = false;
 	IG::WindowRect viewFrame;
 	ResourceFace *faceRes = nullptr;
 	FSNavView navV {*this};
@@ -93,4 +119,10 @@ private:
 
 	void loadDir(const char *path);
 	void changeDirByInput(const char *path, const Input::Event &e);
+	TextMenuItem &entryText(uint i) const;
+	void clearTextCache();
+	void addEntries(FsSys &batch);
+	void scanEntries();
+	void onScanMessage();
+	void stopScan();
 };
@@ -25,6 +25,8 @@ public:
 	static Io *open(const char *path, const char *pathInZip);
 	~IoZip() { close(); }
 	ssize_t readUpTo(void *buffer, size_t numBytes) override;
+	// stored entries of a memory mapped archive are accessed in place
+	const char *mmapConst() override;
 	size_t fwrite(const void *buffer, size_t size, size_t nmemb) override;
 	CallResult tell(ulong &offset) override;
 	CallResult seek(long offset, uint mode) override;
@@ -33,13 +35,23 @@ public:
 	ulong size() override;
 	void sync() override;
 	int eof() override;
+	// frees the cached central directory indexes
+	static void clearIndexCache();
 
 private:
 	unzFile zip = nullptr;
 	Io *zipIo = nullptr;
 	ulong uncompSize = 0;
+	// entry data inside the mapped archive, null when reading through unzip
+	const uint8 *entryData = nullptr;
+	ulong entryDataSize = 0;
+	ulong entryPos = 0;
+	z_stream *inflater = nullptr; // only used for deflated entries of a mapped archive
+	bool stored = false;
 
 	bool openZipFile(const char *path);
+	bool locateFile(const char *path, const char *pathInZip);
 	bool openFileInZip();
+	bool mapEntryData(ulong dirOffset, const unz_file_info &info);
 	void resetFileInZip();
 };
@@ -21,6 +21,19 @@
 namespace IG
 {
 
+enum class PixelConvertKernel
+{
+	AUTO, // widest SIMD kernel the CPU supports
+	SIMD128, // SSE2 or NEON only
+	SCALAR
+};
+
+// convert a run of pixels between any two PixelFormatDescs
+void convertPixels(const PixelFormatDesc &srcFormat, const void *src,
+	const PixelFormatDesc &destFormat, void *dest, uint pixels,
+	PixelConvertKernel kernel = PixelConvertKernel::AUTO);
+const char *pixelConvertKernelName(PixelConvertKernel kernel);
+
 class PixmapDesc
 {
 public:
@@ -73,6 +86,7 @@ public:
 		init2(data, x, y, x * format.bytesPerPixel);
 	}
 
+	// converts pixels if dest has a different format
 	void copy(int srcX, int srcY, int width, int height, Pixmap &dest, int destX, int destY) const;
 	void clearRect(uint xStart, uint yStart, uint xlen, uint ylen);
 	void initSubPixmap(const Pixmap &orig, uint x, uint y, uint xlen, uint ylen);
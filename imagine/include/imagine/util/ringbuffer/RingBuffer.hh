@@ -16,13 +16,22 @@
 	along with Imagine.  If not, see <http://www.gnu.org/licenses/> */
 
 #include <imagine/util/algorithm.h>
+#include <algorithm>
 #include <atomic>
 #include <cstdlib>
+#include <cstring>
 
+// Single-producer/single-consumer ring buffer. The producer only modifies
+// the write position and the consumer only modifies the read position,
+// each kept on its own cache line, so when COUNT is atomic no locking is
+// needed between the audio callback and the emulation thread.
+// Positions run modulo twice the buffer size to tell full from empty.
 template <class COUNT = std::atomic_uint, class SIZE = unsigned int>
 class StaticRingBuffer
 {
 public:
+	static constexpr SIZE CACHE_LINE_SIZE = 64;
+
 	constexpr StaticRingBuffer() {}
 
 	bool init(SIZE size)
@@ -49,87 +58,81 @@ public:
 
 	void reset()
 	{
-		start = end = buff;
-		written = 0;
+		storePos(readPos, 0);
+		storePos(writePos, 0);
 	}
 
 	SIZE freeSpace() const
 	{
-		return buffSize - written;
+		return buffSize - writtenSize();
 	}
 
 	SIZE freeContiguousSpace() const
 	{
-		return ((uintptr_t)buff + buffSize) - (uintptr_t)end;
+		return std::min(freeSpace(), buffSize - offset(loadPos(writePos)));
 	}
 
 	SIZE writtenSize() const
 	{
-		return written;
+		return distance(loadPos(readPos), loadPos(writePos));
 	}
 
-	SIZE write(const void *buff, SIZE size)
+	SIZE write(const void *data, SIZE size)
 	{
-		if(size > freeSpace())
-			size = freeSpace();
-
-		char *writePos = end;
-		iterateTimes(size, i)
-		{
-			//logMsg("addr %p", writePos);
-			*writePos = ((char*)buff)[i];
-			writePos = advanceAddr(writePos, 1);
-		}
-		end = writePos;
-		written += size;
-
-		assert((SIZE)written <= buffSize);
-
+		SIZE w = loadPos(writePos);
+		SIZE freeBytes = buffSize - distance(loadPos(readPos), w);
+		if(size > freeBytes)
+			size = freeBytes;
+		if(!size)
+			return 0;
+		SIZE off = offset(w);
+		SIZE firstPart = std::min(size, buffSize - off);
+		memcpy(buff + off, data, firstPart);
+		if(firstPart != size)
+			memcpy(buff, (const char*)data + firstPart, size - firstPart);
+		storePos(writePos, wrapPos(w + size));
 		//logMsg("wrote %d bytes", (int)size);
 		return size;
 	}
 
 	char *writeAddr() const
 	{
-		return end;
+		return buff + offset(loadPos(writePos));
 	}
 
 	void commitWrite(SIZE size)
 	{
 		assert(size <= freeSpace());
-		end = advanceAddr(end, size);
-		written += size;
+		storePos(writePos, wrapPos(loadPos(writePos) + size));
 	}
 
-	SIZE read(void *buff, SIZE size)
+	SIZE read(void *data, SIZE size)
 	{
-		if(size > (SIZE)written)
-			size = written;
-
-		char *readPos = start;
-		iterateTimes(size, i)
-		{
-			//logMsg("addr %p", readPos);
-			((char*)buff)[i] = *readPos;
-			readPos = advanceAddr(readPos, 1);
-		}
-		start = readPos;
-		written -= size;
-
+		SIZE r = loadPos(readPos);
+		SIZE avail = distance(r, loadPos(writePos));
+		if(size > avail)
+			size = avail;
+		if(!size)
+			return 0;
+		SIZE off = offset(r);
+		SIZE firstPart = std::min(size, buffSize - off);
+		memcpy(data, buff + off, firstPart);
+		if(firstPart != size)
+			memcpy((char*)data + firstPart, buff, size - firstPart);
+		storePos(readPos, wrapPos(r + size));
 		//logMsg("read %d bytes", (int)size);
 		return size;
 	}
 
 	char *readAddr() const
 	{
-		return start;
+		return buff + offset(loadPos(readPos));
 	}
 
 	void commitRead(SIZE size)
 	{
-		assert(size <= (SIZE)written);
-		start = advanceAddr(start, size);
-		written -= size;
+		assert(size <= writtenSize());
+		storePos(readPos, wrapPos(loadPos(readPos) + size));
 	}
 
 	// given an address inside the ring buffer, return the address
@@ -145,9 +148,34 @@ public:
 
 private:
 	char *buff = nullptr;
-	char *start = nullptr, *end = nullptr;
-	COUNT written {0};
 	SIZE buffSize {0};
+	alignas(CACHE_LINE_SIZE) COUNT readPos {0};
+	alignas(CACHE_LINE_SIZE) COUNT writePos {0};
+	char padding[CACHE_LINE_SIZE - sizeof(COUNT)] {};
+
+	template <class T>
+	static SIZE loadPos(const std::atomic<T> &pos) { return pos.load(std::memory_order_acquire); }
+	template <class T>
+	static SIZE loadPos(const T &pos) { return pos; }
+	template <class T>
+	static void storePos(std::atomic<T> &pos, SIZE val) { pos.store(val, std::memory_order_release); }
+	template <class T>
+	static void storePos(T &pos, SIZE val) { pos = val; }
+
+	SIZE wrapPos(SIZE pos) const
+	{
+		return pos >= buffSize*2 ? pos - buffSize*2 : pos;
+	}
+
+	SIZE offset(SIZE pos) const
+	{
+		return pos >= buffSize ? pos - buffSize : pos;
+	}
+
+	SIZE distance(SIZE r, SIZE w) const
+	{
+		return w >= r ? w - r : w + buffSize*2 - r;
+	}
 };
 
 template <class COUNT = std::atomic_uint, class SIZE = unsigned int>
@@ -311,6 +311,8 @@ void setupScreenSizeFromX11()
 	dispYMM = DisplayHeightMM(dpy, screen);
 }
 
+[[gnu::weak]] bool runsHeadless(int argc, char** argv) { return false; }
+
 }
 
 int main(int argc, char** argv)
@@ -318,6 +320,7 @@ int main(int argc, char** argv)
 	using namespace Base;
 	doOrAbort(logger_init());
 	engineInit();
+	bool headless = runsHeadless(argc, argv);
 
 	#ifdef CONFIG_FS
 	FsSys::changeToAppDir(argv[0]);
@@ -325,6 +328,13 @@ int main(int argc, char** argv)
 
 	initMainEventLoop();
 
+	if(headless)
+	{
+		logMsg("running without a display connection");
+		doOrAbort(onInit(argc, argv));
+		return 0;
+	}
+
 	if(Config::Base::FBDEV_VSYNC)
 	{
 		fbdev = open("/dev/fb0", O_RDONLY);
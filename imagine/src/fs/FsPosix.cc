@@ -22,6 +22,8 @@
 #include <imagine/util/string/generic.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <algorithm>
 
 #ifdef __APPLE__
 #include <imagine/util/string/apple.h>
@@ -57,184 +59,204 @@ static const char* dTypeToString(unsigned char d_type)
 	}
 }
 
-static int fileTypeFromStat(const char *path)
+// follows symlinks and only stats when the dirent type can't be used directly
+static int fileTypeFromDirent(int dirFd, const struct dirent &entry)
 {
+	if(entry.d_type == DT_DIR)
+		return Fs::TYPE_DIR;
+	if(entry.d_type != DT_UNKNOWN && entry.d_type != DT_LNK)
+		return Fs::TYPE_FILE;
 	struct stat s;
-	if(stat(path, &s) == 0)
-	{
-		int type = S_ISDIR(s.st_mode) ? Fs::TYPE_DIR : Fs::TYPE_FILE;
-		//logMsg("stat type of %s is %s", path, type == Fs::TYPE_DIR ? "Dir" : "File");
-		return type;
-	}
-	else
+	if(fstatat(dirFd, entry.d_name, &s, 0) != 0)
 	{
-		logMsg("error in stat");
+		logMsg("error in stat of %s", entry.d_name);
 		return Fs::TYPE_FILE;
 	}
+	return S_ISDIR(s.st_mode) ? Fs::TYPE_DIR : Fs::TYPE_FILE;
 }
 
-static int fileTypeFromSymlink(const char *path)
+bool FsPosix::entryIsLess(const DirEntry &e1, const DirEntry &e2)
 {
-	char deRefPath[512]; int deRefPathSize;
-	if((deRefPathSize = readlink(path, deRefPath, sizeof(deRefPath))) == -1)
-	{
-		logWarn("error in readlink() %s", path);
-		return Fs::TYPE_FILE;
-	}
-	else if(deRefPathSize == sizeof(deRefPath))
-	{
-		logWarn("readlink() buffer too small");
-		return Fs::TYPE_FILE;
-	}
-	else
-	{
-		deRefPath[deRefPathSize] = '\0';
-		//logMsg("using stat on deref symlink %s", deRefPath);
-		return fileTypeFromStat(deRefPath);
-	}
+	return strcasecmp(e1.name, e2.name) < 0;
 }
 
-// NOTE: assumes the working directory is the same as the directory entry being inspected
-static int fileTypeFromDirent(const struct dirent &entry)
+// filenames are packed into blocks that never move, so a name's address
+// stays valid while the entry list grows or is merged into another list
+struct FsPosix::NameBlock
+{
+	static constexpr uint SIZE = 0x4000 - sizeof(NameBlock*) - sizeof(uint);
+	NameBlock *next;
+	uint used;
+	char data[SIZE];
+};
+
+CallResult FsPosix::openDir(const char* path, uint flags, FsDirFilterFunc f, FsDirSortFunc s)
 {
-	if(entry.d_type == DT_UNKNOWN)
+	auto res = beginDir(path);
+	if(res != OK)
+		return res;
+	readDir(UINT_MAX, f);
+	if(s)
 	{
-		//logMsg("type from dir entry unknown, using stat on %s", entry->d_name);
-		struct stat s;
-		if(stat(entry.d_name, &s) == 0)
-		{
-			if(S_ISLNK(s.st_mode))
-			{
-				return fileTypeFromSymlink(entry.d_name);
-			}
-			else
-			{
-				return S_ISDIR(s.st_mode) ? Fs::TYPE_DIR : Fs::TYPE_FILE;
-				//logMsg("stat type of %s is %s", entry->d_name, type == Fs::TYPE_DIR ? "Dir" : "File");
-			}
-		}
-		else
-		{
-			logMsg("error in stat");
-			return Fs::TYPE_FILE;
-		}
+		//std::sort();
 	}
-	else if(entry.d_type == DT_LNK)
+	else if(!(flags & Fs::OPEN_UNSORT))
 	{
-		return fileTypeFromSymlink(entry.d_name);
+		sortEntries();
 	}
-	return entry.d_type == DT_DIR ? Fs::TYPE_DIR : Fs::TYPE_FILE;
+	logMsg("read %u entries", numEntries_);
+	return OK;
 }
 
-/*static int customSorter(const struct dirent **e1, const struct dirent **e2)
-{
-	assert(currentSorter);
-	struct stat s1, s2;
-	stat((*e1)->d_name, &s1);
-	stat((*e2)->d_name, &s2);
-	//logMsg("comparing %s,%ld to %s,%ld", (*e1)->d_name, (long int)s1.st_mtime, (*e2)->d_name, (long int)s2.st_mtime);
-	return currentSorter((*e1)->d_name, s1.st_mtime, (*e2)->d_name, s2.st_mtime);
-}*/
-
-CallResult FsPosix::openDir(const char* path, uint flags, FsDirFilterFunc f, FsDirSortFunc s)
+CallResult FsPosix::beginDir(const char* path)
 {
 	closeDir();
 	logMsg("opening directory %s", path);
-
-	bool switchDirs = !string_equal(path, "."); // save working dir and switch into the new one
-	char prevWorkDir[strlen(workDir()) + 1];
-	if(switchDirs)
-	{
-		strcpy(prevWorkDir, workDir());
-		if(chdir(path) != 0)
-		{
-			logErr("unable to enter %s", path);
-			return INVALID_PARAMETER;
-		}
-	}
-
-	auto dir = opendir(".");
+	dir = opendir(path);
 	if(!dir)
 	{
-		logErr("unable to open directory");
+		logErr("unable to open directory %s", path);
 		return INVALID_PARAMETER;
 	}
+	return OK;
+}
 
+bool FsPosix::readDir(uint maxEntries, FsDirFilterFunc f)
+{
+	if(!dir)
+		return false;
+	FullDirent currEntry;
+	struct dirent *resultEntry;
+	for(uint added = 0; added < maxEntries;)
 	{
-		FullDirent currEntry;
-		struct dirent *resultEntry;
-		while(readdir_r(dir, &currEntry.d, &resultEntry) == 0 && resultEntry)
+		if(readdir_r(dir, &currEntry.d, &resultEntry) != 0 || !resultEntry)
 		{
-			auto &d = currEntry.d;
-			logMsg("reading entry: %s", d.d_name);
-			if(!noDotRefs(d))
-				continue;
-			if(f)
-			{
-				auto type = fileTypeFromDirent(d);
-				if(!f(d.d_name, type))
-					continue;
-			}
-
-			uint nameLen = strlen(d.d_name);
-			entry = (char**)mem_realloc(entry, sizeof(char**) * (numEntries_+1));
-			auto &currEntry = entry[numEntries_];
-			currEntry = (char*)mem_alloc(nameLen + 1);
-			strcpy(currEntry, d.d_name);
-			#ifdef __APPLE__
-			// Precompose all strings for text renderer
-			// TODO: make optional when renderer supports decomposed unicode
-			precomposeUnicodeString(currEntry, currEntry, nameLen+1);
-			#endif
-			numEntries_++;
+			closedir(dir);
+			dir = nullptr;
+			return false;
 		}
+		auto &d = currEntry.d;
+		if(!noDotRefs(d))
+			continue;
+		auto type = fileTypeFromDirent(dirfd(dir), d);
+		if(f && !f(d.d_name, type))
+			continue;
+		if(!addEntry(d.d_name, type))
+		{
+			logErr("out of memory reading directory");
+			closedir(dir);
+			dir = nullptr;
+			return false;
+		}
+		added++;
 	}
+	return true;
+}
 
-	if(s)
-	{
-		//std::sort();
-	}
-	else if(!(flags & Fs::OPEN_UNSORT))
+bool FsPosix::reserveEntries(uint count)
+{
+	if(count <= entryCapacity)
+		return true;
+	uint newCapacity = std::max(entryCapacity * 2, 64u);
+	while(newCapacity < count)
+		newCapacity *= 2;
+	auto newEntry = (DirEntry*)mem_realloc(entry, sizeof(DirEntry) * newCapacity);
+	if(!newEntry)
+		return false;
+	entry = newEntry;
+	entryCapacity = newCapacity;
+	return true;
+}
+
+bool FsPosix::addEntry(const char *name, int type)
+{
+	uint size = strlen(name) + 1;
+	if(!reserveEntries(numEntries_ + 1))
+		return false;
+	if(!nameBlock || nameBlock->used + size > NameBlock::SIZE)
 	{
-		// sort by string value
-		std::sort(entry, &entry[numEntries_],
-			[](const char *s1, const char *s2)
-			{
-				return strcasecmp(s1, s2) < 0;
-			}
-		);
+		auto block = (NameBlock*)mem_alloc(sizeof(NameBlock));
+		if(!block)
+			return false;
+		block->next = nameBlock;
+		block->used = 0;
+		nameBlock = block;
 	}
+	auto str = &nameBlock->data[nameBlock->used];
+	memcpy(str, name, size);
+	#ifdef __APPLE__
+	// Precompose all strings for text renderer
+	// TODO: make optional when renderer supports decomposed unicode
+	precomposeUnicodeString(str, str, size);
+	#endif
+	nameBlock->used += size;
+	entry[numEntries_++] = {str, (uint8)type};
+	return true;
+}
 
-	if(switchDirs) // switch back to original working dir
+bool FsPosix::appendEntries(FsPosix &other)
+{
+	if(!reserveEntries(numEntries_ + other.numEntries_))
+		return false;
+	memcpy(&entry[numEntries_], other.entry, sizeof(DirEntry) * other.numEntries_);
+	numEntries_ += other.numEntries_;
+	other.numEntries_ = 0;
+	if(other.nameBlock)
 	{
-		if(chdir(prevWorkDir) != 0)
-		{
-			// TODO: handle this better
-			logErr("unable to return to %s", prevWorkDir);
-		}
+		auto lastBlock = other.nameBlock;
+		while(lastBlock->next)
+			lastBlock = lastBlock->next;
+		lastBlock->next = nameBlock;
+		nameBlock = other.nameBlock;
+		other.nameBlock = nullptr;
 	}
+	return true;
+}
 
-	closedir(dir);
-	return OK;
+bool FsPosix::mergeEntries(FsPosix &other)
+{
+	uint sortedEntries = numEntries_;
+	if(!appendEntries(other))
+		return false;
+	std::inplace_merge(entry, &entry[sortedEntries], &entry[numEntries_], entryIsLess);
+	return true;
+}
+
+void FsPosix::sortEntries()
+{
+	std::sort(entry, &entry[numEntries_], entryIsLess);
 }
 
 void FsPosix::closeDir()
 {
+	if(dir)
+	{
+		closedir(dir);
+		dir = nullptr;
+	}
+	while(nameBlock)
+	{
+		auto next = nameBlock->next;
+		mem_free(nameBlock);
+		nameBlock = next;
+	}
 	if(entry)
 	{
-		iterateTimes(numEntries_, i)
-		{
-			mem_free(entry[i]);
-		}
 		mem_free(entry);
 		entry = nullptr;
-		numEntries_ = 0;
 	}
+	numEntries_ = 0;
+	entryCapacity = 0;
 }
 
 const char *FsPosix::entryFilename(uint index) const
 {
-	return entry[index];
+	return entry[index].name;
+}
+
+int FsPosix::entryType(uint index) const
+{
+	return entry[index].type;
 }
 
 uint FsPosix::numEntries() const
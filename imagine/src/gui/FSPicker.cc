@@ -17,6 +17,10 @@
 
 #include <imagine/gui/FSPicker.hh>
 
+// entries read on the main thread before handing the rest to the scan thread
+static const uint SYNC_ENTRIES = 256;
+static const uint SCAN_BATCH_ENTRIES = 512;
+
 static const Gfx::LGradientStopDesc fsNavViewGrad[] =
 {
 	{ .0, VertexColorPixelFormat.build(.5, .5, .5, 1.) },
@@ -89,16 +93,23 @@ void FSPicker::init(const char *path, Gfx::BufferImage *backRes, Gfx::BufferImag
 	var_selfs(filter);
 	var_selfs(singleDir);
 	navV.init(face, backRes, closeRes, singleDir);
+	scanPipe.init(
+		[this](Base::Pipe &pipe)
+		{
+			onScanMessage();
+			return 1;
+		});
 	loadDir(path);
 }
 
 void FSPicker::deinit()
 {
+	stopScan();
+	scanPipe.deinit();
 	dir.closeDir();
-	if(text)
+	iterateTimes(TEXT_CACHE_SIZE, i)
 	{
-		mem_free(text);
-		text = nullptr;
+		text[i].deinit();
 	}
 	navV.deinit();
 	tbl.cells = 0;
@@ -106,10 +117,7 @@ void FSPicker::deinit()
 
 void FSPicker::place()
 {
-	iterateTimes(tbl.cells, i)
-	{
-		text[i].compile();
-	}
+	clearTextCache();
 
 	tbl.setYCellSize(faceRes->nominalHeight()*2);
 
@@ -127,8 +135,8 @@ void FSPicker::place()
 void FSPicker::changeDirByInput(const char *path, const Input::Event &e)
 {
 	loadDir(path);
-	if(!e.isPointer() && tbl.cells)
-		tbl.selected = 0;
+	if(!e.isPointer())
+		highlightFirstEntry();
 	place();
 	postDraw();
 }
@@ -180,51 +188,81 @@ void FSPicker::drawElement(const GuiTable1D &table, uint i, Gfx::GCRect rect) co
 {
 	using namespace Gfx;
 	setColor(COLOR_WHITE);
-	text[i].draw(rect.x, rect.pos(C2DO).y, rect.xSize(), rect.ySize(), LC2DO);
+	entryText(i).draw(rect.x, rect.pos(C2DO).y, rect.xSize(), rect.ySize(), LC2DO);
 }
 
 void FSPicker::onSelectElement(const GuiTable1D *table, const Input::Event &e, uint i)
 {
 	assert(i < dir.numEntries());
-	text[i].select(this, e);
+	if(dir.entryType(i) == Fs::TYPE_DIR)
+	{
+		assert(!singleDir);
+		logMsg("going to dir %s", dir.entryFilename(i));
+		changeDirByInput(dir.entryFilename(i), e);
+	}
+	else
+	{
+		onSelectFileD(*this, dir.entryFilename(i), e);
+	}
+}
+
+void FSPicker::highlightFirstEntry()
+{
+	if(tbl.cells)
+		tbl.selected = 0;
+	else
+		selectFirstEntry = scanning;
+}
+
+TextMenuItem &FSPicker::entryText(uint i) const
+{
+	uint slot = i % TEXT_CACHE_SIZE;
+	auto &t = text[slot];
+	if(textEntry[slot] != (int)i)
+	{
+		t.init(dir.entryFilename(i), 1, faceRes);
+		t.compile();
+		textEntry[slot] = i;
+	}
+	return t;
+}
+
+void FSPicker::clearTextCache()
+{
+	iterateTimes(TEXT_CACHE_SIZE, i)
+	{
+		textEntry[i] = -1;
+	}
 }
 
 void FSPicker::loadDir(const char *path)
 {
 	assert(path);
+	stopScan();
 	FsSys::chdir(path);
-	dir.openDir(".", 0, filter);
-	logMsg("%d entries", dir.numEntries());
-	if(dir.numEntries())
+	dir.closeDir();
+	clearTextCache();
+	selectFirstEntry = false;
+	if(listDirD && listDirD(FsSys::workDir(), scanReader))
 	{
-		// TODO free old pointer on failure
-		text = mem_newRealloc(text, dir.numEntries());
-		if(!text)
-		{
-			logMsg("out of memory loading directory");
-			Base::abort(); // TODO: handle without exiting
-		}
-		iterateTimes(dir.numEntries(), i)
-		{
-			text[i].init(dir.entryFilename(i), 1, faceRes);
-			if(FsSys::fileType(dir.entryFilename(i)) == Fs::TYPE_DIR)
-			{
-				text[i].onSelect() = [this, i](TextMenuItem &item, const Input::Event &e)
-					{
-						assert(!singleDir);
-						logMsg("going to dir %s", dir.entryFilename(i));
-						changeDirByInput(dir.entryFilename(i), e);
-					};
-			}
-			else
-			{
-				text[i].onSelect() = [this, i](TextMenuItem &item, const Input::Event &e)
-					{
-						onSelectFileD(*this, dir.entryFilename(i), e);
-					};
-			}
-		}
+		dir.appendEntries(scanReader);
+		dir.sortEntries();
+		scanReader.closeDir();
+	}
+	else if(scanReader.beginDir(FsSys::workDir()) == OK)
+	{
+		// small directories are listed right away, larger ones finish on the scan thread,
+		// which only reads through the directory opened here by absolute path and
+		// stats relative to its fd, so later working dir changes can't affect it
+		bool more = scanReader.readDir(SYNC_ENTRIES, filter);
+		dir.appendEntries(scanReader);
+		dir.sortEntries();
+		if(more)
+			scanEntries();
+		else
+			scanReader.closeDir();
 	}
+	logMsg("%d entries", dir.numEntries());
 	tbl.init(this, dir.numEntries(), *this);
 	#if defined(CONFIG_BASE_IOS) && !defined(CONFIG_BASE_IOS_JB)
 	navV.setTitle("Documents");
@@ -232,3 +270,118 @@ void FSPicker::loadDir(const char *path)
 	navV.setTitle(FsSys::workDir());
 	#endif
 }
+
+void FSPicker::scanEntries()
+{
+	cancelScan = false;
+	scanning = true;
+	if(!scanThread.create(0,
+		[this](ThreadPThread &thread)
+		{
+			bool more = true;
+			while(more && !cancelScan.load(std::memory_order_relaxed))
+			{
+				more = scanReader.readDir(SCAN_BATCH_ENTRIES, filter);
+				if(!scanReader.numEntries())
+					continue;
+				auto batch = new FsSys;
+				if(!batch->appendEntries(scanReader))
+				{
+					// entries stay in the reader for the next batch
+					delete batch;
+					continue;
+				}
+				batch->sortEntries();
+				scanPipe.write(&batch, sizeof(batch));
+			}
+			scanReader.closeDir();
+			FsSys *done = nullptr;
+			scanPipe.write(&done, sizeof(done));
+			return 0;
+		}))
+	{
+		logErr("unable to create scan thread, reading the directory now");
+		scanning = false;
+		scanReader.readDir(UINT_MAX, filter);
+		dir.appendEntries(scanReader);
+		dir.sortEntries();
+		scanReader.closeDir();
+	}
+}
+
+void FSPicker::addEntries(FsSys &batch)
+{
+	// keep the same entry selected as the list grows around it
+	const char *selectedName = tbl.selected >= 0 ? dir.entryFilename(tbl.selected) : nullptr;
+	if(!dir.mergeEntries(batch))
+	{
+		logErr("out of memory adding directory entries");
+		return;
+	}
+	tbl.cells = dir.numEntries();
+	if(selectFirstEntry)
+	{
+		tbl.selected = 0;
+		selectFirstEntry = false;
+	}
+	else if(selectedName)
+	{
+		iterateTimes(dir.numEntries(), i)
+		{
+			if(dir.entryFilename(i) == selectedName)
+			{
+				tbl.selected = i;
+				break;
+			}
+		}
+	}
+}
+
+void FSPicker::onScanMessage()
+{
+	bool addedEntries = false;
+	while(scanPipe.hasData())
+	{
+		FsSys *batch;
+		if(!scanPipe.read(&batch, sizeof(batch)))
+			break;
+		if(!batch)
+		{
+			scanThread.join();
+			scanning = false;
+			selectFirstEntry = false;
+			logMsg("finished reading directory, %d entries", dir.numEntries());
+			continue;
+		}
+		addEntries(*batch);
+		batch->closeDir();
+		delete batch;
+		addedEntries = true;
+	}
+	if(addedEntries)
+	{
+		place();
+		postDraw();
+	}
+}
+
+void FSPicker::stopScan()
+{
+	if(!scanning)
+		return;
+	cancelScan = true;
+	scanThread.join();
+	scanning = false;
+	// drop any batches that weren't picked up
+	while(scanPipe.hasData())
+	{
+		FsSys *batch;
+		if(!scanPipe.read(&batch, sizeof(batch)))
+			break;
+		if(batch)
+		{
+			batch->closeDir();
+			delete batch;
+		}
+	}
+}
@@ -18,6 +18,10 @@
 #include <imagine/io/sys.hh>
 #include <imagine/io/utils.hh>
 #include <imagine/logger/logger.h>
+#include <imagine/mem/mem.h>
+#include <imagine/fs/sys.hh>
+#include <sys/stat.h>
+#include <pthread.h>
 
 
 static voidpf zOpenFunc(voidpf opaque, const char* filename, int mode)
@@ -72,6 +76,150 @@ static int zTesterrorFunc(voidpf opaque, voidpf stream)
 	return 0; // TODO
 }
 
+// Index of an archive's central directory, mapping entry names to the
+// offsets accepted by unzSetOffset() through an open addressed hash table
+// so members are found without scanning the directory on each open
+struct ZipIndex
+{
+	FsSys::cPath path {0};
+	off_t fileSize = 0;
+	time_t mTime = 0;
+	uint lastUse = 0;
+	ulong *dirOffset = nullptr;
+	uint32 *nameOffset = nullptr;
+	uint entries = 0;
+	char *names = nullptr;
+	uint32 *table = nullptr; // entry index + 1, 0 if empty
+	uint tableMask = 0;
+
+	void deinit()
+	{
+		mem_freeSafe(dirOffset);
+		mem_freeSafe(nameOffset);
+		mem_freeSafe(names);
+		mem_freeSafe(table);
+		*this = {};
+	}
+};
+
+static constexpr uint INDEX_CACHE_SIZE = 4;
+static ZipIndex indexCache[INDEX_CACHE_SIZE];
+static uint indexUseCounter = 0;
+// archives may be opened from several threads, held while an index is built or used
+static pthread_mutex_t indexMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32 hashName(const char *name)
+{
+	// FNV-1a
+	uint32 hash = 2166136261u;
+	for(; *name; name++)
+	{
+		hash = (hash ^ (uint8)*name) * 16777619u;
+	}
+	return hash;
+}
+
+static bool buildIndex(unzFile zip, ZipIndex &index)
+{
+	unz_global_info globalInfo;
+	if(unzGetGlobalInfo(zip, &globalInfo) != UNZ_OK)
+		return false;
+	uint entries = globalInfo.number_entry;
+	uint tableSize = 16;
+	while(tableSize < entries * 2)
+		tableSize *= 2;
+	uint namesCapacity = std::max(entries * 32, 256u), namesSize = 0;
+	index.dirOffset = (ulong*)mem_alloc(sizeof(ulong) * std::max(entries, 1u));
+	index.nameOffset = (uint32*)mem_alloc(sizeof(uint32) * std::max(entries, 1u));
+	index.names = (char*)mem_alloc(namesCapacity);
+	index.table = (uint32*)mem_calloc(tableSize, sizeof(uint32));
+	if(!index.dirOffset || !index.nameOffset || !index.names || !index.table)
+		return false;
+	index.tableMask = tableSize - 1;
+	uint i = 0;
+	for(int res = unzGoToFirstFile(zip); res == UNZ_OK && i < entries; res = unzGoToNextFile(zip), i++)
+	{
+		char name[1024];
+		unz_file_info info;
+		if(unzGetCurrentFileInfo(zip, &info, name, sizeof(name), 0, 0, 0, 0) != UNZ_OK)
+			return false;
+		uint nameSize = strlen(name) + 1;
+		if(namesSize + nameSize > namesCapacity)
+		{
+			namesCapacity = std::max(namesCapacity * 2, namesSize + nameSize);
+			auto newNames = (char*)mem_realloc(index.names, namesCapacity);
+			if(!newNames)
+				return false;
+			index.names = newNames;
+		}
+		memcpy(&index.names[namesSize], name, nameSize);
+		index.nameOffset[i] = namesSize;
+		namesSize += nameSize;
+		index.dirOffset[i] = unzGetOffset(zip);
+		// the first entry with a name wins, matching unzLocateFile()
+		for(uint slot = hashName(name) & index.tableMask; ; slot = (slot + 1) & index.tableMask)
+		{
+			if(!index.table[slot])
+			{
+				index.table[slot] = i + 1;
+				break;
+			}
+			if(string_equal(&index.names[index.nameOffset[index.table[slot] - 1]], name))
+				break;
+		}
+	}
+	index.entries = i;
+	return true;
+}
+
+static ZipIndex *indexForArchive(unzFile zip, const char *path)
+{
+	struct stat s;
+	if(stat(path, &s) != 0)
+		return nullptr;
+	ZipIndex *oldest = &indexCache[0];
+	for(auto &index : indexCache)
+	{
+		if(index.entries && string_equal(index.path, path))
+		{
+			if(index.fileSize == s.st_size && index.mTime == s.st_mtime)
+			{
+				index.lastUse = ++indexUseCounter;
+				return &index;
+			}
+			// archive changed on disk, rebuild in this slot
+			oldest = &index;
+			break;
+		}
+		if(index.lastUse < oldest->lastUse)
+			oldest = &index;
+	}
+	auto &index = *oldest;
+	index.deinit();
+	if(!buildIndex(zip, index))
+	{
+		logErr("error indexing %s", path);
+		index.deinit();
+		return nullptr;
+	}
+	string_copy(index.path, path);
+	index.fileSize = s.st_size;
+	index.mTime = s.st_mtime;
+	index.lastUse = ++indexUseCounter;
+	logMsg("indexed %u entries in %s", index.entries, path);
+	return &index;
+}
+
+void IoZip::clearIndexCache()
+{
+	pthread_mutex_lock(&indexMutex);
+	for(auto &index : indexCache)
+	{
+		index.deinit();
+	}
+	pthread_mutex_unlock(&indexMutex);
+}
+
 bool IoZip::openZipFile(const char *path)
 {
 	zipIo = IoSys::open(path);
@@ -100,24 +248,116 @@ bool IoZip::openZipFile(const char *path)
 	return 1;
 }
 
+bool IoZip::locateFile(const char *path, const char *pathInZip)
+{
+	pthread_mutex_lock(&indexMutex);
+	auto index = indexForArchive(zip, path);
+	if(!index)
+	{
+		pthread_mutex_unlock(&indexMutex);
+		return unzLocateFile(zip, pathInZip, 1) == UNZ_OK;
+	}
+	ulong dirOffset = 0;
+	bool found = false;
+	for(uint slot = hashName(pathInZip) & index->tableMask; index->table[slot]; slot = (slot + 1) & index->tableMask)
+	{
+		uint i = index->table[slot] - 1;
+		if(string_equal(&index->names[index->nameOffset[i]], pathInZip))
+		{
+			dirOffset = index->dirOffset[i];
+			found = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&indexMutex);
+	return found && unzSetOffset(zip, dirOffset) == UNZ_OK;
+}
+
+static uint readLE16(const uint8 *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static uint32 readLE32(const uint8 *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32)p[3] << 24);
+}
+
+bool IoZip::mapEntryData(ulong dirOffset, const unz_file_info &info)
+{
+	auto archive = (const uint8*)zipIo->mmapConst();
+	if(!archive || (info.compression_method != 0 && info.compression_method != Z_DEFLATED)
+		|| (info.flag & 1)) // encrypted
+		return false;
+	ulong archiveSize = zipIo->size();
+	// central directory record holds the local header offset
+	if(dirOffset + 46 > archiveSize || readLE32(&archive[dirOffset]) != 0x02014b50)
+		return false;
+	ulong localOffset = readLE32(&archive[dirOffset + 42]);
+	if(localOffset + 30 > archiveSize || readLE32(&archive[localOffset]) != 0x04034b50)
+		return false;
+	ulong dataOffset = localOffset + 30 + readLE16(&archive[localOffset + 26]) + readLE16(&archive[localOffset + 28]);
+	if(dataOffset + info.compressed_size > archiveSize)
+		return false;
+	if(info.compression_method == 0)
+	{
+		if(info.compressed_size != info.uncompressed_size)
+			return false;
+	}
+	else
+	{
+		inflater = new z_stream {};
+		if(inflateInit2(inflater, -MAX_WBITS) != Z_OK)
+		{
+			delete inflater;
+			inflater = nullptr;
+			return false;
+		}
+	}
+	entryData = &archive[dataOffset];
+	entryDataSize = info.compressed_size;
+	entryPos = 0;
+	stored = info.compression_method == 0;
+	if(inflater)
+	{
+		inflater->next_in = (Bytef*)entryData;
+		inflater->avail_in = entryDataSize;
+	}
+	return true;
+}
+
 bool IoZip::openFileInZip()
 {
 	unz_file_info info;
 	unzGetCurrentFileInfo(zip, &info, 0, 0, 0, 0, 0, 0);
 	logMsg("current file size %d, comp method %d", (int)info.uncompressed_size, (int)info.compression_method);
-	// TODO: allow direct IO on files with compression_method == 0
+	uncompSize = info.uncompressed_size;
+	if(mapEntryData(unzGetOffset(zip), info))
+	{
+		logMsg("reading %s entry directly from mapped archive", stored ? "stored" : "deflated");
+		return 1;
+	}
 
 	if(unzOpenCurrentFile(zip) != UNZ_OK)
 	{
 		return 0;
 	}
-
-	uncompSize = info.uncompressed_size;
 	return 1;
 }
 
 void IoZip::resetFileInZip()
 {
+	if(entryData)
+	{
+		entryPos = 0;
+		if(inflater)
+		{
+			inflateReset(inflater);
+			inflater->next_in = (Bytef*)entryData;
+			inflater->avail_in = entryDataSize;
+		}
+		return;
+	}
 	unzCloseCurrentFile(zip);
 	unzOpenCurrentFile(zip);
 }
@@ -138,7 +378,7 @@ Io* IoZip::open(const char *path, const char *pathInZip)
 		return 0;
 	}
 
-	if(unzLocateFile(inst->zip, pathInZip, 1) != UNZ_OK)
+	if(!inst->locateFile(path, pathInZip))
 	{
 		logErr("%s not found in zip", pathInZip);
 		delete inst;
@@ -158,6 +398,17 @@ Io* IoZip::open(const char *path, const char *pathInZip)
 
 void IoZip::close()
 {
+	if(inflater)
+	{
+		inflateEnd(inflater);
+		delete inflater;
+		inflater = nullptr;
+	}
+	// the mapping goes away with zipIo, so mmapConst() and reads can't use it after this
+	entryData = nullptr;
+	entryDataSize = 0;
+	entryPos = 0;
+	stored = false;
 	if(zip)
 	{
 		unzCloseCurrentFile(zip);
@@ -178,12 +429,40 @@ void IoZip::sync() { }
 
 ssize_t IoZip::readUpTo(void* buffer, size_t numBytes)
 {
+	if(entryData)
+	{
+		numBytes = std::min((ulong)numBytes, uncompSize - entryPos);
+		if(!numBytes)
+			return 0;
+		if(stored)
+		{
+			memcpy(buffer, &entryData[entryPos], numBytes);
+			entryPos += numBytes;
+			return numBytes;
+		}
+		// the whole compressed entry is mapped, so inflate straight into the caller's buffer
+		inflater->next_out = (Bytef*)buffer;
+		inflater->avail_out = numBytes;
+		int res = inflate(inflater, Z_SYNC_FLUSH);
+		if(res != Z_OK && res != Z_STREAM_END)
+		{
+			logErr("inflate error %d", res);
+		}
+		ssize_t bytesRead = numBytes - inflater->avail_out;
+		entryPos += bytesRead;
+		return bytesRead;
+	}
 	int bytesRead = unzReadCurrentFile(zip, buffer, numBytes);
 	if(bytesRead < 0)
 		bytesRead = 0;
 	return(bytesRead);
 }
 
+const char *IoZip::mmapConst()
+{
+	return stored ? (const char*)entryData : nullptr;
+}
+
 size_t IoZip::fwrite(const void* ptr, size_t size, size_t nmemb)
 {
 	return 0;
@@ -191,6 +470,11 @@ size_t IoZip::fwrite(const void* ptr, size_t size, size_t nmemb)
 
 CallResult IoZip::tell(ulong &offset)
 {
+	if(entryData)
+	{
+		offset = entryPos;
+		return OK;
+	}
 	long pos = unztell(zip);
 	if(pos >= 0)
 	{
@@ -213,6 +497,16 @@ CallResult IoZip::seek(long offset, uint mode)
 		return INVALID_PARAMETER;
 	}
 	ulong absOffset = offset;
+	if(stored)
+	{
+		if(absOffset > uncompSize)
+		{
+			logErr("illegal seek position");
+			return INVALID_PARAMETER;
+		}
+		entryPos = absOffset;
+		return OK;
+	}
 	ulong bytesToSkip = 0;
 	if(pos > absOffset) // seeking backwards, need to return to start of zip
 	{
@@ -246,5 +540,7 @@ ulong IoZip::size()
 
 int IoZip::eof()
 {
+	if(entryData)
+		return entryPos >= uncompSize;
 	return unzeof(zip);
 }
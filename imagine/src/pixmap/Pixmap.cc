@@ -41,9 +41,23 @@ void Pixmap::copy(int srcX, int srcY, int width, int height, Pixmap &dest, int d
 		assert(dest.format.bytesPerPixel <= format.bytesPerPixel);
 	}
 	//logMsg("copying %s to %s", dest->format->name, format->name);
-	assert(format.id == dest.format.id);
 	char *srcData = getPixel(srcX, srcY);
 	char *destData = dest.getPixel(destX, destY);
+	if(format.id != dest.format.id)
+	{
+		if(!isPadded() && !dest.isPadded() && dest.x == x && dest.x == (uint)width)
+		{
+			convertPixels(format, srcData, dest.format, destData, width * height);
+			return;
+		}
+		iterateTimes(height, i)
+		{
+			convertPixels(format, srcData, dest.format, destData, width);
+			srcData += pitch;
+			destData += dest.pitch;
+		}
+		return;
+	}
 	if(dest.x == x && dest.pitch == pitch && dest.x == (uint)width)
 	{
 		// whole block
@@ -53,7 +67,7 @@ void Pixmap::copy(int srcX, int srcY, int width, int height, Pixmap &dest, int d
 	else
 	{
 		// line at a time
-		for(int y = srcY; y < height; y++)
+		iterateTimes(height, i)
 		{
 			memcpy(destData, srcData, sizeOfPixels(width));
 			srcData += pitch;
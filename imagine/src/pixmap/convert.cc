@@ -0,0 +1,398 @@
+/*  This file is part of Imagine.
+
+	Imagine is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Imagine is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Imagine.  If not, see <http://www.gnu.org/licenses/> */
+
+#define LOGTAG "PixmapConvert"
+#include <imagine/pixmap/Pixmap.hh>
+#include <cstring>
+#if defined __x86_64__ || defined __i386__
+#include <immintrin.h>
+#define PIXMAP_CONVERT_SSE2
+	#ifdef __GNUC__
+	#define PIXMAP_CONVERT_AVX2 // selected at runtime
+	#endif
+#elif defined __ARM_NEON__ || defined __ARM_NEON
+#include <arm_neon.h>
+#define PIXMAP_CONVERT_NEON
+#endif
+
+// Pixels are treated as little-endian words of bytesPerPixel bytes. Formats
+// with all 8-bit components are stored in the byte order of their name
+// (RGBA8888 is R,G,B,A in memory) while the 16-bit packed formats are
+// native shorts, matching how the GL texture code uploads them.
+
+namespace IG
+{
+
+struct ConvertComponent
+{
+	uint srcShift, srcMask;
+	uint mult, multShift; // expands the source bits to 8 by replication
+	uint destTrunc, destShift;
+};
+
+struct ConvertDesc
+{
+	ConvertComponent comp[4];
+	uint components = 0;
+	uint fill = 0; // bits for components missing in the source
+	uint srcBytes = 0, destBytes = 0;
+	bool grayDest = false;
+};
+
+static bool isByteOrdered(const PixelFormatDesc &f)
+{
+	return (!f.rBits || f.rBits == 8) && (!f.gBits || f.gBits == 8)
+		&& (!f.bBits || f.bBits == 8) && (!f.aBits || f.aBits == 8);
+}
+
+static uint laneShift(const PixelFormatDesc &f, uint shift)
+{
+	return isByteOrdered(f) ? f.bitsPerPixel - 8 - shift : shift;
+}
+
+static void expandParams(uint bits, uint &mult, uint &multShift)
+{
+	static const uchar multTable[9] {0, 0xff, 0x55, 0x49, 0x11, 0x21, 0x41, 0x81, 0x01};
+	static const uchar shiftTable[9] {0, 0, 0, 1, 0, 2, 4, 6, 0};
+	mult = multTable[bits];
+	multShift = shiftTable[bits];
+}
+
+static ConvertDesc makeConvertDesc(const PixelFormatDesc &srcFormat, const PixelFormatDesc &destFormat)
+{
+	ConvertDesc d;
+	d.srcBytes = srcFormat.bytesPerPixel;
+	d.destBytes = destFormat.bytesPerPixel;
+	d.grayDest = destFormat.hasColorComponent() && destFormat.isGrayscale();
+	const uchar srcShift[4] {srcFormat.rShift, srcFormat.gShift, srcFormat.bShift, srcFormat.aShift};
+	const uchar srcBits[4] {srcFormat.rBits, srcFormat.gBits, srcFormat.bBits, srcFormat.aBits};
+	const uchar destShift[4] {destFormat.rShift, destFormat.gShift, destFormat.bShift, destFormat.aShift};
+	const uchar destBits[4] {destFormat.rBits, destFormat.gBits, destFormat.bBits, destFormat.aBits};
+	iterateTimes(4, i)
+	{
+		if(!destBits[i])
+			continue;
+		uint trunc = 8 - destBits[i];
+		uint shift = laneShift(destFormat, destShift[i]);
+		if(!srcBits[i])
+		{
+			uint value = i == 3 ? 0xff : 0;
+			d.fill |= (value >> trunc) << shift;
+			continue;
+		}
+		auto &c = d.comp[d.components++];
+		c.srcShift = laneShift(srcFormat, srcShift[i]);
+		c.srcMask = bit_fullMask<uint>(srcBits[i]);
+		expandParams(srcBits[i], c.mult, c.multShift);
+		c.destTrunc = trunc;
+		c.destShift = shift;
+	}
+	return d;
+}
+
+static uint loadWord(const char *p, uint bytes)
+{
+	switch(bytes)
+	{
+		case 1: return (uchar)p[0];
+		case 2: { uint16 v; memcpy(&v, p, 2); return v; }
+		case 3: return (uchar)p[0] | ((uchar)p[1] << 8) | ((uchar)p[2] << 16);
+		default: { uint32 v; memcpy(&v, p, 4); return v; }
+	}
+}
+
+static void storeWord(char *p, uint bytes, uint v)
+{
+	switch(bytes)
+	{
+		case 1: p[0] = v; return;
+		case 2: { uint16 v16 = v; memcpy(p, &v16, 2); return; }
+		case 3: p[0] = v; p[1] = v >> 8; p[2] = v >> 16; return;
+		default: { uint32 v32 = v; memcpy(p, &v32, 4); return; }
+	}
+}
+
+static uint convertWord(const ConvertDesc &d, uint v)
+{
+	uint out = d.fill;
+	iterateTimes(d.components, i)
+	{
+		auto &c = d.comp[i];
+		uint x = ((((v >> c.srcShift) & c.srcMask) * c.mult) >> c.multShift);
+		out |= (x >> c.destTrunc) << c.destShift;
+	}
+	return out;
+}
+
+static void convertScalar(const ConvertDesc &d, const char *src, char *dest, uint pixels)
+{
+	iterateTimes(pixels, i)
+	{
+		storeWord(dest, d.destBytes, convertWord(d, loadWord(src, d.srcBytes)));
+		src += d.srcBytes;
+		dest += d.destBytes;
+	}
+}
+
+static void convertToGrayscale(const PixelFormatDesc &srcFormat, const char *src,
+	const PixelFormatDesc &destFormat, char *dest, uint pixels)
+{
+	// decode to RGBA8888 then weight the color channels into one intensity
+	auto toRGBA = makeConvertDesc(srcFormat, PixelFormatRGBA8888);
+	uint iShift = laneShift(destFormat, destFormat.rShift);
+	uint iTrunc = 8 - destFormat.rBits;
+	uint aShift = laneShift(destFormat, destFormat.aShift);
+	uint aTrunc = 8 - destFormat.aBits;
+	iterateTimes(pixels, i)
+	{
+		uint rgba = convertWord(toRGBA, loadWord(src, toRGBA.srcBytes));
+		uint r = rgba & 0xff, g = (rgba >> 8) & 0xff, b = (rgba >> 16) & 0xff, a = rgba >> 24;
+		uint intensity = (r * 77 + g * 151 + b * 28) >> 8;
+		uint out = (intensity >> iTrunc) << iShift;
+		if(destFormat.aBits)
+			out |= (a >> aTrunc) << aShift;
+		storeWord(dest, destFormat.bytesPerPixel, out);
+		src += srcFormat.bytesPerPixel;
+		dest += destFormat.bytesPerPixel;
+	}
+}
+
+// SIMD kernels handle 2 and 4 byte formats, 8 pixels per iteration for
+// 128-bit vectors and 16 for AVX2, returning the number of pixels done
+
+#ifdef PIXMAP_CONVERT_SSE2
+static __m128i convertLanesSSE2(const ConvertDesc &d, __m128i v)
+{
+	__m128i out = _mm_set1_epi32(d.fill);
+	iterateTimes(d.components, i)
+	{
+		auto &c = d.comp[i];
+		__m128i x = _mm_and_si128(_mm_srl_epi32(v, _mm_cvtsi32_si128(c.srcShift)), _mm_set1_epi32(c.srcMask));
+		// products fit in 16 bits so the low half multiply is exact
+		x = _mm_mullo_epi16(x, _mm_set1_epi32(c.mult));
+		x = _mm_srl_epi32(x, _mm_cvtsi32_si128(c.multShift + c.destTrunc));
+		out = _mm_or_si128(out, _mm_sll_epi32(x, _mm_cvtsi32_si128(c.destShift)));
+	}
+	return out;
+}
+
+static __m128i packLanes16SSE2(__m128i lo, __m128i hi)
+{
+	// sign extend so the signed saturating pack is exact for 16-bit values
+	lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+	hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+	return _mm_packs_epi32(lo, hi);
+}
+
+static uint convertSSE2(const ConvertDesc &d, const char *src, char *dest, uint pixels)
+{
+	uint blocks = pixels / 8;
+	iterateTimes(blocks, i)
+	{
+		__m128i lo, hi;
+		if(d.srcBytes == 2)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)src);
+			lo = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+			hi = _mm_unpackhi_epi16(v, _mm_setzero_si128());
+		}
+		else
+		{
+			lo = _mm_loadu_si128((const __m128i*)src);
+			hi = _mm_loadu_si128((const __m128i*)(src + 16));
+		}
+		lo = convertLanesSSE2(d, lo);
+		hi = convertLanesSSE2(d, hi);
+		if(d.destBytes == 2)
+		{
+			_mm_storeu_si128((__m128i*)dest, packLanes16SSE2(lo, hi));
+		}
+		else
+		{
+			_mm_storeu_si128((__m128i*)dest, lo);
+			_mm_storeu_si128((__m128i*)(dest + 16), hi);
+		}
+		src += 8 * d.srcBytes;
+		dest += 8 * d.destBytes;
+	}
+	return blocks * 8;
+}
+#endif
+
+#ifdef PIXMAP_CONVERT_AVX2
+__attribute__((target("avx2")))
+static __m256i convertLanesAVX2(const ConvertDesc &d, __m256i v)
+{
+	__m256i out = _mm256_set1_epi32(d.fill);
+	iterateTimes(d.components, i)
+	{
+		auto &c = d.comp[i];
+		__m256i x = _mm256_and_si256(_mm256_srl_epi32(v, _mm_cvtsi32_si128(c.srcShift)), _mm256_set1_epi32(c.srcMask));
+		x = _mm256_mullo_epi16(x, _mm256_set1_epi32(c.mult));
+		x = _mm256_srl_epi32(x, _mm_cvtsi32_si128(c.multShift + c.destTrunc));
+		out = _mm256_or_si256(out, _mm256_sll_epi32(x, _mm_cvtsi32_si128(c.destShift)));
+	}
+	return out;
+}
+
+__attribute__((target("avx2")))
+static uint convertAVX2(const ConvertDesc &d, const char *src, char *dest, uint pixels)
+{
+	uint blocks = pixels / 16;
+	iterateTimes(blocks, i)
+	{
+		__m256i lo, hi;
+		if(d.srcBytes == 2)
+		{
+			lo = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)src));
+			hi = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src + 16)));
+		}
+		else
+		{
+			lo = _mm256_loadu_si256((const __m256i*)src);
+			hi = _mm256_loadu_si256((const __m256i*)(src + 32));
+		}
+		lo = convertLanesAVX2(d, lo);
+		hi = convertLanesAVX2(d, hi);
+		if(d.destBytes == 2)
+		{
+			// pack works within 128-bit halves, reorder the 64-bit quarters afterwards
+			__m256i packed = _mm256_packus_epi32(lo, hi);
+			_mm256_storeu_si256((__m256i*)dest, _mm256_permute4x64_epi64(packed, 0xD8));
+		}
+		else
+		{
+			_mm256_storeu_si256((__m256i*)dest, lo);
+			_mm256_storeu_si256((__m256i*)(dest + 32), hi);
+		}
+		src += 16 * d.srcBytes;
+		dest += 16 * d.destBytes;
+	}
+	return blocks * 16;
+}
+
+static bool hasAVX2()
+{
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2;
+}
+#endif
+
+#ifdef PIXMAP_CONVERT_NEON
+static uint32x4_t convertLanesNEON(const ConvertDesc &d, uint32x4_t v)
+{
+	uint32x4_t out = vdupq_n_u32(d.fill);
+	iterateTimes(d.components, i)
+	{
+		auto &c = d.comp[i];
+		uint32x4_t x = vandq_u32(vshlq_u32(v, vdupq_n_s32(-(int)c.srcShift)), vdupq_n_u32(c.srcMask));
+		x = vmulq_u32(x, vdupq_n_u32(c.mult));
+		x = vshlq_u32(x, vdupq_n_s32(-(int)(c.multShift + c.destTrunc)));
+		out = vorrq_u32(out, vshlq_u32(x, vdupq_n_s32(c.destShift)));
+	}
+	return out;
+}
+
+static uint convertNEON(const ConvertDesc &d, const char *src, char *dest, uint pixels)
+{
+	uint blocks = pixels / 8;
+	iterateTimes(blocks, i)
+	{
+		uint32x4_t lo, hi;
+		if(d.srcBytes == 2)
+		{
+			uint16x8_t v = vld1q_u16((const uint16_t*)src);
+			lo = vmovl_u16(vget_low_u16(v));
+			hi = vmovl_u16(vget_high_u16(v));
+		}
+		else
+		{
+			lo = vld1q_u32((const uint32_t*)src);
+			hi = vld1q_u32((const uint32_t*)(src + 16));
+		}
+		lo = convertLanesNEON(d, lo);
+		hi = convertLanesNEON(d, hi);
+		if(d.destBytes == 2)
+		{
+			vst1q_u16((uint16_t*)dest, vcombine_u16(vmovn_u32(lo), vmovn_u32(hi)));
+		}
+		else
+		{
+			vst1q_u32((uint32_t*)dest, lo);
+			vst1q_u32((uint32_t*)(dest + 16), hi);
+		}
+		src += 8 * d.srcBytes;
+		dest += 8 * d.destBytes;
+	}
+	return blocks * 8;
+}
+#endif
+
+static bool isSIMDSize(uint bytes)
+{
+	return bytes == 2 || bytes == 4;
+}
+
+void convertPixels(const PixelFormatDesc &srcFormat, const void *srcPtr,
+	const PixelFormatDesc &destFormat, void *destPtr, uint pixels, PixelConvertKernel kernel)
+{
+	auto src = (const char*)srcPtr;
+	auto dest = (char*)destPtr;
+	if(srcFormat.id == destFormat.id)
+	{
+		memcpy(dest, src, pixels * srcFormat.bytesPerPixel);
+		return;
+	}
+	auto d = makeConvertDesc(srcFormat, destFormat);
+	if(d.grayDest)
+	{
+		convertToGrayscale(srcFormat, src, destFormat, dest, pixels);
+		return;
+	}
+	uint done = 0;
+	if(kernel != PixelConvertKernel::SCALAR && isSIMDSize(d.srcBytes) && isSIMDSize(d.destBytes))
+	{
+		#ifdef PIXMAP_CONVERT_AVX2
+		if(kernel != PixelConvertKernel::SIMD128 && hasAVX2())
+			done = convertAVX2(d, src, dest, pixels);
+		#endif
+		#ifdef PIXMAP_CONVERT_SSE2
+		done += convertSSE2(d, src + done * d.srcBytes, dest + done * d.destBytes, pixels - done);
+		#endif
+		#ifdef PIXMAP_CONVERT_NEON
+		done = convertNEON(d, src, dest, pixels);
+		#endif
+	}
+	convertScalar(d, src + done * d.srcBytes, dest + done * d.destBytes, pixels - done);
+}
+
+const char *pixelConvertKernelName(PixelConvertKernel kernel)
+{
+	if(kernel == PixelConvertKernel::SCALAR)
+		return "scalar";
+	#ifdef PIXMAP_CONVERT_AVX2
+	if(kernel != PixelConvertKernel::SIMD128 && hasAVX2())
+		return "avx2";
+	#endif
+	#ifdef PIXMAP_CONVERT_SSE2
+	return "sse2";
+	#elif defined PIXMAP_CONVERT_NEON
+	return "neon";
+	#else
+	return "scalar";
+	#endif
+}
+
+}